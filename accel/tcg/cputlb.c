@@ -306,6 +306,19 @@ void tlb_flush_counts(size_t *pfull, size_t *ppart, size_t *pelide)
     *pelide = elide;
 }
 
+size_t tlb_fill_count(void)
+{
+    CPUState *cpu;
+    size_t fill = 0;
+
+    CPU_FOREACH(cpu) {
+        CPUArchState *env = cpu->env_ptr;
+
+        fill += atomic_read(&env_tlb(env)->c.fill_count);
+    }
+    return fill;
+}
+
 static void tlb_flush_by_mmuidx_async_work(CPUState *cpu, run_on_cpu_data data)
 {
     CPUArchState *env = cpu->env_ptr;
@@ -1008,8 +1021,11 @@ static void tlb_fill(CPUState *cpu, target_ulong addr, int size,
                      MMUAccessType access_type, int mmu_idx, uintptr_t retaddr)
 {
     CPUClass *cc = CPU_GET_CLASS(cpu);
+    CPUArchState *env = cpu->env_ptr;
     bool ok;
 
+    atomic_set(&env_tlb(env)->c.fill_count, env_tlb(env)->c.fill_count + 1);
+
     /*
      * This is not a probe, so only valid return is success; failure
      * should result in exception + longjmp to the cpu loop.
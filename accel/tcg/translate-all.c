@@ -2347,6 +2347,7 @@ void dump_exec_info(void)
     qemu_printf("TLB full flushes    %zu\n", flush_full);
     qemu_printf("TLB partial flushes %zu\n", flush_part);
     qemu_printf("TLB elided flushes  %zu\n", flush_elide);
+    qemu_printf("TLB fills           %zu\n", tlb_fill_count());
     tcg_dump_info();
 }
 
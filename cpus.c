@@ -129,6 +129,11 @@ static bool all_cpu_threads_idle(void)
 /* Protected by TimersState seqlock */
 
 static bool icount_sleep = true;
+static bool idle_warp;
+/* Arbitrarily limit the clock scale to 1/1000 .. 1000 times host time.  */
+#define CLOCK_SCALE_ONE 1000000
+#define CLOCK_SCALE_MIN (CLOCK_SCALE_ONE / 1000)
+#define CLOCK_SCALE_MAX (CLOCK_SCALE_ONE * 1000ULL)
 /* Arbitrarily pick 1MIPS as the minimum allowable speed.  */
 #define MAX_ICOUNT_SHIFT 10
 
@@ -154,6 +159,14 @@ typedef struct TimersState {
     int64_t vm_clock_warp_start;
     int64_t cpu_clock_offset;
 
+    /* Scale of QEMU_CLOCK_VIRTUAL relative to host time without icount,
+     * in millionths (0 meaning unscaled), and the host and scaled time of
+     * the last scale change.
+     */
+    uint32_t clock_scale;
+    int64_t clock_scale_base_host;
+    int64_t clock_scale_base;
+
     /* Only written by TCG thread */
     int64_t qemu_icount;
 
@@ -295,13 +308,25 @@ int64_t cpu_get_ticks(void)
     return ticks;
 }
 
+/* Scale the given host time, continuous across changes of the scale */
+static int64_t cpu_scale_clock_locked(int64_t host)
+{
+    if (!timers_state.clock_scale) {
+        return host;
+    }
+
+    return timers_state.clock_scale_base +
+           muldiv64(host - timers_state.clock_scale_base_host,
+                    timers_state.clock_scale, CLOCK_SCALE_ONE);
+}
+
 static int64_t cpu_get_clock_locked(void)
 {
     int64_t time;
 
     time = timers_state.cpu_clock_offset;
     if (timers_state.cpu_ticks_enabled) {
-        time += get_clock();
+        time += cpu_scale_clock_locked(get_clock());
     }
 
     return time;
@@ -332,7 +357,7 @@ void cpu_enable_ticks(void)
                        &timers_state.vm_clock_lock);
     if (!timers_state.cpu_ticks_enabled) {
         timers_state.cpu_ticks_offset -= cpu_get_host_ticks();
-        timers_state.cpu_clock_offset -= get_clock();
+        timers_state.cpu_clock_offset -= cpu_scale_clock_locked(get_clock());
         timers_state.cpu_ticks_enabled = 1;
     }
     seqlock_write_unlock(&timers_state.vm_clock_seqlock,
@@ -505,12 +530,172 @@ void qtest_clock_warp(int64_t dest)
     qemu_clock_notify(QEMU_CLOCK_VIRTUAL);
 }
 
+/* Advance QEMU_CLOCK_VIRTUAL to the next timer deadline while all vCPUs
+ * are idle. This is the counterpart of icount sleep=off without icount.
+ */
+static void idle_warp_start(void)
+{
+    int64_t deadline;
+
+    if (!runstate_is_running() || !all_cpu_threads_idle() || qtest_enabled()) {
+        return;
+    }
+
+    deadline = qemu_clock_deadline_ns_all(QEMU_CLOCK_VIRTUAL,
+                                          ~QEMU_TIMER_ATTR_EXTERNAL);
+    if (deadline > 0) {
+        seqlock_write_lock(&timers_state.vm_clock_seqlock,
+                           &timers_state.vm_clock_lock);
+        timers_state.cpu_clock_offset += deadline;
+        seqlock_write_unlock(&timers_state.vm_clock_seqlock,
+                             &timers_state.vm_clock_lock);
+        qemu_clock_notify(QEMU_CLOCK_VIRTUAL);
+    } else if (deadline == 0) {
+        qemu_clock_notify(QEMU_CLOCK_VIRTUAL);
+    }
+}
+
+int64_t cpu_clock_skip_to(int64_t dest)
+{
+    int64_t skip, deadline;
+
+    if (use_icount || !runstate_is_running() || qtest_enabled()
+        || replay_mode != REPLAY_MODE_NONE) {
+        return 0;
+    }
+
+    /* do not skip past any other timer */
+    skip = dest - qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    deadline = qemu_clock_deadline_ns_all(QEMU_CLOCK_VIRTUAL,
+                                          QEMU_TIMER_ATTR_ALL);
+    if (deadline >= 0 && deadline < skip) {
+        skip = deadline;
+    }
+
+    if (skip > 0) {
+        seqlock_write_lock(&timers_state.vm_clock_seqlock,
+                           &timers_state.vm_clock_lock);
+        timers_state.cpu_clock_offset += skip;
+        seqlock_write_unlock(&timers_state.vm_clock_seqlock,
+                             &timers_state.vm_clock_lock);
+    }
+
+    /*
+     * The expired timers are run by the main loop, not from within the
+     * caller's device access. Leave the execution loop so that the vCPU
+     * sees their effects (e.g. interrupts) before continuing.
+     */
+    qemu_clock_notify(QEMU_CLOCK_VIRTUAL);
+    if (current_cpu) {
+        cpu_exit(current_cpu);
+    }
+
+    return MAX(skip, 0);
+}
+
+void cpu_icount_stall(CPUState *cpu, int64_t count)
+{
+    int64_t n;
+
+    if (!use_icount || count <= 0) {
+        return;
+    }
+
+    /* Taken from the budget of the current execution as if executed, so that
+     * it still ends at the next timer deadline.
+     */
+    n = MIN(count, cpu->icount_extra);
+    cpu->icount_extra -= n;
+    count -= n;
+
+    n = MIN(count, cpu_neg(cpu)->icount_decr.u16.low);
+    cpu_neg(cpu)->icount_decr.u16.low -= n;
+    count -= n;
+
+    /* The budget is exhausted, the execution ends after the current block */
+    if (count) {
+        seqlock_write_lock(&timers_state.vm_clock_seqlock,
+                           &timers_state.vm_clock_lock);
+        atomic_set_i64(&timers_state.qemu_icount,
+                       timers_state.qemu_icount + count);
+        seqlock_write_unlock(&timers_state.vm_clock_seqlock,
+                             &timers_state.vm_clock_lock);
+    }
+}
+
+int64_t cpu_icount_insn_ns(void)
+{
+    /* the shift is adjusted at runtime with shift=auto */
+    return use_icount == 1 ? cpu_icount_to_ns(1) : 0;
+}
+
+void cpu_set_idle_warp(bool enable)
+{
+    idle_warp = enable;
+    qemu_notify_event();
+}
+
+bool cpu_get_idle_warp(void)
+{
+    return idle_warp;
+}
+
+bool cpu_set_clock_scale(double scale)
+{
+    int64_t now;
+
+    if (use_icount || scale * CLOCK_SCALE_ONE < CLOCK_SCALE_MIN
+        || scale * CLOCK_SCALE_ONE > CLOCK_SCALE_MAX) {
+        return false;
+    }
+
+    seqlock_write_lock(&timers_state.vm_clock_seqlock,
+                       &timers_state.vm_clock_lock);
+    now = get_clock();
+    timers_state.clock_scale_base = cpu_scale_clock_locked(now);
+    timers_state.clock_scale_base_host = now;
+    timers_state.clock_scale = (uint32_t)(scale * CLOCK_SCALE_ONE + 0.5);
+    seqlock_write_unlock(&timers_state.vm_clock_seqlock,
+                         &timers_state.vm_clock_lock);
+
+    /* timer deadlines have to be re-evaluated with the new scale */
+    qemu_clock_notify(QEMU_CLOCK_VIRTUAL);
+    return true;
+}
+
+double cpu_get_clock_scale(void)
+{
+    uint32_t scale = atomic_read(&timers_state.clock_scale);
+
+    return scale ? (double)scale / CLOCK_SCALE_ONE : 1.0;
+}
+
+int64_t cpu_clock_deadline_to_host(int64_t ns)
+{
+    uint32_t scale = atomic_read(&timers_state.clock_scale);
+
+    if (ns <= 0 || !scale || scale == CLOCK_SCALE_ONE) {
+        return ns;
+    }
+
+    /* waking up early is harmless, so do not bother with huge deadlines */
+    if (scale < CLOCK_SCALE_ONE && ns > INT64_MAX / CLOCK_SCALE_ONE) {
+        return ns;
+    }
+
+    /* round up so that the timer has expired once we wake up */
+    return muldiv64(ns, CLOCK_SCALE_ONE, scale) + 1;
+}
+
 void qemu_start_warp_timer(void)
 {
     int64_t clock;
     int64_t deadline;
 
     if (!use_icount) {
+        if (idle_warp) {
+            idle_warp_start();
+        }
         return;
     }
 
@@ -693,6 +878,48 @@ static const VMStateDescription icount_vmstate_timers = {
     }
 };
 
+static bool clock_scale_needed(void *opaque)
+{
+    TimersState *s = opaque;
+    return s->clock_scale && s->clock_scale != CLOCK_SCALE_ONE;
+}
+
+static int clock_scale_post_load(void *opaque, int version_id)
+{
+    TimersState *s = opaque;
+    int64_t now;
+
+    if (use_icount || s->clock_scale < CLOCK_SCALE_MIN
+        || s->clock_scale > CLOCK_SCALE_MAX) {
+        return -EINVAL;
+    }
+
+    /* The clock is stopped while loading, cpu_clock_offset holds its value.
+     * Rebase the scaled time on the host clock of this instance.
+     */
+    seqlock_write_lock(&s->vm_clock_seqlock, &s->vm_clock_lock);
+    now = get_clock();
+    s->clock_scale_base_host = now;
+    s->clock_scale_base = now;
+    seqlock_write_unlock(&s->vm_clock_seqlock, &s->vm_clock_lock);
+    return 0;
+}
+
+/*
+ * This is a subsection for the scale of QEMU_CLOCK_VIRTUAL without icount.
+ */
+static const VMStateDescription vmstate_clock_scale = {
+    .name = "timer/clock_scale",
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .needed = clock_scale_needed,
+    .post_load = clock_scale_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(clock_scale, TimersState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
 static const VMStateDescription vmstate_timers = {
     .name = "timer",
     .version_id = 2,
@@ -705,6 +932,7 @@ static const VMStateDescription vmstate_timers = {
     },
     .subsections = (const VMStateDescription*[]) {
         &icount_vmstate_timers,
+        &vmstate_clock_scale,
         NULL
     }
 };
@@ -1200,6 +1428,10 @@ static void qemu_wait_io_event(CPUState *cpu)
             slept = true;
             qemu_plugin_vcpu_idle_cb(cpu);
         }
+        if (idle_warp && all_cpu_threads_idle()) {
+            /* wake up the main loop to warp the clock, see idle_warp_start */
+            qemu_notify_event();
+        }
         qemu_cond_wait(cpu->halt_cond, &qemu_global_mutex);
     }
     if (slept) {
@@ -1535,7 +1767,7 @@ static void *qemu_tcg_rr_cpu_thread_fn(void *arg)
             atomic_mb_set(&cpu->exit_request, 0);
         }
 
-        if (use_icount && all_cpu_threads_idle()) {
+        if ((use_icount || idle_warp) && all_cpu_threads_idle()) {
             /*
              * When all cpus are sleeping (e.g in WFI), to avoid a deadlock
              * in the main_loop, wake it up in order to start the warp timer.
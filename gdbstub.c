@@ -41,9 +41,15 @@
 #include "exec/gdbstub.h"
 #include "hw/cpu/cluster.h"
 #include "hw/boards.h"
+#include "exec/address-spaces.h"
+#include "qemu/rcu.h"
 #endif
 
-#define MAX_PACKET_LENGTH 4096
+/*
+ * Large enough that binary downloads of a few MiB are not dominated by the
+ * per-packet round trip.
+ */
+#define MAX_PACKET_LENGTH 0x20000
 
 #include "qemu/sockets.h"
 #include "sysemu/hw_accel.h"
@@ -1778,6 +1784,52 @@ static void handle_write_mem(GdbCmdContext *gdb_ctx, void *user_ctx)
     put_packet("OK");
 }
 
+/*
+ * Return the binary data following the first ':' at or after @start in the
+ * current packet. The data may contain NUL bytes, so its length is taken
+ * from the received packet rather than from the parsed parameters.
+ */
+static const char *gdb_binary_data(const char *start, size_t *len)
+{
+    const char *end = gdbserver_state.line_buf + gdbserver_state.line_buf_index;
+    const char *p = memchr(start, ':', end - start);
+
+    if (!p) {
+        return NULL;
+    }
+
+    *len = end - (p + 1);
+    return p + 1;
+}
+
+static void handle_write_mem_binary(GdbCmdContext *gdb_ctx, void *user_ctx)
+{
+    const char *data;
+    size_t len;
+
+    if (gdb_ctx->num_params != 2) {
+        put_packet("E22");
+        return;
+    }
+
+    data = gdb_binary_data(gdbserver_state.line_buf, &len);
+    if (!data || gdb_ctx->params[1].val_ull > len) {
+        put_packet("E22");
+        return;
+    }
+
+    /* a zero length write is used by gdb to probe for X support */
+    if (gdb_ctx->params[1].val_ull &&
+        target_memory_rw_debug(gdbserver_state.g_cpu, gdb_ctx->params[0].val_ull,
+                               (uint8_t *)data, gdb_ctx->params[1].val_ull,
+                               true)) {
+        put_packet("E14");
+        return;
+    }
+
+    put_packet("OK");
+}
+
 static void handle_read_mem(GdbCmdContext *gdb_ctx, void *user_ctx)
 {
     if (gdb_ctx->num_params != 2) {
@@ -1939,6 +1991,143 @@ static void handle_v_kill(GdbCmdContext *gdb_ctx, void *user_ctx)
     exit(0);
 }
 
+#ifndef CONFIG_USER_ONLY
+typedef struct GDBFlashRegion {
+    hwaddr base;
+    uint64_t size;
+    uint32_t blocksize;
+    const GDBFlashOps *ops;
+    void *opaque;
+} GDBFlashRegion;
+
+/*
+ * Kept outside of gdbserver_state, which is only set up once the gdbserver
+ * is started, after machine initialization.
+ */
+static GArray *gdb_flash_regions;   /* sorted by base address */
+static bool gdb_memory_map_enabled;
+
+static gint gdb_flash_region_cmp(gconstpointer a, gconstpointer b)
+{
+    const GDBFlashRegion *ra = a;
+    const GDBFlashRegion *rb = b;
+
+    return ra->base < rb->base ? -1 : ra->base > rb->base;
+}
+
+void gdb_register_flash(hwaddr base, uint64_t size, uint32_t blocksize,
+                        const GDBFlashOps *ops, void *opaque)
+{
+    GDBFlashRegion region = {
+        .base = base,
+        .size = size,
+        .blocksize = blocksize,
+        .ops = ops,
+        .opaque = opaque,
+    };
+
+    if (!gdb_flash_regions) {
+        gdb_flash_regions = g_array_new(false, false, sizeof(GDBFlashRegion));
+    }
+
+    g_array_append_val(gdb_flash_regions, region);
+    g_array_sort(gdb_flash_regions, gdb_flash_region_cmp);
+}
+
+void gdb_enable_memory_map(void)
+{
+    gdb_memory_map_enabled = true;
+}
+
+static GDBFlashRegion *gdb_flash_find(hwaddr addr)
+{
+    int i;
+
+    for (i = 0; gdb_flash_regions && i < gdb_flash_regions->len; i++) {
+        GDBFlashRegion *r = &g_array_index(gdb_flash_regions, GDBFlashRegion, i);
+
+        if (addr >= r->base && addr - r->base < r->size) {
+            return r;
+        }
+    }
+
+    return NULL;
+}
+
+static void handle_v_flash_erase(GdbCmdContext *gdb_ctx, void *user_ctx)
+{
+    hwaddr addr, end;
+
+    if (gdb_ctx->num_params != 2) {
+        put_packet("E22");
+        return;
+    }
+
+    addr = gdb_ctx->params[0].val_ull;
+    end = addr + gdb_ctx->params[1].val_ull;
+
+    /* the range may span several regions with different block sizes */
+    while (addr < end) {
+        GDBFlashRegion *r = gdb_flash_find(addr);
+        uint64_t len;
+
+        if (!r) {
+            put_packet("E01");
+            return;
+        }
+
+        len = MIN(end, r->base + r->size) - addr;
+        if (r->ops->erase(r->opaque, addr, len)) {
+            put_packet("E01");
+            return;
+        }
+        addr += len;
+    }
+
+    put_packet("OK");
+}
+
+static void handle_v_flash_write(GdbCmdContext *gdb_ctx, void *user_ctx)
+{
+    GDBFlashRegion *r;
+    const char *data;
+    hwaddr addr;
+    size_t len;
+
+    if (gdb_ctx->num_params != 1) {
+        put_packet("E22");
+        return;
+    }
+
+    addr = gdb_ctx->params[0].val_ull;
+    data = gdb_binary_data(gdbserver_state.line_buf + strlen("vFlashWrite:"),
+                           &len);
+    if (!data) {
+        put_packet("E22");
+        return;
+    }
+
+    r = gdb_flash_find(addr);
+    if (!r || len > r->base + r->size - addr) {
+        put_packet("E.memtype");
+        return;
+    }
+
+    if (r->ops->write(r->opaque, addr, (const uint8_t *)data, len)) {
+        put_packet("E01");
+        return;
+    }
+
+    put_packet("OK");
+}
+
+static void handle_v_flash_done(GdbCmdContext *gdb_ctx, void *user_ctx)
+{
+    /* flash writes are applied immediately, nothing left to do */
+    put_packet("OK");
+}
+#endif
+
 static GdbCmdParseEntry gdb_v_commands_table[] = {
     /* Order is important if has same prefix */
     {
@@ -1963,6 +2152,24 @@ static GdbCmdParseEntry gdb_v_commands_table[] = {
         .cmd = "Kill;",
         .cmd_startswith = 1
     },
+#ifndef CONFIG_USER_ONLY
+    {
+        .handler = handle_v_flash_erase,
+        .cmd = "FlashErase:",
+        .cmd_startswith = 1,
+        .schema = "L,L0"
+    },
+    {
+        .handler = handle_v_flash_write,
+        .cmd = "FlashWrite:",
+        .cmd_startswith = 1,
+        .schema = "L:"
+    },
+    {
+        .handler = handle_v_flash_done,
+        .cmd = "FlashDone",
+    },
+#endif
 };
 
 static void handle_v_commands(GdbCmdContext *gdb_ctx, void *user_ctx)
@@ -2124,6 +2331,11 @@ static void handle_query_supported(GdbCmdContext *gdb_ctx, void *user_ctx)
     if (cc->gdb_core_xml_file) {
         g_string_append(gdbserver_state.str_buf, ";qXfer:features:read+");
     }
+#ifndef CONFIG_USER_ONLY
+    if (gdb_memory_map_enabled) {
+        g_string_append(gdbserver_state.str_buf, ";qXfer:memory-map:read+");
+    }
+#endif
 
     if (gdb_ctx->num_params &&
         strstr(gdb_ctx->params[0].data, "multiprocess+")) {
@@ -2186,6 +2398,151 @@ static void handle_query_xfer_features(GdbCmdContext *gdb_ctx, void *user_ctx)
                       gdbserver_state.str_buf->len, true);
 }
 
+#ifndef CONFIG_USER_ONLY
+typedef struct GDBMemoryMapEntry {
+    uint64_t start;
+    uint64_t end;
+    bool rom;
+} GDBMemoryMapEntry;
+
+static void gdb_memory_map_append(GArray *map, uint64_t start, uint64_t end,
+                                  bool rom)
+{
+    GDBMemoryMapEntry entry = { .start = start, .end = end, .rom = rom };
+
+    if (map->len) {
+        GDBMemoryMapEntry *last = &g_array_index(map, GDBMemoryMapEntry,
+                                                 map->len - 1);
+
+        if (last->end == start && last->rom == rom) {
+            last->end = end;
+            return;
+        }
+    }
+
+    g_array_append_val(map, entry);
+}
+
+static bool gdb_memory_map_add_range(Int128 start, Int128 len,
+                                     const MemoryRegion *mr, void *opaque)
+{
+    GArray *map = opaque;
+    Int128 end = int128_add(start, len);
+    uint64_t s = int128_get64(start);
+    uint64_t e = int128_ge(end, int128_2_64()) ? UINT64_MAX : int128_get64(end);
+    /*
+     * Debug accesses can write ROM, so report only ROM devices, which need to
+     * be programmed via their own interface, as read-only.
+     */
+    bool rom = mr->rom_device;
+    int i;
+
+    /* registered flash is described separately, with its block size */
+    for (i = 0; gdb_flash_regions && i < gdb_flash_regions->len && s < e; i++) {
+        GDBFlashRegion *r = &g_array_index(gdb_flash_regions, GDBFlashRegion, i);
+
+        if (r->base >= e || r->base + r->size <= s) {
+            continue;
+        }
+        if (r->base > s) {
+            gdb_memory_map_append(map, s, r->base, rom);
+        }
+        s = MAX(s, r->base + r->size);
+    }
+
+    if (s < e) {
+        gdb_memory_map_append(map, s, e, rom);
+    }
+
+    return false;
+}
+
+static char *gdb_memory_map_xml(void)
+{
+    GString *xml = g_string_new("<?xml version=\"1.0\"?>\n"
+                                "<!DOCTYPE memory-map PUBLIC "
+                                "\"+//IDN gnu.org//DTD GDB Memory Map V1.0//EN\" "
+                                "\"http://sourceware.org/gdb/gdb-memory-map.dtd\">\n"
+                                "<memory-map>\n");
+    GArray *map = g_array_new(false, false, sizeof(GDBMemoryMapEntry));
+    int i;
+
+    WITH_RCU_READ_LOCK_GUARD() {
+        flatview_for_each_range(address_space_to_flatview(&address_space_memory),
+                                gdb_memory_map_add_range, map);
+    }
+
+    for (i = 0; i < map->len; i++) {
+        GDBMemoryMapEntry *e = &g_array_index(map, GDBMemoryMapEntry, i);
+
+        g_string_append_printf(xml, "<memory type=\"%s\" start=\"0x%" PRIx64
+                               "\" length=\"0x%" PRIx64 "\"/>\n",
+                               e->rom ? "rom" : "ram", e->start,
+                               e->end - e->start);
+    }
+
+    for (i = 0; gdb_flash_regions && i < gdb_flash_regions->len; i++) {
+        GDBFlashRegion *r = &g_array_index(gdb_flash_regions, GDBFlashRegion, i);
+
+        g_string_append_printf(xml, "<memory type=\"flash\" start=\"0x%"
+                               HWADDR_PRIx "\" length=\"0x%" PRIx64 "\">\n"
+                               "  <property name=\"blocksize\">0x%" PRIx32
+                               "</property>\n</memory>\n",
+                               r->base, r->size, r->blocksize);
+    }
+
+    g_string_append(xml, "</memory-map>\n");
+    g_array_free(map, true);
+    return g_string_free(xml, false);
+}
+
+static void handle_query_xfer_memory_map(GdbCmdContext *gdb_ctx, void *user_ctx)
+{
+    static char *xml;
+    unsigned long len, total_len, addr;
+
+    if (gdb_ctx->num_params < 2) {
+        put_packet("E22");
+        return;
+    }
+
+    if (!gdb_memory_map_enabled) {
+        put_packet("");
+        return;
+    }
+
+    addr = gdb_ctx->params[0].val_ul;
+    len = gdb_ctx->params[1].val_ul;
+
+    /* built on the first chunk, so that all chunks are of the same map */
+    if (!addr || !xml) {
+        g_free(xml);
+        xml = gdb_memory_map_xml();
+    }
+
+    total_len = strlen(xml);
+    if (addr > total_len) {
+        put_packet("E00");
+        return;
+    }
+
+    if (len > (MAX_PACKET_LENGTH - 5) / 2) {
+        len = (MAX_PACKET_LENGTH - 5) / 2;
+    }
+
+    if (len < total_len - addr) {
+        g_string_assign(gdbserver_state.str_buf, "m");
+        memtox(gdbserver_state.str_buf, xml + addr, len);
+    } else {
+        g_string_assign(gdbserver_state.str_buf, "l");
+        memtox(gdbserver_state.str_buf, xml + addr, total_len - addr);
+    }
+
+    put_packet_binary(gdbserver_state.str_buf->str,
+                      gdbserver_state.str_buf->len, true);
+}
+#endif
+
 static void handle_query_attached(GdbCmdContext *gdb_ctx, void *user_ctx)
 {
     put_packet(GDB_ATTACHED);
@@ -2291,6 +2648,14 @@ static GdbCmdParseEntry gdb_gen_query_table[] = {
         .cmd_startswith = 1,
         .schema = "s:l,l0"
     },
+#ifndef CONFIG_USER_ONLY
+    {
+        .handler = handle_query_xfer_memory_map,
+        .cmd = "Xfer:memory-map:read::",
+        .cmd_startswith = 1,
+        .schema = "l,l0"
+    },
+#endif
     {
         .handler = handle_query_attached,
         .cmd = "Attached:",
@@ -2515,6 +2880,17 @@ static int gdb_handle_packet(const char *line_buf)
             cmd_parser = &write_mem_cmd_desc;
         }
         break;
+    case 'X':
+        {
+            static const GdbCmdParseEntry write_mem_binary_cmd_desc = {
+                .handler = handle_write_mem_binary,
+                .cmd = "X",
+                .cmd_startswith = 1,
+                .schema = "L,L:"
+            };
+            cmd_parser = &write_mem_binary_cmd_desc;
+        }
+        break;
     case 'p':
         {
             static const GdbCmdParseEntry get_reg_cmd_desc = {
@@ -2659,6 +3035,11 @@ static void gdb_vm_state_change(void *opaque, int running, RunState state)
 
     switch (state) {
     case RUN_STATE_DEBUG:
+        if (cpu->machine_breakpoint_hit) {
+            /* handled (and resumed) by the machine, not a stop for GDB */
+            cpu->machine_breakpoint_hit = false;
+            return;
+        }
         if (cpu->watchpoint_hit) {
             switch (cpu->watchpoint_hit->flags & BP_MEM_ACCESS) {
             case BP_MEM_READ:
@@ -880,4 +880,54 @@ SRST
     Show SEV information.
 ERST
 
+#if defined(TARGET_ARM)
+    {
+        .name       = "iobc-irq",
+        .args_type  = "reset:-r",
+        .params     = "[-r]",
+        .help       = "show interrupt statistics of the iOBC interrupt "
+                      "controller (-r: reset statistics afterwards)",
+        .cmd        = hmp_info_iobc_irq,
+    },
+#endif
+
+SRST
+  ``info iobc-irq`` [-r]
+    Show interrupt statistics of the iOBC interrupt controller (isis-obc
+    machine only). With -r, reset the statistics afterwards.
+ERST
+
+#if defined(TARGET_ARM)
+    {
+        .name       = "iobc-pflash",
+        .args_type  = "reset:-r",
+        .params     = "[-r]",
+        .help       = "show per-sector erase and program counts of the iOBC "
+                      "NOR flash (-r: reset counts afterwards)",
+        .cmd        = hmp_info_iobc_pflash,
+    },
+#endif
 
+SRST
+  ``info iobc-pflash`` [-r]
+    Show per-sector erase and program counts of the iOBC CFI NOR flash
+    (isis-obc machine with pflash-cfi=on only). With -r, reset the counts
+    afterwards.
+ERST
+
+#if defined(TARGET_ARM)
+    {
+        .name       = "iobc-polls",
+        .args_type  = "reset:-r",
+        .params     = "[-r]",
+        .help       = "show status register polling statistics of the iOBC "
+                      "peripherals (-r: reset counts afterwards)",
+        .cmd        = hmp_info_iobc_polls,
+    },
+#endif
+
+SRST
+  ``info iobc-polls`` [-r]
+    Show read, poll, and skip counts of the iOBC peripheral status registers
+    (isis-obc machine only). With -r, reset the counts afterwards.
+ERST
@@ -0,0 +1,75 @@
+/*
+ * ISIS iOBC QMP/HMP command stubs.
+ *
+ * The iOBC commands are part of the QAPI schema of all ARM targets, but only
+ * implemented if the isis-obc machine is built (CONFIG_ISIS_OBC).
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qapi/error.h"
+#include "qapi/qmp/qerror.h"
+#include "qapi/qapi-commands-misc-target.h"
+#include "monitor/hmp.h"
+#include "monitor/monitor.h"
+
+
+IobcIrqStats *qmp_query_iobc_irq_stats(bool has_reset, bool reset, Error **errp)
+{
+    error_setg(errp, QERR_UNSUPPORTED);
+    return NULL;
+}
+
+IobcPflashStats *qmp_query_iobc_pflash(bool has_reset, bool reset, Error **errp)
+{
+    error_setg(errp, QERR_UNSUPPORTED);
+    return NULL;
+}
+
+IobcWarmStartInfo *qmp_query_iobc_warm_start(Error **errp)
+{
+    error_setg(errp, QERR_UNSUPPORTED);
+    return NULL;
+}
+
+void qmp_iobc_warm_start_ready(Error **errp)
+{
+    error_setg(errp, QERR_UNSUPPORTED);
+}
+
+IobcTimeScaleInfo *qmp_query_iobc_time_scale(Error **errp)
+{
+    error_setg(errp, QERR_UNSUPPORTED);
+    return NULL;
+}
+
+void qmp_iobc_set_time_scale(bool has_ratio, double ratio, bool has_unbounded,
+                             bool unbounded, Error **errp)
+{
+    error_setg(errp, QERR_UNSUPPORTED);
+}
+
+IobcPollStatsList *qmp_query_iobc_polls(bool has_reset, bool reset, Error **errp)
+{
+    error_setg(errp, QERR_UNSUPPORTED);
+    return NULL;
+}
+
+void hmp_info_iobc_irq(Monitor *mon, const QDict *qdict)
+{
+    monitor_printf(mon, "%s\n", QERR_UNSUPPORTED);
+}
+
+void hmp_info_iobc_pflash(Monitor *mon, const QDict *qdict)
+{
+    monitor_printf(mon, "%s\n", QERR_UNSUPPORTED);
+}
+
+void hmp_info_iobc_polls(Monitor *mon, const QDict *qdict)
+{
+    monitor_printf(mon, "%s\n", QERR_UNSUPPORTED);
+}
@@ -10,8 +10,18 @@
  */
 
 #include "at91-aic.h"
+#include "iobc-fault.h"
+#include "iobc-fuzz.h"
 #include "qemu/error-report.h"
+#include "qemu/host-utils.h"
+#include "qemu/timer.h"
+#include "qapi/error.h"
+#include "qapi/qapi-commands-misc-target.h"
+#include "qapi/qmp/qdict.h"
+#include "monitor/monitor.h"
+#include "monitor/hmp.h"
 #include "hw/irq.h"
+#include "migration/vmstate.h"
 
 #define AIC_SMR0            0x000
 #define AIC_SMR31           0x07C
@@ -74,7 +84,7 @@ inline static uint8_t aic_irq_get_type(AicState *s, uint8_t irq)
 
 inline static bool aic_irq_is_edge_triggered(AicState *s, uint8_t irq)
 {
-    return aic_irq_get_type(s, irq) & ST_EDGE_MASK;
+    return !!(s->src_edge & (1 << irq));
 }
 
 inline static bool aic_irq_is_level_triggered(AicState *s, uint8_t irq)
@@ -88,48 +98,184 @@ inline static bool aic_irq_is_fast(AicState *s, uint8_t irq)
 }
 
 
-static int aic_irq_get_highest_pending(AicState *s)
+/*
+ * Arbitration state.
+ *
+ * Instead of scanning all sources on each IVR read or line change, the AIC
+ * keeps one bitmap of pending, enabled, and non-fast sources per priority
+ * level, as well as a summary bitmap of the levels having any such source.
+ * The highest pending interrupt is then given by the highest set bit in the
+ * summary (i.e. the priority) and the lowest set bit in the respective
+ * per-priority bitmap (i.e. the source number).
+ *
+ * SPEC: If several interrupt sources of equal priority are pending and
+ * enabled when the AIC_IVR is read, the interrupt with the lowest interrupt
+ * source number is serviced first.
+ */
+
+static void aic_src_update(AicState *s, int irq, uint32_t smr_old)
+{
+    const uint32_t mask = 1 << irq;
+
+    s->src_prio[smr_old & 7] &= ~mask;
+    s->src_prio[aic_irq_get_priority(s, irq)] |= mask;
+
+    if (aic_irq_get_type(s, irq) & ST_EDGE_MASK) {
+        s->src_edge |= mask;
+    } else {
+        s->src_edge &= ~mask;
+    }
+}
+
+static void aic_src_rebuild(AicState *s)
+{
+    int irq;
+
+    memset(s->src_prio, 0, sizeof(s->src_prio));
+    s->src_edge = 0;
+
+    for (irq = 0; irq < 32; irq++) {
+        s->src_prio[aic_irq_get_priority(s, irq)] |= 1 << irq;
+
+        if (aic_irq_get_type(s, irq) & ST_EDGE_MASK) {
+            s->src_edge |= 1 << irq;
+        }
+    }
+}
+
+inline static int aic_pending_resolve(AicState *s)
 {
-    uint32_t pending = s->reg_ipr & s->reg_imr & ~s->reg_ffsr;
-    int h_irq = -1;
-    int h_pri = -1;
-    int c_irq;
-    int c_pri;
+    int pri;
 
-    // SPEC: If several interrupt sources of equal priority are pending and
-    // enabled when the AIC_IVR is read, the interrupt with the lowest
-    // interrupt source number is serviced first.
+    if (!s->pending_prio_set) {
+        return -1;
+    }
+
+    pri = 31 - clz32(s->pending_prio_set);
+    return ctz32(s->pending_prio[pri]);
+}
 
+static void aic_pending_update(AicState *s)
+{
     // deliberately skip FIQ (irq=0) as this is the fast irq
-    for (c_irq = 1; c_irq < 32; c_irq++) {
-        c_pri = aic_irq_get_priority(s, c_irq);
-        if ((pending & (1 << c_irq)) && c_pri > h_pri) {
-            h_irq = c_irq;
-            h_pri = c_pri;
+    const uint32_t pending = s->reg_ipr & s->reg_imr & ~(s->reg_ffsr | 1);
+    int pri;
+
+    s->pending_prio_set = 0;
+    for (pri = IRQ_PRIO_LOWEST; pri <= IRQ_PRIO_HIGHEST; pri++) {
+        s->pending_prio[pri] = pending & s->src_prio[pri];
+
+        if (s->pending_prio[pri]) {
+            s->pending_prio_set |= 1 << pri;
         }
     }
 
-    return h_irq;
+    s->pending_highest = aic_pending_resolve(s);
+}
+
+static void aic_pending_update_irq(AicState *s, int irq)
+{
+    const uint32_t mask = 1 << irq;
+    const uint32_t pending = s->reg_ipr & s->reg_imr & ~(s->reg_ffsr | 1);
+    const int pri = aic_irq_get_priority(s, irq);
+
+    s->pending_prio[pri] = (s->pending_prio[pri] & ~mask) | (pending & mask);
+
+    if (s->pending_prio[pri]) {
+        s->pending_prio_set |= 1 << pri;
+    } else {
+        s->pending_prio_set &= ~(1 << pri);
+    }
+
+    s->pending_highest = aic_pending_resolve(s);
+}
+
+inline static int aic_irq_get_highest_pending(AicState *s)
+{
+    return s->pending_highest;
+}
+
+
+static void aic_hist_record(AicHistogram *h, int64_t value)
+{
+    uint64_t v = value > 0 ? value : 0;
+    int bucket = v ? 63 - clz64(v) : 0;
+
+    if (h->count == 0 || v < h->min) {
+        h->min = v;
+    }
+    if (v > h->max) {
+        h->max = v;
+    }
+
+    h->count += 1;
+    h->total += v;
+    h->buckets[MIN(bucket, AT91_AIC_HIST_BUCKETS - 1)] += 1;
+}
+
+inline static void aic_stats_asserted(AicState *s, int irq)
+{
+    s->stats[irq].asserted += 1;
+    s->pending_since[irq] = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+}
+
+static void aic_stats_reset(AicState *s)
+{
+    memset(s->stats, 0, sizeof(s->stats));
+    memset(s->stats_nesting, 0, sizeof(s->stats_nesting));
+    s->stats_spurious = 0;
 }
 
 
 inline static void aic_irq_stack_push(AicState *s, uint8_t irq, uint8_t pri)
 {
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+
     if (s->irq_stack_pos >= 8) {
+        if (iobc_fuzz_crash("too many interrupts")) {
+            return;
+        }
+
         error_report("at91.aic: too many interrupts");
         abort();
     }
 
     s->irq_stack_pos += 1;
     s->irq_stack[s->irq_stack_pos].irq = irq;
-    s->irq_stack[s->irq_stack_pos].irq = pri;
+    s->irq_stack[s->irq_stack_pos].pri = pri;
+    s->irq_stack[s->irq_stack_pos].time_entered = now;
+
+    s->stats_nesting[s->irq_stack_pos] += 1;
+
+    if (irq == IRQ_NUM_SPURIOUS) {
+        s->stats_spurious += 1;
+    } else {
+        s->stats[irq].serviced += 1;
+        aic_hist_record(&s->stats[irq].latency, now - s->pending_since[irq]);
+    }
 }
 
 inline static void aic_irq_stack_pop(AicState *s)
 {
-    if (s->irq_stack_pos >= 0) {
-        s->irq_stack_pos -= 1;
+    AicIrqStackElem *elem;
+    int64_t now;
+
+    if (s->irq_stack_pos < 0) {
+        return;
+    }
+
+    elem = &s->irq_stack[s->irq_stack_pos];
+    if (elem->irq != IRQ_NUM_SPURIOUS) {
+        now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+        aic_hist_record(&s->stats[elem->irq].service, now - elem->time_entered);
+
+        // level-triggered source still asserted: next service starts now
+        if (s->reg_ipr & (1 << elem->irq)) {
+            s->pending_since[elem->irq] = now;
+        }
     }
+
+    s->irq_stack_pos -= 1;
 }
 
 inline static AicIrqStackElem *aic_irq_stack_top(AicState *s)
@@ -154,11 +300,11 @@ static void aic_core_irq_update(AicState *s)
     if (s->reg_dcr & DCR_GMSK) {
         s->reg_cisr = 0;
     } else {
+        irq = aic_irq_get_highest_pending(s);
         nfiq = irq_pending & irq_fast;
-        nirq = irq_pending & ~irq_fast;
+        nirq = irq >= 0;
 
         if (nirq && current) {
-            irq = aic_irq_get_highest_pending(s);
             nirq = aic_irq_get_priority(s, irq) > current->pri;
         }
 
@@ -193,6 +339,9 @@ static void aic_irq_handle(void *opaque, int n, int level)
     }
 
     if (active) {
+        if (!(s->reg_ipr & mask)) {
+            aic_stats_asserted(s, n);
+        }
         s->reg_ipr |= mask;
     } else if (!aic_irq_is_edge_triggered(s, n)) {
         // edge-triggered IRQs are cleared during handling, only clear
@@ -200,6 +349,7 @@ static void aic_irq_handle(void *opaque, int n, int level)
         s->reg_ipr &= ~mask;
     }
 
+    aic_pending_update_irq(s, n);
     aic_core_irq_update(s);
 }
 
@@ -211,8 +361,9 @@ static uint64_t aic_mmio_read(void *opaque, hwaddr offset, unsigned size)
     int irq;
 
     if (size != 0x04) {
-        error_report("at91.aic illegal read access at 0x%03lx with size: 0x%02x", offset, size);
-        abort();
+        iobc_fault(&s->mmio, offset, false,
+                   "at91.aic illegal read access at 0x%03lx with size: 0x%02x", offset, size);
+        return 0;
     }
 
     switch (offset) {
@@ -234,6 +385,7 @@ static uint64_t aic_mmio_read(void *opaque, hwaddr offset, unsigned size)
                 // automatic clear for edge-triggered non-fast-forced interrupts
                 if (aic_irq_is_edge_triggered(s, irq) && !aic_irq_is_fast(s, irq)) {
                     s->reg_ipr &= ~(1 << irq);
+                    aic_pending_update_irq(s, irq);
                 }
             }
 
@@ -291,25 +443,31 @@ static uint64_t aic_mmio_read(void *opaque, hwaddr offset, unsigned size)
         return s->reg_ffsr;
 
     default:
-        error_report("at91.aic illegal read access at 0x%03lx", offset);
-        abort();
+        iobc_fault(&s->mmio, offset, false, "at91.aic illegal read access at 0x%03lx", offset);
+        return 0;
     }
 }
 
 static void aic_mmio_write(void *opaque, hwaddr offset, uint64_t value, unsigned size)
 {
     AicState *s = opaque;
+    uint32_t smr_old;
+    uint32_t asserted;
     int irq;
 
     if (size != 0x04) {
-        error_report("at91.aic illegal write access at 0x%03lx with size: 0x%02x [value: 0x%08lx]",
-                     offset, size, value);
-        abort();
+        iobc_fault(&s->mmio, offset, true,
+                   "at91.aic illegal write access at 0x%03lx with size: 0x%02x [value: 0x%08lx]",
+                   offset, size, value);
+        return;
     }
 
     switch (offset) {
     case AIC_SMR0 ... AIC_SMR31:
-        s->reg_smr[(offset - AIC_SMR0) / 4] = value;
+        irq = (offset - AIC_SMR0) / 4;
+        smr_old = s->reg_smr[irq];
+        s->reg_smr[irq] = value;
+        aic_src_update(s, irq, smr_old);
         break;
 
     case AIC_SVR0 ... AIC_SVR31:
@@ -343,20 +501,19 @@ static void aic_mmio_write(void *opaque, hwaddr offset, uint64_t value, unsigned
 
     case AIC_ICCR:
         // can only clear edge-triggered interrupts
-        for (irq = 0; irq < 32; irq++) {
-            if (!aic_irq_is_edge_triggered(s, irq))
-                value &= ~(1 << irq);
-        }
-        s->reg_ipr &= ~value;
+        s->reg_ipr &= ~(value & s->src_edge);
         break;
 
     case AIC_ISCR:
         // can only set edge-triggered interrupts
-        for (irq = 0; irq < 32; irq++) {
-            if (!aic_irq_is_edge_triggered(s, irq))
-                value &= ~(1 << irq);
+        asserted = value & s->src_edge & ~s->reg_ipr;
+        while (asserted) {
+            irq = ctz32(asserted);
+            asserted &= ~(1 << irq);
+            aic_stats_asserted(s, irq);
         }
-        s->reg_ipr |= value;
+        s->reg_ipr |= value & s->src_edge;
+        break;
 
     case AIC_EOICR:
         aic_irq_stack_pop(s);
@@ -379,17 +536,20 @@ static void aic_mmio_write(void *opaque, hwaddr offset, uint64_t value, unsigned
         break;
 
     default:
-        error_report("at91.aic illegal write access at "
-                      "0x%03lx [value: 0x%08lx]", offset, value);
-        abort();
+        iobc_fault(&s->mmio, offset, true, "at91.aic illegal write access at "
+                                           "0x%03lx [value: 0x%08lx]", offset, value);
+        return;
     }
 
+    aic_pending_update(s);
     aic_core_irq_update(s);
 }
 
+IOBC_FAULT_ACCESSORS(aic_mmio_read, aic_mmio_write)
+
 static const MemoryRegionOps aic_mmio_ops = {
-    .read = aic_mmio_read,
-    .write = aic_mmio_write,
+    .read_with_attrs = aic_mmio_read_tx,
+    .write_with_attrs = aic_mmio_write_tx,
     .impl.min_access_size = 4,
     .impl.max_access_size = 4,
     .valid.min_access_size = 4,
@@ -413,6 +573,9 @@ static void aic_reset_registers(AicState *s)
     s->reg_spu  = 0;
     s->reg_dcr  = 0;
     s->reg_ffsr = 0;
+
+    aic_src_rebuild(s);
+    aic_pending_update(s);
 }
 
 static void aic_device_init(Object *obj)
@@ -434,6 +597,7 @@ static void aic_device_realize(DeviceState *dev, Error **errp)
     AicState *s = AT91_AIC(dev);
 
     aic_reset_registers(s);
+    aic_stats_reset(s);
     s->irq_stack_pos = -1;
     s->line_state = 0;
 }
@@ -447,12 +611,219 @@ static void aic_device_reset(DeviceState *dev)
     s->line_state = 0;
 }
 
+
+static AicState *aic_find(Error **errp)
+{
+    Object *obj = object_resolve_path_type("", TYPE_AT91_AIC, NULL);
+
+    if (!obj) {
+        error_setg(errp, "No AT91 AIC found");
+        return NULL;
+    }
+
+    return AT91_AIC(obj);
+}
+
+static IobcIrqHistogram *aic_hist_to_qapi(AicHistogram *h)
+{
+    IobcIrqHistogram *info = g_new0(IobcIrqHistogram, 1);
+    intList **next = &info->buckets;
+    int last;
+    int i;
+
+    info->count = h->count;
+    info->total = h->total;
+    info->min = h->min;
+    info->max = h->max;
+
+    // strip trailing empty buckets
+    last = AT91_AIC_HIST_BUCKETS - 1;
+    while (last >= 0 && !h->buckets[last]) {
+        last--;
+    }
+
+    for (i = 0; i <= last; i++) {
+        *next = g_new0(intList, 1);
+        (*next)->value = h->buckets[i];
+        next = &(*next)->next;
+    }
+
+    return info;
+}
+
+IobcIrqStats *qmp_query_iobc_irq_stats(bool has_reset, bool reset, Error **errp)
+{
+    AicState *s = aic_find(errp);
+    IobcIrqStats *info;
+    IobcIrqSourceStatsList **next_src;
+    intList **next_nest;
+    int irq;
+    int i;
+
+    if (!s) {
+        return NULL;
+    }
+
+    info = g_new0(IobcIrqStats, 1);
+    info->spurious = s->stats_spurious;
+    info->depth = s->irq_stack_pos + 1;
+
+    next_src = &info->sources;
+    for (irq = 0; irq < 32; irq++) {
+        AicSourceStats *st = &s->stats[irq];
+        IobcIrqSourceStats *src;
+
+        if (!st->asserted && !st->serviced) {
+            continue;
+        }
+
+        src = g_new0(IobcIrqSourceStats, 1);
+        src->irq = irq;
+        src->priority = aic_irq_get_priority(s, irq);
+        src->asserted = st->asserted;
+        src->serviced = st->serviced;
+        src->latency = aic_hist_to_qapi(&st->latency);
+        src->service = aic_hist_to_qapi(&st->service);
+
+        *next_src = g_new0(IobcIrqSourceStatsList, 1);
+        (*next_src)->value = src;
+        next_src = &(*next_src)->next;
+    }
+
+    next_nest = &info->nesting;
+    for (i = 0; i < ARRAY_SIZE(s->stats_nesting); i++) {
+        *next_nest = g_new0(intList, 1);
+        (*next_nest)->value = s->stats_nesting[i];
+        next_nest = &(*next_nest)->next;
+
+        if (s->stats_nesting[i]) {
+            info->max_nesting = i + 1;
+        }
+    }
+
+    if (has_reset && reset) {
+        aic_stats_reset(s);
+    }
+
+    return info;
+}
+
+void hmp_info_iobc_irq(Monitor *mon, const QDict *qdict)
+{
+    bool reset = qdict_get_try_bool(qdict, "reset", false);
+    Error *err = NULL;
+    IobcIrqStats *info;
+    IobcIrqSourceStatsList *src;
+    intList *nest;
+    int depth;
+
+    info = qmp_query_iobc_irq_stats(true, reset, &err);
+    if (err) {
+        error_report_err(err);
+        return;
+    }
+
+    monitor_printf(mon, "irq pri    asserted    serviced   lat-avg/ns   lat-max/ns"
+                   "   svc-avg/ns   svc-max/ns\n");
+
+    for (src = info->sources; src; src = src->next) {
+        IobcIrqSourceStats *st = src->value;
+
+        monitor_printf(mon, "%3" PRId64 " %3" PRId64 " %11" PRId64 " %11" PRId64
+                       " %12" PRId64 " %12" PRId64 " %12" PRId64 " %12" PRId64 "\n",
+                       st->irq, st->priority, st->asserted, st->serviced,
+                       st->latency->count ? st->latency->total / st->latency->count : 0,
+                       st->latency->max,
+                       st->service->count ? st->service->total / st->service->count : 0,
+                       st->service->max);
+    }
+
+    monitor_printf(mon, "spurious: %" PRId64 "\n", info->spurious);
+    monitor_printf(mon, "current depth: %" PRId64 ", max depth: %" PRId64 "\n",
+                   info->depth, info->max_nesting);
+
+    for (nest = info->nesting, depth = 1; nest; nest = nest->next, depth++) {
+        if (nest->value) {
+            monitor_printf(mon, "  depth %d: %" PRId64 "\n", depth, nest->value);
+        }
+    }
+
+    qapi_free_IobcIrqStats(info);
+}
+
+
+static int aic_post_load(void *opaque, int version_id)
+{
+    AicState *s = opaque;
+    int i;
+
+    if (s->irq_stack_pos < -1 || s->irq_stack_pos >= (int)ARRAY_SIZE(s->irq_stack)) {
+        return -EINVAL;
+    }
+
+    // stack entries index the per-source state, only accept valid ones
+    for (i = 0; i <= s->irq_stack_pos; i++) {
+        AicIrqStackElem *elem = &s->irq_stack[i];
+
+        if (elem->irq == IRQ_NUM_SPURIOUS ? elem->pri != IRQ_PRIO_SPURIOUS
+                                          : elem->irq >= 32 || elem->pri > 7) {
+            return -EINVAL;
+        }
+    }
+
+    // cached arbitration state is not part of the snapshot, re-derive it
+    aic_src_rebuild(s);
+    aic_pending_update(s);
+    return 0;
+}
+
+static const VMStateDescription aic_irq_stack_elem_vmstate = {
+    .name = TYPE_AT91_AIC "/irq-stack-elem",
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT8(pri, AicIrqStackElem),
+        VMSTATE_UINT8(irq, AicIrqStackElem),
+        VMSTATE_INT64(time_entered, AicIrqStackElem),
+        VMSTATE_END_OF_LIST()
+    },
+};
+
+/*
+ * Note: Interrupt statistics are host-side diagnostics and deliberately not
+ * part of the snapshot. Only the assertion time stamps of pending sources
+ * are kept, so that latencies stay correct across snapshots.
+ */
+static const VMStateDescription aic_vmstate = {
+    .name = TYPE_AT91_AIC,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = aic_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32_ARRAY(reg_smr, AicState, 32),
+        VMSTATE_UINT32_ARRAY(reg_svr, AicState, 32),
+        VMSTATE_UINT32(reg_ipr, AicState),
+        VMSTATE_UINT32(reg_imr, AicState),
+        VMSTATE_UINT32(reg_cisr, AicState),
+        VMSTATE_UINT32(reg_spu, AicState),
+        VMSTATE_UINT32(reg_dcr, AicState),
+        VMSTATE_UINT32(reg_ffsr, AicState),
+        VMSTATE_STRUCT_ARRAY(irq_stack, AicState, 9, 1,
+                             aic_irq_stack_elem_vmstate, AicIrqStackElem),
+        VMSTATE_INT32(irq_stack_pos, AicState),
+        VMSTATE_UINT32(line_state, AicState),
+        VMSTATE_INT64_ARRAY(pending_since, AicState, 32),
+        VMSTATE_END_OF_LIST()
+    },
+};
+
 static void aic_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
     dc->realize = aic_device_realize;
     dc->reset = aic_device_reset;
+    dc->vmsd = &aic_vmstate;
 }
 
 static const TypeInfo aic_device_info = {
@@ -10,6 +10,14 @@
  * their corresponding AIC IRQ line (see AT91 technical documentation for
  * details).
  *
+ * The AIC collects interrupt statistics for profiling of the guest software:
+ * Per-source assertion and service counts, the time from assertion to the
+ * IVR read (latency), and the time from IVR read to EOICR write (service
+ * time), both in virtual nanoseconds and as log2 histograms, as well as the
+ * nesting depth of the interrupt stack. These can be queried via the QMP
+ * command query-iobc-irq-stats and the HMP command "info iobc-irq". Note
+ * that the fast interrupt (FIQ) is not included in these statistics.
+ *
  * Copyright (c) 2019-2020 KSat e.V. Stuttgart
  *
  * This work is licensed under the terms of the GNU GPL, version 2 or, at your
@@ -26,12 +34,30 @@
 #define TYPE_AT91_AIC "at91-aic"
 #define AT91_AIC(obj) OBJECT_CHECK(AicState, (obj), TYPE_AT91_AIC)
 
+#define AT91_AIC_HIST_BUCKETS   32
+
 
 typedef struct {
     uint8_t pri;
     uint8_t irq;
+    int64_t time_entered;
 } AicIrqStackElem;
 
+typedef struct {
+    uint64_t count;
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[AT91_AIC_HIST_BUCKETS];    // bucket n: [2^n, 2^(n+1)) ns
+} AicHistogram;
+
+typedef struct {
+    uint64_t asserted;
+    uint64_t serviced;
+    AicHistogram latency;           // assertion to IVR read
+    AicHistogram service;           // IVR read to EOICR write
+} AicSourceStats;
+
 
 typedef struct {
     SysBusDevice parent_obj;
@@ -54,6 +80,19 @@ typedef struct {
     int irq_stack_pos;
 
     uint32_t line_state;
+
+    // cached arbitration state, derived from SMR/IPR/IMR/FFSR
+    uint32_t src_prio[8];           // sources configured per priority level
+    uint32_t src_edge;              // edge-triggered sources
+    uint32_t pending_prio[8];       // pending, enabled, non-fast per priority
+    uint8_t pending_prio_set;       // bit n set iff pending_prio[n] != 0
+    int pending_highest;            // highest-priority pending IRQ or -1
+
+    // statistics
+    int64_t pending_since[32];
+    AicSourceStats stats[32];
+    uint64_t stats_spurious;
+    uint64_t stats_nesting[9];      // number of IVR reads per resulting depth
 } AicState;
 
 #endif /* HW_ARM_ISIS_OBC_AIC_H */
@@ -12,6 +12,7 @@
 #include "at91-aic_stub.h"
 #include "qemu/error-report.h"
 #include "hw/irq.h"
+#include "migration/vmstate.h"
 
 
 static void aicstub_irq_handle(void *opaque, int n, int level)
@@ -43,12 +44,23 @@ static void aicstub_device_reset(DeviceState *dev)
     s->line_state = 0;
 }
 
+static const VMStateDescription aicstub_vmstate = {
+    .name = TYPE_AT91_AIC_STUB,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(line_state, AicStubState),
+        VMSTATE_END_OF_LIST()
+    },
+};
+
 static void aicstub_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
     dc->realize = aicstub_device_realize;
     dc->reset = aicstub_device_reset;
+    dc->vmsd = &aicstub_vmstate;
 }
 
 static const TypeInfo aicstub_device_info = {
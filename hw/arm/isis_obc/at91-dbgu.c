@@ -21,9 +21,11 @@
 
 
 #include "at91-dbgu.h"
+#include "iobc-fault.h"
 #include "qemu/error-report.h"
 #include "qemu/log.h"
 #include "hw/irq.h"
+#include "migration/vmstate.h"
 #include "hw/qdev-properties.h"
 
 
@@ -155,8 +157,8 @@ static uint64_t dbgu_mmio_read(void *opaque, hwaddr offset, unsigned size)
         // TODO(at91.dbgu.pdc): implement PDC support (Sec. 23)
 
     default:
-        error_report("at91.dbgu illegal read access at 0x%03lx", offset);
-        abort();
+        iobc_fault(&s->mmio, offset, false, "at91.dbgu illegal read access at 0x%03lx", offset);
+        return 0;
     }
 }
 
@@ -257,17 +259,19 @@ static void dbgu_mmio_write(void *opaque, hwaddr offset, uint64_t value, unsigne
         break;
 
     default:
-        error_report("at91.dbgu illegal write access at "
-                      "0x%03lx [value: 0x%08lx]", offset, value);
-        abort();
+        iobc_fault(&s->mmio, offset, true, "at91.dbgu illegal write access at "
+                                           "0x%03lx [value: 0x%08lx]", offset, value);
+        return;
     }
 
     qemu_set_irq(s->irq, !!(s->reg_sr & s->reg_imr));
 }
 
+IOBC_FAULT_ACCESSORS(dbgu_mmio_read, dbgu_mmio_write)
+
 static const MemoryRegionOps dbgu_mmio_ops = {
-    .read = dbgu_mmio_read,
-    .write = dbgu_mmio_write,
+    .read_with_attrs = dbgu_mmio_read_tx,
+    .write_with_attrs = dbgu_mmio_write_tx,
     .endianness = DEVICE_NATIVE_ENDIAN,
 };
 
@@ -318,12 +322,33 @@ static void dbgu_device_reset(DeviceState *dev)
     dbgu_reset_registers(AT91_DBGU(dev));
 }
 
+static const VMStateDescription dbgu_vmstate = {
+    .name = TYPE_AT91_DBGU,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_BOOL(rx_enabled, DbguState),
+        VMSTATE_BOOL(tx_enabled, DbguState),
+        VMSTATE_UINT32(reg_mr, DbguState),
+        VMSTATE_UINT32(reg_imr, DbguState),
+        VMSTATE_UINT32(reg_sr, DbguState),
+        VMSTATE_UINT32(reg_rhr, DbguState),
+        VMSTATE_UINT32(reg_thr, DbguState),
+        VMSTATE_UINT32(reg_brgr, DbguState),
+        VMSTATE_UINT32(reg_cidr, DbguState),
+        VMSTATE_UINT32(reg_exid, DbguState),
+        VMSTATE_UINT32(reg_fnr, DbguState),
+        VMSTATE_END_OF_LIST()
+    },
+};
+
 static void dbgu_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
     dc->realize = dbgu_device_realize;
     dc->reset = dbgu_device_reset;
+    dc->vmsd = &dbgu_vmstate;
     device_class_set_props(dc, dbgu_device_properties);
 }
 
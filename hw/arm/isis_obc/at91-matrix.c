@@ -14,7 +14,9 @@
 //   else)
 
 #include "at91-matrix.h"
+#include "iobc-fault.h"
 #include "qemu/error-report.h"
+#include "migration/vmstate.h"
 
 #define MATRIX_MCFG0        0x000
 #define MATRIX_MCFG4        0x010
@@ -98,8 +100,9 @@ static uint64_t matrix_mmio_read(void *opaque, hwaddr offset, unsigned size)
         return s->reg_ebi_csa;
     }
 
-    error_report("at91.matrix: illegal/unimplemented read access at 0x%02lx", offset);
-    abort();
+    iobc_fault(&s->mmio, offset, false,
+               "at91.matrix: illegal/unimplemented read access at 0x%02lx", offset);
+    return 0;
 }
 
 static void matrix_mmio_write(void *opaque, hwaddr offset, uint64_t value, unsigned size)
@@ -145,14 +148,16 @@ static void matrix_mmio_write(void *opaque, hwaddr offset, uint64_t value, unsig
         return;
     }
 
-    error_report("at91.matrix: illegal/unimplemented write access at 0x%02lx [value; 0x%08lx]",
-                     offset, value);
-    abort();
+    iobc_fault(&s->mmio, offset, true,
+               "at91.matrix: illegal/unimplemented write access at 0x%02lx [value; 0x%08lx]",
+               offset, value);
 }
 
+IOBC_FAULT_ACCESSORS(matrix_mmio_read, matrix_mmio_write)
+
 static const MemoryRegionOps matrix_mmio_ops = {
-    .read = matrix_mmio_read,
-    .write = matrix_mmio_write,
+    .read_with_attrs = matrix_mmio_read_tx,
+    .write_with_attrs = matrix_mmio_write_tx,
     .impl.min_access_size = 4,
     .impl.max_access_size = 4,
     .valid.min_access_size = 4,
@@ -210,12 +215,43 @@ static void matrix_device_reset(DeviceState *dev)
     matrix_bootmem_update(s);
 }
 
+static int matrix_post_load(void *opaque, int version_id)
+{
+    MatrixState *s = opaque;
+
+    // see matrix_bootmem_update, REMAP must be equal for RCB0 and RCB1
+    if (!(s->reg_mrcr & MRCR_RCB0) != !(s->reg_mrcr & MRCR_RCB1)) {
+        return -EINVAL;
+    }
+
+    // restore the bootmem remap target (i.e. the memory mapped at 0x0)
+    matrix_bootmem_update(s);
+    return 0;
+}
+
+static const VMStateDescription matrix_vmstate = {
+    .name = TYPE_AT91_MATRIX,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = matrix_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32_ARRAY(reg_mcfg, MatrixState, 6),
+        VMSTATE_UINT32_ARRAY(reg_scfg, MatrixState, 5),
+        VMSTATE_UINT32_ARRAY(reg_pras, MatrixState, 5),
+        VMSTATE_UINT32(reg_mrcr, MatrixState),
+        VMSTATE_UINT32(reg_ebi_csa, MatrixState),
+        VMSTATE_BOOL(bms, MatrixState),
+        VMSTATE_END_OF_LIST()
+    },
+};
+
 static void matrix_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
     dc->realize = matrix_device_realize;
     dc->reset = matrix_device_reset;
+    dc->vmsd = &matrix_vmstate;
 }
 
 static const TypeInfo matrix_device_info = {
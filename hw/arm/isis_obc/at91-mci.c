@@ -30,11 +30,13 @@
 //   of detail
 
 #include "at91-mci.h"
+#include "iobc-fault.h"
 #include "exec/address-spaces.h"
 #include "qapi/error.h"
 #include "qemu/error-report.h"
 #include "sysemu/blockdev.h"
 #include "hw/irq.h"
+#include "migration/vmstate.h"
 #include "hw/qdev-properties.h"
 
 #define MCI_CR          0x00
@@ -145,7 +147,7 @@ enum cmdr_iospcmd {
 #define SR_OVRE         BIT(30)
 #define SR_UNRE         BIT(31)
 
-#define BLKLEN_MULTIBLOCK_UNLIMITED   ((size_t)-1)
+#define BLKLEN_MULTIBLOCK_UNLIMITED   UINT64_MAX
 
 
 static void mci_reset_registers(MciState *s);
@@ -320,7 +322,7 @@ static void mci_pdc_do_write(MciState *s)
 }
 
 
-static size_t mci_tr_length(MciState *s, uint32_t cmdr)
+static uint64_t mci_tr_length(MciState *s, uint32_t cmdr)
 {
     switch (CMDR_TRTYP(cmdr)) {
     case CMDR_TRTYP_MMCSD_SINGLE_BLOCK:
@@ -330,13 +332,13 @@ static size_t mci_tr_length(MciState *s, uint32_t cmdr)
         if (BLKR_BCNT(s) == 0)          // infinite block transfer
             return BLKLEN_MULTIBLOCK_UNLIMITED;
         else                            // finite block transfer
-            return ((size_t)BLKR_BLKLEN(s)) * ((size_t)BLKR_BCNT(s));
+            return ((uint64_t)BLKR_BLKLEN(s)) * ((uint64_t)BLKR_BCNT(s));
 
     case CMDR_TRTYP_SDIO_BYTE:
         return BLKR_BCNT(s);
 
     case CMDR_TRTYP_SDIO_BLOCK:
-        return ((size_t)BLKR_BLKLEN(s)) * ((size_t)BLKR_BCNT(s));
+        return ((uint64_t)BLKR_BLKLEN(s)) * ((uint64_t)BLKR_BCNT(s));
 
     case CMDR_TRTYP_MMC_STREAM:
         error_report("at91.mci: MMC stream data transfer not supported");
@@ -701,6 +703,8 @@ static uint64_t mci_mmio_read(void *opaque, hwaddr offset, unsigned size)
             uint32_t sr = s->reg_sr;
             s->reg_sr &= ~(SR_BLKE | SR_DCRCE | SR_DTOE | SR_SDIOIRQA | SR_SDIOIRQB);
             mci_irq_update(s);
+            // commands and transfers complete immediately, no deadline
+            iobc_poll_read(&s->poll_sr, sr, IOBC_POLL_NO_DEADLINE);
             return sr;
         }
 
@@ -711,8 +715,8 @@ static uint64_t mci_mmio_read(void *opaque, hwaddr offset, unsigned size)
         return at91_pdc_get_register(&s->pdc, offset);
 
     default:
-        error_report("at91.mci illegal read access at 0x%03lx", offset);
-        abort();
+        iobc_fault(&s->mmio, offset, false, "at91.mci illegal read access at 0x%03lx", offset);
+        return 0;
     }
 }
 
@@ -840,15 +844,17 @@ static void mci_mmio_write(void *opaque, hwaddr offset, uint64_t value, unsigned
         break;
 
     default:
-        error_report("at91.mci illegal write access at "
-                      "0x%03lx [value: 0x%08lx]", offset, value);
-        abort();
+        iobc_fault(&s->mmio, offset, true, "at91.mci illegal write access at "
+                                           "0x%03lx [value: 0x%08lx]", offset, value);
+        return;
     }
 }
 
+IOBC_FAULT_ACCESSORS(mci_mmio_read, mci_mmio_write)
+
 static const MemoryRegionOps mci_mmio_ops = {
-    .read = mci_mmio_read,
-    .write = mci_mmio_write,
+    .read_with_attrs = mci_mmio_read_tx,
+    .write_with_attrs = mci_mmio_write_tx,
     .impl.min_access_size = 4,
     .impl.max_access_size = 4,
     .valid.min_access_size = 4,
@@ -927,6 +933,8 @@ static void mci_device_realize(DeviceState *dev, Error **errp)
     s->selected_card = 0;
     s->rx_dma_enabled = false;
     s->tx_dma_enabled = false;
+
+    iobc_poll_register(&s->poll_sr, &s->mmio, MCI_SR, "SR");
 }
 
 static void mci_device_reset(DeviceState *dev)
@@ -935,12 +943,59 @@ static void mci_device_reset(DeviceState *dev)
     mci_reset_registers(s);
 }
 
+static int mci_post_load(void *opaque, int version_id)
+{
+    MciState *s = opaque;
+
+    if (s->selected_card > 1 || s->reg_rspr_index > 4 || s->reg_rspr_len > 4) {
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+/*
+ * Note: The state of the SD cards themselves is saved by the cards attached
+ * to the SD buses.
+ */
+static const VMStateDescription mci_vmstate = {
+    .name = TYPE_AT91_MCI,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = mci_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(mclk, MciState),
+        VMSTATE_UINT32(mcck, MciState),
+        VMSTATE_UINT32(reg_mr, MciState),
+        VMSTATE_UINT32(reg_dtor, MciState),
+        VMSTATE_UINT32(reg_sdcr, MciState),
+        VMSTATE_UINT32(reg_argr, MciState),
+        VMSTATE_UINT32(reg_blkr, MciState),
+        VMSTATE_UINT32(reg_sr, MciState),
+        VMSTATE_UINT32(reg_imr, MciState),
+        VMSTATE_UINT32_ARRAY(reg_rspr, MciState, 4),
+        VMSTATE_UINT8(reg_rspr_index, MciState),
+        VMSTATE_UINT8(reg_rspr_len, MciState),
+        VMSTATE_BOOL(mcien, MciState),
+        VMSTATE_BOOL(pwsen, MciState),
+        VMSTATE_UINT8(selected_card, MciState),
+        VMSTATE_UINT64(rd_bytes_left, MciState),
+        VMSTATE_UINT64(wr_bytes_left, MciState),
+        VMSTATE_UINT64(wr_bytes_blk, MciState),
+        VMSTATE_AT91_PDC(pdc, MciState),
+        VMSTATE_BOOL(rx_dma_enabled, MciState),
+        VMSTATE_BOOL(tx_dma_enabled, MciState),
+        VMSTATE_END_OF_LIST()
+    },
+};
+
 static void mci_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
     dc->realize = mci_device_realize;
     dc->reset = mci_device_reset;
+    dc->vmsd = &mci_vmstate;
 }
 
 static const TypeInfo mci_device_info = {
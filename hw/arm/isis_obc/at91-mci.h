@@ -22,6 +22,7 @@
 #include "hw/sysbus.h"
 #include "hw/sd/sd.h"
 #include "at91-pdc.h"
+#include "iobc-poll.h"
 
 
 #define TYPE_AT91_MCI "at91-mci"
@@ -56,13 +57,15 @@ typedef struct {
 
     uint8_t selected_card;
 
-    size_t rd_bytes_left;
-    size_t wr_bytes_left;
-    size_t wr_bytes_blk;
+    uint64_t rd_bytes_left;
+    uint64_t wr_bytes_left;
+    uint64_t wr_bytes_blk;
 
     At91Pdc pdc;
     bool rx_dma_enabled;
     bool tx_dma_enabled;
+
+    IobcPollReg poll_sr;
 } MciState;
 
 
@@ -17,6 +17,7 @@
 #include "qemu/osdep.h"
 #include "qemu/error-report.h"
 #include "hw/sysbus.h"
+#include "migration/vmstate.h"
 
 
 #define PDC_START       0x100
@@ -58,6 +59,17 @@ typedef struct {
     uint16_t reg_tncr;
 } At91Pdc;
 
+#define VMSTATE_AT91_PDC(_field, _state)            \
+    VMSTATE_UINT32(_field.reg_ptsr, _state),        \
+    VMSTATE_UINT32(_field.reg_rpr, _state),         \
+    VMSTATE_UINT32(_field.reg_rnpr, _state),        \
+    VMSTATE_UINT32(_field.reg_tpr, _state),         \
+    VMSTATE_UINT32(_field.reg_tnpr, _state),        \
+    VMSTATE_UINT16(_field.reg_rcr, _state),         \
+    VMSTATE_UINT16(_field.reg_rncr, _state),        \
+    VMSTATE_UINT16(_field.reg_tcr, _state),         \
+    VMSTATE_UINT16(_field.reg_tncr, _state)
+
 typedef struct {
     void *opaque;
     dma_action_cb dma_tx_start;
@@ -16,9 +16,14 @@
 // - Board implementation dependent PSR reset values are assumed to be zero.
 
 #include "at91-pio.h"
+#include "iobc-fault.h"
 #include "qapi/error.h"
 #include "qemu/error-report.h"
+#include "qemu/host-utils.h"
+#include "qemu/main-loop.h"
+#include "qemu/timer.h"
 #include "hw/irq.h"
+#include "migration/vmstate.h"
 #include "hw/qdev-properties.h"
 
 #define IOX_CAT_PINSTATE            0x01
@@ -26,6 +31,8 @@
 #define IOX_CID_PINSTATE_DISABLE    0x02
 #define IOX_CID_PINSTATE_OUT        0x03
 #define IOX_CID_PINSTATE_GET        0x04
+#define IOX_CID_PINSTATE_EVENTS_ENABLE  0x05
+#define IOX_CID_PINSTATE_EVENTS     0x06
 
 #define PIO_PER     0x00
 #define PIO_PDR     0x04
@@ -58,7 +65,8 @@
 #define PIO_OWSR    0xA8
 
 
-static void pio_handle_gpio_pin(void *opaque, int n, int level);
+static uint32_t pio_update_pins(PioState *s, bool notify);
+inline static void pio_update_irq(PioState *s);
 
 static void iox_pinstate_set(PioState *s, struct iox_data_frame *frame)
 {
@@ -68,11 +76,17 @@ static void iox_pinstate_set(PioState *s, struct iox_data_frame *frame)
     }
 
     uint32_t state = *((uint32_t *)&frame->payload[0]);
-    bool level = frame->id == IOX_CID_PINSTATE_ENABLE;
 
-    for (uint32_t i = 0; i < 32; i++)
-        if (state & (1 << i))
-            pio_handle_gpio_pin(s, i, level);
+    // apply all pins at once, same as for input via physical pins
+    if (frame->id == IOX_CID_PINSTATE_ENABLE) {
+        s->pin_state_in |= state;
+    } else {
+        s->pin_state_in &= ~state;
+    }
+
+    if (pio_update_pins(s, false)) {
+        pio_update_irq(s);
+    }
 }
 
 static void iox_pinstate_get(PioState *s, struct iox_data_frame *frame)
@@ -84,6 +98,16 @@ static void iox_pinstate_get(PioState *s, struct iox_data_frame *frame)
     }
 }
 
+static void iox_events_enable(PioState *s, struct iox_data_frame *frame)
+{
+    if (frame->len != sizeof(uint8_t)) {
+        warn_report("at91.pio: invalid event-enable command payload");
+        return;
+    }
+
+    s->events_enabled = !!frame->payload[0];
+}
+
 static void iox_receive(struct iox_data_frame *frame, void *opaque)
 {
     PioState *s = opaque;
@@ -99,6 +123,10 @@ static void iox_receive(struct iox_data_frame *frame, void *opaque)
         case IOX_CID_PINSTATE_GET:
             iox_pinstate_get(s, frame);
             break;
+
+        case IOX_CID_PINSTATE_EVENTS_ENABLE:
+            iox_events_enable(s, frame);
+            break;
         }
     }
 
@@ -113,43 +141,128 @@ static void iox_send_pin_state(PioState *s)
     }
 }
 
+static void iox_send_events(PioState *s)
+{
+    int status;
+
+    if (!s->events_used)
+        return;
+
+    status = iox_send_data_new(s->server, IOX_CAT_PINSTATE, IOX_CID_PINSTATE_EVENTS,
+                               s->events_used * sizeof(struct at91_pio_event),
+                               (uint8_t *)s->events);
+    if (status) {
+        error_report("at91.pio: failed to send pin-state events");
+        abort();
+    }
+
+    s->events_used = 0;
+}
+
+static void pio_events_flush(void *opaque)
+{
+    iox_send_events(opaque);
+}
+
+static void pio_record_event(PioState *s, uint32_t changed)
+{
+    struct at91_pio_event *evt = &s->events[s->events_used++];
+
+    evt->time = cpu_to_le64(qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL));
+    evt->changed = cpu_to_le32(changed);
+    evt->state = cpu_to_le32(s->reg_pdsr);
+
+    if (s->events_used == AT91_PIO_EVENTS_PER_FRAME) {
+        iox_send_events(s);
+    } else if (s->events_used == 1) {
+        qemu_bh_schedule(s->events_bh);
+    }
+}
+
+static void pio_record_vcd(PioState *s, uint32_t changed)
+{
+    uint32_t pending;
+    int pin;
+
+    for (pending = changed & s->vcd_mask; pending; pending &= pending - 1) {
+        pin = ctz32(pending);
+        iobc_vcd_change(s->vcd, s->vcd_signal[pin], !!(s->reg_pdsr & (1 << pin)));
+    }
+}
+
+void at91_pio_set_vcd(PioState *s, IobcVcd *vcd, const char *scope, uint32_t mask)
+{
+    char name[8];
+    int pin;
+
+    s->vcd = vcd;
+    s->vcd_mask = 0;
+
+    for (pin = 0; pin < AT91_PIO_NUM_PINS; pin++) {
+        if (!(mask & (1 << pin)))
+            continue;
+
+        snprintf(name, sizeof(name), "p%d", pin);
+        s->vcd_signal[pin] = iobc_vcd_add_signal(vcd, scope, name, 1,
+                                                 !!(s->reg_pdsr & (1 << pin)));
+        if (s->vcd_signal[pin] >= 0)
+            s->vcd_mask |= 1 << pin;
+    }
+}
+
 
 inline static void pio_update_irq(PioState *s)
 {
     qemu_set_irq(s->irq, !!(s->reg_isr & s->reg_imr));
 }
 
-static void pio_update_pins(PioState *s)
+/*
+ * Recompute the pin data status from the current configuration and raw input
+ * states and propagate changes, i.e. set the interrupt status for all changed
+ * pins and update only the changed output pins. If requested, changes are
+ * reported via a single IOX pin-state frame. Does not update the IRQ line,
+ * returns the mask of changed pins.
+ */
+static uint32_t pio_update_pins(PioState *s, bool notify)
 {
-    uint32_t pdsr = s->reg_pdsr;
-    uint32_t mask;
+    const uint32_t ctrl_pio = s->reg_psr;                       // PIO controls pin
+    const uint32_t ctrl_a = ~s->reg_psr & ~s->reg_absr;         // peripheral A controls pin
+    const uint32_t ctrl_b = ~s->reg_psr & s->reg_absr;          // peripheral B controls pin
+    uint32_t pdsr;
+    uint32_t changed;
+    uint32_t pending;
     int pin;
 
-    for (pin = 0; pin < AT91_PIO_NUM_PINS; pin++) {
-        mask = 1 << pin;
-
-        if (s->reg_psr & mask) {            // PIO controlls this pin
-            if (s->reg_osr & mask) {        // configured as output
-                s->reg_pdsr = (s->reg_pdsr & ~mask) | (s->reg_odsr & mask);
-            } else {                        // configured as input
-                s->reg_pdsr = (s->reg_pdsr & ~mask) | (s->pin_state_in & mask);
-            }
-        } else if (~s->reg_absr & mask) {   // peripheral A controlls this pin
-            s->reg_pdsr = (s->reg_pdsr & ~mask) | (s->pin_state_periph_a & mask);
-        } else {                            // peripheral B controlls this pin
-            s->reg_pdsr = (s->reg_pdsr & ~mask) | (s->pin_state_periph_b & mask);
-        }
+    pdsr = (ctrl_pio &  s->reg_osr & s->reg_odsr)               // output
+         | (ctrl_pio & ~s->reg_osr & s->pin_state_in)           // input
+         | (ctrl_a & s->pin_state_periph_a)
+         | (ctrl_b & s->pin_state_periph_b);
 
-        // force pin value
-        qemu_set_irq(s->pin_out[pin], !!(s->reg_pdsr & mask));
-    }
+    changed = pdsr ^ s->reg_pdsr;
+    if (!changed)
+        return 0;
+
+    s->reg_pdsr = pdsr;
 
     // trigger interrupt on edge/change
-    s->reg_isr |= (pdsr ^ s->reg_pdsr);
-    pio_update_irq(s);
+    s->reg_isr |= changed;
+
+    if (s->events_enabled)
+        pio_record_event(s, changed);
+
+    if (s->vcd_mask & changed)
+        pio_record_vcd(s, changed);
+
+    // set associated output pins
+    for (pending = changed; pending; pending &= pending - 1) {
+        pin = ctz32(pending);
+        qemu_set_irq(s->pin_out[pin], !!(pdsr & (1 << pin)));
+    }
 
-    if (pdsr != s->reg_pdsr)
+    if (notify)
         iox_send_pin_state(s);
+
+    return changed;
 }
 
 
@@ -157,36 +270,17 @@ static void pio_handle_gpio_pin(void *opaque, int n, int level)
 {   // input via physical pin/pad
     PioState *s = opaque;
     uint32_t mask = 1 << n;
-    uint32_t pdsr = s->reg_pdsr;
 
     // save pin state
     s->pin_state_in = (s->pin_state_in & ~mask) | ((!!level) << n);
 
-    // check if PIO controls this pin
-    if (~s->reg_psr & mask)
-        return;
-
-    // check if line is output
-    if (s->reg_osr & mask)
-        return;
-
-    // set PIO output state
-    s->reg_pdsr = (s->reg_pdsr & ~mask) | ((!!level) << n);
-
-    // trigger interrupt on edge
-    if (s->reg_pdsr != pdsr) {
-        s->reg_isr |= mask;
+    if (pio_update_pins(s, false))
         pio_update_irq(s);
-    }
-
-    // set associated output pin
-    qemu_set_irq(s->pin_out[n], level);
 }
 
 static void pio_handle_gpio_periph(PioState *s, int periph, int n, int level)
 {   // input from peripheral output
     uint32_t mask = 1 << n;
-    uint32_t pdsr = s->reg_pdsr;
 
     // save pin state
     if (periph == 0) {
@@ -195,26 +289,8 @@ static void pio_handle_gpio_periph(PioState *s, int periph, int n, int level)
         s->pin_state_periph_b = (s->pin_state_periph_b & ~mask) | ((!!level) << n);
     }
 
-    // check if PIO controls this pin (ie. peripheral output not used)
-    if (s->reg_psr & mask)
-        return;
-
-    // check if correct peripheral is used
-    if (!!(s->reg_absr & mask) != !!periph)
-        return;
-
-    // set PIO output state
-    s->reg_pdsr = (s->reg_pdsr & ~mask) | ((!!level) << n);
-
-    // trigger interrupt on edge
-    if (s->reg_pdsr != pdsr) {
-        s->reg_isr |= mask;
+    if (pio_update_pins(s, true))
         pio_update_irq(s);
-        iox_send_pin_state(s);
-    }
-
-    // set associated output pin
-    qemu_set_irq(s->pin_out[n], level);
 }
 
 static void pio_handle_gpio_periph_a(void *opaque, int n, int level)
@@ -271,8 +347,8 @@ static uint64_t pio_mmio_read(void *opaque, hwaddr offset, unsigned size)
         return s->reg_owsr;
 
     default:
-        error_report("at91.pio: illegal read access at 0x%02lx", offset);
-        abort();
+        iobc_fault(&s->mmio, offset, false, "at91.pio: illegal read access at 0x%02lx", offset);
+        return 0;
     }
 }
 
@@ -314,8 +390,7 @@ static void pio_mmio_write(void *opaque, hwaddr offset, uint64_t value, unsigned
         break;
 
     case PIO_ODSR:
-        s->reg_odsr |= (s->reg_owsr & value);
-        s->reg_odsr &= (~s->reg_owsr | ~value);
+        s->reg_odsr = (s->reg_odsr & ~s->reg_owsr) | (value & s->reg_owsr);
         break;
 
     case PIO_IER:
@@ -359,17 +434,20 @@ static void pio_mmio_write(void *opaque, hwaddr offset, uint64_t value, unsigned
         break;
 
     default:
-        error_report("at91.pio: illegal read access at 0x%02lx", offset);
-        abort();
+        iobc_fault(&s->mmio, offset, true, "at91.pio: illegal read access at 0x%02lx", offset);
+        return;
     }
 
-    // TODO: move to appropriate scopes?
-    pio_update_pins(s);     // also updates IRQs
+    // at most one pin-state frame per register write
+    pio_update_pins(s, true);
+    pio_update_irq(s);
 }
 
+IOBC_FAULT_ACCESSORS(pio_mmio_read, pio_mmio_write)
+
 static const MemoryRegionOps pio_mmio_ops = {
-    .read = pio_mmio_read,
-    .write = pio_mmio_write,
+    .read_with_attrs = pio_mmio_read_tx,
+    .write_with_attrs = pio_mmio_write_tx,
     .impl.min_access_size = 4,
     .impl.max_access_size = 4,
     .valid.min_access_size = 4,
@@ -392,6 +470,8 @@ static void pio_device_init(Object *obj)
     qdev_init_gpio_in_named(DEVICE(s), pio_handle_gpio_pin, "pin.in", AT91_PIO_NUM_PINS);
     qdev_init_gpio_in_named(DEVICE(s), pio_handle_gpio_periph_a, "periph.in.a", AT91_PIO_NUM_PINS);
     qdev_init_gpio_in_named(DEVICE(s), pio_handle_gpio_periph_b, "periph.in.b", AT91_PIO_NUM_PINS);
+
+    s->events_bh = qemu_bh_new(pio_events_flush, s);
 }
 
 static void pio_reset_registers(PioState *s)
@@ -410,8 +490,15 @@ static void pio_reset_registers(PioState *s)
     s->reg_absr = 0;
     s->reg_owsr = 0;
 
-    if (pdsr != s->reg_pdsr)
+    if (pdsr != s->reg_pdsr) {
+        if (s->events_enabled)
+            pio_record_event(s, pdsr ^ s->reg_pdsr);
+
+        if (s->vcd_mask & (pdsr ^ s->reg_pdsr))
+            pio_record_vcd(s, pdsr ^ s->reg_pdsr);
+
         iox_send_pin_state(s);
+    }
 }
 
 static void pio_device_realize(DeviceState *dev, Error **errp)
@@ -446,6 +533,7 @@ static void pio_device_unrealize(DeviceState *dev, Error **errp)
     PioState *s = AT91_PIO(dev);
 
     if (s->server) {
+        iox_send_events(s);
         iox_server_free(s->server);
         s->server = NULL;
     }
@@ -462,6 +550,57 @@ static Property pio_device_properties[] = {
     DEFINE_PROP_END_OF_LIST(),
 };
 
+static int pio_pre_load(void *opaque)
+{
+    PioState *s = opaque;
+
+    // events recorded so far belong to the state being replaced
+    iox_send_events(s);
+    return 0;
+}
+
+static int pio_post_load(void *opaque, int version_id)
+{
+    PioState *s = opaque;
+
+    // let the client know about the restored pin state, but do not fail
+    // loading the snapshot if it has gone away
+    if (iox_send_u32_new(s->server, IOX_CAT_PINSTATE, IOX_CID_PINSTATE_OUT, s->reg_pdsr))
+        warn_report("at91.pio: failed to send restored pin-state");
+
+    return 0;
+}
+
+/*
+ * Note: The event stream and VCD configuration belong to the host side and
+ * are not part of the snapshot.
+ */
+static const VMStateDescription pio_vmstate = {
+    .name = TYPE_AT91_PIO,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .pre_load = pio_pre_load,
+    .post_load = pio_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_IOX_SERVER_SEQ(server, PioState),
+        VMSTATE_UINT32(reg_psr, PioState),
+        VMSTATE_UINT32(reg_osr, PioState),
+        VMSTATE_UINT32(reg_ifsr, PioState),
+        VMSTATE_UINT32(reg_odsr, PioState),
+        VMSTATE_UINT32(reg_pdsr, PioState),
+        VMSTATE_UINT32(reg_imr, PioState),
+        VMSTATE_UINT32(reg_isr, PioState),
+        VMSTATE_UINT32(reg_mdsr, PioState),
+        VMSTATE_UINT32(reg_pusr, PioState),
+        VMSTATE_UINT32(reg_absr, PioState),
+        VMSTATE_UINT32(reg_owsr, PioState),
+        VMSTATE_UINT32(pin_state_in, PioState),
+        VMSTATE_UINT32(pin_state_periph_a, PioState),
+        VMSTATE_UINT32(pin_state_periph_b, PioState),
+        VMSTATE_END_OF_LIST()
+    },
+};
+
 static void pio_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
@@ -469,6 +608,7 @@ static void pio_class_init(ObjectClass *klass, void *data)
     dc->realize = pio_device_realize;
     dc->unrealize = pio_device_unrealize;
     dc->reset = pio_device_reset;
+    dc->vmsd = &pio_vmstate;
     device_class_set_props(dc, pio_device_properties);
 }
 
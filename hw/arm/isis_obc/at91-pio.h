@@ -19,6 +19,17 @@
  * little-endian integer representing the current/to-be-set state of the 32
  * pins (bit index equals pin number).
  *
+ * Additionally, clients can subscribe to a timestamped event stream via
+ * IOX_CID_PINSTATE_EVENTS_ENABLE (payload: one byte, non-zero to enable, zero
+ * to disable). Each change of the pin data status is then recorded as event
+ * (struct at91_pio_event, all fields little-endian) containing the virtual
+ * time in nanoseconds, the mask of changed pins, and the new pin-state.
+ * Events are batched and sent as payload of IOX_CID_PINSTATE_EVENTS output
+ * frames, with up to AT91_PIO_EVENTS_PER_FRAME events per frame. Frames are
+ * sent when full or once the emulator returns to its main loop.
+ *
+ * Pin changes can also be recorded to a VCD file, see at91_pio_set_vcd().
+ *
  * See at91-pio.c for implementation status.
  *
  * Copyright (c) 2019-2020 KSat e.V. Stuttgart
@@ -34,10 +45,20 @@
 #include "hw/sysbus.h"
 
 #include "ioxfer-server.h"
+#include "iobc-vcd.h"
 
 
 #define AT91_PIO_NUM_PINS   32
 
+__attribute__ ((packed))
+struct at91_pio_event {
+    uint64_t time;          // virtual time in ns
+    uint32_t changed;       // mask of changed pins
+    uint32_t state;         // new pin-state
+};
+
+#define AT91_PIO_EVENTS_PER_FRAME   (255 / sizeof(struct at91_pio_event))
+
 #define TYPE_AT91_PIO "at91-pio"
 #define AT91_PIO(obj) OBJECT_CHECK(PioState, (obj), TYPE_AT91_PIO)
 
@@ -52,6 +73,17 @@ typedef struct {
     char* socket;
     IoXferServer *server;
 
+    // timestamped pin-state event stream
+    bool events_enabled;
+    struct at91_pio_event events[AT91_PIO_EVENTS_PER_FRAME];
+    unsigned events_used;
+    QEMUBH *events_bh;
+
+    // value change dump
+    IobcVcd *vcd;
+    uint32_t vcd_mask;
+    int vcd_signal[AT91_PIO_NUM_PINS];
+
     // registers
     uint32_t reg_psr;
     uint32_t reg_osr;
@@ -71,4 +103,11 @@ typedef struct {
     uint32_t pin_state_periph_b;
 } PioState;
 
+/*
+ * Record changes of the pins selected by mask to the given VCD writer. The
+ * pins are added as signals "p<n>" in the given scope. Must be called before
+ * recording starts.
+ */
+void at91_pio_set_vcd(PioState *s, IobcVcd *vcd, const char *scope, uint32_t mask);
+
 #endif /* HW_ARM_ISIS_OBC_PIO_H */
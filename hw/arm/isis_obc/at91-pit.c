@@ -10,8 +10,10 @@
  */
 
 #include "at91-pit.h"
+#include "iobc-fault.h"
 #include "qemu/error-report.h"
 #include "hw/irq.h"
+#include "migration/vmstate.h"
 
 
 #define PIT_MR      0x00
@@ -97,8 +99,8 @@ static uint64_t pit_mmio_read(void *opaque, hwaddr offset, unsigned size)
         return (s->picnt << 20) | pit_timer_cpiv(s);
 
     default:
-        error_report("at91.pit: illegal read access at 0x%02lx", offset);
-        abort();
+        iobc_fault(&s->mmio, offset, false, "at91.pit: illegal read access at 0x%02lx", offset);
+        return 0;
     }
 }
 
@@ -123,14 +125,16 @@ static void pit_mmio_write(void *opaque, hwaddr offset, uint64_t value, unsigned
         break;
 
     default:
-        error_report("at91.pit: illegal read access at 0x%02lx", offset);
-        abort();
+        iobc_fault(&s->mmio, offset, true, "at91.pit: illegal read access at 0x%02lx", offset);
+        return;
     }
 }
 
+IOBC_FAULT_ACCESSORS(pit_mmio_read, pit_mmio_write)
+
 static const MemoryRegionOps pit_mmio_ops = {
-    .read = pit_mmio_read,
-    .write = pit_mmio_write,
+    .read_with_attrs = pit_mmio_read_tx,
+    .write_with_attrs = pit_mmio_write_tx,
     .impl.min_access_size = 4,
     .impl.max_access_size = 4,
     .valid.min_access_size = 4,
@@ -178,12 +182,27 @@ static void pit_device_reset(DeviceState *dev)
     qemu_set_irq(s->irq, 0);
 }
 
+static const VMStateDescription pit_vmstate = {
+    .name = TYPE_AT91_PIT,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_PTIMER(timer, PitState),
+        VMSTATE_UINT32(mclk, PitState),
+        VMSTATE_UINT32(reg_mr, PitState),
+        VMSTATE_UINT32(reg_sr, PitState),
+        VMSTATE_UINT32(picnt, PitState),
+        VMSTATE_END_OF_LIST()
+    },
+};
+
 static void pit_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
     dc->realize = pit_device_realize;
     dc->reset = pit_device_reset;
+    dc->vmsd = &pit_vmstate;
 }
 
 static const TypeInfo pit_device_info = {
@@ -15,8 +15,10 @@
 //   stabilization process is currently not simulated.
 
 #include "at91-pmc.h"
+#include "iobc-fault.h"
 #include "qemu/error-report.h"
 #include "hw/irq.h"
+#include "migration/vmstate.h"
 
 
 #define SR_MOSCS    0x00000001
@@ -156,6 +158,8 @@ static uint64_t pmc_mmio_read(void *opaque, hwaddr offset, unsigned size)
         return s->reg_pmc_pck1;
 
     case PMC_SR:
+        // oscillators and PLLs lock immediately, no deadline
+        iobc_poll_read(&s->poll_sr, s->reg_pmc_sr, IOBC_POLL_NO_DEADLINE);
         return s->reg_pmc_sr;
 
     case PMC_IMR:
@@ -165,8 +169,8 @@ static uint64_t pmc_mmio_read(void *opaque, hwaddr offset, unsigned size)
         return s->reg_pmc_pllicpr;
 
     default:
-        error_report("at91.pmc illegal read access at 0x%08lx", offset);
-        abort();
+        iobc_fault(&s->mmio, offset, false, "at91.pmc illegal read access at 0x%08lx", offset);
+        return 0;
     }
 }
 
@@ -232,9 +236,9 @@ static void pmc_mmio_write(void *opaque, hwaddr offset, uint64_t value, unsigned
         break;
 
     default:
-        error_report("at91.pmc illegal write access at "
-                      "0x%08lx [value: 0x%08lx]", offset, value);
-        abort();
+        iobc_fault(&s->mmio, offset, true, "at91.pmc illegal write access at "
+                                           "0x%08lx [value: 0x%08lx]", offset, value);
+        return;
     }
 
     pmc_update_mckr(s);
@@ -243,9 +247,11 @@ static void pmc_mmio_write(void *opaque, hwaddr offset, uint64_t value, unsigned
     qemu_set_irq(s->irq, !!(s->reg_pmc_sr & s->reg_pmc_imr & PMC_IRQ_MASK));
 }
 
+IOBC_FAULT_ACCESSORS(pmc_mmio_read, pmc_mmio_write)
+
 static const MemoryRegionOps pmc_mmio_ops = {
-    .read = pmc_mmio_read,
-    .write = pmc_mmio_write,
+    .read_with_attrs = pmc_mmio_read_tx,
+    .write_with_attrs = pmc_mmio_write_tx,
     .impl.min_access_size = 4,
     .impl.max_access_size = 4,
     .valid.min_access_size = 4,
@@ -298,6 +304,8 @@ static void pmc_device_realize(DeviceState *dev, Error **errp)
     s->master_clock_freq = 0;
 
     pmc_update_mckr(s);
+
+    iobc_poll_register(&s->poll_sr, &s->mmio, PMC_SR, "SR");
 }
 
 static void pmc_device_reset(DeviceState *dev)
@@ -314,12 +322,39 @@ static void pmc_device_reset(DeviceState *dev)
     pmc_update_mckr(s);
 }
 
+/*
+ * Note: The master clock frequency is restored without notifying the
+ * observer, as all clock consumers save and restore their own copy of it.
+ */
+static const VMStateDescription pmc_vmstate = {
+    .name = TYPE_AT91_PMC,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(reg_pmc_scsr, PmcState),
+        VMSTATE_UINT32(reg_pmc_pcsr, PmcState),
+        VMSTATE_UINT32(reg_ckgr_mor, PmcState),
+        VMSTATE_UINT32(reg_ckgr_mcfr, PmcState),
+        VMSTATE_UINT32(reg_ckgr_plla, PmcState),
+        VMSTATE_UINT32(reg_ckgr_pllb, PmcState),
+        VMSTATE_UINT32(reg_pmc_mckr, PmcState),
+        VMSTATE_UINT32(reg_pmc_pck0, PmcState),
+        VMSTATE_UINT32(reg_pmc_pck1, PmcState),
+        VMSTATE_UINT32(reg_pmc_sr, PmcState),
+        VMSTATE_UINT32(reg_pmc_imr, PmcState),
+        VMSTATE_UINT32(reg_pmc_pllicpr, PmcState),
+        VMSTATE_UINT32(master_clock_freq, PmcState),
+        VMSTATE_END_OF_LIST()
+    },
+};
+
 static void pmc_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
     dc->realize = pmc_device_realize;
     dc->reset = pmc_device_reset;
+    dc->vmsd = &pmc_vmstate;
 }
 
 static void pmc_instance_init(Object *obj)
@@ -21,6 +21,8 @@
 #include "qemu/osdep.h"
 #include "hw/sysbus.h"
 
+#include "iobc-poll.h"
+
 
 #define AT91_PMC_SLCK          32768    // slow clock oscillator frequency
 #define AT91_PMC_MCK        18432000    // main oscillator frequency
@@ -65,6 +67,8 @@ typedef struct {
     // observer for master-clock change
     at91_mclk_cb *mclk_cb;
     void *mclk_opaque;
+
+    IobcPollReg poll_sr;
 } PmcState;
 
 
@@ -78,6 +82,10 @@ inline static void at91_pmc_set_mclk_change_callback(PmcState *s, void *opaque,
     s->mclk_opaque = opaque;
 }
 
+/*
+ * Set the clock register state applied on realization, i.e. the state the
+ * boot code would have set up. Must be called before the device is realized.
+ */
 inline static void at91_pmc_set_init_state(PmcState *s, const PmcInitState *init)
 {
     s->init_state = init;
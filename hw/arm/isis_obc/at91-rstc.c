@@ -15,8 +15,10 @@
 // - external reset not implemented (calling it currently does nothing)
 
 #include "at91-rstc.h"
+#include "iobc-fault.h"
 #include "qemu/error-report.h"
 #include "hw/irq.h"
+#include "migration/vmstate.h"
 
 #define RSTC_KEY_PASSWORD   0xa5
 
@@ -57,8 +59,8 @@ static uint64_t rstc_mmio_read(void *opaque, hwaddr offset, unsigned size)
         return s->reg_mr;
 
     default:
-        error_report("at91.rstc: illegal read access at 0x%02lx", offset);
-        abort();
+        iobc_fault(&s->mmio, offset, false, "at91.rstc: illegal read access at 0x%02lx", offset);
+        return 0;
     }
 }
 
@@ -93,16 +95,18 @@ static void rstc_mmio_write(void *opaque, hwaddr offset, uint64_t value, unsigne
         break;
 
     default:
-        error_report("at91.rstc: illegal read access at 0x%02lx", offset);
-        abort();
+        iobc_fault(&s->mmio, offset, true, "at91.rstc: illegal read access at 0x%02lx", offset);
+        return;
     }
 
     rstc_update_irq(s);
 }
 
+IOBC_FAULT_ACCESSORS(rstc_mmio_read, rstc_mmio_write)
+
 static const MemoryRegionOps rstc_mmio_ops = {
-    .read = rstc_mmio_read,
-    .write = rstc_mmio_write,
+    .read_with_attrs = rstc_mmio_read_tx,
+    .write_with_attrs = rstc_mmio_write_tx,
     .impl.min_access_size = 4,
     .impl.max_access_size = 4,
     .valid.min_access_size = 4,
@@ -129,11 +133,23 @@ static void rstc_device_realize(DeviceState *dev, Error **errp)
     s->reg_mr = 0;
 }
 
+static const VMStateDescription rstc_vmstate = {
+    .name = TYPE_AT91_RSTC,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(reg_sr, RstcState),
+        VMSTATE_UINT32(reg_mr, RstcState),
+        VMSTATE_END_OF_LIST()
+    },
+};
+
 static void rstc_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
     dc->realize = rstc_device_realize;
+    dc->vmsd = &rstc_vmstate;
 }
 
 static const TypeInfo rstc_device_info = {
@@ -8,8 +8,10 @@
  */
 
 #include "at91-rtt.h"
+#include "iobc-fault.h"
 #include "qemu/error-report.h"
 #include "hw/irq.h"
+#include "migration/vmstate.h"
 
 
 #define AT91_SCLK       0x8000
@@ -84,8 +86,8 @@ static uint64_t rtt_mmio_read(void *opaque, hwaddr offset, unsigned size)
         return tmp;
 
     default:
-        error_report("at91.rtt: illegal read access at 0x%02lx", offset);
-        abort();
+        iobc_fault(&s->mmio, offset, false, "at91.rtt: illegal read access at 0x%02lx", offset);
+        return 0;
     }
 }
 
@@ -108,16 +110,19 @@ static void rtt_mmio_write(void *opaque, hwaddr offset, uint64_t value, unsigned
         break;
 
     default:
-        error_report("at91.rtt: illegal write access at 0x%02lx (value: 0x%08lx)", offset, value);
-        abort();
+        iobc_fault(&s->mmio, offset, true,
+                   "at91.rtt: illegal write access at 0x%02lx (value: 0x%08lx)", offset, value);
+        return;
     }
 
     rtt_update_irq(s);
 }
 
+IOBC_FAULT_ACCESSORS(rtt_mmio_read, rtt_mmio_write)
+
 static const MemoryRegionOps rtt_mmio_ops = {
-    .read = rtt_mmio_read,
-    .write = rtt_mmio_write,
+    .read_with_attrs = rtt_mmio_read_tx,
+    .write_with_attrs = rtt_mmio_write_tx,
     .impl.min_access_size = 4,
     .impl.max_access_size = 4,
     .valid.min_access_size = 4,
@@ -168,12 +173,27 @@ static void rtt_device_reset(DeviceState *dev)
     qemu_set_irq(s->irq, 0);
 }
 
+static const VMStateDescription rtt_vmstate = {
+    .name = TYPE_AT91_RTT,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_PTIMER(timer, RttState),
+        VMSTATE_UINT32(reg_mr, RttState),
+        VMSTATE_UINT32(reg_ar, RttState),
+        VMSTATE_UINT32(reg_vr, RttState),
+        VMSTATE_UINT32(reg_sr, RttState),
+        VMSTATE_END_OF_LIST()
+    },
+};
+
 static void rtt_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
     dc->realize = rtt_device_realize;
     dc->reset = rtt_device_reset;
+    dc->vmsd = &rtt_vmstate;
 }
 
 static const TypeInfo rtt_device_info = {
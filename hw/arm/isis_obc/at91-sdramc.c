@@ -10,9 +10,11 @@
  */
 
 #include "at91-sdramc.h"
+#include "iobc-fault.h"
 #include "qapi/error.h"
 #include "qemu/error-report.h"
 #include "hw/irq.h"
+#include "migration/vmstate.h"
 #include "hw/qdev-properties.h"
 
 
@@ -87,8 +89,8 @@ static uint64_t sdramc_mmio_read(void *opaque, hwaddr offset, unsigned size)
         return s->reg_mdr;
 
     default:
-        error_report("at91.sdramc: illegal read access at 0x%02lx", offset);
-        abort();
+        iobc_fault(&s->mmio, offset, false, "at91.sdramc: illegal read access at 0x%02lx", offset);
+        return 0;
     }
 }
 
@@ -128,14 +130,16 @@ static void sdramc_mmio_write(void *opaque, hwaddr offset, uint64_t value, unsig
         break;
 
     default:
-        error_report("at91.sdramc: illegal read access at 0x%02lx", offset);
-        abort();
+        iobc_fault(&s->mmio, offset, true, "at91.sdramc: illegal read access at 0x%02lx", offset);
+        return;
     }
 }
 
+IOBC_FAULT_ACCESSORS(sdramc_mmio_read, sdramc_mmio_write)
+
 static const MemoryRegionOps sdramc_mmio_ops = {
-    .read = sdramc_mmio_read,
-    .write = sdramc_mmio_write,
+    .read_with_attrs = sdramc_mmio_read_tx,
+    .write_with_attrs = sdramc_mmio_write_tx,
     .impl.min_access_size = 4,
     .impl.max_access_size = 4,
     .valid.min_access_size = 4,
@@ -216,6 +220,23 @@ static Property sdramc_device_properties[] = {
     DEFINE_PROP_END_OF_LIST(),
 };
 
+static const VMStateDescription sdramc_vmstate = {
+    .name = TYPE_AT91_SDRAMC,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_IOX_SERVER_SEQ(server, SdramcState),
+        VMSTATE_UINT32(reg_mr, SdramcState),
+        VMSTATE_UINT32(reg_tr, SdramcState),
+        VMSTATE_UINT32(reg_cr, SdramcState),
+        VMSTATE_UINT32(reg_lpr, SdramcState),
+        VMSTATE_UINT32(reg_imr, SdramcState),
+        VMSTATE_UINT32(reg_isr, SdramcState),
+        VMSTATE_UINT32(reg_mdr, SdramcState),
+        VMSTATE_END_OF_LIST()
+    },
+};
+
 static void sdramc_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
@@ -223,6 +244,7 @@ static void sdramc_class_init(ObjectClass *klass, void *data)
     dc->realize = sdramc_device_realize;
     dc->unrealize = sdramc_device_unrealize;
     dc->reset = sdramc_device_reset;
+    dc->vmsd = &sdramc_vmstate;
     device_class_set_props(dc, sdramc_device_properties);
 }
 
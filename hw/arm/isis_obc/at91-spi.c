@@ -17,6 +17,7 @@
 //   directly simulated. This includes LASTXFER having no effect.
 
 #include "at91-spi.h"
+#include "iobc-fault.h"
 #include "exec/address-spaces.h"
 #include "sysemu/cpus.h"
 #include "qapi/error.h"
@@ -24,6 +25,7 @@
 #include "qemu/error-report.h"
 #include "qemu/log.h"
 #include "hw/irq.h"
+#include "migration/vmstate.h"
 #include "hw/qdev-properties.h"
 
 
@@ -176,7 +178,7 @@ inline static void xfer_master_wait_receive_start_dma(SpiState *s, uint32_t n)
     pause_all_vcpus();
 
     // if no server set up or it doesn't have a client, we already prepared rcvbuf
-    if (!s->server || !s->server->client)
+    if (!iox_server_connected(s->server))
         xfer_master_wait_receive_finish(s);
 }
 
@@ -189,7 +191,7 @@ inline static void xfer_master_wait_receive_start_tdr(SpiState *s)
     pause_all_vcpus();
 
     // if no server set up or it doesn't have a client, we already prepared rcvbuf
-    if (!s->server || !s->server->client)
+    if (!iox_server_connected(s->server))
         xfer_master_wait_receive_finish(s);
 }
 
@@ -420,7 +422,7 @@ static uint32_t xfer_transmit_dmabuf_varps(SpiState *s, void *dmabuf, uint32_t l
     }
 
     // if no server set up or it doesn't have a client: echo data to rcvbuf
-    if (!s->server || !s->server->client) {
+    if (!iox_server_connected(s->server)) {
         buffer_reserve(&s->rcvbuf, num_units * sizeof(uint32_t));
         buffer_append(&s->rcvbuf, units, num_units * sizeof(uint32_t));
     }
@@ -471,7 +473,7 @@ static uint32_t xfer_transmit_dmabuf_novarps(SpiState *s, void *dmabuf, uint32_t
     }
 
     // if no server set up or it doesn't have a client: echo data to rcvbuf
-    if (!s->server || !s->server->client) {
+    if (!iox_server_connected(s->server)) {
         buffer_reserve(&s->rcvbuf, num_units * sizeof(uint32_t));
         buffer_append(&s->rcvbuf, units, num_units * sizeof(uint32_t));
     }
@@ -509,7 +511,7 @@ static void xfer_transmit_tdr(SpiState *s)
         s->serializer = s->reg_tdr;
 
         // if no server set up or it doesn't have a client: echo data to rcvbuf
-        if (!s->server || !s->server->client) {
+        if (!iox_server_connected(s->server)) {
             buffer_reserve(&s->rcvbuf, sizeof(uint32_t));
             buffer_append(&s->rcvbuf, &unit, sizeof(uint32_t));
         }
@@ -684,6 +686,8 @@ static uint64_t spi_mmio_read(void *opaque, hwaddr offset, unsigned size)
             uint32_t tmp = s->reg_sr;
             s->reg_sr &= ~(SR_MODF | SR_OVRES | SR_NSSR);
             update_irq(s);
+            // master transfers complete on IOX input, no known deadline
+            iobc_poll_read(&s->poll_sr, tmp, IOBC_POLL_NO_DEADLINE);
             return tmp;
         }
 
@@ -706,8 +710,8 @@ static uint64_t spi_mmio_read(void *opaque, hwaddr offset, unsigned size)
         return at91_pdc_get_register(&s->pdc, offset);
 
     default:
-        error_report("at91.spi: illegal read access at 0x%02lx", offset);
-        abort();
+        iobc_fault(&s->mmio, offset, false, "at91.spi: illegal read access at 0x%02lx", offset);
+        return 0;
     }
 }
 
@@ -813,14 +817,16 @@ static void spi_mmio_write(void *opaque, hwaddr offset, uint64_t value, unsigned
         break;
 
     default:
-        error_report("at91.spi: illegal read access at 0x%02lx", offset);
-        abort();
+        iobc_fault(&s->mmio, offset, true, "at91.spi: illegal read access at 0x%02lx", offset);
+        return;
     }
 }
 
+IOBC_FAULT_ACCESSORS(spi_mmio_read, spi_mmio_write)
+
 static const MemoryRegionOps spi_mmio_ops = {
-    .read = spi_mmio_read,
-    .write = spi_mmio_write,
+    .read_with_attrs = spi_mmio_read_tx,
+    .write_with_attrs = spi_mmio_write_tx,
     .impl.min_access_size = 4,
     .impl.max_access_size = 4,
     .valid.min_access_size = 4,
@@ -868,6 +874,8 @@ static void spi_device_realize(DeviceState *dev, Error **errp)
     buffer_init(&s->rcvbuf, "at91.spi.rcvbuf");
     buffer_reserve(&s->rcvbuf, 1024);
 
+    iobc_poll_register(&s->poll_sr, &s->mmio, SPI_SR, "SR");
+
     if (s->socket) {
         SocketAddress addr;
         addr.type = SOCKET_ADDRESS_TYPE_UNIX;
@@ -912,6 +920,46 @@ static Property spi_device_properties[] = {
     DEFINE_PROP_END_OF_LIST(),
 };
 
+static int spi_post_load(void *opaque, int version_id)
+{
+    SpiState *s = opaque;
+
+    if (s->wait_rcv.ty > AT91_SPI_WAIT_RCV_DMA) {
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+/*
+ * Note: The receive buffer contains 32 bit units in host byte order, thus
+ * snapshots can only be restored on hosts with the same endianness.
+ */
+static const VMStateDescription spi_vmstate = {
+    .name = TYPE_AT91_SPI,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = spi_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_IOX_SERVER_SEQ(server, SpiState),
+        VMSTATE_IOX_BUFFER(rcvbuf, SpiState),
+        VMSTATE_UINT32(mclk, SpiState),
+        VMSTATE_UINT32(reg_mr, SpiState),
+        VMSTATE_UINT32(reg_sr, SpiState),
+        VMSTATE_UINT32(reg_imr, SpiState),
+        VMSTATE_UINT32(reg_rdr, SpiState),
+        VMSTATE_UINT32(reg_tdr, SpiState),
+        VMSTATE_UINT32_ARRAY(reg_csr, SpiState, 4),
+        VMSTATE_UINT16(serializer, SpiState),
+        VMSTATE_BOOL(dma_rx_enabled, SpiState),
+        VMSTATE_BOOL(dma_tx_enabled, SpiState),
+        VMSTATE_UINT32(wait_rcv.ty, SpiState),
+        VMSTATE_UINT32(wait_rcv.n, SpiState),
+        VMSTATE_AT91_PDC(pdc, SpiState),
+        VMSTATE_END_OF_LIST()
+    },
+};
+
 static void spi_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
@@ -919,6 +967,7 @@ static void spi_class_init(ObjectClass *klass, void *data)
     dc->realize = spi_device_realize;
     dc->unrealize = spi_device_unrealize;
     dc->reset = spi_device_reset;
+    dc->vmsd = &spi_vmstate;
     device_class_set_props(dc, spi_device_properties);
 }
 
@@ -49,6 +49,7 @@
 
 #include "at91-pdc.h"
 #include "ioxfer-server.h"
+#include "iobc-poll.h"
 
 
 #define TYPE_AT91_SPI "at91-spi"
@@ -86,11 +87,13 @@ typedef struct {
     bool dma_tx_enabled;
 
     struct {
-        enum wait_rcv_type ty;
+        uint32_t ty;    // one of enum wait_rcv_type
         uint32_t n;
     } wait_rcv;
 
     At91Pdc pdc;
+
+    IobcPollReg poll_sr;
 } SpiState;
 
 void at91_spi_set_master_clock(SpiState *s, unsigned mclk);
@@ -14,9 +14,11 @@
 
 
 #include "at91-tc.h"
+#include "iobc-fault.h"
 #include "at91-pmc.h"
 #include "qemu/error-report.h"
 #include "hw/irq.h"
+#include "migration/vmstate.h"
 
 
 #define TC_CCR      0x00
@@ -292,8 +294,9 @@ static uint64_t tc_chan_mmio_read(TcChanState *s, hwaddr offset, unsigned size)
         return s->reg_imr;
 
     default:
-        error_report("at91.tc: illegal read access at 0x%02lx", offset);
-        abort();
+        iobc_fault(&s->parent->mmio, (s - s->parent->chan) * TCC1_START + offset, false,
+                   "at91.tc: illegal read access at 0x%02lx", offset);
+        return 0;
     }
 }
 
@@ -360,8 +363,9 @@ static void tc_chan_mmio_write(TcChanState *s, hwaddr offset, uint64_t value, un
         break;
 
     default:
-        error_report("at91.tc: illegal write access at 0x%02lx (value: 0x%02lx)", offset, value);
-        abort();
+        iobc_fault(&s->parent->mmio, (s - s->parent->chan) * TCC1_START + offset, true,
+                   "at91.tc: illegal write access at 0x%02lx (value: 0x%02lx)", offset, value);
+        return;
     }
 }
 
@@ -384,8 +388,8 @@ static uint64_t tc_mmio_read(void *opaque, hwaddr offset, unsigned size)
         return s->reg_bmr;
 
     default:
-        error_report("at91.tc: illegal read access at 0x%02lx", offset);
-        abort();
+        iobc_fault(&s->mmio, offset, false, "at91.tc: illegal read access at 0x%02lx", offset);
+        return 0;
     }
 }
 
@@ -422,14 +426,17 @@ static void tc_mmio_write(void *opaque, hwaddr offset, uint64_t value, unsigned
         return;
 
     default:
-        error_report("at91.tc: illegal write access at 0x%02lx (value: 0x%02lx)", offset, value);
-        abort();
+        iobc_fault(&s->mmio, offset, true,
+                   "at91.tc: illegal write access at 0x%02lx (value: 0x%02lx)", offset, value);
+        return;
     }
 }
 
+IOBC_FAULT_ACCESSORS(tc_mmio_read, tc_mmio_write)
+
 static const MemoryRegionOps tc_mmio_ops = {
-    .read = tc_mmio_read,
-    .write = tc_mmio_write,
+    .read_with_attrs = tc_mmio_read_tx,
+    .write_with_attrs = tc_mmio_write_tx,
     .impl.min_access_size = 4,
     .impl.max_access_size = 4,
     .valid.min_access_size = 4,
@@ -481,12 +488,45 @@ static void tc_device_reset(DeviceState *dev)
     tc_reset_registers(s);
 }
 
+static const VMStateDescription tc_chan_vmstate = {
+    .name = TYPE_AT91_TC "/channel",
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(clk, TcChanState),
+        VMSTATE_PTIMER(timer, TcChanState),
+        VMSTATE_INT32(cstep, TcChanState),
+        VMSTATE_UINT32(reg_cmr, TcChanState),
+        VMSTATE_UINT32(reg_cv, TcChanState),
+        VMSTATE_UINT32(reg_ra, TcChanState),
+        VMSTATE_UINT32(reg_rb, TcChanState),
+        VMSTATE_UINT32(reg_rc, TcChanState),
+        VMSTATE_UINT32(reg_sr, TcChanState),
+        VMSTATE_UINT32(reg_imr, TcChanState),
+        VMSTATE_END_OF_LIST()
+    },
+};
+
+static const VMStateDescription tc_vmstate = {
+    .name = TYPE_AT91_TC,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_STRUCT_ARRAY(chan, TcState, AT91_TC_NUM_CHANNELS, 1,
+                             tc_chan_vmstate, TcChanState),
+        VMSTATE_UINT32(mclk, TcState),
+        VMSTATE_UINT32(reg_bmr, TcState),
+        VMSTATE_END_OF_LIST()
+    },
+};
+
 static void tc_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
     dc->realize = tc_device_realize;
     dc->reset = tc_device_reset;
+    dc->vmsd = &tc_vmstate;
 }
 
 static const TypeInfo tc_device_info = {
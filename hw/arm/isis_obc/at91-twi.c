@@ -14,10 +14,12 @@
 // - Software-reset (CR_SWRST) not implemented.
 
 #include "at91-twi.h"
+#include "iobc-fault.h"
 #include "exec/address-spaces.h"
 #include "qemu/error-report.h"
 #include "qapi/error.h"
 #include "hw/irq.h"
+#include "migration/vmstate.h"
 #include "hw/qdev-properties.h"
 
 #define IOX_CAT_DATA            0x01
@@ -186,6 +188,17 @@ static void xfer_chrtx_timer_tick(void *opaque)
     twi_update_irq(s);
 }
 
+// TXCOMP is set when the chrtx timer expires, i.e. once no more data is written
+static int64_t twi_next_event(TwiState *s)
+{
+    if (!s->sendbuf.offset || !s->clock) {
+        return IOBC_POLL_NO_DEADLINE;
+    }
+
+    return qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL)
+        + (ptimer_get_count(s->chrtx_timer) + 1) * (NANOSECONDS_PER_SECOND / s->clock);
+}
+
 static void xfer_chr_transmit(TwiState *s, uint8_t value)
 {
     buffer_reserve(&s->sendbuf, 1);
@@ -198,6 +211,8 @@ static void xfer_chr_transmit(TwiState *s, uint8_t value)
     ptimer_run(s->chrtx_timer, true);
     ptimer_transaction_commit(s->chrtx_timer);
 
+    // the frame is in progress until the send task has run
+    s->reg_sr &= ~SR_TXCOMP;
     s->reg_sr |= SR_TXRDY;
     twi_update_irq(s);
 }
@@ -469,6 +484,7 @@ static uint64_t twi_mmio_read(void *opaque, hwaddr offset, unsigned size)
             uint32_t sr = s->reg_sr;
             s->reg_sr &= ~(SR_GACC | SR_OVRE | SR_NACK | SR_ARBLST | SR_EOSACC);
             twi_update_irq(s);
+            iobc_poll_read(&s->poll_sr, sr, twi_next_event(s));
             return sr;
         }
 
@@ -485,8 +501,8 @@ static uint64_t twi_mmio_read(void *opaque, hwaddr offset, unsigned size)
         return 0;
 
     default:
-        error_report("at91.twi: illegal read access at 0x%02lx", offset);
-        abort();
+        iobc_fault(&s->mmio, offset, false, "at91.twi: illegal read access at 0x%02lx", offset);
+        return 0;
     }
 }
 
@@ -644,14 +660,16 @@ static void twi_mmio_write(void *opaque, hwaddr offset, uint64_t value, unsigned
         break;
 
     default:
-        error_report("at91.twi: illegal write access at 0x%02lx", offset);
-        abort();
+        iobc_fault(&s->mmio, offset, true, "at91.twi: illegal write access at 0x%02lx", offset);
+        return;
     }
 }
 
+IOBC_FAULT_ACCESSORS(twi_mmio_read, twi_mmio_write)
+
 static const MemoryRegionOps twi_mmio_ops = {
-    .read = twi_mmio_read,
-    .write = twi_mmio_write,
+    .read_with_attrs = twi_mmio_read_tx,
+    .write_with_attrs = twi_mmio_write_tx,
     .impl.min_access_size = 4,
     .impl.max_access_size = 4,
     .valid.min_access_size = 4,
@@ -702,6 +720,8 @@ static void twi_device_realize(DeviceState *dev, Error **errp)
     buffer_init(&s->sendbuf, "at91.twi.sendbuf");
     buffer_reserve(&s->sendbuf, 256);
 
+    iobc_poll_register(&s->poll_sr, &s->mmio, TWI_SR, "SR");
+
     if (s->socket) {
         SocketAddress addr;
         addr.type = SOCKET_ADDRESS_TYPE_UNIX;
@@ -746,6 +766,43 @@ static Property twi_device_properties[] = {
     DEFINE_PROP_END_OF_LIST(),
 };
 
+static int twi_post_load(void *opaque, int version_id)
+{
+    TwiState *s = opaque;
+
+    if (s->mode > AT91_TWI_MODE_SLAVE) {
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static const VMStateDescription twi_vmstate = {
+    .name = TYPE_AT91_TWI,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = twi_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_IOX_SERVER_SEQ(server, TwiState),
+        VMSTATE_IOX_BUFFER(rcvbuf, TwiState),
+        VMSTATE_IOX_BUFFER(sendbuf, TwiState),
+        VMSTATE_PTIMER(chrtx_timer, TwiState),
+        VMSTATE_UINT32(mode, TwiState),
+        VMSTATE_UINT32(mclk, TwiState),
+        VMSTATE_UINT32(clock, TwiState),
+        VMSTATE_UINT32(reg_mmr, TwiState),
+        VMSTATE_UINT32(reg_smr, TwiState),
+        VMSTATE_UINT32(reg_iadr, TwiState),
+        VMSTATE_UINT32(reg_cwgr, TwiState),
+        VMSTATE_UINT32(reg_sr, TwiState),
+        VMSTATE_UINT32(reg_imr, TwiState),
+        VMSTATE_UINT32(reg_rhr, TwiState),
+        VMSTATE_AT91_PDC(pdc, TwiState),
+        VMSTATE_BOOL(dma_rx_enabled, TwiState),
+        VMSTATE_END_OF_LIST()
+    },
+};
+
 static void twi_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
@@ -753,6 +810,7 @@ static void twi_class_init(ObjectClass *klass, void *data)
     dc->realize = twi_device_realize;
     dc->unrealize = twi_device_unrealize;
     dc->reset = twi_device_reset;
+    dc->vmsd = &twi_vmstate;
     device_class_set_props(dc, twi_device_properties);
 }
 
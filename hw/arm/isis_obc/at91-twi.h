@@ -50,6 +50,7 @@
 
 #include "at91-pdc.h"
 #include "ioxfer-server.h"
+#include "iobc-poll.h"
 
 
 #define TYPE_AT91_TWI "at91-twi"
@@ -74,7 +75,7 @@ typedef struct {
     Buffer sendbuf;
     ptimer_state *chrtx_timer;
 
-    TwiMode mode;
+    uint32_t mode;      // one of TwiMode
     unsigned mclk;
     unsigned clock;
 
@@ -88,6 +89,8 @@ typedef struct {
 
     At91Pdc pdc;
     bool dma_rx_enabled;
+
+    IobcPollReg poll_sr;
 } TwiState;
 
 
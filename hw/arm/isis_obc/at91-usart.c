@@ -29,10 +29,12 @@
 
 
 #include "at91-usart.h"
+#include "iobc-fault.h"
 #include "exec/address-spaces.h"
 #include "qemu/error-report.h"
 #include "qapi/error.h"
 #include "hw/irq.h"
+#include "migration/vmstate.h"
 #include "hw/qdev-properties.h"
 
 
@@ -604,8 +606,8 @@ static uint64_t usart_mmio_read(void *opaque, hwaddr offset, unsigned size)
         return at91_pdc_get_register(&s->pdc, offset);
 
     default:
-        error_report("at91.usart: illegal read access at 0x%03lx", offset);
-        abort();
+        iobc_fault(&s->mmio, offset, false, "at91.usart: illegal read access at 0x%03lx", offset);
+        return 0;
     }
 }
 
@@ -819,15 +821,17 @@ static void usart_mmio_write(void *opaque, hwaddr offset, uint64_t value, unsign
         break;
 
     default:
-        error_report("at91.usart: illegal write access at "
-                      "0x%03lx [value: 0x%08lx]", offset, value);
-        abort();
+        iobc_fault(&s->mmio, offset, true, "at91.usart: illegal write access at "
+                                           "0x%03lx [value: 0x%08lx]", offset, value);
+        return;
     }
 }
 
+IOBC_FAULT_ACCESSORS(usart_mmio_read, usart_mmio_write)
+
 static const MemoryRegionOps usart_mmio_ops = {
-    .read = usart_mmio_read,
-    .write = usart_mmio_write,
+    .read_with_attrs = usart_mmio_read_tx,
+    .write_with_attrs = usart_mmio_write_tx,
     .impl.min_access_size = 4,
     .impl.max_access_size = 4,
     .valid.min_access_size = 4,
@@ -919,6 +923,34 @@ static Property usart_device_properties[] = {
     DEFINE_PROP_END_OF_LIST(),
 };
 
+static const VMStateDescription usart_vmstate = {
+    .name = TYPE_AT91_USART,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_IOX_SERVER_SEQ(server, UsartState),
+        VMSTATE_IOX_BUFFER(rcvbuf, UsartState),
+        VMSTATE_UINT32(mclk, UsartState),
+        VMSTATE_UINT32(baud, UsartState),
+        VMSTATE_UINT32(reg_mr, UsartState),
+        VMSTATE_UINT32(reg_imr, UsartState),
+        VMSTATE_UINT32(reg_csr, UsartState),
+        VMSTATE_UINT32(reg_rhr, UsartState),
+        VMSTATE_UINT32(reg_brgr, UsartState),
+        VMSTATE_UINT32(reg_rtor, UsartState),
+        VMSTATE_UINT32(reg_ttgr, UsartState),
+        VMSTATE_UINT32(reg_fidi, UsartState),
+        VMSTATE_UINT32(reg_ner, UsartState),
+        VMSTATE_UINT32(reg_if, UsartState),
+        VMSTATE_UINT32(reg_man, UsartState),
+        VMSTATE_BOOL(rx_dma_enabled, UsartState),
+        VMSTATE_BOOL(rx_enabled, UsartState),
+        VMSTATE_BOOL(tx_enabled, UsartState),
+        VMSTATE_AT91_PDC(pdc, UsartState),
+        VMSTATE_END_OF_LIST()
+    },
+};
+
 static void usart_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
@@ -926,6 +958,7 @@ static void usart_class_init(ObjectClass *klass, void *data)
     dc->realize = usart_device_realize;
     dc->unrealize = usart_device_unrealize;
     dc->reset = usart_device_reset;
+    dc->vmsd = &usart_vmstate;
     device_class_set_props(dc, usart_device_properties);
 }
 
@@ -12,6 +12,7 @@
 #include "gpio-led.h"
 #include "qemu/error-report.h"
 #include "hw/qdev-properties.h"
+#include "migration/vmstate.h"
 
 
 static void gpio_led_irq_handle(void *opaque, int n, int level)
@@ -49,12 +50,23 @@ static Property gpio_led_properties[] = {
     DEFINE_PROP_END_OF_LIST(),
 };
 
+static const VMStateDescription gpio_led_vmstate = {
+    .name = TYPE_GPIO_LED,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_INT32(state, GpioLedState),
+        VMSTATE_END_OF_LIST()
+    },
+};
+
 static void gpio_led_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
     dc->realize = gpio_led_device_realize;
     dc->reset = gpio_led_device_reset;
+    dc->vmsd = &gpio_led_vmstate;
     device_class_set_props(dc, gpio_led_properties);
 }
 
@@ -4,6 +4,89 @@
  * Main board file for the ISIS iOBC board with AT91-SAM chip.
  * See iobc_init function for connected devices and device setup.
  *
+ * Machine options:
+ * - vcd=<file>: Record pin changes of the PIO controllers to the given value
+ *   change dump file.
+ * - vcd-pioa/vcd-piob/vcd-pioc=<mask>: Pins of the respective PIO controller
+ *   to record (default: all).
+ * - socket-prefix=<prefix>: Path prefix for the IOX sockets of the
+ *   peripherals, e.g. "<prefix>usart0" (default: "/tmp/qemu_at91_").
+ * - log=<chardev>: Map the emulator logging channel (see iobc-log.h) at
+ *   0x9000_0000 and write its output to the chardev with the given ID.
+ * - pflash-memdev=<id>, sdram-memdev=<id>: Use the given memory backend
+ *   object (e.g. memory-backend-file) for the NOR flash and SDRAM instead of
+ *   anonymous memory. The backend must have a size of 256 MiB.
+ * - pflash-file=<file>: Map the given NOR flash image file into the NOR flash
+ *   region instead of loading it. Pages are read on demand. The file size
+ *   must be a multiple of the host page size and at most 256 MiB; the
+ *   remainder of the region is backed by anonymous memory.
+ * - pflash-share=on|off: Write NOR flash changes through to pflash-file
+ *   (default: off, i.e. changes are private to this instance).
+ * - pflash-cfi=on|off: Model the NOR flash as 1 MiB CFI flash (see
+ *   iobc-pflash.h) instead of plain memory (default: off). The flash contents
+ *   can be backed by a 1 MiB image via -drive if=pflash,format=raw,file=...
+ * - pflash-timing=on|off: Let CFI erase and program operations take their
+ *   typical time in virtual time (default: off).
+ * - norflash=<file>, sdram=<file>: Load the given raw image to the start of
+ *   the NOR flash or SDRAM.
+ * - elf=<file>: Load the segments of the given ELF file to their physical
+ *   addresses. Its symbols are kept for disassembly and profiling output.
+ * - boot-profile=rom|norflash|sdram: Boot via hardware reset (PC at 0),
+ *   start directly in NOR flash, or start directly in SDRAM with clocks set
+ *   up as by the bootloader (default: rom).
+ * - entry=<addr>: Initial program counter, overriding the boot profile and
+ *   the ELF entry point. Accepts an address or one of the memory region
+ *   names bootmem, rom, sram0, sram1, norflash, and sdram.
+ * - snapshot-cache=<dir>: Resume from a cached snapshot of the booted
+ *   firmware if available, create it otherwise (see iobc-warmstart.h).
+ * - ready-pc=<addr>: Program counter at which the firmware is considered
+ *   booted, i.e. at which the snapshot is created. Alternatively, use the
+ *   QMP command iobc-warm-start-ready.
+ * - turbo-idle=on|off: Whenever the CPU is idle (i.e. halted by WFI or at an
+ *   idle-pc), advance the virtual clock directly to the next timer deadline
+ *   instead of waiting for it in real time (default: off). Has no effect with
+ *   -icount, use -icount sleep=off there instead.
+ * - idle-pc=<addr>[:<addr>...]: Program counters of busy-waiting idle loops,
+ *   e.g. in the FreeRTOS idle hook. The CPU is halted as if by WFI when
+ *   reaching one of them and continues there on the next interrupt.
+ * - poll-skip=on|off: When the CPU repeatedly reads an unchanged peripheral
+ *   status register (e.g. TWI_SR waiting for TXCOMP), advance the virtual
+ *   clock to the status change if its time is known (default: off, see
+ *   iobc-poll.h). Has no effect with -icount.
+ *
+ * - fuzz-start=<addr>: Enable the fuzzing harness (see iobc-fuzz.h). The
+ *   snapshot for fuzzing is taken when reaching this program counter.
+ * - fuzz-done=<addr>[:<addr>...]: Program counters at which a fuzzing run is
+ *   considered done.
+ * - fuzz-target=usart0..usart5|spi0|spi1|twi: Peripheral receiving the
+ *   fuzzer input (default: usart0).
+ * - fuzz-input=<file|dir>: Input file (e.g. AFL's @@) or directory of inputs
+ *   to replay (default: stdin).
+ * - fuzz-timeout=<ms>: Timeout of a fuzzing run in virtual time (default:
+ *   100).
+ * - large-pages=on|off: Use 4 KiB instead of 1 KiB target pages for the
+ *   softmmu TLB and translated code tracking (default: off). This is faster
+ *   for firmware not using the MMU or using only sections and 4 KiB pages.
+ *   1 KiB tiny pages and 4 KiB pages with differing subpage permissions
+ *   still work, but need a page table walk on every access. Snapshots are
+ *   not compatible between both settings.
+ * - softfloat-intercept=off|on|verify: Intercept calls to the soft-float
+ *   routines of libgcc and libc (__aeabi_dadd, sqrt, ...) and compute their
+ *   result directly instead of executing them (default: off). Calls with
+ *   results not exactly defined by IEEE 754 (e.g. NaN) are still executed.
+ *   With verify, all routines are executed and their results are compared
+ *   against the intercepted ones (see target/arm/softfloat-intercept.c).
+ * - softfloat-funcs=<name>[=<addr>][:<name>[=<addr>]...]: Routines to
+ *   intercept, looked up in the ELF symbols if no address is given
+ *   (default: all supported routines found in the ELF symbols).
+ * - fault-policy=<policy>[:<prefix>=<policy>...]: Handling of accesses to
+ *   reserved memory regions and illegal peripheral registers: abort,
+ *   data-abort, log, or stop (default: abort). Policies can be given per
+ *   memory region name prefix (see iobc-fault.h).
+ *
+ * The virtual time scale and turbo-idle can be changed at runtime via the QMP
+ * command iobc-set-time-scale.
+ *
  * Copyright (c) 2019-2020 KSat e.V. Stuttgart
  *
  * This work is licensed under the terms of the GNU GPL, version 2 or, at your
@@ -13,20 +96,39 @@
 #include "qemu/osdep.h"
 #include "qemu-common.h"
 #include "qemu/error-report.h"
+#include "qemu/cutils.h"
+#include "qemu/option.h"
 #include "qapi/error.h"
+#include "qapi/qapi-commands-misc-target.h"
 #include "hw/hw.h"
 #include "hw/loader.h"
 #include "hw/boards.h"
 #include "hw/arm/boot.h"
 #include "hw/misc/unimp.h"
 #include "sysemu/sysemu.h"
+#include "sysemu/hostmem.h"
+#include "sysemu/blockdev.h"
+#include "sysemu/block-backend.h"
+#include "sysemu/cpus.h"
+#include "chardev/char.h"
+#include "migration/vmstate.h"
 #include "cpu.h"
+#include "elf.h"
+#include "disas/disas.h"
+#include "exec/gdbstub.h"
 
 #include "iobc-reserved_memory.h"
+#include "iobc-vcd.h"
+#include "iobc-pflash.h"
+#include "iobc-warmstart.h"
+#include "iobc-fuzz.h"
+#include "iobc-fault.h"
+#include "iobc-poll.h"
 #include "at91-pmc.h"
 #include "at91-aic.h"
 #include "at91-aic_stub.h"
 #include "at91-dbgu.h"
+#include "iobc-log.h"
 #include "at91-rtt.h"
 #include "at91-pit.h"
 #include "at91-matrix.h"
@@ -40,34 +142,76 @@
 #include "at91-tc.h"
 
 
-#define SOCKET_TWI      "/tmp/qemu_at91_twi"
-#define SOCKET_USART0   "/tmp/qemu_at91_usart0"
-#define SOCKET_USART1   "/tmp/qemu_at91_usart1"
-#define SOCKET_USART2   "/tmp/qemu_at91_usart2"
-#define SOCKET_USART3   "/tmp/qemu_at91_usart3"
-#define SOCKET_USART4   "/tmp/qemu_at91_usart4"
-#define SOCKET_USART5   "/tmp/qemu_at91_usart5"
-#define SOCKET_SPI0     "/tmp/qemu_at91_spi0"
-#define SOCKET_SPI1     "/tmp/qemu_at91_spi1"
-#define SOCKET_PIOA     "/tmp/qemu_at91_pioa"
-#define SOCKET_PIOB     "/tmp/qemu_at91_piob"
-#define SOCKET_PIOC     "/tmp/qemu_at91_pioc"
-#define SOCKET_SDRAMC   "/tmp/qemu_at91_sdramc"
+#define SOCKET_PREFIX   "/tmp/qemu_at91_"
+
+#define SOCKET_TWI      "twi"
+#define SOCKET_USART0   "usart0"
+#define SOCKET_USART1   "usart1"
+#define SOCKET_USART2   "usart2"
+#define SOCKET_USART3   "usart3"
+#define SOCKET_USART4   "usart4"
+#define SOCKET_USART5   "usart5"
+#define SOCKET_SPI0     "spi0"
+#define SOCKET_SPI1     "spi1"
+#define SOCKET_PIOA     "pioa"
+#define SOCKET_PIOB     "piob"
+#define SOCKET_PIOC     "pioc"
+#define SOCKET_SDRAMC   "sdramc"
+
+#define SIZE_PFLASH     0x10000000
+#define SIZE_SDRAM      0x10000000
 
 #define ADDR_BOOTMEM    0x00000000
+#define ADDR_ROM        0x00100000
+#define ADDR_SRAM0      0x00200000
+#define ADDR_SRAM1      0x00300000
+#define ADDR_PFLASH     0x10000000
 #define ADDR_SDRAMC     0x20000000
+#define ADDR_LOG        0x90000000
 
 
-#define IOBC_LOADER_NONE    0
-#define IOBC_LOADER_DBG     1
-
-#define IOBC_LOADER         IOBC_LOADER_NONE
+typedef enum {
+    IOBC_BOOT_ROM,
+    IOBC_BOOT_NORFLASH,
+    IOBC_BOOT_SDRAM,
+    __IOBC_BOOT_NUM_PROFILES,
+} IobcBootProfile;
 
+static const char *iobc_boot_profile_names[] = {
+    [IOBC_BOOT_ROM]      = "rom",
+    [IOBC_BOOT_NORFLASH] = "norflash",
+    [IOBC_BOOT_SDRAM]    = "sdram",
+};
 
-#if IOBC_LOADER == IOBC_LOADER_DBG
+typedef enum {
+    IOBC_SOFTFLOAT_OFF,
+    IOBC_SOFTFLOAT_ON,
+    IOBC_SOFTFLOAT_VERIFY,
+    __IOBC_SOFTFLOAT_NUM_MODES,
+} IobcSoftFloatMode;
+
+static const char *iobc_softfloat_mode_names[] = {
+    [IOBC_SOFTFLOAT_OFF]    = "off",
+    [IOBC_SOFTFLOAT_ON]     = "on",
+    [IOBC_SOFTFLOAT_VERIFY] = "verify",
+};
 
-#define IOBC_START_ADDRESS  ADDR_SDRAMC
+static const struct {
+    const char *name;
+    hwaddr addr;
+} iobc_mem_names[] = {
+    { "bootmem",  ADDR_BOOTMEM },
+    { "rom",      ADDR_ROM     },
+    { "sram0",    ADDR_SRAM0   },
+    { "sram1",    ADDR_SRAM1   },
+    { "norflash", ADDR_PFLASH  },
+    { "sdram",    ADDR_SDRAMC  },
+};
 
+/*
+ * Clock setup for starting directly in SDRAM. This is done by the bootloader
+ * on real hardware, or via jlink when debug-loading.
+ */
 static const PmcInitState pmc_init_state_sdram = {
     .reg_ckgr_mor     = 0x00004001,
     .reg_ckgr_plla    = 0x202a3f01,
@@ -75,14 +219,54 @@ static const PmcInitState pmc_init_state_sdram = {
     .reg_pmc_mckr     = 0x00001302,
 };
 
-#else /* IOBC_LOADER */
+#define TYPE_IOBC_MACHINE MACHINE_TYPE_NAME("isis-obc")
+#define IOBC_MACHINE(obj) OBJECT_CHECK(IobcMachineState, (obj), TYPE_IOBC_MACHINE)
+
+typedef struct {
+    MachineState parent_obj;
+
+    char *vcd;
+    uint32_t vcd_pio[3];
+
+    char *socket_prefix;
+    char *log;
+    char *pflash_memdev;
+    char *sdram_memdev;
+    char *pflash_file;
+    bool pflash_share;
+    bool pflash_cfi;
+    bool pflash_timing;
 
-#define IOBC_START_ADDRESS  ADDR_BOOTMEM
+    char *norflash;
+    char *sdram;
+    char *elf;
+    char *entry;
+    IobcBootProfile boot_profile;
+
+    char *snapshot_cache;
+    char *ready_pc;
+
+    bool turbo_idle;
+    char *idle_pc;
+    bool poll_skip;
+
+    char *fuzz_start;
+    char *fuzz_done;
+    char *fuzz_target;
+    char *fuzz_input;
+    uint32_t fuzz_timeout;
+
+    char *fault_policy;
+
+    bool large_pages;
+
+    IobcSoftFloatMode softfloat;
+    char *softfloat_funcs;
+} IobcMachineState;
 
-#endif /* IOBC_LOADER */
 
 static struct arm_boot_info iobc_board_binfo = {
-    .loader_start     = IOBC_START_ADDRESS,
+    .loader_start     = ADDR_BOOTMEM,
     .ram_size         = 0x10000000,
     .nb_cpus          = 1,
 };
@@ -95,8 +279,8 @@ typedef struct {
     MemoryRegion mem_rom;
     MemoryRegion mem_sram0;
     MemoryRegion mem_sram1;
-    MemoryRegion mem_pflash;
-    MemoryRegion mem_sdram;
+    MemoryRegion *mem_pflash;
+    MemoryRegion *mem_sdram;
 
     DeviceState *dev_pmc;
     DeviceState *dev_aic;
@@ -127,6 +311,9 @@ typedef struct {
     qemu_irq irq_sysc[32];
 
     at91_bootmem_region mem_boot_target;
+
+    bool has_entry;
+    hwaddr entry;
 } IobcBoardState;
 
 
@@ -169,10 +356,421 @@ static void iobc_mkclk_changed(void *opaque, unsigned clock)
     at91_tc_set_master_clock(AT91_TC(s->dev_tc345), clock);
 }
 
+static void iobc_cpu_reset(void *opaque)
+{
+    IobcBoardState *s = opaque;
+
+    cpu_set_pc(CPU(s->cpu), s->entry);
+}
+
+static bool iobc_parse_addr(const char *str, hwaddr *addr)
+{
+    uint64_t value;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(iobc_mem_names); i++) {
+        if (!strcmp(str, iobc_mem_names[i].name)) {
+            *addr = iobc_mem_names[i].addr;
+            return true;
+        }
+    }
+
+    if (qemu_strtou64(str, NULL, 0, &value) || value > UINT32_MAX) {
+        return false;
+    }
+
+    *addr = value;
+    return true;
+}
+
+static void iobc_load_images(IobcMachineState *m, IobcBoardState *s)
+{
+    uint64_t entry;
+
+    if (m->norflash && rom_add_file_fixed(m->norflash, ADDR_PFLASH, -1) < 0) {
+        error_report("iobc: unable to load '%s' into norflash", m->norflash);
+        exit(1);
+    }
+
+    if (m->sdram && rom_add_file_fixed(m->sdram, ADDR_SDRAMC, -1) < 0) {
+        error_report("iobc: unable to load '%s' into sdram", m->sdram);
+        exit(1);
+    }
+
+    switch (m->boot_profile) {
+    case IOBC_BOOT_NORFLASH:
+        s->has_entry = true;
+        s->entry = ADDR_PFLASH;
+        break;
+
+    case IOBC_BOOT_SDRAM:
+        s->has_entry = true;
+        s->entry = ADDR_SDRAMC;
+        break;
+
+    default:
+        s->has_entry = false;
+        break;
+    }
+
+    // segments are loaded to their physical (load) addresses, symbols are
+    // registered for lookup_symbol()
+    if (m->elf) {
+        if (load_elf(m->elf, NULL, NULL, NULL, &entry, NULL, NULL, NULL,
+                     0, EM_ARM, 1, 0) < 0) {
+            error_report("iobc: unable to load ELF file '%s'", m->elf);
+            exit(1);
+        }
+
+        s->has_entry = true;
+        s->entry = entry;
+    }
+
+    if (m->entry) {
+        if (!iobc_parse_addr(m->entry, &s->entry)) {
+            error_report("iobc: invalid entry address '%s'", m->entry);
+            exit(1);
+        }
+        s->has_entry = true;
+    }
+}
+
+static void iobc_warm_start_add_drive(IobcWarmStart *ws, const char *name,
+                                      BlockInterfaceType type, int unit)
+{
+    DriveInfo *dinfo = drive_get(type, 0, unit);
+    const char *file = dinfo ? qemu_opt_get(dinfo->opts, "file") : NULL;
+
+    if (file) {
+        iobc_warm_start_add_file(ws, name, file, false);
+    } else {
+        iobc_warm_start_add_value(ws, name, dinfo ? "<drive>" : NULL);
+    }
+}
+
+static void iobc_warm_start_init(IobcMachineState *m, IobcBoardState *s)
+{
+    IobcWarmStart *ws = iobc_warm_start_new(m->snapshot_cache);
+    hwaddr ready_pc = 0;
+
+    // configuration affecting the machine state
+    iobc_warm_start_add_value(ws, "boot-profile", iobc_boot_profile_names[m->boot_profile]);
+    iobc_warm_start_add_value(ws, "entry", m->entry);
+    iobc_warm_start_add_value(ws, "ready-pc", m->ready_pc);
+    iobc_warm_start_add_value(ws, "pflash-cfi", m->pflash_cfi ? "on" : "off");
+    iobc_warm_start_add_value(ws, "pflash-timing", m->pflash_timing ? "on" : "off");
+    iobc_warm_start_add_value(ws, "large-pages", m->large_pages ? "on" : "off");
+    // the logging channel is only instantiated (with its vmstate) if given
+    iobc_warm_start_add_value(ws, "log", m->log ? "on" : "off");
+
+    // firmware images
+    if (m->norflash) {
+        iobc_warm_start_add_file(ws, "norflash", m->norflash, true);
+    }
+    if (m->sdram) {
+        iobc_warm_start_add_file(ws, "sdram", m->sdram, true);
+    }
+    if (m->elf) {
+        iobc_warm_start_add_file(ws, "elf", m->elf, true);
+    }
+    if (m->pflash_file) {
+        iobc_warm_start_add_file(ws, "pflash-file", m->pflash_file, true);
+    }
+
+    // drives, only identified by path, size, and modification time
+    iobc_warm_start_add_drive(ws, "pflash-drive", IF_PFLASH, 0);
+    iobc_warm_start_add_drive(ws, "sd0", IF_SD, 0);
+    iobc_warm_start_add_drive(ws, "sd1", IF_SD, 1);
+
+    if (m->ready_pc && !iobc_parse_addr(m->ready_pc, &ready_pc)) {
+        error_report("iobc: invalid ready-pc address '%s'", m->ready_pc);
+        exit(1);
+    }
+
+    iobc_warm_start_activate(ws, s->cpu, m->ready_pc != NULL, ready_pc);
+}
+
+static bool iobc_parse_addr_list(const char *str, GArray *addrs)
+{
+    gchar **parts = g_strsplit(str, ":", -1);
+    hwaddr addr;
+    bool ok = true;
+    int i;
+
+    for (i = 0; parts[i]; i++) {
+        if (!iobc_parse_addr(parts[i], &addr)) {
+            ok = false;
+            break;
+        }
+
+        if (addrs) {
+            g_array_append_val(addrs, addr);
+        }
+    }
+
+    g_strfreev(parts);
+    return ok;
+}
+
+static void iobc_idle_init(IobcMachineState *m, IobcBoardState *s)
+{
+    GArray *addrs = g_array_new(false, false, sizeof(hwaddr));
+    int i;
+
+    if (m->idle_pc) {
+        iobc_parse_addr_list(m->idle_pc, addrs);
+    }
+
+    for (i = 0; i < addrs->len; i++) {
+        cpu_breakpoint_insert(CPU(s->cpu), g_array_index(addrs, hwaddr, i), BP_IDLE, NULL);
+    }
+
+    g_array_free(addrs, true);
+
+    cpu_set_idle_warp(m->turbo_idle);
+    iobc_poll_set_skip(m->poll_skip);
+}
+
+static bool iobc_elf_symbol(const char *name, hwaddr *addr)
+{
+    struct syminfo *si;
+    unsigned i;
+
+    // function symbols of the ELF file loaded via elf=
+    for (si = syminfos; si; si = si->next) {
+        for (i = 0; i < si->disas_num_syms; i++) {
+            struct elf32_sym *sym = &si->disas_symtab.elf32[i];
+
+            if (!strcmp(si->disas_strtab + sym->st_name, name)) {
+                *addr = sym->st_value;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static void iobc_softfloat_init(IobcMachineState *m, IobcBoardState *s)
+{
+    struct syminfo *si;
+    gchar **parts;
+    unsigned n = 0;
+    int i;
+
+    if (!m->softfloat_funcs) {
+        for (si = syminfos; si; si = si->next) {
+            for (i = 0; i < si->disas_num_syms; i++) {
+                struct elf32_sym *sym = &si->disas_symtab.elf32[i];
+
+                n += arm_softfloat_intercept(s->cpu, si->disas_strtab + sym->st_name,
+                                             sym->st_value);
+            }
+        }
+    }
+
+    parts = m->softfloat_funcs ? g_strsplit(m->softfloat_funcs, ":", -1) : NULL;
+    for (i = 0; parts && parts[i]; i++) {
+        char *sep = strchr(parts[i], '=');
+        hwaddr addr;
+
+        if (sep) {
+            *sep = '\0';
+            iobc_parse_addr(sep + 1, &addr);
+        } else if (!iobc_elf_symbol(parts[i], &addr)) {
+            error_report("iobc: soft-float routine '%s' not found in ELF symbols", parts[i]);
+            exit(1);
+        }
+
+        if (!arm_softfloat_intercept(s->cpu, parts[i], addr)) {
+            error_report("iobc: unsupported soft-float routine '%s'", parts[i]);
+            exit(1);
+        }
+        n++;
+    }
+    g_strfreev(parts);
+
+    if (!n) {
+        warn_report("iobc: no soft-float routines to intercept found");
+    }
+
+    if (m->softfloat == IOBC_SOFTFLOAT_VERIFY) {
+        arm_softfloat_enable_verify(s->cpu);
+    }
+}
+
+static IoXferServer *iobc_fuzz_target(IobcBoardState *s, const char *name,
+                                      IobcFuzzTargetType *type)
+{
+    DeviceState *usart[] = {
+        s->dev_usart0, s->dev_usart1, s->dev_usart2,
+        s->dev_usart3, s->dev_usart4, s->dev_usart5,
+    };
+    char buf[8];
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(usart); i++) {
+        snprintf(buf, sizeof(buf), "usart%d", i);
+
+        if (!strcmp(name, buf)) {
+            *type = IOBC_FUZZ_TARGET_USART;
+            return AT91_USART(usart[i])->server;
+        }
+    }
+
+    if (!strcmp(name, "spi0")) {
+        *type = IOBC_FUZZ_TARGET_SPI;
+        return AT91_SPI(s->dev_spi0)->server;
+    } else if (!strcmp(name, "spi1")) {
+        *type = IOBC_FUZZ_TARGET_SPI;
+        return AT91_SPI(s->dev_spi1)->server;
+    } else if (!strcmp(name, "twi")) {
+        *type = IOBC_FUZZ_TARGET_TWI;
+        return AT91_TWI(s->dev_twi)->server;
+    }
+
+    return NULL;
+}
+
+static void iobc_fuzz_init(IobcMachineState *m, IobcBoardState *s)
+{
+    IobcFuzzTargetType type;
+    IoXferServer *target;
+    IobcFuzz *fz;
+    GArray *addrs;
+    hwaddr start;
+    int i;
+
+    target = iobc_fuzz_target(s, m->fuzz_target, &type);
+    if (!target) {
+        error_report("iobc: invalid fuzz-target '%s'", m->fuzz_target);
+        exit(1);
+    }
+
+    // the CFI flash model has no migration state and writes its contents
+    // without dirty tracking, so it cannot be restored after each run
+    if (m->pflash_cfi) {
+        error_report("iobc: fuzzing is not supported with pflash-cfi");
+        exit(1);
+    }
+
+    fz = iobc_fuzz_new(s->cpu, target, type);
+
+    iobc_fuzz_add_ram(fz, &s->mem_sram0);
+    iobc_fuzz_add_ram(fz, &s->mem_sram1);
+    iobc_fuzz_add_ram(fz, s->mem_sdram);
+
+    // with pflash-file, the flash is a container of the file mapping and the rest
+    if (memory_region_is_ram(s->mem_pflash)) {
+        iobc_fuzz_add_ram(fz, s->mem_pflash);
+    } else {
+        MemoryRegion *sub;
+
+        QTAILQ_FOREACH(sub, &s->mem_pflash->subregions, subregions_link) {
+            iobc_fuzz_add_ram(fz, sub);
+        }
+    }
+
+    addrs = g_array_new(false, false, sizeof(hwaddr));
+    if (m->fuzz_done) {
+        iobc_parse_addr_list(m->fuzz_done, addrs);
+    }
+
+    for (i = 0; i < addrs->len; i++) {
+        iobc_fuzz_add_done_pc(fz, g_array_index(addrs, hwaddr, i));
+    }
+
+    g_array_free(addrs, true);
+
+    iobc_parse_addr(m->fuzz_start, &start);
+    iobc_fuzz_activate(fz, start, m->fuzz_input, m->fuzz_timeout * SCALE_MS);
+}
+
+static void iobc_set_socket(IobcMachineState *m, DeviceState *dev, const char *name)
+{
+    char *path = g_strconcat(m->socket_prefix, name, NULL);
+
+    qdev_prop_set_string(dev, "socket", path);
+    g_free(path);
+}
+
+static MemoryRegion *iobc_memory_init(MachineState *machine, const char *name,
+                                      const char *memdev, uint64_t size)
+{
+    MemoryRegion *mr;
+    Object *obj;
+
+    if (!memdev) {
+        mr = g_new(MemoryRegion, 1);
+        memory_region_init_ram(mr, NULL, name, size, &error_fatal);
+        return mr;
+    }
+
+    obj = object_resolve_path_type(memdev, TYPE_MEMORY_BACKEND, NULL);
+    if (!obj) {
+        error_report("%s: memory backend '%s' not found", name, memdev);
+        exit(1);
+    }
+
+    mr = machine_consume_memdev(machine, MEMORY_BACKEND(obj));
+    if (memory_region_size(mr) != size) {
+        error_report("%s: memory backend '%s' must have a size of 0x%" PRIx64,
+                     name, memdev, size);
+        exit(1);
+    }
+
+    return mr;
+}
+
+static MemoryRegion *iobc_pflash_init_from_file(IobcMachineState *m)
+{
+#ifdef CONFIG_POSIX
+    MemoryRegion *mr, *file, *rest;
+    struct stat st;
+
+    if (stat(m->pflash_file, &st)) {
+        error_report("iobc.pflash: cannot access '%s': %s", m->pflash_file, strerror(errno));
+        exit(1);
+    }
+
+    if (st.st_size == 0 || st.st_size > SIZE_PFLASH
+            || st.st_size % qemu_real_host_page_size) {
+        error_report("iobc.pflash: size of '%s' must be a non-zero multiple of "
+                     "0x%" PRIxPTR " and at most 0x%x", m->pflash_file,
+                     qemu_real_host_page_size, SIZE_PFLASH);
+        exit(1);
+    }
+
+    mr = g_new(MemoryRegion, 1);
+    memory_region_init(mr, NULL, "iobc.pflash", SIZE_PFLASH);
+
+    file = g_new(MemoryRegion, 1);
+    memory_region_init_ram_from_file(file, NULL, "iobc.pflash.file", st.st_size, 0,
+                                     m->pflash_share ? RAM_SHARED : 0,
+                                     m->pflash_file, &error_fatal);
+    vmstate_register_ram_global(file);
+    memory_region_add_subregion(mr, 0, file);
+
+    if (st.st_size < SIZE_PFLASH) {
+        rest = g_new(MemoryRegion, 1);
+        memory_region_init_ram(rest, NULL, "iobc.pflash.rest", SIZE_PFLASH - st.st_size,
+                               &error_fatal);
+        memory_region_add_subregion(mr, st.st_size, rest);
+    }
+
+    return mr;
+#else
+    error_report("iobc.pflash: mapping flash image files is not supported on this host");
+    exit(1);
+#endif
+}
+
 static void iobc_init(MachineState *machine)
 {
+    IobcMachineState *m = IOBC_MACHINE(machine);
     MemoryRegion *address_space_mem = get_system_memory();
     IobcBoardState *s = g_new(IobcBoardState, 1);
+    IobcVcd *vcd;
     int i;
 
     s->cpu = ARM_CPU(cpu_create(machine->cpu_type));
@@ -190,6 +788,8 @@ static void iobc_init(MachineState *machine)
     /* 0x1000_0000  0x1000_0000  NOR Program Flash  Gets loaded with program code              */
     /* 0x2000_0000  0x1000_0000  SDRAM              Copied from NOR Flash at boot via hardware */
     /* ...                                                                                     */
+    /* 0x9000_0000  0x0000_0010  Logging channel    Emulator only, with log=<chardev>          */
+    /* ...                                                                                     */
     /*                                                                                         */
     /* ...                                                                                     */
     /* 0xFFFA_C000  0x0000_4000  TWI                TODO: Slave Mode                           */
@@ -224,20 +824,40 @@ static void iobc_init(MachineState *machine)
     memory_region_init_ram(&s->mem_sram0, NULL, "iobc.internal.sram0", 0x4000, &error_fatal);
     memory_region_init_ram(&s->mem_sram1, NULL, "iobc.internal.sram1", 0x4000, &error_fatal);
 
-    memory_region_init_ram(&s->mem_pflash, NULL, "iobc.pflash", 0x10000000, &error_fatal);
-    memory_region_init_ram(&s->mem_sdram,  NULL, "iobc.sdram",  0x10000000, &error_fatal);
+    if (!!m->pflash_file + !!m->pflash_memdev + m->pflash_cfi > 1) {
+        error_report("iobc.pflash: pflash-file, pflash-memdev, and pflash-cfi are mutually exclusive");
+        exit(1);
+    }
+
+    if (m->pflash_file && m->norflash) {
+        error_report("iobc.pflash: pflash-file and norflash are mutually exclusive");
+        exit(1);
+    }
+
+    // Note: anonymous memory is only populated on first access
+    if (m->pflash_cfi) {
+        DriveInfo *dinfo = drive_get(IF_PFLASH, 0, 0);
+
+        s->mem_pflash = iobc_pflash_cfi_init(dinfo ? blk_by_legacy_dinfo(dinfo) : NULL,
+                                             m->pflash_timing, ADDR_PFLASH, SIZE_PFLASH);
+    } else if (m->pflash_file) {
+        s->mem_pflash = iobc_pflash_init_from_file(m);
+    } else {
+        s->mem_pflash = iobc_memory_init(machine, "iobc.pflash", m->pflash_memdev, SIZE_PFLASH);
+    }
+    s->mem_sdram = iobc_memory_init(machine, "iobc.sdram", m->sdram_memdev, SIZE_SDRAM);
 
     // bootmem aliases
     memory_region_init_alias(&s->mem_boot[AT91_BOOTMEM_ROM], NULL, "iobc.internal.bootmem", &s->mem_rom, 0, 0x100000);
     memory_region_init_alias(&s->mem_boot[AT91_BOOTMEM_SRAM0], NULL, "iobc.internal.bootmem", &s->mem_sram0, 0, 0x100000);
-    memory_region_init_alias(&s->mem_boot[AT91_BOOTMEM_EBI_NCS0], NULL, "iobc.internal.bootmem", &s->mem_pflash, 0, 0x100000);
+    memory_region_init_alias(&s->mem_boot[AT91_BOOTMEM_EBI_NCS0], NULL, "iobc.internal.bootmem", s->mem_pflash, 0, 0x100000);
 
     // put it all together
-    memory_region_add_subregion(address_space_mem, 0x00100000, &s->mem_rom);
-    memory_region_add_subregion(address_space_mem, 0x00200000, &s->mem_sram0);
-    memory_region_add_subregion(address_space_mem, 0x00300000, &s->mem_sram1);
-    memory_region_add_subregion(address_space_mem, 0x10000000, &s->mem_pflash);
-    memory_region_add_subregion(address_space_mem, 0x20000000, &s->mem_sdram);
+    memory_region_add_subregion(address_space_mem, ADDR_ROM,    &s->mem_rom);
+    memory_region_add_subregion(address_space_mem, ADDR_SRAM0,  &s->mem_sram0);
+    memory_region_add_subregion(address_space_mem, ADDR_SRAM1,  &s->mem_sram1);
+    memory_region_add_subregion(address_space_mem, ADDR_PFLASH, s->mem_pflash);
+    memory_region_add_subregion(address_space_mem, ADDR_SDRAMC, s->mem_sdram);
 
     memory_region_transaction_begin();
     for (i = 0; i < __AT91_BOOTMEM_NUM_REGIONS; i++) {
@@ -246,6 +866,9 @@ static void iobc_init(MachineState *machine)
     }
     memory_region_transaction_commit();
 
+    // the OBSW runs with an identity mapping, so gdb can use the physical map
+    gdb_enable_memory_map();
+
     // by default REMAP = 0, so initial bootmem mapping depends on BMS only
     s->mem_boot_target = AT91_BMS_INIT ? AT91_BOOTMEM_ROM : AT91_BOOTMEM_EBI_NCS0;
     memory_region_set_enabled(&s->mem_boot[s->mem_boot_target], true);
@@ -281,7 +904,13 @@ static void iobc_init(MachineState *machine)
     }
 
     // Power Managemant Controller
-    s->dev_pmc = sysbus_create_simple(TYPE_AT91_PMC, 0xFFFFFC00, s->irq_sysc[0]);
+    s->dev_pmc = qdev_create(NULL, TYPE_AT91_PMC);
+    if (m->boot_profile == IOBC_BOOT_SDRAM) {
+        at91_pmc_set_init_state(AT91_PMC(s->dev_pmc), &pmc_init_state_sdram);
+    }
+    qdev_init_nofail(s->dev_pmc);
+    sysbus_mmio_map(SYS_BUS_DEVICE(s->dev_pmc), 0, 0xFFFFFC00);
+    sysbus_connect_irq(SYS_BUS_DEVICE(s->dev_pmc), 0, s->irq_sysc[0]);
     at91_pmc_set_mclk_change_callback(AT91_PMC(s->dev_pmc), s, iobc_mkclk_changed);
 
     // Bus Matrix
@@ -295,87 +924,110 @@ static void iobc_init(MachineState *machine)
     sysbus_mmio_map(SYS_BUS_DEVICE(s->dev_dbgu), 0, 0xFFFFF200);
     sysbus_connect_irq(SYS_BUS_DEVICE(s->dev_dbgu), 0, s->irq_sysc[1]);
 
+    // Emulator logging channel, overlaps the undefined region
+    if (m->log) {
+        Chardev *chr = qemu_chr_find(m->log);
+        DeviceState *dev;
+
+        if (!chr) {
+            error_report("iobc.log: chardev '%s' not found", m->log);
+            exit(1);
+        }
+
+        dev = qdev_create(NULL, TYPE_IOBC_LOG);
+        qdev_prop_set_chr(dev, "chardev", chr);
+        qdev_init_nofail(dev);
+        sysbus_mmio_map(SYS_BUS_DEVICE(dev), 0, ADDR_LOG);
+    }
+
     // Parallel Input Ouput Controller
     s->dev_pio_a = qdev_create(NULL, TYPE_AT91_PIO);
-    qdev_prop_set_string(s->dev_pio_a, "socket", SOCKET_PIOA);
+    iobc_set_socket(m, s->dev_pio_a, SOCKET_PIOA);
     qdev_init_nofail(s->dev_pio_a);
     sysbus_mmio_map(SYS_BUS_DEVICE(s->dev_pio_a), 0, 0xFFFFF400);
     sysbus_connect_irq(SYS_BUS_DEVICE(s->dev_pio_a), 0, s->irq_aic[2]);
 
     s->dev_pio_b = qdev_create(NULL, TYPE_AT91_PIO);
-    qdev_prop_set_string(s->dev_pio_b, "socket", SOCKET_PIOB);
+    iobc_set_socket(m, s->dev_pio_b, SOCKET_PIOB);
     qdev_init_nofail(s->dev_pio_b);
     sysbus_mmio_map(SYS_BUS_DEVICE(s->dev_pio_b), 0, 0xFFFFF600);
     sysbus_connect_irq(SYS_BUS_DEVICE(s->dev_pio_b), 0, s->irq_aic[3]);
 
     s->dev_pio_c = qdev_create(NULL, TYPE_AT91_PIO);
-    qdev_prop_set_string(s->dev_pio_c, "socket", SOCKET_PIOC);
+    iobc_set_socket(m, s->dev_pio_c, SOCKET_PIOC);
     qdev_init_nofail(s->dev_pio_c);
     sysbus_mmio_map(SYS_BUS_DEVICE(s->dev_pio_c), 0, 0xFFFFF800);
     sysbus_connect_irq(SYS_BUS_DEVICE(s->dev_pio_c), 0, s->irq_aic[4]);
 
     // TODO: connect PIO(A,B,C) peripheral pins
 
+    if (m->vcd) {
+        vcd = iobc_vcd_open(m->vcd, &error_fatal);
+        at91_pio_set_vcd(AT91_PIO(s->dev_pio_a), vcd, "pioa", m->vcd_pio[0]);
+        at91_pio_set_vcd(AT91_PIO(s->dev_pio_b), vcd, "piob", m->vcd_pio[1]);
+        at91_pio_set_vcd(AT91_PIO(s->dev_pio_c), vcd, "pioc", m->vcd_pio[2]);
+    }
+
     // TWI
     s->dev_twi = qdev_create(NULL, TYPE_AT91_TWI);
-    qdev_prop_set_string(s->dev_twi, "socket", SOCKET_TWI);
+    iobc_set_socket(m, s->dev_twi, SOCKET_TWI);
     qdev_init_nofail(s->dev_twi);
     sysbus_mmio_map(SYS_BUS_DEVICE(s->dev_twi), 0, 0xFFFAC000);
     sysbus_connect_irq(SYS_BUS_DEVICE(s->dev_twi), 0, s->irq_aic[11]);
 
     // USARTs
     s->dev_usart0 = qdev_create(NULL, TYPE_AT91_USART);
-    qdev_prop_set_string(s->dev_usart0, "socket", SOCKET_USART0);
+    iobc_set_socket(m, s->dev_usart0, SOCKET_USART0);
     qdev_init_nofail(s->dev_usart0);
     sysbus_mmio_map(SYS_BUS_DEVICE(s->dev_usart0), 0, 0xFFFB0000);
     sysbus_connect_irq(SYS_BUS_DEVICE(s->dev_usart0), 0, s->irq_aic[6]);
 
     s->dev_usart1 = qdev_create(NULL, TYPE_AT91_USART);
-    qdev_prop_set_string(s->dev_usart1, "socket", SOCKET_USART1);
+    iobc_set_socket(m, s->dev_usart1, SOCKET_USART1);
     qdev_init_nofail(s->dev_usart1);
     sysbus_mmio_map(SYS_BUS_DEVICE(s->dev_usart1), 0, 0xFFFB4000);
     sysbus_connect_irq(SYS_BUS_DEVICE(s->dev_usart1), 0, s->irq_aic[7]);
 
     s->dev_usart2 = qdev_create(NULL, TYPE_AT91_USART);
-    qdev_prop_set_string(s->dev_usart2, "socket", SOCKET_USART2);
+    iobc_set_socket(m, s->dev_usart2, SOCKET_USART2);
     qdev_init_nofail(s->dev_usart2);
     sysbus_mmio_map(SYS_BUS_DEVICE(s->dev_usart2), 0, 0xFFFB8000);
     sysbus_connect_irq(SYS_BUS_DEVICE(s->dev_usart2), 0, s->irq_aic[8]);
 
     s->dev_usart3 = qdev_create(NULL, TYPE_AT91_USART);
-    qdev_prop_set_string(s->dev_usart3, "socket", SOCKET_USART3);
+    iobc_set_socket(m, s->dev_usart3, SOCKET_USART3);
     qdev_init_nofail(s->dev_usart3);
     sysbus_mmio_map(SYS_BUS_DEVICE(s->dev_usart3), 0, 0xFFFD0000);
     sysbus_connect_irq(SYS_BUS_DEVICE(s->dev_usart3), 0, s->irq_aic[23]);
 
     s->dev_usart4 = qdev_create(NULL, TYPE_AT91_USART);
-    qdev_prop_set_string(s->dev_usart4, "socket", SOCKET_USART4);
+    iobc_set_socket(m, s->dev_usart4, SOCKET_USART4);
     qdev_init_nofail(s->dev_usart4);
     sysbus_mmio_map(SYS_BUS_DEVICE(s->dev_usart4), 0, 0xFFFD4000);
     sysbus_connect_irq(SYS_BUS_DEVICE(s->dev_usart4), 0, s->irq_aic[24]);
 
     s->dev_usart5 = qdev_create(NULL, TYPE_AT91_USART);
-    qdev_prop_set_string(s->dev_usart5, "socket", SOCKET_USART5);
+    iobc_set_socket(m, s->dev_usart5, SOCKET_USART5);
     qdev_init_nofail(s->dev_usart5);
     sysbus_mmio_map(SYS_BUS_DEVICE(s->dev_usart5), 0, 0xFFFD8000);
     sysbus_connect_irq(SYS_BUS_DEVICE(s->dev_usart5), 0, s->irq_aic[25]);
 
     // SPIs
     s->dev_spi0 = qdev_create(NULL, TYPE_AT91_SPI);
-    qdev_prop_set_string(s->dev_spi0, "socket", SOCKET_SPI0);
+    iobc_set_socket(m, s->dev_spi0, SOCKET_SPI0);
     qdev_init_nofail(s->dev_spi0);
     sysbus_mmio_map(SYS_BUS_DEVICE(s->dev_spi0), 0, 0xFFFC8000);
     sysbus_connect_irq(SYS_BUS_DEVICE(s->dev_spi0), 0, s->irq_aic[12]);
 
     s->dev_spi1 = qdev_create(NULL, TYPE_AT91_SPI);
-    qdev_prop_set_string(s->dev_spi1, "socket", SOCKET_SPI1);
+    iobc_set_socket(m, s->dev_spi1, SOCKET_SPI1);
     qdev_init_nofail(s->dev_spi1);
     sysbus_mmio_map(SYS_BUS_DEVICE(s->dev_spi1), 0, 0xFFFCC000);
     sysbus_connect_irq(SYS_BUS_DEVICE(s->dev_spi1), 0, s->irq_aic[13]);
 
     // SDRAMC
     s->dev_sdramc = qdev_create(NULL, TYPE_AT91_SDRAMC);
-    qdev_prop_set_string(s->dev_sdramc, "socket", SOCKET_SDRAMC);
+    iobc_set_socket(m, s->dev_sdramc, SOCKET_SDRAMC);
     qdev_init_nofail(s->dev_sdramc);
     sysbus_mmio_map(SYS_BUS_DEVICE(s->dev_sdramc), 0, 0xFFFFEA00);
     sysbus_connect_irq(SYS_BUS_DEVICE(s->dev_sdramc), 0, s->irq_sysc[2]);
@@ -431,45 +1083,702 @@ static void iobc_init(MachineState *machine)
     create_unimplemented_device("iobc.periph.wdt",     0xFFFFFD40, 0x10);
     create_unimplemented_device("iobc.periph.gpbr",    0xFFFFFD50, 0x10);
 
-#if IOBC_LOADER == IOBC_LOADER_DBG
-    char *firmware_path;
-
-    /*
-     * Load firmware directly to SDRAMC.
-     *
-     * Note: This is the "debug" way, i.e. load to SDRAMC and jump to SDRAMC start address.
-     *       This bypasses the bootloader and configures the clock for OBSW, which in debug
-     *       loading on real hardware is done via jlink.
-     */
-    if (bios_name) {
-        firmware_path = qemu_find_file(QEMU_FILE_TYPE_BIOS, bios_name);
-
-        if (firmware_path) {
-            if (load_image_mr(firmware_path, &s->mem_sdram) < 0) {
-                error_report("Unable to load %s into sdram", bios_name);
-                exit(1);
-            }
+    // firmware images and initial program counter
+    iobc_load_images(m, s);
+
+    arm_load_kernel(s->cpu, machine, &iobc_board_binfo);
+
+    // must be registered after arm_load_kernel() so that it runs after the CPU reset
+    if (s->has_entry) {
+        qemu_register_reset(iobc_cpu_reset, s);
+    }
+
+    iobc_idle_init(m, s);
+
+    if (m->softfloat != IOBC_SOFTFLOAT_OFF) {
+        iobc_softfloat_init(m, s);
+    }
+
+    if (m->snapshot_cache) {
+        iobc_warm_start_init(m, s);
+    } else if (m->ready_pc) {
+        error_report("iobc: ready-pc requires snapshot-cache");
+        exit(1);
+    }
+
+    if (m->fuzz_start) {
+        iobc_fuzz_init(m, s);
+    }
+}
+
+static IobcMachineState *iobc_machine_find(Error **errp)
+{
+    Object *obj = object_dynamic_cast(OBJECT(qdev_get_machine()), TYPE_IOBC_MACHINE);
+
+    if (!obj) {
+        error_setg(errp, "Time scale control requires the isis-obc machine");
+        return NULL;
+    }
+
+    return IOBC_MACHINE(obj);
+}
 
-            at91_pmc_set_init_state(AT91_PMC(s->dev_pmc), &pmc_init_state_sdram);
+IobcTimeScaleInfo *qmp_query_iobc_time_scale(Error **errp)
+{
+    IobcTimeScaleInfo *info;
+
+    if (!iobc_machine_find(errp)) {
+        return NULL;
+    }
+
+    info = g_new0(IobcTimeScaleInfo, 1);
+    info->ratio = cpu_get_clock_scale();
+    info->unbounded = cpu_get_idle_warp();
+    return info;
+}
+
+void qmp_iobc_set_time_scale(bool has_ratio, double ratio, bool has_unbounded,
+                             bool unbounded, Error **errp)
+{
+    IobcMachineState *m = iobc_machine_find(errp);
 
-            g_free(firmware_path);
+    if (!m) {
+        return;
+    }
+
+    if (has_ratio && !cpu_set_clock_scale(ratio)) {
+        if (use_icount) {
+            error_setg(errp, "Time scale ratio cannot be changed with -icount");
         } else {
-            error_report("Unable to find %s", bios_name);
-            exit(1);
+            error_setg(errp, "Time scale ratio must be between 0.001 and 1000");
         }
-    } else {
-        warn_report("No firmware specified: Use -bios <file> to load firmware");
+        return;
     }
-#endif
 
-    arm_load_kernel(s->cpu, machine, &iobc_board_binfo);
+    if (has_unbounded) {
+        m->turbo_idle = unbounded;
+        cpu_set_idle_warp(unbounded);
+    }
 }
 
-static void iobc_machine_init(MachineClass *mc)
+static char *iobc_get_vcd(Object *obj, Error **errp)
 {
+    return g_strdup(IOBC_MACHINE(obj)->vcd);
+}
+
+static void iobc_set_vcd(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+
+    g_free(m->vcd);
+    m->vcd = g_strdup(value);
+}
+
+static char *iobc_get_socket_prefix(Object *obj, Error **errp)
+{
+    return g_strdup(IOBC_MACHINE(obj)->socket_prefix);
+}
+
+static void iobc_set_socket_prefix(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+
+    g_free(m->socket_prefix);
+    m->socket_prefix = g_strdup(value);
+}
+
+static char *iobc_get_log(Object *obj, Error **errp)
+{
+    return g_strdup(IOBC_MACHINE(obj)->log);
+}
+
+static void iobc_set_log(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+
+    g_free(m->log);
+    m->log = g_strdup(value);
+}
+
+static char *iobc_get_pflash_memdev(Object *obj, Error **errp)
+{
+    return g_strdup(IOBC_MACHINE(obj)->pflash_memdev);
+}
+
+static void iobc_set_pflash_memdev(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+
+    g_free(m->pflash_memdev);
+    m->pflash_memdev = g_strdup(value);
+}
+
+static char *iobc_get_sdram_memdev(Object *obj, Error **errp)
+{
+    return g_strdup(IOBC_MACHINE(obj)->sdram_memdev);
+}
+
+static void iobc_set_sdram_memdev(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+
+    g_free(m->sdram_memdev);
+    m->sdram_memdev = g_strdup(value);
+}
+
+static char *iobc_get_pflash_file(Object *obj, Error **errp)
+{
+    return g_strdup(IOBC_MACHINE(obj)->pflash_file);
+}
+
+static void iobc_set_pflash_file(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+
+    g_free(m->pflash_file);
+    m->pflash_file = g_strdup(value);
+}
+
+static bool iobc_get_pflash_share(Object *obj, Error **errp)
+{
+    return IOBC_MACHINE(obj)->pflash_share;
+}
+
+static void iobc_set_pflash_share(Object *obj, bool value, Error **errp)
+{
+    IOBC_MACHINE(obj)->pflash_share = value;
+}
+
+static bool iobc_get_pflash_cfi(Object *obj, Error **errp)
+{
+    return IOBC_MACHINE(obj)->pflash_cfi;
+}
+
+static void iobc_set_pflash_cfi(Object *obj, bool value, Error **errp)
+{
+    IOBC_MACHINE(obj)->pflash_cfi = value;
+}
+
+static bool iobc_get_pflash_timing(Object *obj, Error **errp)
+{
+    return IOBC_MACHINE(obj)->pflash_timing;
+}
+
+static void iobc_set_pflash_timing(Object *obj, bool value, Error **errp)
+{
+    IOBC_MACHINE(obj)->pflash_timing = value;
+}
+
+static char *iobc_get_norflash(Object *obj, Error **errp)
+{
+    return g_strdup(IOBC_MACHINE(obj)->norflash);
+}
+
+static void iobc_set_norflash(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+
+    g_free(m->norflash);
+    m->norflash = g_strdup(value);
+}
+
+static char *iobc_get_sdram(Object *obj, Error **errp)
+{
+    return g_strdup(IOBC_MACHINE(obj)->sdram);
+}
+
+static void iobc_set_sdram(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+
+    g_free(m->sdram);
+    m->sdram = g_strdup(value);
+}
+
+static char *iobc_get_elf(Object *obj, Error **errp)
+{
+    return g_strdup(IOBC_MACHINE(obj)->elf);
+}
+
+static void iobc_set_elf(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+
+    g_free(m->elf);
+    m->elf = g_strdup(value);
+}
+
+static char *iobc_get_entry(Object *obj, Error **errp)
+{
+    return g_strdup(IOBC_MACHINE(obj)->entry);
+}
+
+static void iobc_set_entry(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+    hwaddr addr;
+
+    if (!iobc_parse_addr(value, &addr)) {
+        error_setg(errp, "invalid entry address '%s'", value);
+        return;
+    }
+
+    g_free(m->entry);
+    m->entry = g_strdup(value);
+}
+
+static char *iobc_get_boot_profile(Object *obj, Error **errp)
+{
+    return g_strdup(iobc_boot_profile_names[IOBC_MACHINE(obj)->boot_profile]);
+}
+
+static void iobc_set_boot_profile(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+    int i;
+
+    for (i = 0; i < __IOBC_BOOT_NUM_PROFILES; i++) {
+        if (!strcmp(value, iobc_boot_profile_names[i])) {
+            m->boot_profile = i;
+            return;
+        }
+    }
+
+    error_setg(errp, "invalid boot profile '%s' (expected rom, norflash, or sdram)", value);
+}
+
+static char *iobc_get_snapshot_cache(Object *obj, Error **errp)
+{
+    return g_strdup(IOBC_MACHINE(obj)->snapshot_cache);
+}
+
+static void iobc_set_snapshot_cache(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+
+    g_free(m->snapshot_cache);
+    m->snapshot_cache = g_strdup(value);
+}
+
+static char *iobc_get_ready_pc(Object *obj, Error **errp)
+{
+    return g_strdup(IOBC_MACHINE(obj)->ready_pc);
+}
+
+static void iobc_set_ready_pc(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+    hwaddr addr;
+
+    if (!iobc_parse_addr(value, &addr)) {
+        error_setg(errp, "invalid ready-pc address '%s'", value);
+        return;
+    }
+
+    g_free(m->ready_pc);
+    m->ready_pc = g_strdup(value);
+}
+
+static bool iobc_get_turbo_idle(Object *obj, Error **errp)
+{
+    return IOBC_MACHINE(obj)->turbo_idle;
+}
+
+static void iobc_set_turbo_idle(Object *obj, bool value, Error **errp)
+{
+    IOBC_MACHINE(obj)->turbo_idle = value;
+}
+
+static char *iobc_get_idle_pc(Object *obj, Error **errp)
+{
+    return g_strdup(IOBC_MACHINE(obj)->idle_pc);
+}
+
+static void iobc_set_idle_pc(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+
+    if (!iobc_parse_addr_list(value, NULL)) {
+        error_setg(errp, "invalid idle-pc address list '%s'", value);
+        return;
+    }
+
+    g_free(m->idle_pc);
+    m->idle_pc = g_strdup(value);
+}
+
+static bool iobc_get_poll_skip(Object *obj, Error **errp)
+{
+    return IOBC_MACHINE(obj)->poll_skip;
+}
+
+static void iobc_set_poll_skip(Object *obj, bool value, Error **errp)
+{
+    IOBC_MACHINE(obj)->poll_skip = value;
+}
+
+static char *iobc_get_fuzz_start(Object *obj, Error **errp)
+{
+    return g_strdup(IOBC_MACHINE(obj)->fuzz_start);
+}
+
+static void iobc_set_fuzz_start(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+    hwaddr addr;
+
+    if (!iobc_parse_addr(value, &addr)) {
+        error_setg(errp, "invalid fuzz-start address '%s'", value);
+        return;
+    }
+
+    g_free(m->fuzz_start);
+    m->fuzz_start = g_strdup(value);
+}
+
+static char *iobc_get_fuzz_done(Object *obj, Error **errp)
+{
+    return g_strdup(IOBC_MACHINE(obj)->fuzz_done);
+}
+
+static void iobc_set_fuzz_done(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+
+    if (!iobc_parse_addr_list(value, NULL)) {
+        error_setg(errp, "invalid fuzz-done address list '%s'", value);
+        return;
+    }
+
+    g_free(m->fuzz_done);
+    m->fuzz_done = g_strdup(value);
+}
+
+static char *iobc_get_fuzz_target(Object *obj, Error **errp)
+{
+    return g_strdup(IOBC_MACHINE(obj)->fuzz_target);
+}
+
+static void iobc_set_fuzz_target(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+
+    g_free(m->fuzz_target);
+    m->fuzz_target = g_strdup(value);
+}
+
+static char *iobc_get_fuzz_input(Object *obj, Error **errp)
+{
+    return g_strdup(IOBC_MACHINE(obj)->fuzz_input);
+}
+
+static void iobc_set_fuzz_input(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+
+    g_free(m->fuzz_input);
+    m->fuzz_input = g_strdup(value);
+}
+
+static char *iobc_get_fault_policy(Object *obj, Error **errp)
+{
+    return g_strdup(IOBC_MACHINE(obj)->fault_policy);
+}
+
+static void iobc_set_fault_policy(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+
+    if (!iobc_fault_configure(value, errp)) {
+        return;
+    }
+
+    g_free(m->fault_policy);
+    m->fault_policy = g_strdup(value);
+}
+
+static bool iobc_get_large_pages(Object *obj, Error **errp)
+{
+    return IOBC_MACHINE(obj)->large_pages;
+}
+
+static void iobc_set_large_pages(Object *obj, bool value, Error **errp)
+{
+    // only read to decide the page size, see minimum_page_bits_opt
+    IOBC_MACHINE(obj)->large_pages = value;
+}
+
+static char *iobc_get_softfloat(Object *obj, Error **errp)
+{
+    return g_strdup(iobc_softfloat_mode_names[IOBC_MACHINE(obj)->softfloat]);
+}
+
+static void iobc_set_softfloat(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+    int i;
+
+    for (i = 0; i < __IOBC_SOFTFLOAT_NUM_MODES; i++) {
+        if (!strcmp(value, iobc_softfloat_mode_names[i])) {
+            m->softfloat = i;
+            return;
+        }
+    }
+
+    error_setg(errp, "invalid softfloat-intercept mode '%s' (expected off, on, or verify)", value);
+}
+
+static char *iobc_get_softfloat_funcs(Object *obj, Error **errp)
+{
+    return g_strdup(IOBC_MACHINE(obj)->softfloat_funcs);
+}
+
+static void iobc_set_softfloat_funcs(Object *obj, const char *value, Error **errp)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+    gchar **parts = g_strsplit(value, ":", -1);
+    hwaddr addr;
+    int i;
+
+    for (i = 0; parts[i]; i++) {
+        char *sep = strchr(parts[i], '=');
+
+        if (sep == parts[i] || (sep && !iobc_parse_addr(sep + 1, &addr))) {
+            error_setg(errp, "invalid softfloat-funcs entry '%s'", parts[i]);
+            g_strfreev(parts);
+            return;
+        }
+    }
+
+    g_strfreev(parts);
+
+    g_free(m->softfloat_funcs);
+    m->softfloat_funcs = g_strdup(value);
+}
+
+static void iobc_machine_instance_init(Object *obj)
+{
+    IobcMachineState *m = IOBC_MACHINE(obj);
+
+    m->vcd = NULL;
+    m->vcd_pio[0] = 0xFFFFFFFF;
+    m->vcd_pio[1] = 0xFFFFFFFF;
+    m->vcd_pio[2] = 0xFFFFFFFF;
+
+    object_property_add_str(obj, "vcd", iobc_get_vcd, iobc_set_vcd, NULL);
+    object_property_set_description(obj, "vcd",
+                                    "Record PIO pin changes to the given "
+                                    "value change dump (VCD) file", NULL);
+
+    object_property_add_uint32_ptr(obj, "vcd-pioa", &m->vcd_pio[0],
+                                   OBJ_PROP_FLAG_READWRITE, NULL);
+    object_property_add_uint32_ptr(obj, "vcd-piob", &m->vcd_pio[1],
+                                   OBJ_PROP_FLAG_READWRITE, NULL);
+    object_property_add_uint32_ptr(obj, "vcd-pioc", &m->vcd_pio[2],
+                                   OBJ_PROP_FLAG_READWRITE, NULL);
+    object_property_set_description(obj, "vcd-pioa",
+                                    "Mask of PIOA pins to record (default: all)", NULL);
+    object_property_set_description(obj, "vcd-piob",
+                                    "Mask of PIOB pins to record (default: all)", NULL);
+    object_property_set_description(obj, "vcd-pioc",
+                                    "Mask of PIOC pins to record (default: all)", NULL);
+
+    m->socket_prefix = g_strdup(SOCKET_PREFIX);
+    object_property_add_str(obj, "socket-prefix", iobc_get_socket_prefix,
+                            iobc_set_socket_prefix, NULL);
+    object_property_set_description(obj, "socket-prefix",
+                                    "Path prefix for the peripheral IOX sockets "
+                                    "(default: " SOCKET_PREFIX ")", NULL);
+
+    m->log = NULL;
+    object_property_add_str(obj, "log", iobc_get_log, iobc_set_log, NULL);
+    object_property_set_description(obj, "log",
+                                    "Chardev ID for the emulator logging channel", NULL);
+
+    m->pflash_memdev = NULL;
+    object_property_add_str(obj, "pflash-memdev", iobc_get_pflash_memdev,
+                            iobc_set_pflash_memdev, NULL);
+    object_property_set_description(obj, "pflash-memdev",
+                                    "Memory backend ID for the NOR flash", NULL);
+
+    m->sdram_memdev = NULL;
+    object_property_add_str(obj, "sdram-memdev", iobc_get_sdram_memdev,
+                            iobc_set_sdram_memdev, NULL);
+    object_property_set_description(obj, "sdram-memdev",
+                                    "Memory backend ID for the SDRAM", NULL);
+
+    m->pflash_file = NULL;
+    object_property_add_str(obj, "pflash-file", iobc_get_pflash_file,
+                            iobc_set_pflash_file, NULL);
+    object_property_set_description(obj, "pflash-file",
+                                    "Map the given image file into the NOR flash", NULL);
+
+    m->pflash_share = false;
+    object_property_add_bool(obj, "pflash-share", iobc_get_pflash_share,
+                             iobc_set_pflash_share, NULL);
+    object_property_set_description(obj, "pflash-share",
+                                    "Write NOR flash changes through to pflash-file", NULL);
+
+    m->pflash_cfi = false;
+    object_property_add_bool(obj, "pflash-cfi", iobc_get_pflash_cfi,
+                             iobc_set_pflash_cfi, NULL);
+    object_property_set_description(obj, "pflash-cfi",
+                                    "Model the NOR flash as CFI flash", NULL);
+
+    m->pflash_timing = false;
+    object_property_add_bool(obj, "pflash-timing", iobc_get_pflash_timing,
+                             iobc_set_pflash_timing, NULL);
+    object_property_set_description(obj, "pflash-timing",
+                                    "Model CFI erase and program times", NULL);
+
+    m->norflash = NULL;
+    object_property_add_str(obj, "norflash", iobc_get_norflash, iobc_set_norflash, NULL);
+    object_property_set_description(obj, "norflash",
+                                    "Raw image to load into the NOR flash", NULL);
+
+    m->sdram = NULL;
+    object_property_add_str(obj, "sdram", iobc_get_sdram, iobc_set_sdram, NULL);
+    object_property_set_description(obj, "sdram",
+                                    "Raw image to load into the SDRAM", NULL);
+
+    m->elf = NULL;
+    object_property_add_str(obj, "elf", iobc_get_elf, iobc_set_elf, NULL);
+    object_property_set_description(obj, "elf",
+                                    "ELF file to load to its physical addresses", NULL);
+
+    m->entry = NULL;
+    object_property_add_str(obj, "entry", iobc_get_entry, iobc_set_entry, NULL);
+    object_property_set_description(obj, "entry",
+                                    "Initial program counter (address or memory "
+                                    "region name)", NULL);
+
+    m->boot_profile = IOBC_BOOT_ROM;
+    object_property_add_str(obj, "boot-profile", iobc_get_boot_profile,
+                            iobc_set_boot_profile, NULL);
+    object_property_set_description(obj, "boot-profile",
+                                    "Boot profile: rom, norflash, or sdram "
+                                    "(default: rom)", NULL);
+
+    m->snapshot_cache = NULL;
+    object_property_add_str(obj, "snapshot-cache", iobc_get_snapshot_cache,
+                            iobc_set_snapshot_cache, NULL);
+    object_property_set_description(obj, "snapshot-cache",
+                                    "Directory of the warm-start snapshot cache", NULL);
+
+    m->ready_pc = NULL;
+    object_property_add_str(obj, "ready-pc", iobc_get_ready_pc, iobc_set_ready_pc, NULL);
+    object_property_set_description(obj, "ready-pc",
+                                    "Program counter at which the warm-start "
+                                    "snapshot is created", NULL);
+
+    m->turbo_idle = false;
+    object_property_add_bool(obj, "turbo-idle", iobc_get_turbo_idle,
+                             iobc_set_turbo_idle, NULL);
+    object_property_set_description(obj, "turbo-idle",
+                                    "Skip idle time by advancing the virtual clock "
+                                    "to the next timer deadline", NULL);
+
+    m->idle_pc = NULL;
+    object_property_add_str(obj, "idle-pc", iobc_get_idle_pc, iobc_set_idle_pc, NULL);
+    object_property_set_description(obj, "idle-pc",
+                                    "Colon-separated program counters of idle "
+                                    "loops at which the CPU is halted until the "
+                                    "next interrupt", NULL);
+
+    m->poll_skip = false;
+    object_property_add_bool(obj, "poll-skip", iobc_get_poll_skip,
+                             iobc_set_poll_skip, NULL);
+    object_property_set_description(obj, "poll-skip",
+                                    "Advance the virtual clock to the next status "
+                                    "change on status register polling loops", NULL);
+
+    m->fuzz_start = NULL;
+    object_property_add_str(obj, "fuzz-start", iobc_get_fuzz_start,
+                            iobc_set_fuzz_start, NULL);
+    object_property_set_description(obj, "fuzz-start",
+                                    "Program counter at which the fuzzing "
+                                    "snapshot is taken", NULL);
+
+    m->fuzz_done = NULL;
+    object_property_add_str(obj, "fuzz-done", iobc_get_fuzz_done,
+                            iobc_set_fuzz_done, NULL);
+    object_property_set_description(obj, "fuzz-done",
+                                    "Colon-separated program counters at which "
+                                    "a fuzzing run is done", NULL);
+
+    m->fuzz_target = g_strdup("usart0");
+    object_property_add_str(obj, "fuzz-target", iobc_get_fuzz_target,
+                            iobc_set_fuzz_target, NULL);
+    object_property_set_description(obj, "fuzz-target",
+                                    "Peripheral receiving the fuzzer input "
+                                    "(default: usart0)", NULL);
+
+    m->fuzz_input = NULL;
+    object_property_add_str(obj, "fuzz-input", iobc_get_fuzz_input,
+                            iobc_set_fuzz_input, NULL);
+    object_property_set_description(obj, "fuzz-input",
+                                    "Fuzzer input file or directory of inputs "
+                                    "to replay (default: stdin)", NULL);
+
+    m->fuzz_timeout = 100;
+    object_property_add_uint32_ptr(obj, "fuzz-timeout", &m->fuzz_timeout,
+                                   OBJ_PROP_FLAG_READWRITE, NULL);
+    object_property_set_description(obj, "fuzz-timeout",
+                                    "Timeout of a fuzzing run in milliseconds of "
+                                    "virtual time (default: 100)", NULL);
+
+    m->fault_policy = g_strdup("abort");
+    object_property_add_str(obj, "fault-policy", iobc_get_fault_policy,
+                            iobc_set_fault_policy, NULL);
+    object_property_set_description(obj, "fault-policy",
+                                    "Handling of invalid accesses: abort, "
+                                    "data-abort, log, or stop, optionally per "
+                                    "region (default: abort)", NULL);
+
+    m->large_pages = false;
+    object_property_add_bool(obj, "large-pages", iobc_get_large_pages,
+                             iobc_set_large_pages, NULL);
+    object_property_set_description(obj, "large-pages",
+                                    "Use 4 KiB instead of 1 KiB target pages", NULL);
+
+    m->softfloat = IOBC_SOFTFLOAT_OFF;
+    object_property_add_str(obj, "softfloat-intercept", iobc_get_softfloat,
+                            iobc_set_softfloat, NULL);
+    object_property_set_description(obj, "softfloat-intercept",
+                                    "Intercept calls to soft-float library "
+                                    "routines: off, on, or verify (default: off)", NULL);
+
+    m->softfloat_funcs = NULL;
+    object_property_add_str(obj, "softfloat-funcs", iobc_get_softfloat_funcs,
+                            iobc_set_softfloat_funcs, NULL);
+    object_property_set_description(obj, "softfloat-funcs",
+                                    "Colon-separated soft-float routines to "
+                                    "intercept, optionally with their address "
+                                    "(default: all in the ELF symbols)", NULL);
+}
+
+static void iobc_machine_class_init(ObjectClass *oc, void *data)
+{
+    MachineClass *mc = MACHINE_CLASS(oc);
+
     mc->desc = "ISIS-OBC for CubeSat";
     mc->init = iobc_init;
     mc->default_cpu_type = ARM_CPU_TYPE_NAME("arm926");
+    mc->minimum_page_bits = 12;
+    mc->minimum_page_bits_opt = "large-pages";
+}
+
+static const TypeInfo iobc_machine_info = {
+    .name = TYPE_IOBC_MACHINE,
+    .parent = TYPE_MACHINE,
+    .instance_size = sizeof(IobcMachineState),
+    .instance_init = iobc_machine_instance_init,
+    .class_init = iobc_machine_class_init,
+};
+
+static void iobc_machine_register_types(void)
+{
+    type_register_static(&iobc_machine_info);
 }
 
-DEFINE_MACHINE("isis-obc", iobc_machine_init)
+type_init(iobc_machine_register_types)
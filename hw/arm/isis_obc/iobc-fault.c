@@ -0,0 +1,193 @@
+/*
+ * ISIS iOBC fault policy.
+ *
+ * See iobc-fault.h for details.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#include "iobc-fault.h"
+#include "iobc-fuzz.h"
+#include "qemu/error-report.h"
+#include "qapi/error.h"
+#include "qapi/util.h"
+#include "qapi/qapi-events-misc-target.h"
+#include "sysemu/runstate.h"
+#include "exec/exec-all.h"
+#include "hw/core/cpu.h"
+#include "cpu.h"
+
+
+typedef struct {
+    char *prefix;
+    IobcFaultPolicy policy;
+} IobcFaultRule;
+
+static IobcFaultPolicy fault_default = IOBC_FAULT_POLICY_ABORT;
+static GArray *fault_rules = NULL;
+
+// set by iobc_fault(), consumed by the accessor of the faulting access
+static __thread MemTxResult fault_result = MEMTX_OK;
+
+
+static void fault_rules_free(GArray *rules)
+{
+    int i;
+
+    for (i = 0; i < rules->len; i++) {
+        g_free(g_array_index(rules, IobcFaultRule, i).prefix);
+    }
+
+    g_array_free(rules, true);
+}
+
+bool iobc_fault_configure(const char *spec, Error **errp)
+{
+    GArray *rules = g_array_new(false, false, sizeof(IobcFaultRule));
+    IobcFaultPolicy def = IOBC_FAULT_POLICY_ABORT;
+    gchar **parts = g_strsplit(spec, ":", -1);
+    Error *err = NULL;
+    int i;
+
+    for (i = 0; parts[i]; i++) {
+        char *sep = strchr(parts[i], '=');
+        IobcFaultRule rule;
+        int policy;
+
+        policy = qapi_enum_parse(&IobcFaultPolicy_lookup, sep ? sep + 1 : parts[i],
+                                 -1, &err);
+        if (policy < 0) {
+            break;
+        }
+
+        if (!sep) {
+            def = policy;
+            continue;
+        }
+
+        rule.prefix = g_strndup(parts[i], sep - parts[i]);
+        rule.policy = policy;
+        g_array_append_val(rules, rule);
+    }
+
+    g_strfreev(parts);
+
+    if (err) {
+        error_propagate_prepend(errp, err, "invalid fault policy: ");
+        fault_rules_free(rules);
+        return false;
+    }
+
+    if (fault_rules) {
+        fault_rules_free(fault_rules);
+    }
+
+    fault_default = def;
+    fault_rules = rules;
+    return true;
+}
+
+static IobcFaultPolicy fault_policy(const char *source)
+{
+    IobcFaultPolicy policy = fault_default;
+    int i;
+
+    for (i = 0; fault_rules && i < fault_rules->len; i++) {
+        IobcFaultRule *rule = &g_array_index(fault_rules, IobcFaultRule, i);
+
+        if (g_str_has_prefix(source, rule->prefix)) {
+            policy = rule->policy;
+        }
+    }
+
+    return policy;
+}
+
+static hwaddr fault_pc(void)
+{
+    CPUARMState *env;
+    uint32_t pc, condexec, syndrome;
+    hwaddr fault_pc;
+
+    if (!current_cpu) {
+        return 0;
+    }
+
+    // the PC is only synchronized at the start of the translation block,
+    // restore it temporarily for the accessing instruction (this also sets
+    // the syndrome, which is set again when raising a data abort)
+    env = &ARM_CPU(current_cpu)->env;
+    pc = env->regs[15];
+    condexec = env->condexec_bits;
+    syndrome = env->exception.syndrome;
+
+    fault_pc = pc;
+    if (cpu_restore_state(current_cpu, current_cpu->mem_io_pc, false)) {
+        fault_pc = env->regs[15];
+    }
+
+    env->regs[15] = pc;
+    env->condexec_bits = condexec;
+    env->exception.syndrome = syndrome;
+
+    return fault_pc;
+}
+
+void iobc_fault(MemoryRegion *mr, hwaddr offset, bool write, const char *fmt, ...)
+{
+    const char *source = memory_region_name(mr);
+    IobcFaultPolicy policy = fault_policy(source);
+    va_list args;
+    hwaddr pc;
+    char *msg;
+
+    if (iobc_fuzz_crash(source)) {
+        return;
+    }
+
+    va_start(args, fmt);
+    msg = g_strdup_vprintf(fmt, args);
+    va_end(args);
+
+    if (policy == IOBC_FAULT_POLICY_ABORT) {
+        error_report("%s", msg);
+        abort();
+    }
+
+    pc = fault_pc();
+    warn_report("%s [pc: 0x%08" HWADDR_PRIx ", %s]", msg, pc,
+                IobcFaultPolicy_str(policy));
+    g_free(msg);
+
+    qapi_event_send_iobc_fault(source, mr->addr + offset, write, pc, policy);
+
+    // accesses not originating from the CPU (e.g. by the debugger) are
+    // only logged
+    if (!current_cpu) {
+        return;
+    }
+
+    switch (policy) {
+    case IOBC_FAULT_POLICY_DATA_ABORT:
+        fault_result = MEMTX_DECODE_ERROR;
+        break;
+
+    case IOBC_FAULT_POLICY_STOP:
+        vm_stop(RUN_STATE_PAUSED);
+        break;
+
+    default:
+        break;
+    }
+}
+
+MemTxResult iobc_fault_result(void)
+{
+    MemTxResult result = fault_result;
+
+    fault_result = MEMTX_OK;
+    return result;
+}
@@ -0,0 +1,87 @@
+/*
+ * ISIS iOBC fault policy.
+ *
+ * Central handling of invalid guest accesses, i.e. accesses to reserved
+ * memory regions and to unimplemented or illegal peripheral register
+ * offsets. Instead of always aborting the emulator, each fault is handled
+ * according to a configurable policy (see IobcFaultPolicy in
+ * qapi/misc-target.json):
+ * - abort: Log the access and abort the emulator (default).
+ * - data-abort: Log the access and raise a data abort in the guest, as for
+ *   an external abort on the bus.
+ * - log: Log the access and continue. Reads return zero, writes are ignored.
+ * - stop: Log the access and stop the VM (at the end of the current
+ *   translation block). Once resumed, continue as with log.
+ * For all policies except abort, the QMP event IOBC_FAULT is emitted with
+ * the address of the access and the program counter of the accessing
+ * instruction.
+ *
+ * The policy is selected per fault source, i.e. per memory region name (e.g.
+ * "iobc.undefined" for a reserved region or "at91.usart" for all USARTs),
+ * via a colon-separated list of entries. An entry "<policy>" sets the default
+ * policy, an entry "<prefix>=<policy>" sets the policy for all sources
+ * starting with the given prefix. Later entries take precedence, e.g.
+ * "log:iobc.periph=stop:at91.mci=abort".
+ *
+ * While the fuzzing harness runs an input, faults are reported to it as
+ * crashes instead (see iobc-fuzz.h).
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#ifndef HW_ARM_ISIS_OBC_FAULT_H
+#define HW_ARM_ISIS_OBC_FAULT_H
+
+#include "qemu/osdep.h"
+#include "qapi/qapi-types-misc-target.h"
+#include "exec/memory.h"
+
+
+/*
+ * Set the fault policies from the given specification (see above). Replaces
+ * all previously set policies. Returns false and leaves the policies
+ * unchanged if the specification is invalid.
+ */
+bool iobc_fault_configure(const char *spec, Error **errp);
+
+/*
+ * Report an invalid access at the given offset of the given memory region,
+ * with a message in printf format, and handle it according to the policy
+ * for the region. Does not return with the abort policy. Otherwise, reads
+ * should return zero. Must be called from a MemoryRegionOps callback of the
+ * region.
+ */
+void iobc_fault(MemoryRegion *mr, hwaddr offset, bool write, const char *fmt, ...)
+    GCC_FMT_ATTR(4, 5);
+
+/*
+ * Return the transaction result for the current access and reset it, i.e.
+ * MEMTX_DECODE_ERROR if the access has been reported via iobc_fault() with
+ * the data-abort policy, MEMTX_OK otherwise.
+ */
+MemTxResult iobc_fault_result(void);
+
+/*
+ * Define the MemoryRegionOps accessors <read>_tx and <write>_tx (for
+ * read_with_attrs and write_with_attrs), wrapping the given plain accessors
+ * so that faults reported via iobc_fault() can raise a data abort.
+ */
+#define IOBC_FAULT_ACCESSORS(read, write)                                       \
+    static MemTxResult read##_tx(void *opaque, hwaddr offset, uint64_t *data,   \
+                                 unsigned size, MemTxAttrs attrs)               \
+    {                                                                           \
+        *data = read(opaque, offset, size);                                     \
+        return iobc_fault_result();                                             \
+    }                                                                           \
+                                                                                \
+    static MemTxResult write##_tx(void *opaque, hwaddr offset, uint64_t data,   \
+                                  unsigned size, MemTxAttrs attrs)              \
+    {                                                                           \
+        write(opaque, offset, data, size);                                      \
+        return iobc_fault_result();                                             \
+    }
+
+#endif /* HW_ARM_ISIS_OBC_FAULT_H */
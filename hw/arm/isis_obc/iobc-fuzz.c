@@ -0,0 +1,659 @@
+/*
+ * ISIS iOBC snapshot-reset fuzzing harness.
+ *
+ * See iobc-fuzz.h for details.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#include "iobc-fuzz.h"
+#include "qemu/error-report.h"
+#include "qemu/main-loop.h"
+#include "qapi/error.h"
+#include "sysemu/sysemu.h"
+#include "sysemu/runstate.h"
+#include "migration/snapshot.h"
+#include "exec/ram_addr.h"
+#include "hw/core/cpu.h"
+#include "qemu/plugin.h"
+
+
+#define AFL_FORKSRV_FD          198
+
+#define IOX_CAT_DATA            0x01
+#define IOX_CID_DATA_IN         0x01
+#define IOX_CID_DATA_OUT        0x02
+#define IOX_CID_CTRL_START      0x03
+
+#define TWI_START_READ          BIT(7)
+
+// pages are restored in blocks to quickly skip over clean regions
+#define FUZZ_RAM_BLOCK          (64 * TARGET_PAGE_SIZE)
+
+static const struct {
+    hwaddr pc;
+    IobcFuzzResult result;
+    const char *reason;
+} fuzz_vectors[] = {
+    { 0x00000004, IOBC_FUZZ_RESULT_CRASH_UNDEF, "undefined instruction" },
+    { 0x0000000C, IOBC_FUZZ_RESULT_CRASH_ABORT, "prefetch abort" },
+    { 0x00000010, IOBC_FUZZ_RESULT_CRASH_ABORT, "data abort" },
+    { 0xFFFF0004, IOBC_FUZZ_RESULT_CRASH_UNDEF, "undefined instruction" },
+    { 0xFFFF000C, IOBC_FUZZ_RESULT_CRASH_ABORT, "prefetch abort" },
+    { 0xFFFF0010, IOBC_FUZZ_RESULT_CRASH_ABORT, "data abort" },
+};
+
+static const char *fuzz_result_names[] = {
+    [IOBC_FUZZ_RESULT_OK]          = "ok",
+    [IOBC_FUZZ_RESULT_TIMEOUT]     = "timeout",
+    [IOBC_FUZZ_RESULT_CRASH_ABORT] = "crash",
+    [IOBC_FUZZ_RESULT_CRASH_UNDEF] = "crash",
+    [IOBC_FUZZ_RESULT_CRASH_ERROR] = "crash",
+};
+
+// there is only one machine, thus at most one active fuzzing harness
+static IobcFuzz *fuzz_active = NULL;
+
+
+static void fuzz_next_input(IobcFuzz *fz);
+
+static bool fuzz_is_crash(IobcFuzzResult result)
+{
+    return result >= IOBC_FUZZ_RESULT_CRASH_ABORT;
+}
+
+static void fuzz_stop(IobcFuzz *fz, IobcFuzzResult result, const char *reason)
+{
+    if (fz->state != IOBC_FUZZ_RUN) {
+        return;
+    }
+
+    fz->state = IOBC_FUZZ_DONE;
+    fz->result = result;
+    fz->reason = reason;
+    timer_del(fz->timeout);
+
+    // may be called from the vCPU thread, in which case the stop is deferred
+    vm_stop(RUN_STATE_PAUSED);
+}
+
+static void fuzz_timeout(void *opaque)
+{
+    IobcFuzz *fz = opaque;
+
+    fuzz_stop(fz, IOBC_FUZZ_RESULT_TIMEOUT, NULL);
+}
+
+
+static uint8_t fuzz_input_next(IobcFuzz *fz, bool *ok)
+{
+    if (fz->input_pos >= fz->input->len) {
+        *ok = false;
+        return 0;
+    }
+
+    *ok = true;
+    return fz->input->data[fz->input_pos++];
+}
+
+static void fuzz_inject(IobcFuzz *fz, uint8_t *data, unsigned len)
+{
+    uint8_t buf[sizeof(struct iox_data_frame) + 0xff];
+    struct iox_data_frame *frame = (struct iox_data_frame *)buf;
+
+    while (len > 0) {
+        frame->seq = 0;
+        frame->cat = IOX_CAT_DATA;
+        frame->id = IOX_CID_DATA_IN;
+        frame->len = MIN(len, 0xff);
+        memcpy(frame->payload, data, frame->len);
+
+        iox_server_inject(fz->target, frame);
+
+        data += frame->len;
+        len -= frame->len;
+    }
+}
+
+static void fuzz_reply_bh(void *opaque)
+{
+    IobcFuzz *fz = opaque;
+    GByteArray *reply = fz->reply;
+
+    if (fz->state != IOBC_FUZZ_RUN || !reply->len) {
+        g_byte_array_set_size(reply, 0);
+        return;
+    }
+
+    // the reply buffer may be appended to by the device while injecting
+    fz->reply = g_byte_array_new();
+    fuzz_inject(fz, reply->data, reply->len);
+    g_byte_array_free(reply, true);
+}
+
+static void fuzz_tap_spi(IobcFuzz *fz, struct iox_data_frame *frame)
+{
+    unsigned i;
+    bool ok;
+
+    if (frame->id != IOX_CID_DATA_OUT) {
+        return;
+    }
+
+    // transfer units: data in bits 0-15, number of bits - 8 in bits 16-23
+    for (i = 0; i + sizeof(uint32_t) <= frame->len; i += sizeof(uint32_t)) {
+        uint32_t unit = ldl_le_p(&frame->payload[i]);
+        unsigned bits = ((unit >> 16) & 0xff) + 8;
+        uint32_t data;
+
+        data = fuzz_input_next(fz, &ok);
+        if (ok && bits > 8) {
+            data |= fuzz_input_next(fz, &ok) << 8;
+        }
+
+        // echo transmitted data once the input is exhausted
+        if (ok) {
+            unit = (unit & 0xffff0000) | (data & ((1 << bits) - 1));
+        }
+
+        unit = cpu_to_le32(unit);
+        g_byte_array_append(fz->reply, (uint8_t *)&unit, sizeof(unit));
+    }
+}
+
+static void fuzz_tap_twi(IobcFuzz *fz, struct iox_data_frame *frame)
+{
+    unsigned len, i;
+    uint8_t data;
+    bool ok;
+
+    if (frame->id != IOX_CID_CTRL_START || !frame->len
+            || !(frame->payload[0] & TWI_START_READ)) {
+        return;
+    }
+
+    len = fuzz_input_next(fz, &ok);
+    for (i = 0; ok && i < len; i++) {
+        data = fuzz_input_next(fz, &ok);
+        if (ok) {
+            g_byte_array_append(fz->reply, &data, 1);
+        }
+    }
+}
+
+static void fuzz_tap(struct iox_data_frame *frame, void *opaque)
+{
+    IobcFuzz *fz = opaque;
+
+    if (fz->state != IOBC_FUZZ_RUN || frame->cat != IOX_CAT_DATA) {
+        return;
+    }
+
+    switch (fz->target_type) {
+    case IOBC_FUZZ_TARGET_SPI:
+        fuzz_tap_spi(fz, frame);
+        break;
+
+    case IOBC_FUZZ_TARGET_TWI:
+        fuzz_tap_twi(fz, frame);
+        break;
+
+    case IOBC_FUZZ_TARGET_USART:
+        break;
+    }
+
+    // reply asynchronously from the main loop, like an external client
+    if (fz->reply->len) {
+        qemu_bh_schedule(fz->reply_bh);
+    }
+}
+
+
+static void fuzz_restore_ram(IobcFuzzRam *ram)
+{
+    MemoryRegion *mr = ram->mr;
+    uint64_t size = memory_region_size(mr);
+    uint8_t *host = memory_region_get_ram_ptr(mr);
+    ram_addr_t base = memory_region_get_ram_addr(mr);
+    DirtyBitmapSnapshot *snap;
+    hwaddr block, page;
+
+    snap = memory_region_snapshot_and_clear_dirty(mr, 0, size, DIRTY_MEMORY_VGA);
+
+    for (block = 0; block < size; block += FUZZ_RAM_BLOCK) {
+        hwaddr end = MIN(block + FUZZ_RAM_BLOCK, size);
+
+        if (!memory_region_snapshot_get_dirty(mr, snap, block, end - block)) {
+            continue;
+        }
+
+        for (page = block; page < end; page += TARGET_PAGE_SIZE) {
+            if (!memory_region_snapshot_get_dirty(mr, snap, page, TARGET_PAGE_SIZE)) {
+                continue;
+            }
+
+            // copying via the host pointer does not dirty the page again
+            memcpy(host + page, ram->copy + page, TARGET_PAGE_SIZE);
+            tb_invalidate_phys_range(base + page, base + page + TARGET_PAGE_SIZE);
+        }
+    }
+
+    g_free(snap);
+}
+
+static void fuzz_restore(IobcFuzz *fz)
+{
+    Error *err = NULL;
+    unsigned i;
+
+    if (load_device_state_buffer(fz->devstate, &err) < 0) {
+        error_report_err(err);
+        error_report("iobc.fuzz: cannot restore snapshot");
+        exit(1);
+    }
+
+    for (i = 0; i < fz->num_ram; i++) {
+        fuzz_restore_ram(&fz->ram[i]);
+    }
+}
+
+
+static GByteArray *fuzz_read_input(const char *path)
+{
+    GByteArray *input = g_byte_array_new();
+    GError *gerr = NULL;
+    gchar *data;
+    gsize len;
+    uint8_t buf[4096];
+    ssize_t n;
+
+    if (path) {
+        if (!g_file_get_contents(path, &data, &len, &gerr)) {
+            error_report("iobc.fuzz: cannot read input: %s", gerr->message);
+            g_error_free(gerr);
+            return input;
+        }
+
+        g_byte_array_append(input, (uint8_t *)data, len);
+        g_free(data);
+        return input;
+    }
+
+    // AFL rewrites the input file behind stdin for each run
+    lseek(STDIN_FILENO, 0, SEEK_SET);
+    while ((n = read(STDIN_FILENO, buf, sizeof(buf))) > 0) {
+        g_byte_array_append(input, buf, n);
+    }
+
+    return input;
+}
+
+static void fuzz_run(IobcFuzz *fz, GByteArray *input)
+{
+    if (fz->input) {
+        g_byte_array_free(fz->input, true);
+    }
+
+    fz->input = input;
+    fz->input_pos = 0;
+    g_byte_array_set_size(fz->reply, 0);
+
+    fz->state = IOBC_FUZZ_RUN;
+    fz->result = IOBC_FUZZ_RESULT_OK;
+    fz->reason = NULL;
+    fz->finish_scheduled = false;
+
+    if (fz->target_type == IOBC_FUZZ_TARGET_USART) {
+        fz->input_pos = input->len;
+        fuzz_inject(fz, input->data, input->len);
+    }
+
+    // each run starts from the snapshot, let plugins drop their trace state
+    qemu_plugin_restore_cb();
+
+    timer_mod(fz->timeout, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) + fz->timeout_ns);
+    vm_start();
+}
+
+
+/*
+ * AFL kills the child process it has been given on its own timeout. This must
+ * not be the emulator, so it is given an idle placeholder process instead,
+ * which is replaced once killed. Runs always end via the timeout in virtual
+ * time of the harness, which should be shorter than the one of AFL.
+ */
+static uint32_t fuzz_afl_child(IobcFuzz *fz)
+{
+    int status;
+
+    if (fz->afl_child > 0 && waitpid(fz->afl_child, &status, WNOHANG) == 0) {
+        return fz->afl_child;
+    }
+
+    fz->afl_child = fork();
+    if (fz->afl_child < 0) {
+        error_report("iobc.fuzz: cannot create child process: %s", strerror(errno));
+        exit(1);
+    }
+
+    if (fz->afl_child == 0) {
+        for (;;) {
+            pause();
+        }
+    }
+
+    return fz->afl_child;
+}
+
+static void fuzz_exit_notify(Notifier *n, void *data)
+{
+    IobcFuzz *fz = container_of(n, IobcFuzz, exit);
+
+    if (fz->afl_child > 0) {
+        kill(fz->afl_child, SIGKILL);
+        waitpid(fz->afl_child, NULL, 0);
+    }
+}
+
+static void fuzz_afl_request(void *opaque)
+{
+    IobcFuzz *fz = opaque;
+    uint32_t was_killed;
+    uint32_t pid;
+
+    if (read(AFL_FORKSRV_FD, &was_killed, sizeof(was_killed)) != sizeof(was_killed)) {
+        // AFL has gone away
+        qemu_set_fd_handler(AFL_FORKSRV_FD, NULL, NULL, NULL);
+        qemu_system_shutdown_request(SHUTDOWN_CAUSE_HOST_SIGNAL);
+        return;
+    }
+
+    if (fz->state != IOBC_FUZZ_WAIT) {
+        error_report("iobc.fuzz: unexpected AFL request");
+        exit(1);
+    }
+
+    pid = fuzz_afl_child(fz);
+    if (write(AFL_FORKSRV_FD + 1, &pid, sizeof(pid)) != sizeof(pid)) {
+        error_report("iobc.fuzz: cannot reply to AFL");
+        exit(1);
+    }
+
+    fuzz_run(fz, fuzz_read_input(fz->input_path));
+}
+
+static void fuzz_afl_report(IobcFuzz *fz)
+{
+    uint32_t status = 0;
+
+    // encoded as wait status of a process killed by the signal
+    switch (fz->result) {
+    case IOBC_FUZZ_RESULT_OK:
+    case IOBC_FUZZ_RESULT_TIMEOUT:
+        status = 0;
+        break;
+
+    case IOBC_FUZZ_RESULT_CRASH_ABORT:
+        status = SIGSEGV;
+        break;
+
+    case IOBC_FUZZ_RESULT_CRASH_UNDEF:
+        status = SIGILL;
+        break;
+
+    case IOBC_FUZZ_RESULT_CRASH_ERROR:
+        status = SIGABRT;
+        break;
+    }
+
+    if (write(AFL_FORKSRV_FD + 1, &status, sizeof(status)) != sizeof(status)) {
+        error_report("iobc.fuzz: cannot report status to AFL");
+        exit(1);
+    }
+}
+
+static void fuzz_finish_bh(void *opaque)
+{
+    IobcFuzz *fz = opaque;
+
+    fz->execs += 1;
+    if (fz->result == IOBC_FUZZ_RESULT_TIMEOUT) {
+        fz->timeouts += 1;
+    } else if (fuzz_is_crash(fz->result)) {
+        fz->crashes += 1;
+    }
+
+    if (fz->afl) {
+        fuzz_afl_report(fz);
+    } else {
+        const char *input = g_ptr_array_index(fz->inputs, fz->next_input - 1);
+
+        info_report("iobc.fuzz: %s: %s%s%s", input ? input : "stdin",
+                    fuzz_result_names[fz->result], fz->reason ? ": " : "",
+                    fz->reason ? fz->reason : "");
+    }
+
+    fuzz_restore(fz);
+    fz->state = IOBC_FUZZ_WAIT;
+
+    if (!fz->afl) {
+        fuzz_next_input(fz);
+    }
+}
+
+static void fuzz_next_input(IobcFuzz *fz)
+{
+    const char *path;
+
+    if (fz->next_input >= fz->inputs->len) {
+        info_report("iobc.fuzz: %" PRIu64 " inputs, %" PRIu64 " crashes, %" PRIu64 " timeouts",
+                    fz->execs, fz->crashes, fz->timeouts);
+        exit(fz->crashes ? 1 : 0);
+    }
+
+    path = g_ptr_array_index(fz->inputs, fz->next_input++);
+    fuzz_run(fz, fuzz_read_input(path));
+}
+
+static void fuzz_collect_inputs(IobcFuzz *fz)
+{
+    GError *gerr = NULL;
+    const char *name;
+    GDir *dir;
+
+    if (!fz->input_path || !g_file_test(fz->input_path, G_FILE_TEST_IS_DIR)) {
+        g_ptr_array_add(fz->inputs, g_strdup(fz->input_path));
+        return;
+    }
+
+    dir = g_dir_open(fz->input_path, 0, &gerr);
+    if (!dir) {
+        error_report("iobc.fuzz: cannot open input directory: %s", gerr->message);
+        exit(1);
+    }
+
+    while ((name = g_dir_read_name(dir))) {
+        g_ptr_array_add(fz->inputs, g_build_filename(fz->input_path, name, NULL));
+    }
+
+    g_dir_close(dir);
+    g_ptr_array_sort(fz->inputs, (GCompareFunc)g_strcmp0);
+}
+
+
+static void fuzz_snapshot_bh(void *opaque)
+{
+    IobcFuzz *fz = opaque;
+    CPUState *cpu = CPU(fz->cpu);
+    Error *err = NULL;
+    uint32_t hello = 0;
+    unsigned i;
+
+    cpu_breakpoint_remove(cpu, fz->start_pc, BP_MACHINE);
+
+    if (save_device_state_buffer(fz->devstate, &err) < 0) {
+        error_report_err(err);
+        error_report("iobc.fuzz: cannot take snapshot");
+        exit(1);
+    }
+
+    for (i = 0; i < fz->num_ram; i++) {
+        MemoryRegion *mr = fz->ram[i].mr;
+        uint64_t size = memory_region_size(mr);
+
+        fz->ram[i].copy = g_malloc(size);
+        memcpy(fz->ram[i].copy, memory_region_get_ram_ptr(mr), size);
+
+        memory_region_set_log(mr, true, DIRTY_MEMORY_VGA);
+        g_free(memory_region_snapshot_and_clear_dirty(mr, 0, size, DIRTY_MEMORY_VGA));
+    }
+
+    for (i = 0; i < fz->done_pcs->len; i++) {
+        cpu_breakpoint_insert(cpu, g_array_index(fz->done_pcs, hwaddr, i), BP_MACHINE, NULL);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(fuzz_vectors); i++) {
+        cpu_breakpoint_insert(cpu, fuzz_vectors[i].pc, BP_MACHINE, NULL);
+    }
+
+    iox_server_set_tap(fz->target, fuzz_tap, fz);
+
+    fz->state = IOBC_FUZZ_WAIT;
+    info_report("iobc.fuzz: snapshot taken at 0x%08" HWADDR_PRIx, fz->start_pc);
+
+    // AFL sets up the fork server pipes along with the coverage map
+    if (getenv("__AFL_SHM_ID")) {
+        if (write(AFL_FORKSRV_FD + 1, &hello, sizeof(hello)) != sizeof(hello)) {
+            error_report("iobc.fuzz: cannot talk to AFL fork server pipe");
+            exit(1);
+        }
+
+        fz->afl = true;
+        fz->exit.notify = fuzz_exit_notify;
+        qemu_add_exit_notifier(&fz->exit);
+        qemu_set_fd_handler(AFL_FORKSRV_FD, fuzz_afl_request, NULL, fz);
+    } else {
+        fuzz_collect_inputs(fz);
+        fuzz_next_input(fz);
+    }
+}
+
+static void fuzz_check_pc(IobcFuzz *fz, hwaddr pc)
+{
+    unsigned i;
+
+    for (i = 0; i < fz->done_pcs->len; i++) {
+        if (g_array_index(fz->done_pcs, hwaddr, i) == pc) {
+            fz->state = IOBC_FUZZ_DONE;
+            fz->result = IOBC_FUZZ_RESULT_OK;
+            return;
+        }
+    }
+
+    for (i = 0; i < ARRAY_SIZE(fuzz_vectors); i++) {
+        if (fuzz_vectors[i].pc == pc) {
+            fz->state = IOBC_FUZZ_DONE;
+            fz->result = fuzz_vectors[i].result;
+            fz->reason = fuzz_vectors[i].reason;
+            return;
+        }
+    }
+}
+
+static void fuzz_vm_state_change(void *opaque, int running, RunState state)
+{
+    IobcFuzz *fz = opaque;
+    hwaddr pc = fz->cpu->env.regs[15];
+
+    if (running) {
+        return;
+    }
+
+    // cannot snapshot or restore from within the state change notification
+    if (fz->state == IOBC_FUZZ_BOOT) {
+        if (state == RUN_STATE_DEBUG && pc == fz->start_pc) {
+            aio_bh_schedule_oneshot(qemu_get_aio_context(), fuzz_snapshot_bh, fz);
+        }
+        return;
+    }
+
+    if (fz->state == IOBC_FUZZ_RUN && state == RUN_STATE_DEBUG) {
+        fuzz_check_pc(fz, pc);
+    }
+
+    if (fz->state == IOBC_FUZZ_DONE && !fz->finish_scheduled) {
+        fz->finish_scheduled = true;
+        timer_del(fz->timeout);
+        aio_bh_schedule_oneshot(qemu_get_aio_context(), fuzz_finish_bh, fz);
+    }
+}
+
+
+IobcFuzz *iobc_fuzz_new(ARMCPU *cpu, IoXferServer *target, IobcFuzzTargetType type)
+{
+    IobcFuzz *fz = g_new0(IobcFuzz, 1);
+
+    fz->cpu = cpu;
+    fz->target = target;
+    fz->target_type = type;
+    fz->done_pcs = g_array_new(false, false, sizeof(hwaddr));
+    fz->inputs = g_ptr_array_new_with_free_func(g_free);
+    fz->devstate = g_byte_array_new();
+    fz->reply = g_byte_array_new();
+    fz->state = IOBC_FUZZ_BOOT;
+
+    fz->timeout = timer_new_ns(QEMU_CLOCK_VIRTUAL, fuzz_timeout, fz);
+    fz->reply_bh = qemu_bh_new(fuzz_reply_bh, fz);
+
+    return fz;
+}
+
+void iobc_fuzz_add_ram(IobcFuzz *fz, MemoryRegion *mr)
+{
+    // restoring it would not undo, but write the runs through to its file
+    if (qemu_ram_is_shared(mr->ram_block)) {
+        error_report("iobc.fuzz: cannot fuzz with shared memory '%s'",
+                     memory_region_name(mr));
+        exit(1);
+    }
+
+    if (fz->num_ram >= IOBC_FUZZ_MAX_RAM) {
+        error_report("iobc.fuzz: too many RAM regions");
+        exit(1);
+    }
+
+    fz->ram[fz->num_ram++].mr = mr;
+}
+
+void iobc_fuzz_add_done_pc(IobcFuzz *fz, hwaddr pc)
+{
+    g_array_append_val(fz->done_pcs, pc);
+}
+
+void iobc_fuzz_activate(IobcFuzz *fz, hwaddr start_pc, const char *input,
+                        int64_t timeout_ns)
+{
+    fz->start_pc = start_pc;
+    fz->input_path = g_strdup(input);
+    fz->timeout_ns = timeout_ns;
+
+    cpu_breakpoint_insert(CPU(fz->cpu), start_pc, BP_MACHINE, NULL);
+    fz->vm_change = qemu_add_vm_change_state_handler(fuzz_vm_state_change, fz);
+
+    fuzz_active = fz;
+}
+
+bool iobc_fuzz_crash(const char *reason)
+{
+    IobcFuzz *fz = fuzz_active;
+
+    if (!fz || (fz->state != IOBC_FUZZ_RUN && fz->state != IOBC_FUZZ_DONE)) {
+        return false;
+    }
+
+    fuzz_stop(fz, IOBC_FUZZ_RESULT_CRASH_ERROR, reason);
+    return true;
+}
@@ -0,0 +1,168 @@
+/*
+ * ISIS iOBC snapshot-reset fuzzing harness.
+ *
+ * Runs the firmware until it reaches a given start program counter, takes an
+ * in-process snapshot of the device state and RAM there, and then executes
+ * one fuzzer input after the other from this snapshot. Each input is fed to
+ * a single peripheral via its IOX server (i.e. as if sent by an external
+ * simulator):
+ * - USART: The complete input is received as serial data at the start.
+ * - SPI: Each transfer of the firmware is answered with the next input bytes
+ *   (one byte per transfer unit, two for units of more than 8 bits).
+ * - TWI: Each read transfer of the firmware is answered with a chunk of the
+ *   input, consisting of a length byte followed by that many data bytes.
+ * Once the input is exhausted, SPI transfers are answered by an echo of the
+ * transmitted data (as without connected client) and TWI reads are not
+ * answered anymore.
+ *
+ * A run ends when the firmware reaches one of the given done program
+ * counters (e.g. the return of the command handler or the idle loop), when
+ * it crashes, or after a timeout in virtual time. Crashes are:
+ * - undefined instruction, prefetch abort, and data abort exceptions
+ *   (detected at the exception vectors, low and high),
+ * - accesses to reserved memory regions and illegal peripheral registers
+ *   (see iobc-fault.h),
+ * - overflows of the AIC interrupt priority stack.
+ * After each run, the device state is restored and RAM pages written during
+ * the run are copied back from the snapshot (tracked via dirty logging).
+ * This covers SRAM, SDRAM, and the NOR flash. Fuzzing is not supported with
+ * the CFI flash model or with RAM shared with a file.
+ *
+ * If started by AFL (i.e. with __AFL_SHM_ID set), the harness implements the
+ * AFL fork server protocol (on file descriptors 198 and 199). AFL is given an
+ * idle placeholder process as child, so that killing it on an AFL timeout
+ * does not kill the emulator; the timeout in virtual time should thus be
+ * shorter than the one of AFL.
+ * Crashes are reported as SIGSEGV (aborts), SIGILL (undefined instructions)
+ * or SIGABRT (emulator-detected errors), timeouts in virtual time as normal
+ * termination (AFL detects hangs via its own timeout). Edge coverage can be
+ * recorded to the AFL shared memory map via the aflcov TCG plugin (see
+ * tests/plugin/aflcov.c). The input is read from the given file for each run
+ * (e.g. AFL's @@), or from stdin if none is given.
+ *
+ * If not started by AFL, the given input file, or each file of the given
+ * directory, is run once and the result is reported, e.g. for reproducing
+ * crashes. The emulator then exits with status 1 if any input crashed, 0
+ * otherwise.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#ifndef HW_ARM_ISIS_OBC_FUZZ_H
+#define HW_ARM_ISIS_OBC_FUZZ_H
+
+#include "qemu/osdep.h"
+#include "qemu/timer.h"
+#include "qemu/notify.h"
+#include "sysemu/runstate.h"
+#include "exec/memory.h"
+#include "cpu.h"
+
+#include "ioxfer-server.h"
+
+
+#define IOBC_FUZZ_MAX_RAM       8
+
+typedef enum {
+    IOBC_FUZZ_TARGET_USART,
+    IOBC_FUZZ_TARGET_SPI,
+    IOBC_FUZZ_TARGET_TWI,
+} IobcFuzzTargetType;
+
+typedef enum {
+    IOBC_FUZZ_BOOT,         // waiting for the start program counter
+    IOBC_FUZZ_WAIT,         // waiting for the next input
+    IOBC_FUZZ_RUN,          // running an input
+    IOBC_FUZZ_DONE,         // run finished, waiting for reset
+} IobcFuzzState;
+
+typedef enum {
+    IOBC_FUZZ_RESULT_OK,
+    IOBC_FUZZ_RESULT_TIMEOUT,
+    IOBC_FUZZ_RESULT_CRASH_ABORT,
+    IOBC_FUZZ_RESULT_CRASH_UNDEF,
+    IOBC_FUZZ_RESULT_CRASH_ERROR,
+} IobcFuzzResult;
+
+typedef struct {
+    MemoryRegion *mr;
+    uint8_t *copy;
+} IobcFuzzRam;
+
+typedef struct {
+    ARMCPU *cpu;
+    hwaddr start_pc;
+    GArray *done_pcs;
+    int64_t timeout_ns;
+
+    IoXferServer *target;
+    IobcFuzzTargetType target_type;
+
+    char *input_path;
+    GPtrArray *inputs;
+    unsigned next_input;
+    bool afl;
+    pid_t afl_child;
+    Notifier exit;
+
+    GByteArray *devstate;
+    IobcFuzzRam ram[IOBC_FUZZ_MAX_RAM];
+    unsigned num_ram;
+
+    IobcFuzzState state;
+    IobcFuzzResult result;
+    const char *reason;
+    GByteArray *input;
+    unsigned input_pos;
+    GByteArray *reply;
+    bool finish_scheduled;
+
+    QEMUTimer *timeout;
+    QEMUBH *reply_bh;
+    VMChangeStateEntry *vm_change;
+
+    uint64_t execs;
+    uint64_t crashes;
+    uint64_t timeouts;
+} IobcFuzz;
+
+
+/*
+ * Create the fuzzing harness. Inputs are fed to the given IOX server of a
+ * peripheral of the given type. The harness becomes active with
+ * iobc_fuzz_activate().
+ */
+IobcFuzz *iobc_fuzz_new(ARMCPU *cpu, IoXferServer *target, IobcFuzzTargetType type);
+
+/*
+ * Add a RAM region to be restored after each run. Shared RAM is rejected,
+ * as the runs would be written through to its backing file.
+ */
+void iobc_fuzz_add_ram(IobcFuzz *fz, MemoryRegion *mr);
+
+/*
+ * Add a program counter at which a run is considered done.
+ */
+void iobc_fuzz_add_done_pc(IobcFuzz *fz, hwaddr pc);
+
+/*
+ * Start the harness: Take the snapshot once the CPU reaches the given start
+ * program counter and run inputs from the given file or directory (or stdin
+ * if NULL) from there. Runs are stopped after the given timeout (in
+ * nanoseconds of virtual time).
+ */
+void iobc_fuzz_activate(IobcFuzz *fz, hwaddr start_pc, const char *input,
+                        int64_t timeout_ns);
+
+/*
+ * Report a crash detected by a device model (e.g. an access to reserved
+ * memory) with the given reason. Returns true if a fuzzing run is active
+ * and the crash has been recorded, in which case the caller should continue
+ * without aborting the emulator. May be called from the vCPU thread.
+ */
+bool iobc_fuzz_crash(const char *reason);
+
+#endif /* HW_ARM_ISIS_OBC_FUZZ_H */
@@ -0,0 +1,190 @@
+/*
+ * ISIS iOBC emulator logging channel.
+ *
+ * See iobc-log.h for details.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#include "iobc-log.h"
+#include "iobc-fault.h"
+#include "qemu/error-report.h"
+#include "qemu/timer.h"
+#include "exec/address-spaces.h"
+#include "hw/qdev-properties.h"
+#include "migration/vmstate.h"
+
+
+#define LOG_ADDR        0x00
+#define LOG_LEN         0x04
+
+// upper bound for a single message, guards against garbage lengths
+#define LOG_LEN_MAX     0x10000
+
+
+static void log_timestamp(IobcLogState *s)
+{
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    char buf[32];
+    int len;
+
+    len = snprintf(buf, sizeof(buf), "[%6" PRId64 ".%06" PRId64 "] ",
+                   now / NANOSECONDS_PER_SECOND,
+                   now % NANOSECONDS_PER_SECOND / 1000);
+
+    qemu_chr_fe_write_all(&s->chr, (uint8_t *)buf, len);
+}
+
+static void log_output(IobcLogState *s, uint32_t len)
+{
+    uint8_t buf[256];
+    hwaddr addr = s->reg_addr;
+
+    if (len > LOG_LEN_MAX) {
+        iobc_fault(&s->mmio, LOG_LEN, true,
+                   "iobc.log: message length %u exceeds maximum of %u", len, LOG_LEN_MAX);
+        return;
+    }
+
+    // copy in chunks, messages are typically short
+    while (len) {
+        uint32_t n = MIN(len, sizeof(buf));
+        uint32_t start, end;
+
+        if (address_space_read(&address_space_memory, addr, MEMTXATTRS_UNSPECIFIED,
+                               buf, n) != MEMTX_OK) {
+            iobc_fault(&s->mmio, LOG_LEN, true,
+                       "iobc.log: cannot read message at 0x%08" HWADDR_PRIx, addr);
+            return;
+        }
+
+        for (start = 0; start < n; start = end) {
+            uint8_t *nl = memchr(buf + start, '\n', n - start);
+
+            end = nl ? nl - buf + 1 : n;
+
+            if (s->line_start) {
+                log_timestamp(s);
+            }
+
+            qemu_chr_fe_write_all(&s->chr, buf + start, end - start);
+            s->line_start = nl != NULL;
+        }
+
+        addr += n;
+        len -= n;
+    }
+}
+
+
+static uint64_t log_mmio_read(void *opaque, hwaddr offset, unsigned size)
+{
+    IobcLogState *s = opaque;
+
+    switch (offset) {
+    case LOG_ADDR:
+        return s->reg_addr;
+
+    case LOG_LEN:
+        return 0;
+
+    default:
+        iobc_fault(&s->mmio, offset, false,
+                   "iobc.log: illegal read access at 0x%02" HWADDR_PRIx,
+                   offset);
+        return 0;
+    }
+}
+
+static void log_mmio_write(void *opaque, hwaddr offset, uint64_t value, unsigned size)
+{
+    IobcLogState *s = opaque;
+
+    switch (offset) {
+    case LOG_ADDR:
+        s->reg_addr = value;
+        break;
+
+    case LOG_LEN:
+        log_output(s, value);
+        break;
+
+    default:
+        iobc_fault(&s->mmio, offset, true,
+                   "iobc.log: illegal write access at 0x%02" HWADDR_PRIx " (value: 0x%08" PRIx64 ")",
+                   offset, value);
+        break;
+    }
+}
+
+IOBC_FAULT_ACCESSORS(log_mmio_read, log_mmio_write)
+
+static const MemoryRegionOps log_mmio_ops = {
+    .read_with_attrs = log_mmio_read_tx,
+    .write_with_attrs = log_mmio_write_tx,
+    .impl.min_access_size = 4,
+    .impl.max_access_size = 4,
+    .valid.min_access_size = 4,
+    .valid.max_access_size = 4,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
+static Property log_device_properties[] = {
+    DEFINE_PROP_CHR("chardev", IobcLogState, chr),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+
+static void log_device_init(Object *obj)
+{
+    IobcLogState *s = IOBC_LOG(obj);
+
+    memory_region_init_io(&s->mmio, OBJECT(s), &log_mmio_ops, s, "iobc.log", 0x10);
+    sysbus_init_mmio(SYS_BUS_DEVICE(s), &s->mmio);
+}
+
+static void log_device_reset(DeviceState *dev)
+{
+    IobcLogState *s = IOBC_LOG(dev);
+
+    s->reg_addr = 0;
+    s->line_start = true;
+}
+
+static const VMStateDescription log_vmstate = {
+    .name = TYPE_IOBC_LOG,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(reg_addr, IobcLogState),
+        VMSTATE_BOOL(line_start, IobcLogState),
+        VMSTATE_END_OF_LIST()
+    },
+};
+
+static void log_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->reset = log_device_reset;
+    dc->vmsd = &log_vmstate;
+    device_class_set_props(dc, log_device_properties);
+}
+
+static const TypeInfo log_device_info = {
+    .name = TYPE_IOBC_LOG,
+    .parent = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(IobcLogState),
+    .instance_init = log_device_init,
+    .class_init = log_class_init,
+};
+
+static void log_register_types(void)
+{
+    type_register_static(&log_device_info);
+}
+
+type_init(log_register_types)
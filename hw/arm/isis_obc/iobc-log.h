@@ -0,0 +1,47 @@
+/*
+ * ISIS iOBC emulator logging channel.
+ *
+ * Logging via the DBGU or a USART costs at least one MMIO access per
+ * character. This emulator-only device (not present on the real iOBC) lets
+ * the firmware hand over a whole message with two register writes instead:
+ *
+ *   0x00 LOG_ADDR (RW): physical address of the message buffer
+ *   0x04 LOG_LEN  (W):  length of the message, writing it outputs the message
+ *
+ * The message is copied from guest memory in one go and written to the
+ * chardev given by the "chardev" property, each line prefixed with the
+ * virtual time in seconds.
+ *
+ * Messages are limited to 64 KiB. Longer messages and messages not fully
+ * backed by guest memory are reported as access faults (see iobc-fault.h)
+ * and dropped, with any part already copied being kept.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#ifndef HW_ARM_ISIS_OBC_LOG_H
+#define HW_ARM_ISIS_OBC_LOG_H
+
+#include "qemu/osdep.h"
+#include "hw/sysbus.h"
+#include "chardev/char-fe.h"
+
+
+#define TYPE_IOBC_LOG "iobc-log"
+#define IOBC_LOG(obj) OBJECT_CHECK(IobcLogState, (obj), TYPE_IOBC_LOG)
+
+
+typedef struct {
+    SysBusDevice parent_obj;
+
+    MemoryRegion mmio;
+    CharBackend chr;
+
+    uint32_t reg_addr;
+    bool line_start;
+} IobcLogState;
+
+#endif /* HW_ARM_ISIS_OBC_LOG_H */
@@ -0,0 +1,210 @@
+/*
+ * ISIS iOBC CFI NOR program flash.
+ *
+ * See iobc-pflash.h for details.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#include "iobc-pflash.h"
+#include "qemu/error-report.h"
+#include "qapi/error.h"
+#include "qapi/qapi-commands-misc-target.h"
+#include "qapi/qmp/qdict.h"
+#include "monitor/monitor.h"
+#include "monitor/hmp.h"
+#include "hw/block/flash.h"
+#include "exec/gdbstub.h"
+#include "hw/qdev-properties.h"
+#include "hw/sysbus.h"
+
+
+// S29AL008J, bottom boot block, word mode
+#define PFLASH_ID_MANUFACTURER  0x0001
+#define PFLASH_ID_DEVICE        0x225B
+
+#define PFLASH_UNLOCK_ADDR0     0x555
+#define PFLASH_UNLOCK_ADDR1     0x2AA
+
+static const struct {
+    uint32_t num;
+    uint32_t len;
+} pflash_regions[] = {
+    {  1, 0x4000 },
+    {  2, 0x2000 },
+    {  1, 0x8000 },
+    { 15, 0x10000 },
+};
+
+typedef struct {
+    PFlashCFI02 *fl;
+    hwaddr base;
+} PflashGdb;
+
+
+static int pflash_gdb_erase(void *opaque, hwaddr addr, uint64_t len)
+{
+    PflashGdb *g = opaque;
+
+    return pflash_cfi02_direct_erase(g->fl, addr - g->base, len) ? 0 : -1;
+}
+
+static int pflash_gdb_write(void *opaque, hwaddr addr, const uint8_t *buf, uint64_t len)
+{
+    PflashGdb *g = opaque;
+
+    return pflash_cfi02_direct_program(g->fl, addr - g->base, buf, len) ? 0 : -1;
+}
+
+static const GDBFlashOps pflash_gdb_ops = {
+    .erase = pflash_gdb_erase,
+    .write = pflash_gdb_write,
+};
+
+MemoryRegion *iobc_pflash_cfi_init(BlockBackend *blk, bool timing, hwaddr base,
+                                   uint64_t window)
+{
+    DeviceState *dev = qdev_create(NULL, TYPE_PFLASH_CFI02);
+    MemoryRegion *flash, *mr, *alias;
+    PflashGdb *gdb;
+    hwaddr offset;
+    char name[32];
+    uint64_t i;
+
+    assert(window % IOBC_PFLASH_CFI_SIZE == 0);
+
+    if (blk) {
+        qdev_prop_set_drive(dev, "drive", blk, &error_fatal);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(pflash_regions); i++) {
+        snprintf(name, sizeof(name), "num-blocks%" PRIu64, i);
+        qdev_prop_set_uint32(dev, name, pflash_regions[i].num);
+        snprintf(name, sizeof(name), "sector-length%" PRIu64, i);
+        qdev_prop_set_uint32(dev, name, pflash_regions[i].len);
+    }
+
+    qdev_prop_set_uint8(dev, "width", 2);
+    qdev_prop_set_uint8(dev, "mappings", 1);
+    qdev_prop_set_uint8(dev, "big-endian", 0);
+    qdev_prop_set_uint16(dev, "id0", PFLASH_ID_MANUFACTURER);
+    qdev_prop_set_uint16(dev, "id1", PFLASH_ID_DEVICE);
+    qdev_prop_set_uint16(dev, "unlock-addr0", PFLASH_UNLOCK_ADDR0);
+    qdev_prop_set_uint16(dev, "unlock-addr1", PFLASH_UNLOCK_ADDR1);
+    qdev_prop_set_bit(dev, "erase-timing", timing);
+    qdev_prop_set_bit(dev, "program-timing", timing);
+    qdev_prop_set_string(dev, "name", "iobc.pflash.cfi");
+    qdev_init_nofail(dev);
+
+    // gdb expects a uniform block size per flash range
+    gdb = g_new(PflashGdb, 1);
+    gdb->fl = PFLASH_CFI02(dev);
+    gdb->base = base;
+
+    for (i = 0, offset = 0; i < ARRAY_SIZE(pflash_regions); i++) {
+        uint64_t size = (uint64_t)pflash_regions[i].num * pflash_regions[i].len;
+
+        gdb_register_flash(base + offset, size, pflash_regions[i].len,
+                           &pflash_gdb_ops, gdb);
+        offset += size;
+    }
+
+    flash = sysbus_mmio_get_region(SYS_BUS_DEVICE(dev), 0);
+
+    mr = g_new(MemoryRegion, 1);
+    memory_region_init(mr, NULL, "iobc.pflash", window);
+
+    for (i = 0; i < window / IOBC_PFLASH_CFI_SIZE; i++) {
+        alias = g_new(MemoryRegion, 1);
+        memory_region_init_alias(alias, NULL, "iobc.pflash.mirror", flash, 0,
+                                 IOBC_PFLASH_CFI_SIZE);
+        memory_region_add_subregion(mr, i * IOBC_PFLASH_CFI_SIZE, alias);
+    }
+
+    return mr;
+}
+
+
+static PFlashCFI02 *pflash_find(Error **errp)
+{
+    Object *obj = object_resolve_path_type("", TYPE_PFLASH_CFI02, NULL);
+
+    if (!obj) {
+        error_setg(errp, "No CFI NOR flash found (requires -M isis-obc,pflash-cfi=on)");
+        return NULL;
+    }
+
+    return PFLASH_CFI02(obj);
+}
+
+IobcPflashStats *qmp_query_iobc_pflash(bool has_reset, bool reset, Error **errp)
+{
+    PFlashCFI02 *fl = pflash_find(errp);
+    PFlashCFI02SectorStats st;
+    IobcPflashStats *info;
+    IobcPflashSectorStatsList **next;
+    uint32_t n;
+
+    if (!fl) {
+        return NULL;
+    }
+
+    info = g_new0(IobcPflashStats, 1);
+
+    next = &info->sectors;
+    for (n = 0; n < pflash_cfi02_get_num_sectors(fl); n++) {
+        IobcPflashSectorStats *sec = g_new0(IobcPflashSectorStats, 1);
+
+        pflash_cfi02_get_sector_stats(fl, n, &st);
+        sec->sector = n;
+        sec->offset = st.offset;
+        sec->size = st.len;
+        sec->erases = st.erases;
+        sec->programs = st.programs;
+
+        info->erases += st.erases;
+        info->programs += st.programs;
+
+        *next = g_new0(IobcPflashSectorStatsList, 1);
+        (*next)->value = sec;
+        next = &(*next)->next;
+    }
+
+    if (has_reset && reset) {
+        pflash_cfi02_reset_sector_stats(fl);
+    }
+
+    return info;
+}
+
+void hmp_info_iobc_pflash(Monitor *mon, const QDict *qdict)
+{
+    bool reset = qdict_get_try_bool(qdict, "reset", false);
+    Error *err = NULL;
+    IobcPflashStats *info;
+    IobcPflashSectorStatsList *sec;
+
+    info = qmp_query_iobc_pflash(true, reset, &err);
+    if (err) {
+        error_report_err(err);
+        return;
+    }
+
+    monitor_printf(mon, "sector     offset       size       erases     programs\n");
+
+    for (sec = info->sectors; sec; sec = sec->next) {
+        IobcPflashSectorStats *st = sec->value;
+
+        monitor_printf(mon, "%6" PRId64 " 0x%08" PRIx64 " 0x%08" PRIx64
+                       " %12" PRId64 " %12" PRId64 "\n",
+                       st->sector, st->offset, st->size, st->erases, st->programs);
+    }
+
+    monitor_printf(mon, "total: %" PRId64 " erases, %" PRId64 " programs\n",
+                   info->erases, info->programs);
+
+    qapi_free_IobcPflashStats(info);
+}
@@ -0,0 +1,44 @@
+/*
+ * ISIS iOBC CFI NOR program flash.
+ *
+ * Models the NOR program flash of the iOBC as CFI flash with AMD/Spansion
+ * command set (1 MiB, 16 bit bus, bottom boot block layout of the S29AL008J:
+ * 1x 16 KiB, 2x 8 KiB, 1x 32 KiB, 15x 64 KiB sectors). The flash is mirrored
+ * across the whole EBI chip select 0 window, as the upper address lines are
+ * not decoded.
+ *
+ * The flash operates in ROMD mode, i.e. reads in read array mode directly
+ * access the backing memory, only command sequences and status polling go
+ * through the CFI state machine. Erase and program operations optionally
+ * take their typical time (as given in the CFI table) in virtual time,
+ * otherwise they complete (almost) immediately. Per-sector erase and program
+ * counts can be queried via the QMP command query-iobc-pflash and the HMP
+ * command 'info iobc-pflash'.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#ifndef HW_ARM_ISIS_OBC_PFLASH_H
+#define HW_ARM_ISIS_OBC_PFLASH_H
+
+#include "qemu/osdep.h"
+#include "exec/memory.h"
+#include "sysemu/block-backend.h"
+
+#define IOBC_PFLASH_CFI_SIZE    0x100000
+
+
+/*
+ * Create the CFI NOR flash and return a container of the given window size
+ * mirroring it. If blk is non-null, the flash contents are read from and
+ * written through to the given block backend, which must have a size of
+ * exactly IOBC_PFLASH_CFI_SIZE. The first mirror, at the given base address,
+ * is registered as flash for loading via the gdbstub.
+ */
+MemoryRegion *iobc_pflash_cfi_init(BlockBackend *blk, bool timing, hwaddr base,
+                                   uint64_t window);
+
+#endif /* HW_ARM_ISIS_OBC_PFLASH_H */
@@ -0,0 +1,130 @@
+/*
+ * ISIS iOBC status register polling detection.
+ *
+ * See iobc-poll.h for details.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#include "iobc-poll.h"
+#include "qemu/error-report.h"
+#include "qemu/timer.h"
+#include "qapi/error.h"
+#include "qapi/qapi-commands-misc-target.h"
+#include "qapi/qmp/qdict.h"
+#include "monitor/monitor.h"
+#include "monitor/hmp.h"
+#include "sysemu/cpus.h"
+#include "hw/core/cpu.h"
+
+
+static QTAILQ_HEAD(, IobcPollReg) poll_regs = QTAILQ_HEAD_INITIALIZER(poll_regs);
+static bool poll_skip = false;
+
+
+void iobc_poll_register(IobcPollReg *reg, MemoryRegion *mr, hwaddr offset,
+                        const char *name)
+{
+    memset(reg, 0, sizeof(*reg));
+    reg->mr = mr;
+    reg->offset = offset;
+    reg->name = name;
+
+    QTAILQ_INSERT_TAIL(&poll_regs, reg, next);
+}
+
+void iobc_poll_read(IobcPollReg *reg, uint64_t value, int64_t deadline)
+{
+    uintptr_t pc = current_cpu ? current_cpu->mem_io_pc : 0;
+    int64_t skipped;
+
+    reg->reads++;
+
+    // only CPU accesses can poll
+    if (!pc || pc != reg->pc || value != reg->value) {
+        reg->pc = pc;
+        reg->value = value;
+        reg->repeat = 0;
+        return;
+    }
+
+    reg->polls++;
+
+    if (++reg->repeat < IOBC_POLL_THRESHOLD || !poll_skip
+            || deadline == IOBC_POLL_NO_DEADLINE) {
+        return;
+    }
+
+    reg->repeat = 0;
+
+    skipped = cpu_clock_skip_to(deadline);
+    if (skipped > 0) {
+        reg->skips++;
+        reg->skipped_ns += skipped;
+    }
+}
+
+void iobc_poll_set_skip(bool enable)
+{
+    poll_skip = enable;
+}
+
+IobcPollStatsList *qmp_query_iobc_polls(bool has_reset, bool reset, Error **errp)
+{
+    IobcPollStatsList *list = NULL, **next = &list;
+    IobcPollReg *reg;
+
+    QTAILQ_FOREACH(reg, &poll_regs, next) {
+        IobcPollStats *st = g_new0(IobcPollStats, 1);
+
+        st->source = g_strdup(memory_region_name(reg->mr));
+        st->name = g_strdup(reg->name);
+        st->address = reg->mr->addr + reg->offset;
+        st->reads = reg->reads;
+        st->polls = reg->polls;
+        st->skips = reg->skips;
+        st->skipped_ns = reg->skipped_ns;
+
+        *next = g_new0(IobcPollStatsList, 1);
+        (*next)->value = st;
+        next = &(*next)->next;
+
+        if (has_reset && reset) {
+            reg->reads = 0;
+            reg->polls = 0;
+            reg->skips = 0;
+            reg->skipped_ns = 0;
+        }
+    }
+
+    return list;
+}
+
+void hmp_info_iobc_polls(Monitor *mon, const QDict *qdict)
+{
+    bool reset = qdict_get_try_bool(qdict, "reset", false);
+    Error *err = NULL;
+    IobcPollStatsList *list, *item;
+
+    list = qmp_query_iobc_polls(true, reset, &err);
+    if (err) {
+        error_report_err(err);
+        return;
+    }
+
+    monitor_printf(mon, "source     register    address        reads        polls"
+                   "      skips   skipped [ms]\n");
+
+    for (item = list; item; item = item->next) {
+        IobcPollStats *st = item->value;
+
+        monitor_printf(mon, "%-10s %-8s 0x%08" PRIx64 " %12" PRId64 " %12" PRId64
+                       " %10" PRId64 " %14.3f\n", st->source, st->name, st->address,
+                       st->reads, st->polls, st->skips, st->skipped_ns / 1e6);
+    }
+
+    qapi_free_IobcPollStatsList(list);
+}
@@ -0,0 +1,86 @@
+/*
+ * ISIS iOBC status register polling detection.
+ *
+ * Drivers commonly busy-wait on peripheral status registers, e.g. on
+ * TWI_SR.TXCOMP, SPI_SR.TDRE, MCI_SR.NOTBUSY, or PMC_SR.LOCKA. Each loop
+ * iteration is a full MMIO dispatch into the device, and without any further
+ * events, the loop spins until the device changes its state in virtual time.
+ *
+ * Devices pass each read of such a status register to iobc_poll_read(),
+ * together with the deadline of their next state change (if known, e.g. the
+ * expiry of a transfer timer). A read is counted as poll if the register has
+ * last been read by the same instruction with the same result. After
+ * IOBC_POLL_THRESHOLD consecutive polls, and if enabled via
+ * iobc_poll_set_skip(), the virtual clock is advanced to the deadline (or to
+ * the next timer deadline, if that is earlier). The expired timers then run
+ * from the main loop, while the CPU leaves its execution loop, so that the
+ * polling loop sees the state change on one of its next iterations. This has
+ * no effect with -icount.
+ *
+ * The instruction is identified by the host return address of the access
+ * (i.e. the load in the translated code), which is cheap to get but only
+ * stable as long as the translation block is not re-translated.
+ *
+ * Read, poll, and skip counts of all registers are available via the QMP
+ * command query-iobc-polls and the HMP command info iobc-polls.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#ifndef HW_ARM_ISIS_OBC_POLL_H
+#define HW_ARM_ISIS_OBC_POLL_H
+
+#include "qemu/osdep.h"
+#include "qemu/queue.h"
+#include "exec/memory.h"
+
+
+#define IOBC_POLL_THRESHOLD     8
+#define IOBC_POLL_NO_DEADLINE   (-1)
+
+typedef struct IobcPollReg {
+    MemoryRegion *mr;
+    hwaddr offset;
+    const char *name;
+
+    // last read
+    uintptr_t pc;
+    uint64_t value;
+    unsigned repeat;
+
+    // statistics
+    uint64_t reads;
+    uint64_t polls;
+    uint64_t skips;
+    int64_t skipped_ns;
+
+    QTAILQ_ENTRY(IobcPollReg) next;
+} IobcPollReg;
+
+
+/*
+ * Register a status register at the given offset of the given device memory
+ * region for polling detection and statistics. Must be called once the
+ * device is realized.
+ */
+void iobc_poll_register(IobcPollReg *reg, MemoryRegion *mr, hwaddr offset,
+                        const char *name);
+
+/*
+ * Record a read of the given register returning the given value. The
+ * deadline is the time of the next state change of the device in
+ * QEMU_CLOCK_VIRTUAL nanoseconds, or IOBC_POLL_NO_DEADLINE if unknown (e.g.
+ * when waiting for IOX input). Must be called from the MMIO read callback.
+ */
+void iobc_poll_read(IobcPollReg *reg, uint64_t value, int64_t deadline);
+
+/*
+ * Enable or disable advancing the virtual clock on detected polling loops
+ * (disabled by default). Polls are counted in both cases.
+ */
+void iobc_poll_set_skip(bool enable);
+
+#endif /* HW_ARM_ISIS_OBC_POLL_H */
@@ -16,29 +16,37 @@
 #include "hw/sysbus.h"
 
 #include "iobc-reserved_memory.h"
+#include "iobc-fault.h"
 
 
-static uint64_t reserved_memory_read(void *opaque, hwaddr offset, unsigned size)
+static MemTxResult reserved_memory_read(void *opaque, hwaddr offset, uint64_t *data,
+                                        unsigned size, MemTxAttrs attrs)
 {
     ReservedMemoryDeviceState *s = IOBC_RESERVED_MEMORY(opaque);
     MemoryRegion *mem = &s->iomem;
 
-    error_report("invalid memory access to '%s' [0x%08lx + 0x%08lx, r]", mem->name, mem->addr, offset);
-    abort();
+    iobc_fault(mem, offset, false, "invalid memory access to '%s' [0x%08lx + 0x%08lx, r]",
+               mem->name, mem->addr, offset);
+
+    *data = 0;
+    return iobc_fault_result();
 }
 
-static void reserved_memory_write(void *opaque, hwaddr offset, uint64_t value, unsigned size)
+static MemTxResult reserved_memory_write(void *opaque, hwaddr offset, uint64_t value,
+                                         unsigned size, MemTxAttrs attrs)
 {
     ReservedMemoryDeviceState *s = IOBC_RESERVED_MEMORY(opaque);
     MemoryRegion *mem = &s->iomem;
 
-    error_report("invalid memory access to '%s' [0x%08lx + 0x%08lx, r]", mem->name, mem->addr, offset);
-    abort();
+    iobc_fault(mem, offset, true, "invalid memory access to '%s' [0x%08lx + 0x%08lx, w]",
+               mem->name, mem->addr, offset);
+
+    return iobc_fault_result();
 }
 
 static const MemoryRegionOps reserved_memory_ops = {
-    .read = reserved_memory_read,
-    .write = reserved_memory_write,
+    .read_with_attrs = reserved_memory_read,
+    .write_with_attrs = reserved_memory_write,
     .impl.min_access_size = 1,
     .impl.max_access_size = 8,
     .valid.min_access_size = 1,
@@ -2,8 +2,9 @@
  * Basic reserved memory region.
  *
  * Implements a basic reserved memory region. Access to this region is
- * considered invalid and will output the location of the incident to the log
- * as well as abort the emulator.
+ * considered invalid and will output the location of the incident to the log.
+ * The access is then handled according to the fault policy of the region
+ * (see iobc-fault.h), i.e. by default the emulator is aborted.
  *
  * Copyright (c) 2019-2020 KSat e.V. Stuttgart
  *
@@ -36,7 +37,7 @@ typedef struct {
  *
  * Create a reserved memory region with the given name, base-address and size.
  * Access to this region will output the location of the incident to the log
- * and abort the emulator.
+ * and is handled according to the fault policy (see iobc-fault.h).
  */
 inline static void create_reserved_memory_region(const char* name, hwaddr base, hwaddr size)
 {
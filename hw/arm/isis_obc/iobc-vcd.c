@@ -0,0 +1,188 @@
+/*
+ * Value change dump (VCD) writer.
+ *
+ * See iobc-vcd.h for details.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#include "iobc-vcd.h"
+#include "qemu/error-report.h"
+#include "qemu/timer.h"
+#include "qapi/error.h"
+#include "sysemu/sysemu.h"
+
+
+static void vcd_make_id(char *buf, unsigned index)
+{
+    // identifiers consist of printable ASCII characters ('!' to '~')
+    do {
+        *buf++ = '!' + (index % 94);
+        index /= 94;
+    } while (index);
+
+    *buf = '\0';
+}
+
+static void vcd_write_value(IobcVcd *vcd, IobcVcdSignal *sig)
+{
+    int bit;
+
+    if (sig->width == 1) {
+        fprintf(vcd->file, "%c%s\n", sig->value ? '1' : '0', sig->id);
+        return;
+    }
+
+    fputc('b', vcd->file);
+    for (bit = sig->width - 1; bit >= 0; bit--) {
+        fputc((sig->value >> bit) & 1 ? '1' : '0', vcd->file);
+    }
+    fprintf(vcd->file, " %s\n", sig->id);
+}
+
+static void vcd_write_header(IobcVcd *vcd)
+{
+    const char *scope = NULL;
+    IobcVcdSignal *sig;
+    unsigned i;
+
+    fprintf(vcd->file, "$version QEMU isis-obc $end\n");
+    fprintf(vcd->file, "$timescale 1ns $end\n");
+
+    for (i = 0; i < vcd->signals->len; i++) {
+        sig = &g_array_index(vcd->signals, IobcVcdSignal, i);
+
+        if (!scope || strcmp(scope, sig->scope)) {
+            if (scope) {
+                fprintf(vcd->file, "$upscope $end\n");
+            }
+
+            scope = sig->scope;
+            fprintf(vcd->file, "$scope module %s $end\n", scope);
+        }
+
+        fprintf(vcd->file, "$var wire %u %s %s $end\n", sig->width, sig->id, sig->name);
+    }
+
+    if (scope) {
+        fprintf(vcd->file, "$upscope $end\n");
+    }
+
+    fprintf(vcd->file, "$enddefinitions $end\n");
+
+    vcd->time_last = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    fprintf(vcd->file, "#%" PRId64 "\n$dumpvars\n", vcd->time_last);
+    for (i = 0; i < vcd->signals->len; i++) {
+        vcd_write_value(vcd, &g_array_index(vcd->signals, IobcVcdSignal, i));
+    }
+    fprintf(vcd->file, "$end\n");
+
+    vcd->header_done = true;
+}
+
+static void vcd_exit_notify(Notifier *notifier, void *data)
+{
+    IobcVcd *vcd = container_of(notifier, IobcVcd, exit);
+
+    if (vcd->file) {
+        if (!vcd->header_done) {
+            vcd_write_header(vcd);
+        }
+
+        fclose(vcd->file);
+        vcd->file = NULL;
+    }
+}
+
+
+IobcVcd *iobc_vcd_open(const char *path, Error **errp)
+{
+    IobcVcd *vcd;
+    FILE *file;
+
+    file = fopen(path, "w");
+    if (!file) {
+        error_setg_errno(errp, errno, "cannot open VCD file '%s'", path);
+        return NULL;
+    }
+
+    vcd = g_new0(IobcVcd, 1);
+    vcd->file = file;
+    vcd->signals = g_array_new(false, true, sizeof(IobcVcdSignal));
+    vcd->header_done = false;
+
+    vcd->exit.notify = vcd_exit_notify;
+    qemu_add_exit_notifier(&vcd->exit);
+
+    return vcd;
+}
+
+void iobc_vcd_close(IobcVcd *vcd)
+{
+    IobcVcdSignal *sig;
+    unsigned i;
+
+    vcd_exit_notify(&vcd->exit, NULL);
+    qemu_remove_exit_notifier(&vcd->exit);
+
+    for (i = 0; i < vcd->signals->len; i++) {
+        sig = &g_array_index(vcd->signals, IobcVcdSignal, i);
+        g_free(sig->scope);
+        g_free(sig->name);
+    }
+
+    g_array_free(vcd->signals, true);
+    g_free(vcd);
+}
+
+int iobc_vcd_add_signal(IobcVcd *vcd, const char *scope, const char *name,
+                        unsigned width, uint64_t initial)
+{
+    IobcVcdSignal sig;
+
+    if (vcd->header_done) {
+        warn_report("iobc.vcd: cannot add signal '%s.%s' after recording started",
+                    scope, name);
+        return -1;
+    }
+
+    sig.scope = g_strdup(scope);
+    sig.name = g_strdup(name);
+    sig.width = MAX(1, MIN(width, 64));
+    sig.value = sig.width < 64 ? initial & ((1ull << sig.width) - 1) : initial;
+    vcd_make_id(sig.id, vcd->signals->len);
+
+    g_array_append_val(vcd->signals, sig);
+    return vcd->signals->len - 1;
+}
+
+void iobc_vcd_change(IobcVcd *vcd, int signal, uint64_t value)
+{
+    IobcVcdSignal *sig;
+    int64_t now;
+
+    if (!vcd->file || signal < 0 || signal >= vcd->signals->len)
+        return;
+
+    if (!vcd->header_done)
+        vcd_write_header(vcd);
+
+    sig = &g_array_index(vcd->signals, IobcVcdSignal, signal);
+    if (sig->width < 64)
+        value &= (1ull << sig->width) - 1;
+
+    if (sig->value == value)
+        return;
+
+    now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    if (now != vcd->time_last) {
+        fprintf(vcd->file, "#%" PRId64 "\n", now);
+        vcd->time_last = now;
+    }
+
+    sig->value = value;
+    vcd_write_value(vcd, sig);
+}
@@ -0,0 +1,62 @@
+/*
+ * Value change dump (VCD) writer.
+ *
+ * Records signal changes (e.g. GPIO pin states) with their virtual time
+ * stamp to a VCD file, which can be inspected with common waveform viewers
+ * (e.g. GTKWave) or analyzed offline. The time scale is one nanosecond of
+ * QEMU_CLOCK_VIRTUAL.
+ *
+ * Signals are grouped by scope (usually the device name) and must be added
+ * before the first value change is recorded, as the VCD header containing
+ * all signal definitions is written at that point. Output is buffered and
+ * flushed when the writer is closed, which happens automatically on exit of
+ * the emulator.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#ifndef HW_ARM_ISIS_OBC_VCD_H
+#define HW_ARM_ISIS_OBC_VCD_H
+
+#include "qemu/osdep.h"
+#include "qemu/notify.h"
+
+
+typedef struct {
+    char *scope;
+    char *name;
+    char id[8];
+    unsigned width;
+    uint64_t value;
+} IobcVcdSignal;
+
+typedef struct {
+    FILE *file;
+    GArray *signals;
+    bool header_done;
+    int64_t time_last;
+    Notifier exit;
+} IobcVcd;
+
+
+IobcVcd *iobc_vcd_open(const char *path, Error **errp);
+void iobc_vcd_close(IobcVcd *vcd);
+
+/*
+ * Add a signal with the given scope, name, width (in bits) and initial
+ * value. Returns the signal handle to be used for recording changes, or -1
+ * if the signal cannot be added anymore.
+ */
+int iobc_vcd_add_signal(IobcVcd *vcd, const char *scope, const char *name,
+                        unsigned width, uint64_t initial);
+
+/*
+ * Record the new value of the given signal at the current virtual time.
+ * Values equal to the previously recorded value are ignored.
+ */
+void iobc_vcd_change(IobcVcd *vcd, int signal, uint64_t value);
+
+#endif /* HW_ARM_ISIS_OBC_VCD_H */
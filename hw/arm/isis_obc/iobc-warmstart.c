@@ -0,0 +1,267 @@
+/*
+ * ISIS iOBC warm-start snapshot cache.
+ *
+ * See iobc-warmstart.h for details.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#include "iobc-warmstart.h"
+#include "qemu/error-report.h"
+#include "qemu/main-loop.h"
+#include "qapi/error.h"
+#include "qapi/qapi-commands-misc-target.h"
+#include "qapi/qapi-events-misc-target.h"
+#include "sysemu/sysemu.h"
+#include "sysemu/runstate.h"
+#include "migration/snapshot.h"
+#include "hw/core/cpu.h"
+
+
+// there is only one machine, thus at most one active snapshot cache
+static IobcWarmStart *warm_start_active = NULL;
+
+
+static void warm_start_hash_field(IobcWarmStart *ws, const char *name)
+{
+    g_checksum_update(ws->hash, (const guchar *)name, strlen(name) + 1);
+}
+
+static int warm_start_save(IobcWarmStart *ws, Error **errp)
+{
+    char *tmp = g_strdup_printf("%s.%d.tmp", ws->path, getpid());
+    int ret;
+
+    if (ws->has_ready_pc) {
+        cpu_breakpoint_remove(CPU(ws->cpu), ws->ready_pc, BP_MACHINE);
+    }
+    ws->ready = true;
+
+    ret = save_snapshot_file(tmp, errp);
+    if (ret >= 0 && rename(tmp, ws->path)) {
+        ret = -errno;
+        error_setg_errno(errp, -ret, "cannot rename '%s' to '%s'", tmp, ws->path);
+    }
+
+    if (ret < 0) {
+        unlink(tmp);
+    } else {
+        info_report("iobc.warm-start: created snapshot %s", ws->path);
+        qapi_event_send_iobc_warm_start_ready(ws->key, false);
+    }
+
+    g_free(tmp);
+    return ret;
+}
+
+static void warm_start_save_bh(void *opaque)
+{
+    IobcWarmStart *ws = opaque;
+    Error *err = NULL;
+
+    if (warm_start_save(ws, &err) < 0) {
+        error_report_err(err);
+    }
+
+    // continue if nothing else stopped the VM in the meantime
+    if (runstate_check(RUN_STATE_DEBUG)) {
+        vm_start();
+    }
+}
+
+static void warm_start_vm_state_change(void *opaque, int running, RunState state)
+{
+    IobcWarmStart *ws = opaque;
+
+    if (running || state != RUN_STATE_DEBUG || ws->ready) {
+        return;
+    }
+
+    // stopped by a breakpoint, check if it is ours
+    if (ws->cpu->env.regs[15] != ws->ready_pc) {
+        return;
+    }
+
+    // cannot save from within the state change notification
+    aio_bh_schedule_oneshot(qemu_get_aio_context(), warm_start_save_bh, ws);
+}
+
+static void warm_start_resume_bh(void *opaque)
+{
+    IobcWarmStart *ws = opaque;
+    Error *err = NULL;
+
+    if (load_snapshot_file(ws->path, &err) < 0) {
+        error_report_err(err);
+        error_report("iobc.warm-start: cannot resume from '%s', remove it to recreate it",
+                     ws->path);
+        exit(1);
+    }
+
+    info_report("iobc.warm-start: resumed from snapshot %s", ws->path);
+
+    ws->ready = true;
+    qapi_event_send_iobc_warm_start_ready(ws->key, true);
+
+    if (ws->autostart) {
+        vm_start();
+    }
+}
+
+static void warm_start_machine_done(Notifier *notifier, void *data)
+{
+    IobcWarmStart *ws = container_of(notifier, IobcWarmStart, machine_done);
+
+    /*
+     * The machine gets reset after this, so the snapshot can only be loaded
+     * from the main loop. Prevent the VM from starting until then.
+     */
+    ws->autostart = autostart;
+    autostart = 0;
+
+    aio_bh_schedule_oneshot(qemu_get_aio_context(), warm_start_resume_bh, ws);
+}
+
+
+IobcWarmStart *iobc_warm_start_new(const char *cache_dir)
+{
+    IobcWarmStart *ws = g_new0(IobcWarmStart, 1);
+
+    ws->dir = g_strdup(cache_dir);
+    ws->hash = g_checksum_new(G_CHECKSUM_SHA256);
+
+    iobc_warm_start_add_value(ws, "qemu", QEMU_VERSION);
+    return ws;
+}
+
+void iobc_warm_start_add_value(IobcWarmStart *ws, const char *name, const char *value)
+{
+    warm_start_hash_field(ws, name);
+    warm_start_hash_field(ws, value ? value : "");
+}
+
+void iobc_warm_start_add_file(IobcWarmStart *ws, const char *name, const char *path,
+                              bool contents)
+{
+    guchar buf[64 * 1024];
+    struct stat st;
+    char *ident;
+    size_t n;
+    FILE *f;
+
+    if (stat(path, &st)) {
+        error_report("iobc.warm-start: cannot access '%s': %s", path, strerror(errno));
+        exit(1);
+    }
+
+    if (!contents) {
+        ident = g_strdup_printf("%s:%" PRIu64 ":%" PRId64, path, (uint64_t)st.st_size,
+                                (int64_t)st.st_mtime);
+        iobc_warm_start_add_value(ws, name, ident);
+        g_free(ident);
+        return;
+    }
+
+    f = fopen(path, "rb");
+    if (!f) {
+        error_report("iobc.warm-start: cannot open '%s': %s", path, strerror(errno));
+        exit(1);
+    }
+
+    warm_start_hash_field(ws, name);
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        g_checksum_update(ws->hash, buf, n);
+    }
+
+    if (ferror(f)) {
+        error_report("iobc.warm-start: cannot read '%s'", path);
+        exit(1);
+    }
+
+    fclose(f);
+}
+
+void iobc_warm_start_activate(IobcWarmStart *ws, ARMCPU *cpu, bool has_ready_pc,
+                              hwaddr ready_pc)
+{
+    ws->key = g_strdup(g_checksum_get_string(ws->hash));
+    ws->path = g_strdup_printf("%s/%s.vmstate", ws->dir, ws->key);
+    ws->cpu = cpu;
+    ws->has_ready_pc = has_ready_pc;
+    ws->ready_pc = ready_pc;
+
+    warm_start_active = ws;
+
+    if (!access(ws->path, R_OK)) {
+        ws->resumed = true;
+        ws->machine_done.notify = warm_start_machine_done;
+        qemu_add_machine_init_done_notifier(&ws->machine_done);
+        return;
+    }
+
+    if (g_mkdir_with_parents(ws->dir, 0755)) {
+        error_report("iobc.warm-start: cannot create cache directory '%s': %s",
+                     ws->dir, strerror(errno));
+        exit(1);
+    }
+
+    info_report("iobc.warm-start: no snapshot for %s, creating it when ready", ws->key);
+
+    if (has_ready_pc) {
+        cpu_breakpoint_insert(CPU(cpu), ready_pc, BP_MACHINE, NULL);
+        ws->vm_change = qemu_add_vm_change_state_handler(warm_start_vm_state_change, ws);
+    }
+}
+
+
+static IobcWarmStart *warm_start_find(Error **errp)
+{
+    if (!warm_start_active) {
+        error_setg(errp, "Warm-start snapshot cache not enabled "
+                   "(requires -M isis-obc,snapshot-cache=<dir>)");
+    }
+
+    return warm_start_active;
+}
+
+IobcWarmStartInfo *qmp_query_iobc_warm_start(Error **errp)
+{
+    IobcWarmStart *ws = warm_start_find(errp);
+    IobcWarmStartInfo *info;
+
+    if (!ws) {
+        return NULL;
+    }
+
+    info = g_new0(IobcWarmStartInfo, 1);
+    info->key = g_strdup(ws->key);
+    info->path = g_strdup(ws->path);
+    info->resumed = ws->resumed;
+    info->ready = ws->ready;
+
+    return info;
+}
+
+void qmp_iobc_warm_start_ready(Error **errp)
+{
+    IobcWarmStart *ws = warm_start_find(errp);
+
+    if (!ws) {
+        return;
+    }
+
+    if (ws->resumed) {
+        error_setg(errp, "Machine has been resumed from a warm-start snapshot");
+        return;
+    }
+
+    if (ws->ready) {
+        error_setg(errp, "Warm-start snapshot has already been created");
+        return;
+    }
+
+    warm_start_save(ws, errp);
+}
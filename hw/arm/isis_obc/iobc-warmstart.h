@@ -0,0 +1,78 @@
+/*
+ * ISIS iOBC warm-start snapshot cache.
+ *
+ * Caches the complete machine state after the firmware has booted, keyed by
+ * a hash of the firmware images and the machine configuration. On a cache
+ * hit, the machine is resumed from the cached snapshot directly after
+ * startup instead of booting. On a cache miss, the machine boots normally
+ * and the snapshot is created as soon as the firmware declares itself ready,
+ * i.e. when it reaches a given program counter or when the QMP command
+ * iobc-warm-start-ready is issued. In both cases, the QMP event
+ * IOBC_WARM_START_READY is emitted once the ready state has been reached.
+ *
+ * Image files given to the machine (e.g. norflash=, elf=) are hashed by
+ * content. Drives (NOR flash and SD cards) are hashed by path, size, and
+ * modification time only, as they may be large. As drive contents are not
+ * part of the snapshot, drives should not be modified by the boot process
+ * (use -snapshot if required).
+ *
+ * Snapshots are written to a temporary file and then renamed, so multiple
+ * instances can safely share one cache directory.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#ifndef HW_ARM_ISIS_OBC_WARMSTART_H
+#define HW_ARM_ISIS_OBC_WARMSTART_H
+
+#include "qemu/osdep.h"
+#include "qemu/notify.h"
+#include "sysemu/runstate.h"
+#include "cpu.h"
+
+
+typedef struct {
+    char *dir;
+    GChecksum *hash;
+
+    char *key;
+    char *path;
+
+    ARMCPU *cpu;
+    bool has_ready_pc;
+    hwaddr ready_pc;
+
+    bool resumed;
+    bool ready;
+    int autostart;
+
+    Notifier machine_done;
+    VMChangeStateEntry *vm_change;
+} IobcWarmStart;
+
+
+IobcWarmStart *iobc_warm_start_new(const char *cache_dir);
+
+/*
+ * Add a named configuration value to the hash.
+ */
+void iobc_warm_start_add_value(IobcWarmStart *ws, const char *name, const char *value);
+
+/*
+ * Add a named file to the hash. If contents is true, the file contents are
+ * hashed, otherwise only its path, size, and modification time.
+ */
+void iobc_warm_start_add_file(IobcWarmStart *ws, const char *name, const char *path,
+                              bool contents);
+
+/*
+ * Finalize the hash and look up the snapshot. Must be called during machine
+ * initialization, after all inputs have been added.
+ */
+void iobc_warm_start_activate(IobcWarmStart *ws, ARMCPU *cpu, bool has_ready_pc,
+                              hwaddr ready_pc);
+
+#endif /* HW_ARM_ISIS_OBC_WARMSTART_H */
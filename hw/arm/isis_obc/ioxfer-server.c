@@ -12,6 +12,7 @@
 #include "ioxfer-server.h"
 #include "qemu/error-report.h"
 #include "qapi/error.h"
+#include "migration/qemu-file-types.h"
 
 
 static void server_accept(QIONetListener *listener, QIOChannelSocket *sioc, gpointer data);
@@ -91,8 +92,26 @@ void iox_server_close(IoXferServer *srv)
 }
 
 
+void iox_server_set_tap(IoXferServer *srv, iox_frame_tap *tap, void *opaque)
+{
+    srv->tap = tap;
+    srv->tap_opaque = opaque;
+}
+
+void iox_server_inject(IoXferServer *srv, struct iox_data_frame *frame)
+{
+    if (srv->handler)
+        srv->handler(frame, srv->handler_opaque);
+}
+
+
 int iox_send_frame(IoXferServer *srv, struct iox_data_frame *frame)
 {
+    if (srv && srv->tap) {
+        srv->tap(frame, srv->tap_opaque);
+        return 0;
+    }
+
     if (!srv || !srv->client)
         return 0;
 
@@ -227,3 +246,72 @@ static gboolean client_hup(QIOChannel *ioc, GIOCondition cond, gpointer data)
     iox_client_disconnect(srv);
     return G_SOURCE_REMOVE;
 }
+
+
+static int iox_server_seq_get(QEMUFile *f, void *pv, size_t size,
+                              const VMStateField *field)
+{
+    IoXferServer *srv = *(IoXferServer **)pv;
+    uint8_t seq = qemu_get_byte(f);
+
+    if (srv)
+        srv->seq = seq;
+
+    return 0;
+}
+
+static int iox_server_seq_put(QEMUFile *f, void *pv, size_t size,
+                              const VMStateField *field, QJSON *vmdesc)
+{
+    IoXferServer *srv = *(IoXferServer **)pv;
+
+    qemu_put_byte(f, srv ? srv->seq : 0);
+    return 0;
+}
+
+const VMStateInfo vmstate_info_iox_server_seq = {
+    .name = "iox-server-seq",
+    .get  = iox_server_seq_get,
+    .put  = iox_server_seq_put,
+};
+
+static int iox_buffer_get(QEMUFile *f, void *pv, size_t size,
+                          const VMStateField *field)
+{
+    Buffer *buf = pv;
+    uint32_t len = qemu_get_be32(f);
+
+    if (len > IOX_BUFFER_MAX_SAVED) {
+        error_report("iox: invalid buffer size in snapshot: %" PRIu32, len);
+        return -EINVAL;
+    }
+
+    buffer_reset(buf);
+    buffer_reserve(buf, len);
+    qemu_get_buffer(f, buffer_end(buf), len);
+    buf->offset += len;
+
+    return qemu_file_get_error(f);
+}
+
+static int iox_buffer_put(QEMUFile *f, void *pv, size_t size,
+                          const VMStateField *field, QJSON *vmdesc)
+{
+    Buffer *buf = pv;
+
+    if (buf->offset > IOX_BUFFER_MAX_SAVED) {
+        error_report("iox: pending data of %s too large to save: %zu bytes",
+                     buf->name, buf->offset);
+        return -EINVAL;
+    }
+
+    qemu_put_be32(f, buf->offset);
+    qemu_put_buffer(f, buf->buffer, buf->offset);
+    return 0;
+}
+
+const VMStateInfo vmstate_info_iox_buffer = {
+    .name = "iox-buffer",
+    .get  = iox_buffer_get,
+    .put  = iox_buffer_put,
+};
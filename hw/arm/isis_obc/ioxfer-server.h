@@ -44,6 +44,7 @@
 #include "qemu/buffer.h"
 #include "io/channel-socket.h"
 #include "io/net-listener.h"
+#include "migration/vmstate.h"
 
 #define IOX_SEQ_DIRECTION_SET_IN(x)     ((x) & ~BIT(7))
 #define IOX_SEQ_DIRECTION_SET_OUT(x)    ((x) | BIT(7))
@@ -64,6 +65,7 @@ struct iox_data_frame {
 };
 
 typedef void(iox_frame_handler)(struct iox_data_frame *cmd, void* opaque);
+typedef void(iox_frame_tap)(struct iox_data_frame *frame, void *opaque);
 
 
 typedef struct {
@@ -73,6 +75,9 @@ typedef struct {
     iox_frame_handler *handler;
     void *handler_opaque;
 
+    iox_frame_tap *tap;
+    void *tap_opaque;
+
     uint8_t buffer[sizeof(struct iox_data_frame) + 256];
     unsigned buffer_used;
 
@@ -87,6 +92,24 @@ void iox_server_set_handler(IoXferServer *srv, iox_frame_handler *handler, void*
 int iox_server_open(IoXferServer *srv, SocketAddress *addr, Error **errp);
 void iox_server_close(IoXferServer *srv);
 
+/*
+ * Replace the socket client by an in-process one (e.g. a fuzzer): Frames
+ * sent by the device are passed to the tap instead of the socket client,
+ * frames injected via iox_server_inject() are handled as if received from
+ * a client. Pass NULL to detach the tap.
+ */
+void iox_server_set_tap(IoXferServer *srv, iox_frame_tap *tap, void *opaque);
+void iox_server_inject(IoXferServer *srv, struct iox_data_frame *frame);
+
+/*
+ * Check if a client (socket or tap) is connected, i.e. if the device may
+ * wait for a response.
+ */
+static inline bool iox_server_connected(IoXferServer *srv)
+{
+    return srv && (srv->client || srv->tap);
+}
+
 static inline uint8_t iox_next_seqid(IoXferServer *srv)
 {
     if (!srv)
@@ -136,4 +159,37 @@ static inline int iox_send_u32_resp(IoXferServer *srv, struct iox_data_frame *fr
     return iox_send_u32(srv, frame->seq, frame->cat, frame->id, value);
 }
 
+
+/*
+ * Migration support.
+ *
+ * VMSTATE_IOX_SERVER_SEQ saves/restores the sequence counter of the server
+ * referenced by the given IoXferServer pointer field (zero if no server has
+ * been set up). Connection state is not part of the snapshot.
+ *
+ * VMSTATE_IOX_BUFFER saves/restores the pending data of a Buffer used for
+ * buffering data from/to the IOX client. At most IOX_BUFFER_MAX_SAVED bytes
+ * can be saved, larger sizes in a snapshot are rejected as invalid.
+ */
+#define IOX_BUFFER_MAX_SAVED    (1 << 20)
+
+extern const VMStateInfo vmstate_info_iox_server_seq;
+extern const VMStateInfo vmstate_info_iox_buffer;
+
+#define VMSTATE_IOX_SERVER_SEQ(_field, _state) {                            \
+    .name       = (stringify(_field)),                                      \
+    .size       = sizeof(IoXferServer *),                                   \
+    .info       = &vmstate_info_iox_server_seq,                             \
+    .flags      = VMS_SINGLE,                                               \
+    .offset     = vmstate_offset_value(_state, _field, IoXferServer *),     \
+}
+
+#define VMSTATE_IOX_BUFFER(_field, _state) {                                \
+    .name       = (stringify(_field)),                                      \
+    .size       = sizeof(Buffer),                                           \
+    .info       = &vmstate_info_iox_buffer,                                 \
+    .flags      = VMS_SINGLE,                                               \
+    .offset     = vmstate_offset_value(_state, _field, Buffer),             \
+}
+
 #endif /* HW_ARM_ISIS_OBC_IOXFER_SERVER_H */
@@ -84,6 +84,8 @@ struct PFlashCFI02 {
     uint8_t mappings;
     uint8_t width;
     uint8_t be;
+    bool erase_timing;
+    bool program_timing;
     int wcycle; /* if 0, the flash is read normally */
     int bypass;
     int ro;
@@ -110,6 +112,8 @@ struct PFlashCFI02 {
     int sectors_to_erase;
     uint64_t erase_time_remaining;
     unsigned long *sector_erase_map;
+    uint64_t *sector_erases;    /* array; one per sector */
+    uint64_t *sector_programs;  /* array; one per sector */
     char *name;
     void *storage;
 };
@@ -198,6 +202,9 @@ static size_t pflash_regions_count(PFlashCFI02 *pfl)
  */
 static uint64_t pflash_erase_time(PFlashCFI02 *pfl)
 {
+    if (!pfl->erase_timing) {
+        return 0;
+    }
     /*
      * If there are no sectors to erase (which can happen if all of the sectors
      * to be erased are protected), then erase takes 100 us. Protected sectors
@@ -417,6 +424,7 @@ static void pflash_sector_erase(PFlashCFI02 *pfl, hwaddr offset)
         pflash_update(pfl, offset, sector_len);
     }
     set_dq7(pfl, 0x00);
+    ++pfl->sector_erases[sector_info.num];
     ++pfl->sectors_to_erase;
     set_bit(sector_info.num, pfl->sector_erase_map);
     /* Set (or reset) the 50 us timer for additional erase commands.  */
@@ -553,11 +561,22 @@ static void pflash_write(void *opaque, hwaddr offset, uint64_t value,
                 }
                 pflash_update(pfl, offset, width);
             }
+            ++pfl->sector_programs[pflash_sector_info(pfl, offset).num];
             /*
              * While programming, status bit DQ7 should hold the opposite
              * value from how it was programmed.
              */
             set_dq7(pfl, ~value);
+            if (pfl->program_timing) {
+                /*
+                 * Stay busy for the typical word program time (CFI address
+                 * 0x1F); the timer then returns to read array mode.
+                 */
+                timer_mod(&pfl->timer, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) +
+                          (1ULL << pfl->cfi_table[0x1F]) * SCALE_US);
+                pfl->wcycle = 4;
+                return;
+            }
             /* Let's pretend write is immediate */
             if (pfl->bypass)
                 goto do_bypass;
@@ -587,7 +606,7 @@ static void pflash_write(void *opaque, hwaddr offset, uint64_t value,
         switch (pfl->cmd) {
         case 0xA0: /* Program */
             /* Ignore writes while flash data write is occurring */
-            /* As we suppose write is immediate, this should never happen */
+            /* This only happens with program timing enabled */
             return;
         case 0x80: /* Erase */
             goto check_unlock1;
@@ -616,10 +635,14 @@ static void pflash_write(void *opaque, hwaddr offset, uint64_t value,
                 memset(pfl->storage, 0xff, pfl->chip_len);
                 pflash_update(pfl, 0, pfl->chip_len);
             }
+            for (int i = 0; i < pfl->total_sectors; ++i) {
+                ++pfl->sector_erases[i];
+            }
             set_dq7(pfl, 0x00);
             /* Wait the time specified at CFI address 0x22. */
             timer_mod(&pfl->timer, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) +
-                      (1ULL << pfl->cfi_table[0x22]) * SCALE_MS);
+                      (pfl->erase_timing ?
+                       (1ULL << pfl->cfi_table[0x22]) * SCALE_MS : 0));
             break;
         case 0x30: /* Sector erase */
             pflash_sector_erase(pfl, offset);
@@ -821,6 +844,10 @@ static void pflash_cfi02_realize(DeviceState *dev, Error **errp)
     /* Allocate memory for a bitmap for sectors being erased. */
     pfl->sector_erase_map = bitmap_new(pfl->total_sectors);
 
+    /* Per-sector wear statistics. */
+    pfl->sector_erases = g_new0(uint64_t, pfl->total_sectors);
+    pfl->sector_programs = g_new0(uint64_t, pfl->total_sectors);
+
     pflash_setup_mappings(pfl);
     pfl->rom_mode = 1;
     sysbus_init_mmio(SYS_BUS_DEVICE(dev), &pfl->mem);
@@ -946,6 +973,8 @@ static Property pflash_cfi02_properties[] = {
     DEFINE_PROP_UINT16("unlock-addr0", PFlashCFI02, unlock_addr0, 0),
     DEFINE_PROP_UINT16("unlock-addr1", PFlashCFI02, unlock_addr1, 0),
     DEFINE_PROP_STRING("name", PFlashCFI02, name),
+    DEFINE_PROP_BOOL("erase-timing", PFlashCFI02, erase_timing, true),
+    DEFINE_PROP_BOOL("program-timing", PFlashCFI02, program_timing, false),
     DEFINE_PROP_END_OF_LIST(),
 };
 
@@ -954,6 +983,8 @@ static void pflash_cfi02_unrealize(DeviceState *dev, Error **errp)
     PFlashCFI02 *pfl = PFLASH_CFI02(dev);
     timer_del(&pfl->timer);
     g_free(pfl->sector_erase_map);
+    g_free(pfl->sector_erases);
+    g_free(pfl->sector_programs);
 }
 
 static void pflash_cfi02_class_init(ObjectClass *klass, void *data)
@@ -1015,3 +1046,88 @@ PFlashCFI02 *pflash_cfi02_register(hwaddr base,
     sysbus_mmio_map(SYS_BUS_DEVICE(dev), 0, base);
     return PFLASH_CFI02(dev);
 }
+
+uint32_t pflash_cfi02_get_num_sectors(PFlashCFI02 *fl)
+{
+    return fl->total_sectors;
+}
+
+void pflash_cfi02_get_sector_stats(PFlashCFI02 *fl, uint32_t sector,
+                                   PFlashCFI02SectorStats *stats)
+{
+    hwaddr addr = 0;
+    uint32_t first = 0;
+
+    assert(sector < fl->total_sectors);
+    for (int i = 0; i < pflash_regions_count(fl); ++i) {
+        if (sector < first + fl->nb_blocs[i]) {
+            stats->offset = addr + (hwaddr)(sector - first) * fl->sector_len[i];
+            stats->len = fl->sector_len[i];
+            stats->erases = fl->sector_erases[sector];
+            stats->programs = fl->sector_programs[sector];
+            return;
+        }
+        first += fl->nb_blocs[i];
+        addr += (uint64_t)fl->nb_blocs[i] * fl->sector_len[i];
+    }
+    abort();
+}
+
+void pflash_cfi02_reset_sector_stats(PFlashCFI02 *fl)
+{
+    memset(fl->sector_erases, 0, fl->total_sectors * sizeof(uint64_t));
+    memset(fl->sector_programs, 0, fl->total_sectors * sizeof(uint64_t));
+}
+
+bool pflash_cfi02_direct_erase(PFlashCFI02 *fl, hwaddr offset, uint64_t len)
+{
+    hwaddr end = offset + len;
+
+    if (fl->ro || end > fl->chip_len || end < offset) {
+        return false;
+    }
+
+    while (offset < end) {
+        SectorInfo sector_info = pflash_sector_info(fl, offset);
+        hwaddr start = offset & ~((hwaddr)sector_info.len - 1);
+
+        memset((uint8_t *)fl->storage + start, 0xff, sector_info.len);
+        pflash_update(fl, start, sector_info.len);
+        memory_region_flush_rom_device(&fl->orig_mem, start, sector_info.len);
+        ++fl->sector_erases[sector_info.num];
+        offset = start + sector_info.len;
+    }
+
+    return true;
+}
+
+bool pflash_cfi02_direct_program(PFlashCFI02 *fl, hwaddr offset,
+                                 const uint8_t *buf, uint64_t len)
+{
+    uint8_t *p = (uint8_t *)fl->storage + offset;
+    hwaddr end = offset + len;
+    hwaddr addr;
+
+    if (fl->ro || end > fl->chip_len || end < offset) {
+        return false;
+    }
+
+    /* like a program operation, this can only clear bits */
+    for (addr = 0; addr < len; addr++) {
+        p[addr] &= buf[addr];
+    }
+
+    for (addr = offset; addr < end;) {
+        SectorInfo sector_info = pflash_sector_info(fl, addr);
+        hwaddr next = (addr & ~((hwaddr)sector_info.len - 1)) + sector_info.len;
+
+        next = MIN(next, end);
+        fl->sector_programs[sector_info.num] += DIV_ROUND_UP(next - addr,
+                                                             fl->width);
+        addr = next;
+    }
+
+    pflash_update(fl, offset, len);
+    memory_region_flush_rom_device(&fl->orig_mem, offset, len);
+    return true;
+}
@@ -206,6 +206,7 @@ typedef struct CPUTLBCommon {
     size_t full_flush_count;
     size_t part_flush_count;
     size_t elide_flush_count;
+    size_t fill_count;
 } CPUTLBCommon;
 
 /*
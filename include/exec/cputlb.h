@@ -27,5 +27,6 @@
 void tlb_protect_code(ram_addr_t ram_addr);
 void tlb_unprotect_code(ram_addr_t ram_addr);
 void tlb_flush_counts(size_t *full, size_t *part, size_t *elide);
+size_t tlb_fill_count(void);
 #endif
 #endif
@@ -174,6 +174,48 @@ int gdbserver_start(const char *port);
 
 void gdbserver_cleanup(void);
 
+#ifndef CONFIG_USER_ONLY
+#include "exec/hwaddr.h"
+
+/**
+ * GDBFlashOps:
+ * @erase: erase the blocks covering @len bytes at physical address @addr
+ * @write: program @len bytes at physical address @addr
+ *
+ * Both return 0 on success and a negative value on failure.
+ */
+typedef struct GDBFlashOps {
+    int (*erase)(void *opaque, hwaddr addr, uint64_t len);
+    int (*write)(void *opaque, hwaddr addr, const uint8_t *buf, uint64_t len);
+} GDBFlashOps;
+
+/**
+ * gdb_register_flash:
+ * @base: physical base address of the flash
+ * @size: size of the flash in bytes
+ * @blocksize: erase block size, uniform across the range
+ * @ops: callbacks for the vFlashErase and vFlashWrite commands
+ * @opaque: opaque pointer passed to @ops
+ *
+ * Declare a range of flash memory to gdb, which loads it with the vFlash
+ * commands instead of plain memory writes. Flash with several block sizes is
+ * registered as one range per block size. Must be called during machine
+ * initialization.
+ */
+void gdb_register_flash(hwaddr base, uint64_t size, uint32_t blocksize,
+                        const GDBFlashOps *ops, void *opaque);
+
+/**
+ * gdb_enable_memory_map:
+ *
+ * Provide the memory map to gdb via qXfer:memory-map:read, built from the
+ * system address space and the registered flash ranges. gdb treats it as the
+ * map of virtual addresses, so this is only suitable for machines which run
+ * with identity-mapped (or no) virtual memory.
+ */
+void gdb_enable_memory_map(void);
+#endif
+
 /**
  * gdb_has_xml:
  * This is an ugly hack to cope with both new and old gdb.
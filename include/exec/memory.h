@@ -693,6 +693,23 @@ static inline FlatView *address_space_to_flatview(AddressSpace *as)
     return atomic_rcu_read(&as->current_map);
 }
 
+typedef bool (*flatview_cb)(Int128 start,
+                            Int128 len,
+                            const MemoryRegion *mr,
+                            void *opaque);
+
+/**
+ * flatview_for_each_range: iterate through the ranges of a #FlatView
+ *
+ * Calls @cb for each range in ascending address order, until it returns
+ * true. Must be called within an RCU critical section.
+ *
+ * @fv: the #FlatView to iterate
+ * @cb: function called with the start, length, and #MemoryRegion of a range
+ * @opaque: opaque pointer passed to @cb
+ */
+void flatview_for_each_range(FlatView *fv, flatview_cb cb, void *opaque);
+
 
 /**
  * MemoryRegionSection: describes a fragment of a #MemoryRegion
@@ -47,6 +47,30 @@ PFlashCFI02 *pflash_cfi02_register(hwaddr base,
                                    uint16_t unlock_addr1,
                                    int be);
 
+/* Wear statistics of a single sector, counted since realize or last reset. */
+typedef struct PFlashCFI02SectorStats {
+    hwaddr offset;      /* byte offset of the sector in the device */
+    uint32_t len;       /* sector length in bytes */
+    uint64_t erases;    /* sector and chip erase operations */
+    uint64_t programs;  /* word/byte program operations */
+} PFlashCFI02SectorStats;
+
+uint32_t pflash_cfi02_get_num_sectors(PFlashCFI02 *fl);
+void pflash_cfi02_get_sector_stats(PFlashCFI02 *fl, uint32_t sector,
+                                   PFlashCFI02SectorStats *stats);
+void pflash_cfi02_reset_sector_stats(PFlashCFI02 *fl);
+
+/*
+ * Erase the sectors covering a range, or program data into the flash (ANDed
+ * with the current contents, as a program operation would), immediately and
+ * bypassing the command interface, e.g. for loading an image via a debugger.
+ * Changes are written through to the block backend. Return false if the
+ * flash is read-only or the range is out of bounds.
+ */
+bool pflash_cfi02_direct_erase(PFlashCFI02 *fl, hwaddr offset, uint64_t len);
+bool pflash_cfi02_direct_program(PFlashCFI02 *fl, hwaddr offset,
+                                 const uint8_t *buf, uint64_t len);
+
 /* nand.c */
 DeviceState *nand_init(BlockBackend *blk, int manf_id, int chip_id);
 void nand_setpins(DeviceState *dev, uint8_t cle, uint8_t ale,
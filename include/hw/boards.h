@@ -119,6 +119,10 @@ typedef struct {
  *    size than the target architecture's minimum. (Attempting to create
  *    such a CPU will fail.) Note that changing this is a migration
  *    compatibility break for the machine.
+ * @minimum_page_bits_opt:
+ *    If set, @minimum_page_bits only applies if the boolean machine option
+ *    of this name is enabled. The board must also provide a property of
+ *    this name.
  * @ignore_memory_transaction_failures:
  *    If this is flag is true then the CPU will ignore memory transaction
  *    failures which should cause the CPU to take an exception due to an
@@ -201,6 +205,7 @@ struct MachineClass {
     bool option_rom_has_mr;
     bool rom_file_has_mr;
     int minimum_page_bits;
+    const char *minimum_page_bits_opt;
     bool has_hotpluggable_cpus;
     bool ignore_memory_transaction_failures;
     int numa_mem_align_shift;
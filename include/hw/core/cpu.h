@@ -399,6 +399,8 @@ struct CPUState {
 
     QTAILQ_HEAD(, CPUWatchpoint) watchpoints;
     CPUWatchpoint *watchpoint_hit;
+    /* The last debug exception was raised by a BP_MACHINE breakpoint only */
+    bool machine_breakpoint_hit;
 
     void *opaque;
 
@@ -1039,6 +1041,15 @@ void cpu_single_step(CPUState *cpu, int enabled);
 #define BP_WATCHPOINT_HIT_READ 0x40
 #define BP_WATCHPOINT_HIT_WRITE 0x80
 #define BP_WATCHPOINT_HIT (BP_WATCHPOINT_HIT_READ | BP_WATCHPOINT_HIT_WRITE)
+/*
+ * Stops the VM like BP_GDB, but is owned by the machine: the gdbstub neither
+ * reports nor removes it (ARM only)
+ */
+#define BP_MACHINE            0x100
+/* Halt the CPU until the next interrupt, as if by WFI (ARM only) */
+#define BP_IDLE               0x200
+/* Entry of an intercepted soft-float library routine (ARM only) */
+#define BP_SOFTFLOAT          0x400
 
 int cpu_breakpoint_insert(CPUState *cpu, vaddr pc, int flags,
                           CPUBreakpoint **breakpoint);
@@ -17,5 +17,9 @@
 
 int save_snapshot(const char *name, Error **errp);
 int load_snapshot(const char *name, Error **errp);
+int save_snapshot_file(const char *filename, Error **errp);
+int load_snapshot_file(const char *filename, Error **errp);
+int save_device_state_buffer(GByteArray *buf, Error **errp);
+int load_device_state_buffer(GByteArray *buf, Error **errp);
 
 #endif
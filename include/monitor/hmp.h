@@ -129,5 +129,8 @@ void hmp_hotpluggable_cpus(Monitor *mon, const QDict *qdict);
 void hmp_info_vm_generation_id(Monitor *mon, const QDict *qdict);
 void hmp_info_memory_size_summary(Monitor *mon, const QDict *qdict);
 void hmp_info_sev(Monitor *mon, const QDict *qdict);
+void hmp_info_iobc_irq(Monitor *mon, const QDict *qdict);
+void hmp_info_iobc_pflash(Monitor *mon, const QDict *qdict);
+void hmp_info_iobc_polls(Monitor *mon, const QDict *qdict);
 
 #endif
@@ -59,6 +59,7 @@ enum qemu_plugin_event {
     QEMU_PLUGIN_EV_VCPU_SYSCALL,
     QEMU_PLUGIN_EV_VCPU_SYSCALL_RET,
     QEMU_PLUGIN_EV_FLUSH,
+    QEMU_PLUGIN_EV_RESTORE,
     QEMU_PLUGIN_EV_ATEXIT,
     QEMU_PLUGIN_EV_MAX, /* total number of plugin events we support */
 };
@@ -199,6 +200,8 @@ void qemu_plugin_vcpu_mem_cb(CPUState *cpu, uint64_t vaddr, uint32_t meminfo);
 
 void qemu_plugin_flush_cb(void);
 
+void qemu_plugin_restore_cb(void);
+
 void qemu_plugin_atexit_cb(void);
 
 void qemu_plugin_add_dyn_cb_arr(GArray *arr);
@@ -240,6 +243,9 @@ static inline void qemu_plugin_vcpu_mem_cb(CPUState *cpu, uint64_t vaddr,
 static inline void qemu_plugin_flush_cb(void)
 { }
 
+static inline void qemu_plugin_restore_cb(void)
+{ }
+
 static inline void qemu_plugin_atexit_cb(void)
 { }
 
@@ -394,6 +394,19 @@ void qemu_plugin_vcpu_for_each(qemu_plugin_id_t id,
 void qemu_plugin_register_flush_cb(qemu_plugin_id_t id,
                                    qemu_plugin_simple_cb_t cb);
 
+/**
+ * qemu_plugin_register_restore_cb() - register a state restore callback
+ * @id: plugin ID
+ * @cb: callback function
+ *
+ * The @cb function is called after the machine state has been restored to
+ * an earlier snapshot while the vCPUs are stopped, e.g. at the start of each
+ * run of the iOBC fuzzing harness. Plugins can use this to reset any state
+ * tracking the guest execution.
+ */
+void qemu_plugin_register_restore_cb(qemu_plugin_id_t id,
+                                     qemu_plugin_simple_cb_t cb);
+
 void qemu_plugin_register_atexit_cb(qemu_plugin_id_t id,
                                     qemu_plugin_udata_cb_t cb, void *userdata);
 
@@ -403,6 +416,132 @@ int qemu_plugin_n_vcpus(void);
 /* returns -1 in user-mode */
 int qemu_plugin_n_max_vcpus(void);
 
+/*
+ * Guest state access
+ *
+ * The following functions read the registers and memory of a vCPU. They
+ * must only be called from a callback running on that vCPU, which has
+ * been registered with QEMU_PLUGIN_CB_R_REGS (otherwise, register values
+ * may still be held in host registers), or from a periodic callback (see
+ * qemu_plugin_register_vcpu_periodic_cb()). The program counter is
+ * generally not up to date during a block, use the vaddr of the block or
+ * instruction instead.
+ */
+
+/**
+ * qemu_plugin_vcpu_read_register() - read a register of a vCPU
+ * @vcpu_index: the vCPU the callback is running on
+ * @reg: register number as in the GDB remote protocol of the target
+ *       (ARM: 0-15 for r0-r15, 25 for cpsr)
+ * @value: returns the register value, zero-extended
+ *
+ * Returns: the size of the register in bytes, or 0 if the register does
+ * not exist or is larger than 64 bits.
+ */
+int qemu_plugin_vcpu_read_register(unsigned int vcpu_index, int reg,
+                                   uint64_t *value);
+
+/**
+ * qemu_plugin_vcpu_gprs() - general-purpose registers of a vCPU
+ * @vcpu_index: the vCPU the callback is running on
+ * @reg_size: returns the size of each register in bytes (4 or 8)
+ * @n_regs: returns the number of registers
+ *
+ * Direct access to the general-purpose registers of the current CPU mode,
+ * e.g. to read the stack pointer in a frequent callback without a function
+ * call (see qemu_plugin_gpr()). The array stays valid as long as the vCPU
+ * exists, but its contents and layout change with the CPU mode (on ARM,
+ * e.g. the banked sp and lr, or AArch32 and AArch64 state).
+ *
+ * Returns: a pointer to the register array in host byte order, or NULL if
+ * not supported by the target (currently only ARM).
+ */
+const void *qemu_plugin_vcpu_gprs(unsigned int vcpu_index, size_t *reg_size,
+                                  int *n_regs);
+
+/**
+ * qemu_plugin_gpr() - read a register from qemu_plugin_vcpu_gprs()
+ * @gprs: the register array
+ * @reg_size: the register size returned with @gprs
+ * @reg: the register number, less than the number returned with @gprs
+ */
+static inline uint64_t qemu_plugin_gpr(const void *gprs, size_t reg_size,
+                                       int reg)
+{
+    if (reg_size == 4) {
+        return ((const uint32_t *)gprs)[reg];
+    }
+    return ((const uint64_t *)gprs)[reg];
+}
+
+/**
+ * qemu_plugin_vcpu_read_memory() - read guest virtual memory
+ * @vcpu_index: the vCPU the callback is running on
+ * @vaddr: guest virtual address, translated with the current MMU context
+ *         and privilege level of the vCPU
+ * @buf: buffer receiving the data, in guest memory byte order
+ * @len: number of bytes to read
+ *
+ * Only RAM and ROM are read, so that reads never have side effects on
+ * devices. Page table walks do not raise guest faults.
+ *
+ * Returns: 0 on success, -1 if any part of the range is not mapped to RAM
+ * or ROM.
+ */
+int qemu_plugin_vcpu_read_memory(unsigned int vcpu_index, uint64_t vaddr,
+                                 void *buf, size_t len);
+
+/**
+ * qemu_plugin_register_vcpu_periodic_cb() - register a periodic vCPU callback
+ * @id: plugin ID
+ * @period_ns: period in virtual time (QEMU_CLOCK_VIRTUAL nanoseconds)
+ * @cb: callback function
+ *
+ * The @cb function is called on each vCPU every @period_ns of virtual time,
+ * between two translated blocks (or while the vCPU is halted). In contrast
+ * to block and instruction callbacks, this does not slow down the executed
+ * code, e.g. for sampling profilers. The registers of the vCPU, including
+ * the program counter, are up to date during @cb and can be read with the
+ * guest state access functions above. With -icount, the period corresponds
+ * to a number of instructions. Not available in user-mode, and must not be
+ * used by plugins which uninstall themselves.
+ */
+void qemu_plugin_register_vcpu_periodic_cb(qemu_plugin_id_t id,
+                                           uint64_t period_ns,
+                                           qemu_plugin_vcpu_simple_cb_t cb);
+
+/**
+ * qemu_plugin_virtual_clock_ns() - current virtual time
+ *
+ * Returns: the guest-visible virtual clock (QEMU_CLOCK_VIRTUAL) in
+ * nanoseconds, e.g. to attribute time to guest threads, or 0 in
+ * user-mode.
+ */
+uint64_t qemu_plugin_virtual_clock_ns(void);
+
+/**
+ * qemu_plugin_icount_insn_ns() - virtual time of an instruction
+ *
+ * Returns: the virtual time each executed instruction takes with -icount
+ * and a fixed shift (2^shift nanoseconds), or 0 without -icount, with
+ * shift=auto, or in user-mode.
+ */
+uint64_t qemu_plugin_icount_insn_ns(void);
+
+/**
+ * qemu_plugin_vcpu_icount_stall() - stall a vCPU in virtual time
+ * @vcpu_index: the vCPU the callback is running on
+ * @count: number of instructions
+ *
+ * With -icount, account @count instructions in addition to the executed
+ * ones, i.e. advance the virtual clock by @count times
+ * qemu_plugin_icount_insn_ns() as if the vCPU had been stalled, e.g. for a
+ * timing model. Timers expiring during the stall run at the end of the
+ * current block at the latest. Must be called from a block or instruction
+ * callback running on that vCPU. Has no effect without -icount.
+ */
+void qemu_plugin_vcpu_icount_stall(unsigned int vcpu_index, uint64_t count);
+
 /**
  * qemu_plugin_outs() - output string via QEMU's logging system
  * @string: a string
@@ -854,6 +854,7 @@ static inline int64_t get_clock(void)
 int64_t cpu_get_icount_raw(void);
 int64_t cpu_get_icount(void);
 int64_t cpu_get_clock(void);
+int64_t cpu_clock_deadline_to_host(int64_t ns);
 int64_t cpu_icount_to_ns(int64_t icount);
 void    cpu_update_icount(CPUState *cpu);
 
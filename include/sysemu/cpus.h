@@ -31,6 +31,46 @@ void cpu_synchronize_all_pre_loadvm(void);
 
 void qtest_clock_warp(int64_t dest);
 
+/*
+ * Without icount, advance QEMU_CLOCK_VIRTUAL directly to the next timer
+ * deadline whenever all vCPUs are halted (e.g. in WFI) instead of waiting
+ * for it in real time.
+ */
+void cpu_set_idle_warp(bool enable);
+bool cpu_get_idle_warp(void);
+
+/*
+ * Without icount, advance QEMU_CLOCK_VIRTUAL to the given time, but not past
+ * the next timer deadline, e.g. to skip the time a device polling loop would
+ * spin. The expired timers are not run by this function but by the main loop,
+ * which is notified, and the current vCPU leaves its execution loop. Must be
+ * called from the vCPU thread with the BQL held. Returns the time skipped.
+ */
+int64_t cpu_clock_skip_to(int64_t dest);
+
+/*
+ * With icount, account the given number of instructions in addition to the
+ * executed ones, i.e. advance QEMU_CLOCK_VIRTUAL by the time they take, e.g.
+ * for pipeline and memory stalls estimated by a timing model. Must be called
+ * from the vCPU thread during execution (e.g. from a helper).
+ */
+void cpu_icount_stall(CPUState *cpu, int64_t count);
+
+/*
+ * The time of one instruction with icount and a fixed shift in nanoseconds,
+ * 0 otherwise.
+ */
+int64_t cpu_icount_insn_ns(void);
+
+/*
+ * Without icount, let QEMU_CLOCK_VIRTUAL run at the given multiple of host
+ * time (between 0.001 and 1000). The virtual clock stays continuous across
+ * scale changes. Returns false if the scale is out of range or icount is
+ * enabled.
+ */
+bool cpu_set_clock_scale(double scale);
+double cpu_get_clock_scale(void);
+
 #ifndef CONFIG_USER_ONLY
 /* vl.c */
 /* *-user doesn't have configurable SMP topology */
@@ -2916,6 +2916,160 @@ err_drain:
     return ret;
 }
 
+/*
+ * Save the complete VM state, including RAM, to the given file. Unlike
+ * save_snapshot(), this does not require a snapshot-capable block device.
+ * The VM is stopped while saving and resumed afterwards if it was running.
+ */
+int save_snapshot_file(const char *filename, Error **errp)
+{
+    QEMUFile *f;
+    QIOChannelFile *ioc;
+    int saved_vm_running;
+    int ret;
+
+    saved_vm_running = runstate_is_running();
+
+    ret = global_state_store();
+    if (ret) {
+        error_setg(errp, "Error saving global state");
+        return ret;
+    }
+    vm_stop(RUN_STATE_SAVE_VM);
+
+    ioc = qio_channel_file_new_path(filename, O_WRONLY | O_CREAT | O_TRUNC |
+                                    O_BINARY, 0660, errp);
+    if (!ioc) {
+        ret = -EIO;
+        goto the_end;
+    }
+    qio_channel_set_name(QIO_CHANNEL(ioc), "migration-file-save-state");
+    f = qemu_fopen_channel_output(QIO_CHANNEL(ioc));
+    object_unref(OBJECT(ioc));
+
+    ret = qemu_savevm_state(f, errp);
+    if (qemu_fclose(f) < 0 && ret == 0) {
+        error_setg(errp, QERR_IO_ERROR);
+        ret = -EIO;
+    }
+
+ the_end:
+    if (saved_vm_running) {
+        vm_start();
+    }
+    return ret;
+}
+
+/*
+ * Reset the VM and load the complete VM state from a file written by
+ * save_snapshot_file(). The VM must be stopped.
+ */
+int load_snapshot_file(const char *filename, Error **errp)
+{
+    MigrationIncomingState *mis = migration_incoming_get_current();
+    QEMUFile *f;
+    QIOChannelFile *ioc;
+    int ret;
+
+    if (runstate_is_running()) {
+        error_setg(errp, "Cannot load VM state while vm is running");
+        return -EINVAL;
+    }
+
+    ioc = qio_channel_file_new_path(filename, O_RDONLY | O_BINARY, 0, errp);
+    if (!ioc) {
+        return -EIO;
+    }
+    qio_channel_set_name(QIO_CHANNEL(ioc), "migration-file-load-state");
+    f = qemu_fopen_channel_input(QIO_CHANNEL(ioc));
+    object_unref(OBJECT(ioc));
+
+    qemu_system_reset(SHUTDOWN_CAUSE_NONE);
+    mis->from_src_file = f;
+
+    ret = qemu_loadvm_state(f);
+    migration_incoming_state_destroy();
+
+    if (ret < 0) {
+        error_setg(errp, "Error %d while loading VM state", ret);
+    }
+    return ret;
+}
+
+/*
+ * Save the state of all devices, excluding RAM, to the given buffer. Used
+ * for fast in-process snapshots (e.g. for fuzzing) where RAM is restored
+ * separately. The VM must be stopped.
+ */
+int save_device_state_buffer(GByteArray *buf, Error **errp)
+{
+    QIOChannelBuffer *bioc;
+    QEMUFile *f;
+    int ret;
+
+    if (runstate_is_running()) {
+        error_setg(errp, "Cannot save device state while vm is running");
+        return -EINVAL;
+    }
+
+    bioc = qio_channel_buffer_new(4096);
+    qio_channel_set_name(QIO_CHANNEL(bioc), "device-state-save-buffer");
+    f = qemu_fopen_channel_output(QIO_CHANNEL(bioc));
+
+    ret = qemu_save_device_state(f);
+    qemu_fflush(f);
+
+    if (ret < 0) {
+        error_setg(errp, "Error %d while saving device state", ret);
+    } else {
+        g_byte_array_set_size(buf, 0);
+        g_byte_array_append(buf, bioc->data, bioc->usage);
+    }
+
+    qemu_fclose(f);
+    object_unref(OBJECT(bioc));
+    return ret;
+}
+
+/*
+ * Load the state of all devices, excluding RAM, from a buffer written by
+ * save_device_state_buffer(). The VM must be stopped.
+ */
+int load_device_state_buffer(GByteArray *buf, Error **errp)
+{
+    QIOChannelBuffer *bioc;
+    QEMUFile *f;
+    int ret;
+
+    if (runstate_is_running()) {
+        error_setg(errp, "Cannot load device state while vm is running");
+        return -EINVAL;
+    }
+
+    bioc = qio_channel_buffer_new(buf->len);
+    qio_channel_set_name(QIO_CHANNEL(bioc), "device-state-load-buffer");
+    memcpy(bioc->data, buf->data, buf->len);
+    bioc->usage = buf->len;
+
+    f = qemu_fopen_channel_input(QIO_CHANNEL(bioc));
+    object_unref(OBJECT(bioc));
+
+    if (qemu_get_be32(f) != QEMU_VM_FILE_MAGIC
+        || qemu_get_be32(f) != QEMU_VM_FILE_VERSION) {
+        error_setg(errp, "Invalid device state buffer");
+        qemu_fclose(f);
+        return -EINVAL;
+    }
+
+    ret = qemu_load_device_state(f);
+    qemu_fclose(f);
+
+    if (ret < 0) {
+        error_setg(errp, "Error %d while loading device state", ret);
+    }
+    return ret;
+}
+
 void vmstate_register_ram(MemoryRegion *mr, DeviceState *dev)
 {
     qemu_ram_set_idstr(mr->ram_block,
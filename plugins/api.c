@@ -40,7 +40,10 @@
 #include "sysemu/sysemu.h"
 #include "tcg/tcg.h"
 #include "exec/exec-all.h"
+#include "exec/cpu_ldst.h"
 #include "disas/disas.h"
+#include "qemu/timer.h"
+#include "sysemu/cpus.h"
 #include "plugin.h"
 #ifndef CONFIG_USER_ONLY
 #include "qemu/plugin-memory.h"
@@ -333,6 +336,201 @@ int qemu_plugin_n_max_vcpus(void)
 #endif
 }
 
+/*
+ * Guest state access
+ *
+ * Registers are read via the gdbstub accessors of the target, which also
+ * provide the register numbering. Memory is read via the softmmu TLB
+ * without faulting, so that only RAM is accessed and guest state apart from
+ * the TLB contents is not modified.
+ */
+
+int qemu_plugin_vcpu_read_register(unsigned int vcpu_index, int reg,
+                                   uint64_t *value)
+{
+    static __thread GByteArray *buf;
+    CPUState *cpu = qemu_get_cpu(vcpu_index);
+    CPUClass *cc;
+    int size;
+
+    if (!cpu) {
+        return 0;
+    }
+
+    cc = CPU_GET_CLASS(cpu);
+    if (reg < 0 || reg >= cc->gdb_num_core_regs || !cc->gdb_read_register) {
+        return 0;
+    }
+
+    if (!buf) {
+        buf = g_byte_array_sized_new(16);
+    }
+    g_byte_array_set_size(buf, 0);
+
+    size = cc->gdb_read_register(cpu, buf, reg);
+
+    /* the gdbstub provides the value in target byte order */
+    switch (size) {
+    case 1:
+        *value = ldub_p(buf->data);
+        break;
+    case 2:
+        *value = lduw_p(buf->data);
+        break;
+    case 4:
+        *value = ldl_p(buf->data);
+        break;
+    case 8:
+        *value = ldq_p(buf->data);
+        break;
+    default:
+        return 0;
+    }
+
+    return size;
+}
+
+const void *qemu_plugin_vcpu_gprs(unsigned int vcpu_index, size_t *reg_size,
+                                  int *n_regs)
+{
+#ifdef TARGET_ARM
+    CPUState *cpu = qemu_get_cpu(vcpu_index);
+    CPUARMState *env;
+
+    if (!cpu) {
+        return NULL;
+    }
+
+    env = cpu->env_ptr;
+    if (is_a64(env)) {
+        *reg_size = sizeof(env->xregs[0]);
+        *n_regs = ARRAY_SIZE(env->xregs);
+        return env->xregs;
+    }
+
+    *reg_size = sizeof(env->regs[0]);
+    *n_regs = ARRAY_SIZE(env->regs);
+    return env->regs;
+#else
+    return NULL;
+#endif
+}
+
+int qemu_plugin_vcpu_read_memory(unsigned int vcpu_index, uint64_t vaddr,
+                                 void *buf, size_t len)
+{
+    CPUState *cpu = qemu_get_cpu(vcpu_index);
+#ifndef CONFIG_USER_ONLY
+    CPUArchState *env;
+    uint8_t *p = buf;
+    int mmu_idx;
+#endif
+
+    if (!cpu) {
+        return -1;
+    }
+
+#ifdef CONFIG_USER_ONLY
+    return cpu_memory_rw_debug(cpu, vaddr, buf, len, false);
+#else
+    env = cpu->env_ptr;
+    mmu_idx = cpu_mmu_index(env, false);
+
+    while (len) {
+        size_t l = MIN(len, TARGET_PAGE_SIZE - (vaddr & ~TARGET_PAGE_MASK));
+        void *host = tlb_vaddr_to_host(env, vaddr, MMU_DATA_LOAD, mmu_idx);
+
+        /* not mapped, I/O, or watched */
+        if (!host) {
+            return -1;
+        }
+
+        memcpy(p, host, l);
+        vaddr += l;
+        p += l;
+        len -= l;
+    }
+
+    return 0;
+#endif
+}
+
+#ifndef CONFIG_USER_ONLY
+typedef struct {
+    qemu_plugin_id_t id;
+    qemu_plugin_vcpu_simple_cb_t cb;
+    int64_t period;
+    QEMUTimer *timer;
+} PluginPeriodicCb;
+
+static void plugin_periodic_work(CPUState *cpu, run_on_cpu_data data)
+{
+    PluginPeriodicCb *p = data.host_ptr;
+
+    p->cb(p->id, cpu->cpu_index);
+}
+
+/*
+ * Kicked vCPUs leave the execution loop at the next block boundary, where
+ * their state is synchronized, and then run the queued work.
+ */
+static void plugin_periodic_tick(void *opaque)
+{
+    PluginPeriodicCb *p = opaque;
+    CPUState *cpu;
+
+    CPU_FOREACH(cpu) {
+        async_run_on_cpu(cpu, plugin_periodic_work, RUN_ON_CPU_HOST_PTR(p));
+    }
+
+    timer_mod(p->timer, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) + p->period);
+}
+#endif
+
+void qemu_plugin_register_vcpu_periodic_cb(qemu_plugin_id_t id,
+                                           uint64_t period_ns,
+                                           qemu_plugin_vcpu_simple_cb_t cb)
+{
+#ifndef CONFIG_USER_ONLY
+    PluginPeriodicCb *p = g_new0(PluginPeriodicCb, 1);
+
+    p->id = id;
+    p->cb = cb;
+    p->period = MAX(period_ns, 1);
+    p->timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, plugin_periodic_tick, p);
+    timer_mod(p->timer, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) + p->period);
+#endif
+}
+
+uint64_t qemu_plugin_virtual_clock_ns(void)
+{
+#ifdef CONFIG_USER_ONLY
+    return 0;
+#else
+    return qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+#endif
+}
+
+uint64_t qemu_plugin_icount_insn_ns(void)
+{
+#ifdef CONFIG_USER_ONLY
+    return 0;
+#else
+    return cpu_icount_insn_ns();
+#endif
+}
+
+void qemu_plugin_vcpu_icount_stall(unsigned int vcpu_index, uint64_t count)
+{
+#ifndef CONFIG_USER_ONLY
+    CPUState *cpu = qemu_get_cpu(vcpu_index);
+
+    if (cpu && cpu == current_cpu) {
+        cpu_icount_stall(cpu, count);
+    }
+#endif
+}
+
 /*
  * Plugin output
  */
@@ -117,6 +117,7 @@ static void plugin_cb__simple(enum qemu_plugin_event ev)
 
     switch (ev) {
     case QEMU_PLUGIN_EV_FLUSH:
+    case QEMU_PLUGIN_EV_RESTORE:
         QLIST_FOREACH_SAFE_RCU(cb, &plugin.cb_lists[ev], entry, next) {
             qemu_plugin_simple_cb_t func = cb->f.simple;
 
@@ -402,6 +403,12 @@ void qemu_plugin_register_flush_cb(qemu_plugin_id_t id,
     plugin_register_cb(id, QEMU_PLUGIN_EV_FLUSH, cb);
 }
 
+void qemu_plugin_register_restore_cb(qemu_plugin_id_t id,
+                                     qemu_plugin_simple_cb_t cb)
+{
+    plugin_register_cb(id, QEMU_PLUGIN_EV_RESTORE, cb);
+}
+
 static bool free_dyn_cb_arr(void *p, uint32_t h, void *userp)
 {
     g_array_free((GArray *) p, true);
@@ -416,6 +423,11 @@ void qemu_plugin_flush_cb(void)
     plugin_cb__simple(QEMU_PLUGIN_EV_FLUSH);
 }
 
+void qemu_plugin_restore_cb(void)
+{
+    plugin_cb__simple(QEMU_PLUGIN_EV_RESTORE);
+}
+
 void exec_inline_op(struct qemu_plugin_dyn_cb *cb)
 {
     uint64_t *val = cb->userp;
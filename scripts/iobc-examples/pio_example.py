@@ -20,6 +20,10 @@ IOX_CID_PINSTATE_ENABLE = 0x01
 IOX_CID_PINSTATE_DISABLE = 0x02
 IOX_CID_PINSTATE_OUT = 0x03
 IOX_CID_PINSTATE_GET = 0x04
+IOX_CID_PINSTATE_EVENTS_ENABLE = 0x05
+IOX_CID_PINSTATE_EVENTS = 0x06
+
+PIO_EVENT_FORMAT = '<QII'     # virtual time (ns), changed pins, new pin-state
 
 
 class QmpException(Exception):
@@ -199,6 +203,7 @@ class Pio:
         self.respd = dict()
         self.respc = asyncio.Condition()
         self.dataq = asyncio.Queue()
+        self.eventq = asyncio.Queue()
         self.transport = None
         self.proto = None
         self.seq = 0
@@ -251,6 +256,26 @@ class Pio:
         frame = await self.dataq.get()
         return struct.unpack('I', frame.data)[0]
 
+    def enable_events(self, enable=True):
+        """
+        Enable or disable the timestamped pin-state event stream. Received
+        events can be retrieved via wait_events().
+        """
+
+        self._send_new_frame(IOX_CAT_PINSTATE, IOX_CID_PINSTATE_EVENTS_ENABLE, [int(enable)])
+
+    async def wait_events(self):
+        """
+        Wait for the next batch of pin-state events and return them as list
+        of (virtual time in ns, mask of changed pins, new pin-state) tuples.
+        """
+
+        frame = await self.eventq.get()
+        size = struct.calcsize(PIO_EVENT_FORMAT)
+
+        return [struct.unpack_from(PIO_EVENT_FORMAT, frame.data, off)
+                for off in range(0, len(frame.data), size)]
+
     async def get_pin_state(self):
         """
         Query and return the current pin state. The values are returned as
@@ -309,6 +334,8 @@ class PioProtocol(asyncio.Protocol):
 
             if frame.cat == IOX_CAT_PINSTATE and frame.id == IOX_CID_PINSTATE_OUT:
                 self.conn.dataq.put_nowait(frame)
+            elif frame.cat == IOX_CAT_PINSTATE and frame.id == IOX_CID_PINSTATE_EVENTS:
+                self.conn.eventq.put_nowait(frame)
             elif frame.cat == IOX_CAT_PINSTATE and frame.id == IOX_CID_PINSTATE_GET:
                 loop = asyncio.get_event_loop()
                 loop.create_task(self._pinstate_get_response_received(frame))
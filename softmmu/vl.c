@@ -3884,7 +3884,14 @@ void qemu_init(int argc, char **argv, char **envp)
                               "sysbus", OBJECT(sysbus_get_default()),
                               NULL);
 
-    if (machine_class->minimum_page_bits) {
+    /*
+     * Machine properties are only set below, after the page size has been
+     * fixed, so an opt-in for larger pages is read from the options directly.
+     */
+    if (machine_class->minimum_page_bits &&
+        (!machine_class->minimum_page_bits_opt ||
+         qemu_opt_get_bool(qemu_get_machine_opts(),
+                           machine_class->minimum_page_bits_opt, false))) {
         if (!set_preferred_target_page_bits(machine_class->minimum_page_bits)) {
             /* This would be a board error: specifying a minimum smaller than
              * a target's compile-time fixed setting.
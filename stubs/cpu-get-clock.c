@@ -5,3 +5,8 @@ int64_t cpu_get_clock(void)
 {
     return get_clock_realtime();
 }
+
+int64_t cpu_clock_deadline_to_host(int64_t ns)
+{
+    return ns;
+}
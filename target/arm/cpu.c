@@ -1629,10 +1629,14 @@ static void arm_cpu_realizefn(DeviceState *dev, Error **errp)
          */
         pagebits = 10;
     }
-    if (!set_preferred_target_page_bits(pagebits)) {
+    if (!set_preferred_target_page_bits(pagebits) &&
+        (arm_feature(env, ARM_FEATURE_M) || arm_feature(env, ARM_FEATURE_PMSA))) {
         /* This can only ever happen for hotplugging a CPU, or if
          * the board code incorrectly creates a CPU which it has
          * promised via minimum_page_size that it will not.
+         * VMSA CPUs can live with larger pages: tiny pages and
+         * differing subpage permissions are handled by refilling
+         * the TLB on every access (see get_phys_addr_v5).
          */
         error_setg(errp, "This CPU requires a smaller page size than the "
                    "system is using");
@@ -956,6 +956,13 @@ struct ARMCPU {
 
     /* Generic timer counter frequency, in Hz */
     uint64_t gt_cntfrq_hz;
+
+    /* Intercepted soft-float routines by entry address, see
+     * arm_softfloat_intercept(). Calls waiting for the return of the guest
+     * routine in verify mode.
+     */
+    GHashTable *softfloat_funcs;
+    GArray *softfloat_pending;
 };
 
 unsigned int gt_cntfrq_period_ns(ARMCPU *cpu);
@@ -975,6 +982,27 @@ bool arm_cpu_exec_interrupt(CPUState *cpu, int int_req);
 hwaddr arm_cpu_get_phys_page_attrs_debug(CPUState *cpu, vaddr addr,
                                          MemTxAttrs *attrs);
 
+/**
+ * arm_softfloat_intercept:
+ * @cpu: ARMCPU
+ * @name: name of the routine, e.g. "__aeabi_dadd" or "__adddf3"
+ * @pc: entry address of the routine, the Thumb bit is ignored
+ *
+ * Intercept calls to the given soft-float library routine of the guest and
+ * compute their result in the emulator instead (see softfloat-intercept.c).
+ * Returns false if the routine is not supported.
+ */
+bool arm_softfloat_intercept(ARMCPU *cpu, const char *name, vaddr pc);
+
+/**
+ * arm_softfloat_enable_verify:
+ * @cpu: ARMCPU
+ *
+ * Execute intercepted soft-float routines in the guest and report results
+ * differing from the intercepted ones instead of skipping the routines.
+ */
+void arm_softfloat_enable_verify(ARMCPU *cpu);
+
 int arm_cpu_gdb_read_register(CPUState *cpu, GByteArray *buf, int reg);
 int arm_cpu_gdb_write_register(CPUState *cpu, uint8_t *buf, int reg);
 
@@ -268,6 +268,8 @@ void arm_debug_excp_handler(CPUState *cs)
     CPUARMState *env = &cpu->env;
     CPUWatchpoint *wp_hit = cs->watchpoint_hit;
 
+    cs->machine_breakpoint_hit = false;
+
     if (wp_hit) {
         if (wp_hit->flags & BP_CPU) {
             bool wnr = (wp_hit->flags & BP_WATCHPOINT_HIT_WRITE) != 0;
@@ -293,6 +295,10 @@ void arm_debug_excp_handler(CPUState *cs)
          */
         if (cpu_breakpoint_test(cs, pc, BP_GDB)
             || !cpu_breakpoint_test(cs, pc, BP_CPU)) {
+            /* (3) Machine breakpoints are not seen by GDB */
+            cs->machine_breakpoint_hit = !cs->singlestep_enabled
+                && cpu_breakpoint_test(cs, pc, BP_MACHINE)
+                && !cpu_breakpoint_test(cs, pc, BP_GDB);
             return;
         }
 
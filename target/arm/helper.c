@@ -19,6 +19,7 @@
 #include "qemu/bitops.h"
 #include "qemu/crc32c.h"
 #include "qemu/qemu-print.h"
+#include "qemu/error-report.h"
 #include "exec/exec-all.h"
 #include <zlib.h> /* For crc32 */
 #include "hw/irq.h"
@@ -10287,6 +10288,14 @@ static bool get_phys_addr_v5(CPUARMState *env, uint32_t address,
             phys_addr = (desc & 0xfffff000) | (address & 0xfff);
             ap = (desc >> (4 + ((address >> 9) & 6))) & 3;
             *page_size = 0x1000;
+            /* With target pages larger than 1k, differing subpage
+             * permissions can only be enforced by a TLB refill on
+             * every access.
+             */
+            if (TARGET_PAGE_BITS > 10 &&
+                extract32(desc, 4, 8) != ap * 0x55) {
+                *page_size = 0x400;
+            }
             break;
         case 3: /* 1k page, or ARMv6/XScale "extended small (4k) page" */
             if (type == 1) {
@@ -10305,6 +10314,11 @@ static bool get_phys_addr_v5(CPUARMState *env, uint32_t address,
             } else {
                 phys_addr = (desc & 0xfffffc00) | (address & 0x3ff);
                 *page_size = 0x400;
+                if (TARGET_PAGE_BITS > 10) {
+                    warn_report_once("arm: guest uses 1k tiny pages, which "
+                                     "are slow with the current target page "
+                                     "size");
+                }
             }
             ap = (desc >> 4) & 3;
             break;
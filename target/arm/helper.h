@@ -49,6 +49,10 @@ DEF_HELPER_4(exception_with_syndrome, void, env, i32, i32, i32)
 DEF_HELPER_2(exception_bkpt_insn, void, env, i32)
 DEF_HELPER_1(setend, void, env)
 DEF_HELPER_2(wfi, void, env, i32)
+DEF_HELPER_1(idle, void, env)
+#ifndef CONFIG_USER_ONLY
+DEF_HELPER_3(softfloat_call, i32, env, i32, i32)
+#endif
 DEF_HELPER_1(wfe, void, env)
 DEF_HELPER_1(yield, void, env)
 DEF_HELPER_1(pre_hvc, void, env)
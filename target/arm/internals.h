@@ -1236,6 +1236,12 @@ bool get_phys_addr(CPUARMState *env, target_ulong address,
 
 void arm_log_exception(int idx);
 
+/*
+ * Return the soft-float routine intercepted at @pc (for the softfloat_call
+ * helper), or -1 if none (see arm_softfloat_intercept()).
+ */
+int arm_softfloat_func(ARMCPU *cpu, vaddr pc);
+
 #endif /* !CONFIG_USER_ONLY */
 
 #endif
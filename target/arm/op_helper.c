@@ -309,6 +309,24 @@ void HELPER(wfi)(CPUARMState *env, uint32_t insn_len)
     cpu_loop_exit(cs);
 }
 
+void HELPER(idle)(CPUARMState *env)
+{
+    /* Idle-loop breakpoint (BP_IDLE): halt before the instruction at the
+     * breakpoint as if a WFI had been executed there. On wakeup, the pending
+     * interrupt is taken with the breakpoint address as return address. If
+     * the interrupt is masked, the instruction is executed normally.
+     */
+    CPUState *cs = env_cpu(env);
+
+    if (cpu_has_work(cs)) {
+        return;
+    }
+
+    cs->exception_index = EXCP_HLT;
+    cs->halted = 1;
+    cpu_loop_exit_restore(cs, GETPC());
+}
+
 void HELPER(wfe)(CPUARMState *env)
 {
     /* This is a hint instruction that is semantically different
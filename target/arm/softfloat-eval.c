@@ -0,0 +1,241 @@
+/*
+ * ARM soft-float library call intercept: evaluation of the routines.
+ *
+ * See softfloat-eval.h for details.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "fpu/softfloat.h"
+#include "softfloat-eval.h"
+
+
+/* 2^63 and 2^64, limits of the conversions to 64 bit integers */
+#define SF_FLOAT64_2P63     make_float64(0x43e0000000000000ULL)
+#define SF_FLOAT64_2P64     make_float64(0x43f0000000000000ULL)
+
+
+static bool sf_binop64(SoftFloatFunc func, float64 a, float64 b, uint64_t *ret,
+                       float_status *fs)
+{
+    float64 r;
+
+    if (float64_is_any_nan(a) || float64_is_any_nan(b)) {
+        return false;
+    }
+
+    switch (func) {
+    case SF_DADD:
+        r = float64_add(a, b, fs);
+        break;
+    case SF_DSUB:
+        r = float64_sub(a, b, fs);
+        break;
+    case SF_DRSUB:
+        r = float64_sub(b, a, fs);
+        break;
+    case SF_DMUL:
+        r = float64_mul(a, b, fs);
+        break;
+    default:
+        r = float64_div(a, b, fs);
+        break;
+    }
+
+    /* the guest routine decides on the default NaN */
+    if (float64_is_any_nan(r)) {
+        return false;
+    }
+
+    *ret = float64_val(r);
+    return true;
+}
+
+static bool sf_binop32(SoftFloatFunc func, float32 a, float32 b, uint64_t *ret,
+                       float_status *fs)
+{
+    float32 r;
+
+    if (float32_is_any_nan(a) || float32_is_any_nan(b)) {
+        return false;
+    }
+
+    switch (func) {
+    case SF_FADD:
+        r = float32_add(a, b, fs);
+        break;
+    case SF_FSUB:
+        r = float32_sub(a, b, fs);
+        break;
+    case SF_FRSUB:
+        r = float32_sub(b, a, fs);
+        break;
+    case SF_FMUL:
+        r = float32_mul(a, b, fs);
+        break;
+    default:
+        r = float32_div(a, b, fs);
+        break;
+    }
+
+    if (float32_is_any_nan(r)) {
+        return false;
+    }
+
+    *ret = float32_val(r);
+    return true;
+}
+
+bool arm_softfloat_eval(SoftFloatFunc func, uint64_t a, uint64_t b, uint64_t *ret)
+{
+    float_status fs = { .float_rounding_mode = float_round_nearest_even };
+    float64 d = make_float64(a);
+    float32 f = make_float32(a);
+
+    switch (func) {
+    case SF_DADD ... SF_DDIV:
+        return sf_binop64(func, d, make_float64(b), ret, &fs);
+
+    case SF_FADD ... SF_FDIV:
+        return sf_binop32(func, f, make_float32(b), ret, &fs);
+
+    /* comparisons are false for unordered operands */
+    case SF_DCMPEQ:
+        *ret = float64_eq_quiet(d, make_float64(b), &fs);
+        return true;
+    case SF_DCMPLT:
+        *ret = float64_lt_quiet(d, make_float64(b), &fs);
+        return true;
+    case SF_DCMPLE:
+        *ret = float64_le_quiet(d, make_float64(b), &fs);
+        return true;
+    case SF_DCMPGE:
+        *ret = float64_le_quiet(make_float64(b), d, &fs);
+        return true;
+    case SF_DCMPGT:
+        *ret = float64_lt_quiet(make_float64(b), d, &fs);
+        return true;
+    case SF_DCMPUN:
+        *ret = float64_unordered_quiet(d, make_float64(b), &fs);
+        return true;
+
+    case SF_FCMPEQ:
+        *ret = float32_eq_quiet(f, make_float32(b), &fs);
+        return true;
+    case SF_FCMPLT:
+        *ret = float32_lt_quiet(f, make_float32(b), &fs);
+        return true;
+    case SF_FCMPLE:
+        *ret = float32_le_quiet(f, make_float32(b), &fs);
+        return true;
+    case SF_FCMPGE:
+        *ret = float32_le_quiet(make_float32(b), f, &fs);
+        return true;
+    case SF_FCMPGT:
+        *ret = float32_lt_quiet(make_float32(b), f, &fs);
+        return true;
+    case SF_FCMPUN:
+        *ret = float32_unordered_quiet(f, make_float32(b), &fs);
+        return true;
+
+    case SF_I2D:
+        *ret = float64_val(int32_to_float64(a, &fs));
+        return true;
+    case SF_UI2D:
+        *ret = float64_val(uint32_to_float64(a, &fs));
+        return true;
+    case SF_L2D:
+        *ret = float64_val(int64_to_float64(a, &fs));
+        return true;
+    case SF_UL2D:
+        *ret = float64_val(uint64_to_float64(a, &fs));
+        return true;
+    case SF_I2F:
+        *ret = float32_val(int32_to_float32(a, &fs));
+        return true;
+    case SF_UI2F:
+        *ret = float32_val(uint32_to_float32(a, &fs));
+        return true;
+    case SF_L2F:
+        *ret = float32_val(int64_to_float32(a, &fs));
+        return true;
+    case SF_UL2F:
+        *ret = float32_val(uint64_to_float32(a, &fs));
+        return true;
+
+    /* 32 bit conversions saturate as the guest routines */
+    case SF_D2IZ:
+        if (float64_is_any_nan(d)) {
+            return false;
+        }
+        *ret = (uint32_t)float64_to_int32_round_to_zero(d, &fs);
+        return true;
+    case SF_D2UIZ:
+        if (float64_is_any_nan(d)) {
+            return false;
+        }
+        *ret = float64_to_uint32_round_to_zero(d, &fs);
+        return true;
+    case SF_F2IZ:
+        if (float32_is_any_nan(f)) {
+            return false;
+        }
+        *ret = (uint32_t)float32_to_int32_round_to_zero(f, &fs);
+        return true;
+    case SF_F2UIZ:
+        if (float32_is_any_nan(f)) {
+            return false;
+        }
+        *ret = float32_to_uint32_round_to_zero(f, &fs);
+        return true;
+
+    /* 64 bit conversions are implemented in C, only intercept the range */
+    case SF_D2LZ:
+        if (!float64_lt_quiet(float64_abs(d), SF_FLOAT64_2P63, &fs)) {
+            return false;
+        }
+        *ret = float64_to_int64_round_to_zero(d, &fs);
+        return true;
+    case SF_D2ULZ:
+        if (!float64_le_quiet(float64_zero, d, &fs)
+                || !float64_lt_quiet(d, SF_FLOAT64_2P64, &fs)) {
+            return false;
+        }
+        *ret = float64_to_uint64_round_to_zero(d, &fs);
+        return true;
+
+    case SF_F2D:
+        if (float32_is_any_nan(f)) {
+            return false;
+        }
+        *ret = float64_val(float32_to_float64(f, &fs));
+        return true;
+    case SF_D2F:
+        if (float64_is_any_nan(d)) {
+            return false;
+        }
+        *ret = float32_val(float64_to_float32(d, &fs));
+        return true;
+
+    /* sqrt() sets errno for negative arguments */
+    case SF_SQRT:
+        if (float64_is_any_nan(d) || (float64_is_neg(d) && !float64_is_zero(d))) {
+            return false;
+        }
+        *ret = float64_val(float64_sqrt(d, &fs));
+        return true;
+    case SF_SQRTF:
+        if (float32_is_any_nan(f) || (float32_is_neg(f) && !float32_is_zero(f))) {
+            return false;
+        }
+        *ret = float32_val(float32_sqrt(f, &fs));
+        return true;
+
+    default:
+        g_assert_not_reached();
+    }
+}
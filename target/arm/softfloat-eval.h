@@ -0,0 +1,71 @@
+/*
+ * ARM soft-float library call intercept: evaluation of the routines.
+ *
+ * Computes the results of the soft-float routines of the compiler runtime
+ * and the C library from their arguments with fpu/softfloat, as used by
+ * softfloat-intercept.c. Kept independent of the CPU state, so that it can
+ * be tested against a reference implementation (see tests/fp/fp-intercept.c).
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#ifndef TARGET_ARM_SOFTFLOAT_EVAL_H
+#define TARGET_ARM_SOFTFLOAT_EVAL_H
+
+typedef enum {
+    SF_DADD,
+    SF_DSUB,
+    SF_DRSUB,
+    SF_DMUL,
+    SF_DDIV,
+    SF_FADD,
+    SF_FSUB,
+    SF_FRSUB,
+    SF_FMUL,
+    SF_FDIV,
+    SF_DCMPEQ,
+    SF_DCMPLT,
+    SF_DCMPLE,
+    SF_DCMPGE,
+    SF_DCMPGT,
+    SF_DCMPUN,
+    SF_FCMPEQ,
+    SF_FCMPLT,
+    SF_FCMPLE,
+    SF_FCMPGE,
+    SF_FCMPGT,
+    SF_FCMPUN,
+    SF_I2D,
+    SF_UI2D,
+    SF_L2D,
+    SF_UL2D,
+    SF_D2IZ,
+    SF_D2UIZ,
+    SF_D2LZ,
+    SF_D2ULZ,
+    SF_I2F,
+    SF_UI2F,
+    SF_L2F,
+    SF_UL2F,
+    SF_F2IZ,
+    SF_F2UIZ,
+    SF_F2D,
+    SF_D2F,
+    SF_SQRT,
+    SF_SQRTF,
+    __SF_NUM_FUNCS,
+} SoftFloatFunc;
+
+/*
+ * Compute the result of the given routine from its first and second argument
+ * (the second one only for routines taking two arguments), each either a 32
+ * or 64 bit value depending on the routine. Returns false if the result is
+ * not fully defined by IEEE 754 in round-to-nearest-even mode, in which case
+ * the call has to be passed to the guest routine.
+ */
+bool arm_softfloat_eval(SoftFloatFunc func, uint64_t a, uint64_t b, uint64_t *ret);
+
+#endif /* TARGET_ARM_SOFTFLOAT_EVAL_H */
@@ -0,0 +1,321 @@
+/*
+ * ARM soft-float library call intercept.
+ *
+ * CPUs without FPU (e.g. the ARM926EJ-S) rely on the soft-float routines of
+ * the compiler runtime (libgcc, i.e. the AEABI helpers __aeabi_dadd etc.) and
+ * the C library (sqrt) for all floating point arithmetic. Each call executes
+ * tens to hundreds of integer instructions. Instead, calls to these routines
+ * can be intercepted at their entry address (see arm_softfloat_intercept()):
+ * the result is computed with fpu/softfloat, written to r0 (and r1) as by
+ * the routine, and the routine is left via its return address (bx lr).
+ *
+ * Results are only computed for operations with a result fully defined by
+ * IEEE 754 in round-to-nearest-even mode, which the guest routines implement.
+ * Calls with NaN operands or results, out-of-range conversions to 64 bit
+ * integers, and square roots of negative numbers (which set errno) are
+ * passed on to the guest routine. Transcendental functions (sin, cos, ...)
+ * are not correctly rounded by the guest library and are never intercepted.
+ *
+ * In verify mode (see arm_softfloat_enable_verify()), the guest routine is
+ * always executed and its result is compared against the intercepted one.
+ * For this, the return address is replaced with the entry address of the
+ * routine, so that its return is detected by the intercept as well.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bitops.h"
+#include "qemu/error-report.h"
+#include "qemu/notify.h"
+#include "sysemu/sysemu.h"
+#include "cpu.h"
+#include "exec/helper-proto.h"
+#include "internals.h"
+#include "softfloat-eval.h"
+
+
+/*
+ * AEABI name and the equivalent libgcc/libc name of each routine, whether
+ * its arguments are 64 bit values in r0 and r1 (and r2 and r3), and whether
+ * it returns a 64 bit value in r0 and r1.
+ */
+static const struct {
+    const char *name;
+    const char *alias;
+    bool arg64;
+    bool ret64;
+} sf_funcs[] = {
+    [SF_DADD]   = { "__aeabi_dadd",   "__adddf3",      true,  true  },
+    [SF_DSUB]   = { "__aeabi_dsub",   "__subdf3",      true,  true  },
+    [SF_DRSUB]  = { "__aeabi_drsub",  NULL,            true,  true  },
+    [SF_DMUL]   = { "__aeabi_dmul",   "__muldf3",      true,  true  },
+    [SF_DDIV]   = { "__aeabi_ddiv",   "__divdf3",      true,  true  },
+    [SF_FADD]   = { "__aeabi_fadd",   "__addsf3",      false, false },
+    [SF_FSUB]   = { "__aeabi_fsub",   "__subsf3",      false, false },
+    [SF_FRSUB]  = { "__aeabi_frsub",  NULL,            false, false },
+    [SF_FMUL]   = { "__aeabi_fmul",   "__mulsf3",      false, false },
+    [SF_FDIV]   = { "__aeabi_fdiv",   "__divsf3",      false, false },
+    [SF_DCMPEQ] = { "__aeabi_dcmpeq", NULL,            true,  false },
+    [SF_DCMPLT] = { "__aeabi_dcmplt", NULL,            true,  false },
+    [SF_DCMPLE] = { "__aeabi_dcmple", NULL,            true,  false },
+    [SF_DCMPGE] = { "__aeabi_dcmpge", NULL,            true,  false },
+    [SF_DCMPGT] = { "__aeabi_dcmpgt", NULL,            true,  false },
+    [SF_DCMPUN] = { "__aeabi_dcmpun", "__unorddf2",    true,  false },
+    [SF_FCMPEQ] = { "__aeabi_fcmpeq", NULL,            false, false },
+    [SF_FCMPLT] = { "__aeabi_fcmplt", NULL,            false, false },
+    [SF_FCMPLE] = { "__aeabi_fcmple", NULL,            false, false },
+    [SF_FCMPGE] = { "__aeabi_fcmpge", NULL,            false, false },
+    [SF_FCMPGT] = { "__aeabi_fcmpgt", NULL,            false, false },
+    [SF_FCMPUN] = { "__aeabi_fcmpun", "__unordsf2",    false, false },
+    [SF_I2D]    = { "__aeabi_i2d",    "__floatsidf",   false, true  },
+    [SF_UI2D]   = { "__aeabi_ui2d",   "__floatunsidf", false, true  },
+    [SF_L2D]    = { "__aeabi_l2d",    "__floatdidf",   true,  true  },
+    [SF_UL2D]   = { "__aeabi_ul2d",   "__floatundidf", true,  true  },
+    [SF_D2IZ]   = { "__aeabi_d2iz",   "__fixdfsi",     true,  false },
+    [SF_D2UIZ]  = { "__aeabi_d2uiz",  "__fixunsdfsi",  true,  false },
+    [SF_D2LZ]   = { "__aeabi_d2lz",   "__fixdfdi",     true,  true  },
+    [SF_D2ULZ]  = { "__aeabi_d2ulz",  "__fixunsdfdi",  true,  true  },
+    [SF_I2F]    = { "__aeabi_i2f",    "__floatsisf",   false, false },
+    [SF_UI2F]   = { "__aeabi_ui2f",   "__floatunsisf", false, false },
+    [SF_L2F]    = { "__aeabi_l2f",    "__floatdisf",   true,  false },
+    [SF_UL2F]   = { "__aeabi_ul2f",   "__floatundisf", true,  false },
+    [SF_F2IZ]   = { "__aeabi_f2iz",   "__fixsfsi",     false, false },
+    [SF_F2UIZ]  = { "__aeabi_f2uiz",  "__fixunssfsi",  false, false },
+    [SF_F2D]    = { "__aeabi_f2d",    "__extendsfdf2", false, true  },
+    [SF_D2F]    = { "__aeabi_d2f",    "__truncdfsf2",  true,  false },
+    [SF_SQRT]   = { "sqrt",           NULL,            true,  true  },
+    [SF_SQRTF]  = { "sqrtf",          NULL,            false, false },
+};
+
+/* A call in verify mode, waiting for the return of the guest routine */
+typedef struct {
+    uint32_t func;
+    uint32_t entry;
+    uint32_t sp;
+    uint32_t lr;
+    uint32_t args[4];
+    uint64_t ret;
+} SoftFloatCall;
+
+/* Limit for calls which never return, e.g. due to a task being deleted */
+#define SF_MAX_PENDING      64
+
+/* verify mode statistics, reported at exit */
+static uint64_t sf_verified;
+static uint64_t sf_mismatches;
+static Notifier sf_exit;
+
+
+static uint64_t sf_arg64(CPUARMState *env, int reg)
+{
+    /* 64 bit arguments are passed in memory order */
+    if (arm_cpu_data_is_big_endian(env)) {
+        return deposit64(env->regs[reg + 1], 32, 32, env->regs[reg]);
+    }
+
+    return deposit64(env->regs[reg], 32, 32, env->regs[reg + 1]);
+}
+
+static void sf_set_ret(CPUARMState *env, uint32_t func, uint64_t ret)
+{
+    if (!sf_funcs[func].ret64) {
+        env->regs[0] = ret;
+    } else if (arm_cpu_data_is_big_endian(env)) {
+        env->regs[0] = ret >> 32;
+        env->regs[1] = ret;
+    } else {
+        env->regs[0] = ret;
+        env->regs[1] = ret >> 32;
+    }
+}
+
+static uint64_t sf_get_ret(CPUARMState *env, uint32_t func)
+{
+    return sf_funcs[func].ret64 ? sf_arg64(env, 0) : env->regs[0];
+}
+
+static void sf_return(CPUARMState *env, uint32_t lr)
+{
+    /* as bx lr */
+    env->thumb = lr & 1;
+    env->regs[15] = lr & ~1;
+}
+
+/*
+ * Compute the result of the given routine from the current argument
+ * registers. Returns false if the call has to be passed to the guest
+ * routine.
+ */
+static bool sf_eval(CPUARMState *env, uint32_t func, uint64_t *ret)
+{
+    uint64_t a, b;
+
+    if (sf_funcs[func].arg64) {
+        a = sf_arg64(env, 0);
+        b = sf_arg64(env, 2);
+    } else {
+        a = env->regs[0];
+        b = env->regs[1];
+    }
+
+    return arm_softfloat_eval(func, a, b, ret);
+}
+
+static void sf_verify_check(CPUARMState *env, SoftFloatCall *call)
+{
+    uint64_t ret = sf_get_ret(env, call->func);
+
+    sf_verified++;
+
+    if (ret == call->ret) {
+        return;
+    }
+
+    sf_mismatches++;
+    error_report("arm: soft-float mismatch: %s(0x%08x, 0x%08x, 0x%08x, 0x%08x) "
+                 "returned 0x%" PRIx64 ", intercept computed 0x%" PRIx64,
+                 sf_funcs[call->func].name, call->args[0], call->args[1],
+                 call->args[2], call->args[3], ret, call->ret);
+}
+
+static uint32_t sf_verify(ARMCPU *cpu, uint32_t func, uint32_t pc)
+{
+    CPUARMState *env = &cpu->env;
+    GArray *pending = cpu->softfloat_pending;
+    uint32_t entry = pc | env->thumb;
+    SoftFloatCall call;
+    int i;
+
+    /*
+     * Returned to the entry: the stack pointer is the same as on the call,
+     * and differs from all other calls pending in other tasks or handlers.
+     * A call left behind (e.g. by longjmp or a deleted task) may match a
+     * later call at the same stack pointer. The guest routine never sees
+     * the original return address, so a call with that link register is a
+     * new call from the same call site, and the pending one is dropped.
+     */
+    for (i = pending->len - 1; i >= 0; i--) {
+        SoftFloatCall *c = &g_array_index(pending, SoftFloatCall, i);
+
+        if (c->entry != entry || c->sp != env->regs[13]) {
+            continue;
+        }
+
+        if (c->lr == env->regs[14]) {
+            g_array_remove_index(pending, i);
+        } else {
+            sf_verify_check(env, c);
+
+            env->regs[14] = c->lr;
+            sf_return(env, c->lr);
+            g_array_remove_index(pending, i);
+            return 1;
+        }
+    }
+
+    if (!sf_eval(env, func, &call.ret)) {
+        return 0;
+    }
+
+    call.func = func;
+    call.entry = entry;
+    call.sp = env->regs[13];
+    call.lr = env->regs[14];
+    memcpy(call.args, env->regs, sizeof(call.args));
+
+    if (pending->len == SF_MAX_PENDING) {
+        g_array_remove_index(pending, 0);
+    }
+    g_array_append_val(pending, call);
+
+    /* run the guest routine, returning to its entry */
+    env->regs[14] = entry;
+    return 0;
+}
+
+uint32_t HELPER(softfloat_call)(CPUARMState *env, uint32_t func, uint32_t pc)
+{
+    ARMCPU *cpu = env_archcpu(env);
+    uint64_t ret;
+
+    if (cpu->softfloat_pending) {
+        return sf_verify(cpu, func, pc);
+    }
+
+    if (!sf_eval(env, func, &ret)) {
+        return 0;
+    }
+
+    sf_set_ret(env, func, ret);
+    sf_return(env, env->regs[14]);
+    return 1;
+}
+
+int arm_softfloat_func(ARMCPU *cpu, vaddr pc)
+{
+    gpointer func;
+
+    if (!cpu->softfloat_funcs
+            || !g_hash_table_lookup_extended(cpu->softfloat_funcs,
+                                             GUINT_TO_POINTER(pc), NULL, &func)) {
+        return -1;
+    }
+
+    return GPOINTER_TO_INT(func);
+}
+
+bool arm_softfloat_intercept(ARMCPU *cpu, const char *name, vaddr pc)
+{
+    int func;
+
+    for (func = 0; func < __SF_NUM_FUNCS; func++) {
+        if (!strcmp(name, sf_funcs[func].name)
+                || (sf_funcs[func].alias && !strcmp(name, sf_funcs[func].alias))) {
+            break;
+        }
+    }
+
+    if (func == __SF_NUM_FUNCS) {
+        return false;
+    }
+
+    /* the Thumb bit of function symbols is not part of the address */
+    pc &= ~1;
+
+    if (!cpu->softfloat_funcs) {
+        cpu->softfloat_funcs = g_hash_table_new(NULL, NULL);
+    }
+
+    /* aliases usually share the same address */
+    if (arm_softfloat_func(cpu, pc) < 0) {
+        g_hash_table_insert(cpu->softfloat_funcs, GUINT_TO_POINTER(pc),
+                            GINT_TO_POINTER(func));
+        cpu_breakpoint_insert(CPU(cpu), pc, BP_SOFTFLOAT, NULL);
+    }
+
+    return true;
+}
+
+static void sf_verify_report(Notifier *n, void *data)
+{
+    info_report("arm: verified %" PRIu64 " soft-float calls, %" PRIu64
+                " mismatches", sf_verified, sf_mismatches);
+}
+
+void arm_softfloat_enable_verify(ARMCPU *cpu)
+{
+    if (cpu->softfloat_pending) {
+        return;
+    }
+
+    cpu->softfloat_pending = g_array_new(false, false, sizeof(SoftFloatCall));
+
+    if (!sf_exit.notify) {
+        sf_exit.notify = sf_verify_report;
+        qemu_add_exit_notifier(&sf_exit);
+    }
+}
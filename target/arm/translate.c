@@ -11172,11 +11172,49 @@ static void arm_tr_insn_start(DisasContextBase *dcbase, CPUState *cpu)
     dc->insn_start = tcg_last_op();
 }
 
+#ifndef CONFIG_USER_ONLY
+/*
+ * Call of an intercepted soft-float routine (see softfloat-intercept.c).
+ * If the helper has computed the result, it has also set the PC to the
+ * return address, so continue there.
+ */
+static void gen_softfloat_call(DisasContext *dc, int func)
+{
+    TCGLabel *label = gen_new_label();
+    TCGv_i32 tmp = tcg_temp_new_i32();
+    TCGv_i32 tmp_func = tcg_const_i32(func);
+    TCGv_i32 tmp_pc = tcg_const_i32(dc->base.pc_next);
+
+    gen_helper_softfloat_call(tmp, cpu_env, tmp_func, tmp_pc);
+    tcg_temp_free_i32(tmp_func);
+    tcg_temp_free_i32(tmp_pc);
+
+    tcg_gen_brcondi_i32(TCG_COND_EQ, tmp, 0, label);
+    tcg_temp_free_i32(tmp);
+    tcg_gen_lookup_and_goto_ptr();
+    gen_set_label(label);
+}
+#endif
+
 static bool arm_tr_breakpoint_check(DisasContextBase *dcbase, CPUState *cpu,
                                     const CPUBreakpoint *bp)
 {
     DisasContext *dc = container_of(dcbase, DisasContext, base);
 
+    if (bp->flags & BP_IDLE) {
+        /* translate the instruction normally after the idle check */
+        gen_helper_idle(cpu_env);
+        return false;
+    }
+
+#ifndef CONFIG_USER_ONLY
+    if (bp->flags & BP_SOFTFLOAT) {
+        /* translate the routine normally if the call is not intercepted */
+        gen_softfloat_call(dc, arm_softfloat_func(ARM_CPU(cpu), bp->pc));
+        return false;
+    }
+#endif
+
     if (bp->flags & BP_CPU) {
         gen_set_condexec(dc);
         gen_set_pc_im(dc, dc->base.pc_next);
@@ -11184,6 +11222,7 @@ static bool arm_tr_breakpoint_check(DisasContextBase *dcbase, CPUState *cpu,
         /* End the TB early; it's likely not going to be executed */
         dc->base.is_jmp = DISAS_TOO_MANY;
     } else {
+        /* BP_GDB or BP_MACHINE, stopping the VM */
         gen_exception_internal_insn(dc, dc->base.pc_next, EXCP_DEBUG);
         /* The address covered by the breakpoint must be
            included in [tb->pc, tb->pc + tb->size) in order
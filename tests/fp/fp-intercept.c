@@ -0,0 +1,426 @@
+/*
+ * Differential test of the ARM soft-float library call intercept.
+ *
+ * Evaluates each intercepted routine (see target/arm/softfloat-eval.h) on
+ * edge operands, i.e. signed zeros, denormals, the limits of the normal
+ * range, infinities, quiet and signaling NaNs, and the limits of the integer
+ * conversions, and compares the results against Berkeley SoftFloat as the
+ * reference for the IEEE 754 results the guest routines compute. Also checks
+ * that the intercept passes exactly those calls to the guest routine which it
+ * is documented to pass (NaN operands or results, square roots of negative
+ * numbers, out-of-range conversions to 64 bit integers).
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "platform.h"
+#include "softfloat.h"
+#include "target/arm/softfloat-eval.h"
+
+
+typedef enum {
+    ARG_NONE,
+    ARG_F32,
+    ARG_F64,
+    ARG_I32,
+    ARG_I64,
+} ArgType;
+
+static const struct {
+    SoftFloatFunc func;
+    const char *name;
+    ArgType a;
+    ArgType b;
+} funcs[] = {
+    { SF_DADD,   "dadd",   ARG_F64, ARG_F64  },
+    { SF_DSUB,   "dsub",   ARG_F64, ARG_F64  },
+    { SF_DRSUB,  "drsub",  ARG_F64, ARG_F64  },
+    { SF_DMUL,   "dmul",   ARG_F64, ARG_F64  },
+    { SF_DDIV,   "ddiv",   ARG_F64, ARG_F64  },
+    { SF_FADD,   "fadd",   ARG_F32, ARG_F32  },
+    { SF_FSUB,   "fsub",   ARG_F32, ARG_F32  },
+    { SF_FRSUB,  "frsub",  ARG_F32, ARG_F32  },
+    { SF_FMUL,   "fmul",   ARG_F32, ARG_F32  },
+    { SF_FDIV,   "fdiv",   ARG_F32, ARG_F32  },
+    { SF_DCMPEQ, "dcmpeq", ARG_F64, ARG_F64  },
+    { SF_DCMPLT, "dcmplt", ARG_F64, ARG_F64  },
+    { SF_DCMPLE, "dcmple", ARG_F64, ARG_F64  },
+    { SF_DCMPGE, "dcmpge", ARG_F64, ARG_F64  },
+    { SF_DCMPGT, "dcmpgt", ARG_F64, ARG_F64  },
+    { SF_DCMPUN, "dcmpun", ARG_F64, ARG_F64  },
+    { SF_FCMPEQ, "fcmpeq", ARG_F32, ARG_F32  },
+    { SF_FCMPLT, "fcmplt", ARG_F32, ARG_F32  },
+    { SF_FCMPLE, "fcmple", ARG_F32, ARG_F32  },
+    { SF_FCMPGE, "fcmpge", ARG_F32, ARG_F32  },
+    { SF_FCMPGT, "fcmpgt", ARG_F32, ARG_F32  },
+    { SF_FCMPUN, "fcmpun", ARG_F32, ARG_F32  },
+    { SF_I2D,    "i2d",    ARG_I32, ARG_NONE },
+    { SF_UI2D,   "ui2d",   ARG_I32, ARG_NONE },
+    { SF_L2D,    "l2d",    ARG_I64, ARG_NONE },
+    { SF_UL2D,   "ul2d",   ARG_I64, ARG_NONE },
+    { SF_D2IZ,   "d2iz",   ARG_F64, ARG_NONE },
+    { SF_D2UIZ,  "d2uiz",  ARG_F64, ARG_NONE },
+    { SF_D2LZ,   "d2lz",   ARG_F64, ARG_NONE },
+    { SF_D2ULZ,  "d2ulz",  ARG_F64, ARG_NONE },
+    { SF_I2F,    "i2f",    ARG_I32, ARG_NONE },
+    { SF_UI2F,   "ui2f",   ARG_I32, ARG_NONE },
+    { SF_L2F,    "l2f",    ARG_I64, ARG_NONE },
+    { SF_UL2F,   "ul2f",   ARG_I64, ARG_NONE },
+    { SF_F2IZ,   "f2iz",   ARG_F32, ARG_NONE },
+    { SF_F2UIZ,  "f2uiz",  ARG_F32, ARG_NONE },
+    { SF_F2D,    "f2d",    ARG_F32, ARG_NONE },
+    { SF_D2F,    "d2f",    ARG_F64, ARG_NONE },
+    { SF_SQRT,   "sqrt",   ARG_F64, ARG_NONE },
+    { SF_SQRTF,  "sqrtf",  ARG_F32, ARG_NONE },
+};
+
+static const uint64_t edge_f64[] = {
+    0x0000000000000000ULL,  // +0
+    0x8000000000000000ULL,  // -0
+    0x0000000000000001ULL,  // smallest denormal
+    0x800fffffffffffffULL,  // largest negative denormal
+    0x0010000000000000ULL,  // smallest normal
+    0x3fe0000000000000ULL,  // 0.5
+    0xbfe0000000000000ULL,  // -0.5
+    0x3ff0000000000000ULL,  // 1
+    0x3ff0000000000001ULL,  // 1 + ulp
+    0xbff0000000000000ULL,  // -1
+    0x3ff8000000000000ULL,  // 1.5
+    0x3fd5555555555555ULL,  // 1/3
+    0x41dfffffffc00000ULL,  // 2^31 - 1
+    0x41e0000000000000ULL,  // 2^31
+    0xc1e0000000000000ULL,  // -2^31
+    0x41f0000000000000ULL,  // 2^32
+    0x43e0000000000000ULL,  // 2^63
+    0xc3e0000000000000ULL,  // -2^63
+    0x43efffffffffffffULL,  // largest below 2^64
+    0x43f0000000000000ULL,  // 2^64
+    0x47efffffe0000000ULL,  // largest float
+    0x47efffffffffffffULL,  // overflows float
+    0x7fefffffffffffffULL,  // largest normal
+    0xffefffffffffffffULL,  // -largest normal
+    0x7ff0000000000000ULL,  // +inf
+    0xfff0000000000000ULL,  // -inf
+    0x7ff8000000000000ULL,  // quiet NaN
+    0xfff8000000000001ULL,  // negative quiet NaN
+    0x7ff0000000000001ULL,  // signaling NaN
+};
+
+static const uint64_t edge_f32[] = {
+    0x00000000,             // +0
+    0x80000000,             // -0
+    0x00000001,             // smallest denormal
+    0x807fffff,             // largest negative denormal
+    0x00800000,             // smallest normal
+    0x3f000000,             // 0.5
+    0xbf000000,             // -0.5
+    0x3f800000,             // 1
+    0x3f800001,             // 1 + ulp
+    0xbf800000,             // -1
+    0x3fc00000,             // 1.5
+    0x3eaaaaab,             // 1/3
+    0x4f000000,             // 2^31
+    0xcf000000,             // -2^31
+    0x4f800000,             // 2^32
+    0x7f7fffff,             // largest normal
+    0xff7fffff,             // -largest normal
+    0x7f800000,             // +inf
+    0xff800000,             // -inf
+    0x7fc00000,             // quiet NaN
+    0xffc00001,             // negative quiet NaN
+    0x7f800001,             // signaling NaN
+};
+
+static const uint64_t edge_int[] = {
+    0x0000000000000000ULL,
+    0x0000000000000001ULL,
+    0x0000000000ffffffULL,  // largest exact float
+    0x0000000001000001ULL,  // rounds as float
+    0x000000007fffffffULL,
+    0x0000000080000000ULL,
+    0x00000000ffffffffULL,
+    0x0020000000000001ULL,  // rounds as double
+    0x7fffffffffffffffULL,
+    0x8000000000000000ULL,
+    0x8000000000000001ULL,
+    0xffffffffffffffffULL,
+};
+
+
+static bool is_nan64(uint64_t a)
+{
+    return (a & 0x7fffffffffffffffULL) > 0x7ff0000000000000ULL;
+}
+
+static bool is_nan32(uint64_t a)
+{
+    return (a & 0x7fffffff) > 0x7f800000;
+}
+
+static float64_t f64(uint64_t a)
+{
+    return (float64_t){ .v = a };
+}
+
+static float32_t f32(uint64_t a)
+{
+    return (float32_t){ .v = a };
+}
+
+/* Conversions to 32 bit integers saturate, as the guest routines */
+static uint64_t ref_to_i32(int_fast32_t r, bool neg)
+{
+    if (softfloat_exceptionFlags & softfloat_flag_invalid) {
+        return neg ? 0x80000000 : 0x7fffffff;
+    }
+    return (uint32_t)r;
+}
+
+static uint64_t ref_to_ui32(uint_fast32_t r, bool neg)
+{
+    if (softfloat_exceptionFlags & softfloat_flag_invalid) {
+        return neg ? 0 : 0xffffffff;
+    }
+    return (uint32_t)r;
+}
+
+/*
+ * Compute the reference result. Returns false if the intercept is expected to
+ * pass the call to the guest routine.
+ */
+static bool ref_eval(SoftFloatFunc func, uint64_t a, uint64_t b, uint64_t *ret)
+{
+    bool neg64 = a >> 63;
+    bool neg32 = (a >> 31) & 1;
+
+    softfloat_roundingMode = softfloat_round_near_even;
+    softfloat_exceptionFlags = 0;
+
+    switch (func) {
+    case SF_DADD ... SF_DDIV:
+        if (is_nan64(a) || is_nan64(b)) {
+            return false;
+        }
+        switch (func) {
+        case SF_DADD:
+            *ret = f64_add(f64(a), f64(b)).v;
+            break;
+        case SF_DSUB:
+            *ret = f64_sub(f64(a), f64(b)).v;
+            break;
+        case SF_DRSUB:
+            *ret = f64_sub(f64(b), f64(a)).v;
+            break;
+        case SF_DMUL:
+            *ret = f64_mul(f64(a), f64(b)).v;
+            break;
+        default:
+            *ret = f64_div(f64(a), f64(b)).v;
+            break;
+        }
+        return !is_nan64(*ret);
+
+    case SF_FADD ... SF_FDIV:
+        if (is_nan32(a) || is_nan32(b)) {
+            return false;
+        }
+        switch (func) {
+        case SF_FADD:
+            *ret = f32_add(f32(a), f32(b)).v;
+            break;
+        case SF_FSUB:
+            *ret = f32_sub(f32(a), f32(b)).v;
+            break;
+        case SF_FRSUB:
+            *ret = f32_sub(f32(b), f32(a)).v;
+            break;
+        case SF_FMUL:
+            *ret = f32_mul(f32(a), f32(b)).v;
+            break;
+        default:
+            *ret = f32_div(f32(a), f32(b)).v;
+            break;
+        }
+        return !is_nan32(*ret);
+
+    case SF_DCMPEQ:
+        *ret = f64_eq(f64(a), f64(b));
+        return true;
+    case SF_DCMPLT:
+        *ret = f64_lt_quiet(f64(a), f64(b));
+        return true;
+    case SF_DCMPLE:
+        *ret = f64_le_quiet(f64(a), f64(b));
+        return true;
+    case SF_DCMPGE:
+        *ret = f64_le_quiet(f64(b), f64(a));
+        return true;
+    case SF_DCMPGT:
+        *ret = f64_lt_quiet(f64(b), f64(a));
+        return true;
+    case SF_DCMPUN:
+        *ret = is_nan64(a) || is_nan64(b);
+        return true;
+
+    case SF_FCMPEQ:
+        *ret = f32_eq(f32(a), f32(b));
+        return true;
+    case SF_FCMPLT:
+        *ret = f32_lt_quiet(f32(a), f32(b));
+        return true;
+    case SF_FCMPLE:
+        *ret = f32_le_quiet(f32(a), f32(b));
+        return true;
+    case SF_FCMPGE:
+        *ret = f32_le_quiet(f32(b), f32(a));
+        return true;
+    case SF_FCMPGT:
+        *ret = f32_lt_quiet(f32(b), f32(a));
+        return true;
+    case SF_FCMPUN:
+        *ret = is_nan32(a) || is_nan32(b);
+        return true;
+
+    case SF_I2D:
+        *ret = i32_to_f64(a).v;
+        return true;
+    case SF_UI2D:
+        *ret = ui32_to_f64(a).v;
+        return true;
+    case SF_L2D:
+        *ret = i64_to_f64(a).v;
+        return true;
+    case SF_UL2D:
+        *ret = ui64_to_f64(a).v;
+        return true;
+    case SF_I2F:
+        *ret = i32_to_f32(a).v;
+        return true;
+    case SF_UI2F:
+        *ret = ui32_to_f32(a).v;
+        return true;
+    case SF_L2F:
+        *ret = i64_to_f32(a).v;
+        return true;
+    case SF_UL2F:
+        *ret = ui64_to_f32(a).v;
+        return true;
+
+    case SF_D2IZ:
+        *ret = ref_to_i32(f64_to_i32_r_minMag(f64(a), false), neg64);
+        return !is_nan64(a);
+    case SF_D2UIZ:
+        *ret = ref_to_ui32(f64_to_ui32_r_minMag(f64(a), false), neg64);
+        return !is_nan64(a);
+    case SF_F2IZ:
+        *ret = ref_to_i32(f32_to_i32_r_minMag(f32(a), false), neg32);
+        return !is_nan32(a);
+    case SF_F2UIZ:
+        *ret = ref_to_ui32(f32_to_ui32_r_minMag(f32(a), false), neg32);
+        return !is_nan32(a);
+
+    /* only the range of the target type, i.e. |a| < 2^63 and 0 <= a < 2^64 */
+    case SF_D2LZ:
+        *ret = f64_to_i64_r_minMag(f64(a), false);
+        return f64_lt_quiet(f64(a & ~(1ULL << 63)), f64(0x43e0000000000000ULL));
+    case SF_D2ULZ:
+        *ret = f64_to_ui64_r_minMag(f64(a), false);
+        return f64_le_quiet(f64(0), f64(a))
+               && f64_lt_quiet(f64(a), f64(0x43f0000000000000ULL));
+
+    case SF_F2D:
+        *ret = f32_to_f64(f32(a)).v;
+        return !is_nan32(a);
+    case SF_D2F:
+        *ret = f64_to_f32(f64(a)).v;
+        return !is_nan64(a);
+
+    case SF_SQRT:
+        *ret = f64_sqrt(f64(a)).v;
+        return !is_nan64(*ret) && (!neg64 || !(a << 1));
+    case SF_SQRTF:
+        *ret = f32_sqrt(f32(a)).v;
+        return !is_nan32(*ret) && (!neg32 || !(uint32_t)(a << 1));
+
+    default:
+        g_assert_not_reached();
+    }
+}
+
+static const uint64_t *edge_values(ArgType type, size_t *n)
+{
+    switch (type) {
+    case ARG_F32:
+        *n = ARRAY_SIZE(edge_f32);
+        return edge_f32;
+    case ARG_F64:
+        *n = ARRAY_SIZE(edge_f64);
+        return edge_f64;
+    default:
+        *n = ARRAY_SIZE(edge_int);
+        return edge_int;
+    }
+}
+
+static void test_func(const void *opaque)
+{
+    SoftFloatFunc func = funcs[GPOINTER_TO_INT(opaque)].func;
+    ArgType type_a = funcs[GPOINTER_TO_INT(opaque)].a;
+    ArgType type_b = funcs[GPOINTER_TO_INT(opaque)].b;
+    static const uint64_t none[] = { 0 };
+    const uint64_t *va, *vb;
+    size_t na, nb, i, j;
+
+    va = edge_values(type_a, &na);
+    if (type_b == ARG_NONE) {
+        vb = none;
+        nb = 1;
+    } else {
+        vb = edge_values(type_b, &nb);
+    }
+
+    for (i = 0; i < na; i++) {
+        for (j = 0; j < nb; j++) {
+            uint64_t a = type_a == ARG_I32 ? (uint32_t)va[i] : va[i];
+            uint64_t b = vb[j];
+            uint64_t ret = 0, ref = 0;
+            bool handled, expected;
+
+            handled = arm_softfloat_eval(func, a, b, &ret);
+            expected = ref_eval(func, a, b, &ref);
+
+            if (handled != expected || (handled && ret != ref)) {
+                g_test_message("a=0x%016" PRIx64 " b=0x%016" PRIx64 ": "
+                               "intercept %s 0x%" PRIx64 ", "
+                               "reference %s 0x%" PRIx64,
+                               a, b,
+                               handled ? "returned" : "passed", ret,
+                               expected ? "returned" : "passed", ref);
+            }
+            g_assert_cmpint(handled, ==, expected);
+            if (handled) {
+                g_assert_cmphex(ret, ==, ref);
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int i;
+
+    g_test_init(&argc, &argv, NULL);
+
+    for (i = 0; i < ARRAY_SIZE(funcs); i++) {
+        g_autofree char *path = g_strdup_printf("/fp/intercept/%s",
+                                                funcs[i].name);
+
+        g_test_add_data_func(path, GINT_TO_POINTER(i), test_func);
+    }
+
+    return g_test_run();
+}
@@ -0,0 +1,95 @@
+/*
+ * AFL-style edge coverage of translation blocks.
+ *
+ * Records the transitions between executed blocks into the AFL shared memory
+ * map given by the __AFL_SHM_ID environment variable, or into a local map if
+ * not run by AFL, in which case the number of covered edges is printed at
+ * exit. Intended for use with the iOBC fuzzing harness, which restores the
+ * machine state before each run; the previous location is reset along with
+ * it so that edges do not carry over from one run to the next.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/shm.h>
+#include <glib.h>
+
+#include <qemu-plugin.h>
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+#define MAP_SIZE        (1 << 16)
+
+static uint8_t *map;
+static uintptr_t prev_loc;
+
+static void plugin_exit(qemu_plugin_id_t id, void *p)
+{
+    g_autofree gchar *out = NULL;
+    unsigned edges = 0;
+    unsigned i;
+
+    for (i = 0; i < MAP_SIZE; i++) {
+        if (map[i]) {
+            edges++;
+        }
+    }
+
+    out = g_strdup_printf("edges: %u\n", edges);
+    qemu_plugin_outs(out);
+}
+
+static void vm_restore(qemu_plugin_id_t id)
+{
+    prev_loc = 0;
+}
+
+static void vcpu_tb_exec(unsigned int cpu_index, void *udata)
+{
+    uintptr_t cur_loc = (uintptr_t)udata;
+
+    map[cur_loc ^ prev_loc]++;
+    prev_loc = cur_loc >> 1;
+}
+
+static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+    uint64_t pc = qemu_plugin_tb_vaddr(tb);
+    uintptr_t cur_loc;
+
+    // same location hash as afl-qemu-trace
+    cur_loc = (pc >> 4) ^ (pc << 8);
+    cur_loc &= MAP_SIZE - 1;
+
+    qemu_plugin_register_vcpu_tb_exec_cb(tb, vcpu_tb_exec,
+                                         QEMU_PLUGIN_CB_NO_REGS,
+                                         (void *)cur_loc);
+}
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_install(qemu_plugin_id_t id,
+                                           const qemu_info_t *info,
+                                           int argc, char **argv)
+{
+    const char *shm_id = getenv("__AFL_SHM_ID");
+
+    if (shm_id) {
+        map = shmat(atoi(shm_id), NULL, 0);
+        if (map == (void *)-1) {
+            fprintf(stderr, "aflcov: cannot attach to AFL shared memory\n");
+            return -1;
+        }
+    } else {
+        map = g_malloc0(MAP_SIZE);
+        qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
+    }
+
+    qemu_plugin_register_restore_cb(id, vm_restore);
+    qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
+    return 0;
+}
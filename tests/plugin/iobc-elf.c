@@ -0,0 +1,154 @@
+/*
+ * ELF symbol loading shared by the ISIS iOBC plugins.
+ *
+ * See iobc-elf.h for details.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "iobc-elf.h"
+
+Symbol symbol_unknown = { "[unknown]", 0, 0, 0 };
+
+
+static gint symbol_cmp(gconstpointer a, gconstpointer b)
+{
+    const Symbol *sa = a;
+    const Symbol *sb = b;
+
+    return sa->addr < sb->addr ? -1 : sa->addr > sb->addr;
+}
+
+// call the given function for each symbol table entry of the file
+static void elf_foreach_sym(ElfFile *elf,
+                            void (*fn)(ElfFile *, const Elf32_Sym *, const char *, void *),
+                            void *opaque)
+{
+    int i;
+
+    for (i = 0; i < elf->ehdr->e_shnum; i++) {
+        const Elf32_Shdr *sh = &elf->shdr[i];
+        const Elf32_Sym *syms;
+        const char *strtab;
+        int j, n;
+
+        if (sh->sh_type != SHT_SYMTAB || sh->sh_link >= elf->ehdr->e_shnum
+                || (uint64_t)sh->sh_offset + sh->sh_size > elf->len
+                || elf->shdr[sh->sh_link].sh_offset >= elf->len) {
+            continue;
+        }
+
+        syms = (const Elf32_Sym *)(elf->data + sh->sh_offset);
+        strtab = elf->data + elf->shdr[sh->sh_link].sh_offset;
+        n = sh->sh_size / sizeof(*syms);
+
+        for (j = 0; j < n; j++) {
+            fn(elf, &syms[j], strtab + syms[j].st_name, opaque);
+        }
+    }
+}
+
+static void elf_add_sym(ElfFile *elf, const Elf32_Sym *esym, const char *name,
+                        void *opaque)
+{
+    bool objects = *(bool *)opaque;
+    int type = ELF32_ST_TYPE(esym->st_info);
+    Symbol sym = {};
+
+    if ((type != STT_FUNC && !(objects && type == STT_OBJECT)) || !esym->st_size) {
+        return;
+    }
+
+    // clear the thumb bit of function addresses
+    sym.addr = esym->st_value & (type == STT_FUNC ? ~1u : ~0u);
+    sym.size = esym->st_size;
+    sym.name = g_strdup(name);
+    g_array_append_val(elf->symbols, sym);
+}
+
+ElfFile *elf_load(const char *plugin, const char *path, bool objects)
+{
+    ElfFile *elf = g_new0(ElfFile, 1);
+    const Elf32_Ehdr *ehdr;
+
+    if (!g_file_get_contents(path, &elf->data, &elf->len, NULL)) {
+        fprintf(stderr, "%s: cannot read ELF file '%s'\n", plugin, path);
+        g_free(elf);
+        return NULL;
+    }
+
+    ehdr = (const Elf32_Ehdr *)elf->data;
+    if (elf->len < sizeof(*ehdr) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG)
+            || ehdr->e_ident[EI_CLASS] != ELFCLASS32
+            || ehdr->e_shoff + (uint64_t)ehdr->e_shnum * sizeof(Elf32_Shdr) > elf->len) {
+        fprintf(stderr, "%s: '%s' is not a 32-bit ELF file\n", plugin, path);
+        g_free(elf->data);
+        g_free(elf);
+        return NULL;
+    }
+
+    elf->ehdr = ehdr;
+    elf->shdr = (const Elf32_Shdr *)(elf->data + ehdr->e_shoff);
+    elf->symbols = g_array_new(false, false, sizeof(Symbol));
+
+    elf_foreach_sym(elf, elf_add_sym, &objects);
+    g_array_sort(elf->symbols, symbol_cmp);
+
+    return elf;
+}
+
+Symbol *elf_symbol_lookup(ElfFile *elf, uint64_t addr)
+{
+    int lo = 0, hi = elf ? elf->symbols->len : 0;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        Symbol *sym = &g_array_index(elf->symbols, Symbol, mid);
+
+        if (addr < sym->addr) {
+            hi = mid;
+        } else if (addr - sym->addr >= sym->size) {
+            lo = mid + 1;
+        } else {
+            return sym;
+        }
+    }
+
+    return &symbol_unknown;
+}
+
+typedef struct {
+    const char *name;
+    uint32_t value;
+    bool found;
+} SymbolFind;
+
+static void elf_find_sym(ElfFile *elf, const Elf32_Sym *esym, const char *name,
+                         void *opaque)
+{
+    SymbolFind *find = opaque;
+
+    if (!find->found && !strcmp(name, find->name)) {
+        find->value = esym->st_value;
+        find->found = true;
+    }
+}
+
+bool elf_symbol_find(ElfFile *elf, const char *name, uint32_t *value)
+{
+    SymbolFind find = { .name = name };
+
+    elf_foreach_sym(elf, elf_find_sym, &find);
+    if (find.found) {
+        *value = find.value;
+    }
+
+    return find.found;
+}
@@ -0,0 +1,59 @@
+/*
+ * ELF symbol loading shared by the ISIS iOBC plugins.
+ *
+ * Reads the firmware ELF file given to a plugin and provides its symbols
+ * sorted by address for attributing guest addresses to functions and
+ * objects. Built into each iobc* plugin.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+#ifndef TESTS_PLUGIN_IOBC_ELF_H
+#define TESTS_PLUGIN_IOBC_ELF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <elf.h>
+#include <glib.h>
+
+typedef struct {
+    char *name;
+    uint64_t addr;
+    uint64_t size;
+    uint64_t count;             // free for use by the plugin
+} Symbol;
+
+// returned for addresses not covered by any symbol
+extern Symbol symbol_unknown;
+
+typedef struct {
+    gchar *data;
+    gsize len;
+    const Elf32_Ehdr *ehdr;
+    const Elf32_Shdr *shdr;     // ehdr->e_shnum section headers
+    GArray *symbols;            // Symbol, sorted by address
+} ElfFile;
+
+/*
+ * Read the given 32-bit ELF file with its function symbols, and also its
+ * object symbols if objects is set. The Thumb bit is cleared from function
+ * addresses. Symbols without size are skipped. Errors are printed with the
+ * given plugin name as prefix, in which case NULL is returned.
+ */
+ElfFile *elf_load(const char *plugin, const char *path, bool objects);
+
+/*
+ * Return the symbol containing the given address, or symbol_unknown. The
+ * ELF file may be NULL, e.g. if none has been given to the plugin.
+ */
+Symbol *elf_symbol_lookup(ElfFile *elf, uint64_t addr);
+
+/*
+ * Get the value of the symbol with the given name, including symbols not
+ * loaded by elf_load(). Returns false if there is no such symbol.
+ */
+bool elf_symbol_find(ElfFile *elf, const char *name, uint32_t *value);
+
+#endif /* TESTS_PLUGIN_IOBC_ELF_H */
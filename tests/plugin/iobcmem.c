@@ -0,0 +1,336 @@
+/*
+ * ISIS iOBC memory region access profiler.
+ *
+ * Counts instruction fetches, loads, and stores per region of the iOBC
+ * memory map (see hw/arm/isis_obc/iobc-board.c) and per 1 KiB page, and
+ * attributes them to the symbols of the firmware ELF file. This shows which
+ * code and data would profit most from being placed in the internal SRAM.
+ *
+ * Options:
+ * - elf=<file>: Firmware ELF file to take function and object symbols from.
+ * - folded=<file>: Write the counts as folded stacks (region;page;symbol;
+ *   access type), e.g. for flamegraph.pl.
+ * - pages=<n>: Number of hottest pages in the report (default: 20).
+ *
+ * Addresses are taken as physical addresses, i.e. the firmware is expected
+ * to use an identity mapping if the MMU is enabled (as done by the ISIS
+ * BSP).
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <glib.h>
+
+#include <qemu-plugin.h>
+
+#include "iobc-elf.h"
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
+
+#define PROF_PAGE_BITS       10
+#define PROF_PAGE_SIZE       (1 << PROF_PAGE_BITS)
+
+typedef struct {
+    const char *name;
+    uint64_t start;
+    uint64_t size;
+} Region;
+
+// see iobc_init in hw/arm/isis_obc/iobc-board.c
+static const Region regions[] = {
+    { "bootmem",     0x00000000, 0x00100000 },
+    { "rom",         0x00100000, 0x00008000 },
+    { "sram0",       0x00200000, 0x00004000 },
+    { "sram1",       0x00300000, 0x00004000 },
+    { "pflash",      0x10000000, 0x10000000 },
+    { "sdram",       0x20000000, 0x10000000 },
+    { "peripherals", 0xF0000000, 0x10000000 },
+};
+
+static const Region region_other = { "other", 0, 0 };
+
+typedef struct {
+    uint64_t fetches;
+    uint64_t loads;
+    uint64_t stores;
+} Counts;
+
+typedef struct {
+    uint64_t addr;
+    const Region *region;
+    GHashTable *symbols;        // Symbol * -> Counts *
+    Counts total;
+} Page;
+
+static GMutex lock;
+static GHashTable *pages;
+static ElfFile *elf;
+
+static char *folded_path;
+static int limit = 20;
+
+
+static const Region *region_lookup(uint64_t addr)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(regions); i++) {
+        if (addr >= regions[i].start && addr - regions[i].start < regions[i].size) {
+            return &regions[i];
+        }
+    }
+
+    return &region_other;
+}
+
+// must be called with lock held
+static Counts *counts_lookup(uint64_t addr)
+{
+    uint64_t page_addr = addr & ~(uint64_t)(PROF_PAGE_SIZE - 1);
+    Symbol *sym = elf_symbol_lookup(elf, addr);
+    Counts *counts;
+    Page *page;
+
+    page = g_hash_table_lookup(pages, GUINT_TO_POINTER(page_addr));
+    if (!page) {
+        page = g_new0(Page, 1);
+        page->addr = page_addr;
+        page->region = region_lookup(page_addr);
+        page->symbols = g_hash_table_new(NULL, NULL);
+        g_hash_table_insert(pages, GUINT_TO_POINTER(page_addr), page);
+    }
+
+    counts = g_hash_table_lookup(page->symbols, sym);
+    if (!counts) {
+        counts = g_new0(Counts, 1);
+        g_hash_table_insert(page->symbols, sym, counts);
+    }
+
+    return counts;
+}
+
+
+
+static void page_sum(Page *page)
+{
+    GHashTableIter iter;
+    Counts *counts;
+
+    g_hash_table_iter_init(&iter, page->symbols);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&counts)) {
+        page->total.fetches += counts->fetches;
+        page->total.loads += counts->loads;
+        page->total.stores += counts->stores;
+    }
+}
+
+static uint64_t counts_sum(const Counts *c)
+{
+    return c->fetches + c->loads + c->stores;
+}
+
+static gint page_cmp(gconstpointer a, gconstpointer b)
+{
+    uint64_t na = counts_sum(&((const Page *)a)->total);
+    uint64_t nb = counts_sum(&((const Page *)b)->total);
+
+    return na > nb ? -1 : na < nb;
+}
+
+static gint page_symbol_cmp(gconstpointer a, gconstpointer b, gpointer data)
+{
+    GHashTable *syms = data;
+    uint64_t na = counts_sum(g_hash_table_lookup(syms, a));
+    uint64_t nb = counts_sum(g_hash_table_lookup(syms, b));
+
+    return na > nb ? -1 : na < nb;
+}
+
+static void write_folded(GList *list)
+{
+    FILE *f = fopen(folded_path, "w");
+    GList *it;
+
+    if (!f) {
+        fprintf(stderr, "iobcmem: cannot open '%s'\n", folded_path);
+        return;
+    }
+
+    for (it = list; it; it = it->next) {
+        Page *page = it->data;
+        GHashTableIter iter;
+        Symbol *sym;
+        Counts *c;
+
+        g_hash_table_iter_init(&iter, page->symbols);
+        while (g_hash_table_iter_next(&iter, (gpointer *)&sym, (gpointer *)&c)) {
+            const char *type[] = { "fetch", "load", "store" };
+            uint64_t n[] = { c->fetches, c->loads, c->stores };
+            int i;
+
+            for (i = 0; i < ARRAY_SIZE(n); i++) {
+                if (n[i]) {
+                    fprintf(f, "%s;0x%08" PRIx64 ";%s;%s %" PRIu64 "\n",
+                            page->region->name, page->addr, sym->name, type[i], n[i]);
+                }
+            }
+        }
+    }
+
+    fclose(f);
+}
+
+static void plugin_exit(qemu_plugin_id_t id, void *p)
+{
+    g_autoptr(GString) report = g_string_new("");
+    Counts region_total[ARRAY_SIZE(regions) + 1] = { 0 };
+    uint64_t total = 0;
+    GList *list, *it;
+    int i;
+
+    g_mutex_lock(&lock);
+
+    list = g_hash_table_get_values(pages);
+
+    for (it = list; it; it = it->next) {
+        Page *page = it->data;
+        Counts *r;
+
+        page_sum(page);
+
+        r = &region_total[page->region == &region_other ? ARRAY_SIZE(regions)
+                          : page->region - regions];
+        r->fetches += page->total.fetches;
+        r->loads += page->total.loads;
+        r->stores += page->total.stores;
+        total += counts_sum(&page->total);
+    }
+
+    list = g_list_sort(list, page_cmp);
+
+    g_string_append_printf(report, "%-12s %14s %14s %14s %7s\n",
+                           "region", "fetches", "loads", "stores", "share");
+
+    for (i = 0; i <= ARRAY_SIZE(regions); i++) {
+        const Region *region = i < ARRAY_SIZE(regions) ? &regions[i] : &region_other;
+        Counts *r = &region_total[i];
+
+        if (!counts_sum(r)) {
+            continue;
+        }
+
+        g_string_append_printf(report, "%-12s %14" PRIu64 " %14" PRIu64 " %14" PRIu64
+                               " %6.2f%%\n", region->name, r->fetches, r->loads,
+                               r->stores, total ? 100.0 * counts_sum(r) / total : 0.0);
+    }
+
+    g_string_append_printf(report, "\n%-12s %-10s %14s %14s %14s  %s\n",
+                           "region", "page", "fetches", "loads", "stores", "symbols");
+
+    for (i = 0, it = list; i < limit && it; i++, it = it->next) {
+        Page *page = it->data;
+        GList *syms, *s;
+        int j;
+
+        g_string_append_printf(report, "%-12s 0x%08" PRIx64 " %14" PRIu64 " %14" PRIu64
+                               " %14" PRIu64 " ", page->region->name, page->addr,
+                               page->total.fetches, page->total.loads,
+                               page->total.stores);
+
+        syms = g_list_sort_with_data(g_hash_table_get_keys(page->symbols),
+                                     page_symbol_cmp, page->symbols);
+
+        for (j = 0, s = syms; j < 3 && s; j++, s = s->next) {
+            g_string_append_printf(report, " %s", ((Symbol *)s->data)->name);
+        }
+
+        g_string_append(report, s ? " ...\n" : "\n");
+        g_list_free(syms);
+    }
+
+    if (folded_path) {
+        write_folded(list);
+    }
+
+    g_list_free(list);
+    g_mutex_unlock(&lock);
+
+    qemu_plugin_outs(report->str);
+}
+
+static void vcpu_mem(unsigned int cpu_index, qemu_plugin_meminfo_t meminfo,
+                     uint64_t vaddr, void *udata)
+{
+    Counts *counts;
+
+    g_mutex_lock(&lock);
+
+    counts = counts_lookup(vaddr);
+    if (qemu_plugin_mem_is_store(meminfo)) {
+        counts->stores++;
+    } else {
+        counts->loads++;
+    }
+
+    g_mutex_unlock(&lock);
+}
+
+static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+    size_t n = qemu_plugin_tb_n_insns(tb);
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        struct qemu_plugin_insn *insn = qemu_plugin_tb_get_insn(tb, i);
+        Counts *counts;
+
+        // counters are never freed, so they can be incremented inline
+        g_mutex_lock(&lock);
+        counts = counts_lookup(qemu_plugin_insn_vaddr(insn));
+        g_mutex_unlock(&lock);
+
+        qemu_plugin_register_vcpu_insn_exec_inline(insn, QEMU_PLUGIN_INLINE_ADD_U64,
+                                                   &counts->fetches, 1);
+        qemu_plugin_register_vcpu_mem_cb(insn, vcpu_mem, QEMU_PLUGIN_CB_NO_REGS,
+                                         QEMU_PLUGIN_MEM_RW, NULL);
+    }
+}
+
+QEMU_PLUGIN_EXPORT
+int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
+                        int argc, char **argv)
+{
+    int i;
+
+    for (i = 0; i < argc; i++) {
+        char *opt = argv[i];
+
+        if (g_str_has_prefix(opt, "elf=")) {
+            elf = elf_load("iobcmem", opt + 4, true);
+            if (!elf) {
+                return -1;
+            }
+        } else if (g_str_has_prefix(opt, "folded=")) {
+            folded_path = g_strdup(opt + 7);
+        } else if (g_str_has_prefix(opt, "pages=")) {
+            limit = atoi(opt + 6);
+        } else {
+            fprintf(stderr, "option parsing failed: %s\n", opt);
+            return -1;
+        }
+    }
+
+    pages = g_hash_table_new(NULL, NULL);
+
+    qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
+    qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
+    return 0;
+}
@@ -0,0 +1,744 @@
+/*
+ * ISIS iOBC sampling profiler.
+ *
+ * Samples the program counter and the call stack of the guest at a fixed
+ * period of virtual time, symbolizes them with the firmware ELF file, and
+ * writes the samples as folded stacks (one line per distinct stack, root
+ * first, e.g. for flamegraph.pl or speedscope) together with a perf-style
+ * report of the functions with the most samples.
+ *
+ * In contrast to the insn and hotblocks plugins, no code is instrumented:
+ * samples are taken by a periodic callback between two blocks, so that the
+ * overhead only depends on the sampling rate (one exit from the execution
+ * loop and one stack walk per sample). With -icount, virtual time is
+ * proportional to the number of executed instructions, i.e. samples are
+ * taken every n instructions (e.g. every 2^shift * period / 1000 with
+ * period in microseconds).
+ *
+ * Each sample is weighted by the virtual time passed since the previous one
+ * (in units of the period), so that time skipped while the CPU is idle (see
+ * the turbo-idle and poll-skip machine options) is attributed to the idle
+ * loop instead of being lost.
+ *
+ * Call stacks are unwound with one of:
+ * - exidx: The ARM exception handling tables (.ARM.exidx and .ARM.extab),
+ *   which GCC emits with -funwind-tables (or -fexceptions). Works for ARM and
+ *   Thumb code and does not need frame pointers.
+ * - fp: The frame pointer chain of GCC (-fno-omit-frame-pointer, ARM code):
+ *   r11 points to the saved lr, with the saved r11 below it.
+ * - apcs: The frame pointer chain of the APCS frame layout (-mapcs-frame):
+ *   r11 points to the saved pc, with lr, sp, and r11 below it.
+ * - none: Only the program counter is sampled.
+ * Functions without a frame of their own (leaf functions with fp and apcs)
+ * hide their caller. Unwinding stops at the first frame which cannot be
+ * unwound, e.g. in hand-written assembly without unwind annotations.
+ *
+ * Options:
+ * - elf=<file>: Firmware ELF file (required).
+ * - period=<us>: Sampling period in microseconds of virtual time
+ *   (default: 100, i.e. 10 kHz).
+ * - unwind=exidx|fp|apcs|none: Stack unwinding method (default: exidx if the
+ *   ELF file contains unwind tables, none otherwise).
+ * - depth=<n>: Maximum number of frames per stack (default: 32).
+ * - folded=<file>: Write the folded stacks to the given file.
+ * - top=<n>: Number of functions in the report (default: 20).
+ *
+ * Only the first vCPU is sampled, the iOBC has a single CPU.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <glib.h>
+
+#include <qemu-plugin.h>
+
+#include "iobc-elf.h"
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+#define ARM_REG_FP          11
+#define ARM_REG_SP          13
+#define ARM_REG_LR          14
+#define ARM_REG_PC          15
+#define ARM_NUM_REGS        16
+
+#define EXIDX_CANTUNWIND    0x00000001
+#define EHABI_FINISH        0xb0
+
+#define MAX_DEPTH           256
+
+typedef enum {
+    UNWIND_NONE,
+    UNWIND_EXIDX,
+    UNWIND_FP,
+    UNWIND_APCS,
+} Unwind;
+
+// loaded section of the ELF file
+typedef struct {
+    uint32_t addr;
+    uint32_t size;
+    const uint8_t *data;
+} Section;
+
+typedef struct {
+    uint32_t fn;                // function start
+    uint32_t addr;              // address of the entry
+    uint32_t data;              // second word of the entry
+} ExidxEntry;
+
+typedef struct {
+    uint64_t weight;
+    unsigned depth;
+    Symbol *frames[];           // innermost first
+} Stack;
+
+typedef struct {
+    Symbol *sym;
+    uint64_t self;
+    uint64_t total;
+} Function;
+
+// opcode stream of an unwind table entry
+typedef struct {
+    uint32_t addr;              // address of the current word
+    uint32_t word;
+    int byte;                   // next byte in the word, 3 (msb) to 0
+    unsigned words;             // remaining words including the current one
+} OpStream;
+
+static ElfFile *elf;
+static GArray *sections;
+static GArray *exidx;           // sorted by function start
+
+static uint64_t period_ns = 100000;
+static Unwind unwind = UNWIND_EXIDX;
+static bool unwind_set;
+static unsigned max_depth = 32;
+static unsigned top_n = 20;
+static char *folded_path;
+
+static GHashTable *stacks;      // Stack * -> Stack *
+static Stack *scratch;
+static uint64_t last_sample;
+static uint64_t samples, total_weight;
+
+static const void *gprs;
+static size_t gpr_size;
+
+
+static bool image_read_u32(uint32_t addr, uint32_t *value)
+{
+    int i;
+
+    for (i = 0; i < sections->len; i++) {
+        Section *sec = &g_array_index(sections, Section, i);
+
+        if (addr >= sec->addr && addr - sec->addr + 4 <= sec->size) {
+            memcpy(value, sec->data + (addr - sec->addr), sizeof(*value));
+            *value = GUINT32_FROM_LE(*value);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// decode a place-relative 31-bit offset
+static uint32_t prel31(uint32_t addr, uint32_t word)
+{
+    return addr + (uint32_t)((int32_t)(word << 1) >> 1);
+}
+
+static gint exidx_cmp(gconstpointer a, gconstpointer b)
+{
+    const ExidxEntry *ea = a;
+    const ExidxEntry *eb = b;
+
+    return ea->fn < eb->fn ? -1 : ea->fn > eb->fn;
+}
+
+static void load_exidx(const Elf32_Shdr *shdr)
+{
+    const uint32_t *words = (const uint32_t *)(elf->data + shdr->sh_offset);
+    int i, n = shdr->sh_size / 8;
+
+    for (i = 0; i < n; i++) {
+        ExidxEntry e;
+
+        e.addr = shdr->sh_addr + i * 8;
+        e.fn = prel31(e.addr, GUINT32_FROM_LE(words[2 * i]));
+        e.data = GUINT32_FROM_LE(words[2 * i + 1]);
+        g_array_append_val(exidx, e);
+    }
+}
+
+static bool load_elf(const char *path)
+{
+    int i;
+
+    elf = elf_load("iobcprof", path, false);
+    if (!elf) {
+        return false;
+    }
+
+    sections = g_array_new(false, false, sizeof(Section));
+    exidx = g_array_new(false, false, sizeof(ExidxEntry));
+
+    for (i = 0; i < elf->ehdr->e_shnum; i++) {
+        const Elf32_Shdr *shdr = &elf->shdr[i];
+
+        if (shdr->sh_type == SHT_NOBITS
+                || (uint64_t)shdr->sh_offset + shdr->sh_size > elf->len) {
+            continue;
+        }
+
+        // unwind tables are read from the file, the guest may not map them
+        if ((shdr->sh_flags & SHF_ALLOC) && shdr->sh_size) {
+            Section sec = {
+                .addr = shdr->sh_addr,
+                .size = shdr->sh_size,
+                .data = (const uint8_t *)elf->data + shdr->sh_offset,
+            };
+
+            g_array_append_val(sections, sec);
+        }
+
+        if (shdr->sh_type == SHT_ARM_EXIDX) {
+            load_exidx(shdr);
+        }
+    }
+
+    g_array_sort(exidx, exidx_cmp);
+    return true;
+}
+
+
+static ExidxEntry *exidx_lookup(uint32_t pc)
+{
+    int lo = 0, hi = exidx->len;
+
+    // last entry starting at or before pc
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+
+        if (pc < g_array_index(exidx, ExidxEntry, mid).fn) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    return lo ? &g_array_index(exidx, ExidxEntry, lo - 1) : NULL;
+}
+
+static uint8_t op_next(OpStream *s)
+{
+    uint8_t op;
+
+    // an exhausted stream implicitly finishes
+    if (!s->words) {
+        return EHABI_FINISH;
+    }
+
+    op = s->word >> (s->byte * 8);
+
+    if (--s->byte < 0) {
+        s->byte = 3;
+        s->addr += 4;
+        if (--s->words && !image_read_u32(s->addr, &s->word)) {
+            s->words = 0;
+        }
+    }
+
+    return op;
+}
+
+static bool op_init(OpStream *s, ExidxEntry *e)
+{
+    uint32_t word;
+
+    if (e->data == EXIDX_CANTUNWIND) {
+        return false;
+    }
+
+    // compact model (personality 0) inlined in the index table
+    if (e->data & 0x80000000) {
+        s->addr = e->addr + 4;
+        s->word = e->data;
+        s->byte = 2;
+        s->words = 1;
+        return (e->data & 0x0f000000) == 0;
+    }
+
+    s->addr = prel31(e->addr + 4, e->data);
+    if (!image_read_u32(s->addr, &word)) {
+        return false;
+    }
+
+    if (word & 0x80000000) {
+        // compact model in the table, personality 0 (short) or 1 and 2 (long)
+        switch ((word >> 24) & 0x0f) {
+        case 0:
+            s->byte = 2;
+            s->words = 1;
+            break;
+        case 1:
+        case 2:
+            s->byte = 1;
+            s->words = 1 + ((word >> 16) & 0xff);
+            break;
+        default:
+            return false;
+        }
+        s->word = word;
+        return true;
+    }
+
+    // generic model (e.g. __gxx_personality_v0), opcodes follow in the format of personality 1
+    s->addr += 4;
+    if (!image_read_u32(s->addr, &s->word)) {
+        return false;
+    }
+    s->byte = 2;
+    s->words = 1 + (s->word >> 24);
+    return true;
+}
+
+static bool pop_regs(unsigned int cpu_index, uint32_t *regs, uint32_t *vsp,
+                     uint16_t mask)
+{
+    int i;
+
+    for (i = 0; i < ARM_NUM_REGS; i++) {
+        uint32_t value;
+
+        if (!(mask & (1u << i))) {
+            continue;
+        }
+
+        if (qemu_plugin_vcpu_read_memory(cpu_index, *vsp, &value, sizeof(value))) {
+            return false;
+        }
+
+        regs[i] = GUINT32_FROM_LE(value);
+        *vsp += 4;
+    }
+
+    // popping sp replaces the virtual stack pointer
+    if (mask & (1u << ARM_REG_SP)) {
+        *vsp = regs[ARM_REG_SP];
+    }
+
+    return true;
+}
+
+/*
+ * Unwind one frame by executing the unwind opcodes of the function containing
+ * pc (ARM EHABI, section 10), i.e. restore the registers of the caller.
+ */
+static bool unwind_exidx(unsigned int cpu_index, uint32_t *regs, uint32_t pc)
+{
+    ExidxEntry *e = exidx_lookup(pc);
+    uint32_t vsp = regs[ARM_REG_SP];
+    bool pc_set = false;
+    OpStream s;
+
+    if (!e || !op_init(&s, e)) {
+        return false;
+    }
+
+    for (;;) {
+        uint8_t op = op_next(&s);
+        uint32_t v;
+
+        if ((op & 0xc0) == 0x00) {
+            vsp += ((op & 0x3f) << 2) + 4;
+        } else if ((op & 0xc0) == 0x40) {
+            vsp -= ((op & 0x3f) << 2) + 4;
+        } else if ((op & 0xf0) == 0x80) {
+            // pop r4-r15 under mask
+            v = ((op & 0x0f) << 8) | op_next(&s);
+            if (!v || !pop_regs(cpu_index, regs, &vsp, v << 4)) {
+                return false;
+            }
+            pc_set |= v & (1u << (ARM_REG_PC - 4));
+        } else if ((op & 0xf0) == 0x90) {
+            if ((op & 0x0f) == ARM_REG_SP || (op & 0x0f) == ARM_REG_PC) {
+                return false;
+            }
+            vsp = regs[op & 0x0f];
+        } else if ((op & 0xf0) == 0xa0) {
+            // pop r4-r[4+n], and r14 if bit 3 is set
+            v = ((1u << ((op & 0x07) + 1)) - 1) << 4;
+            if (op & 0x08) {
+                v |= 1u << ARM_REG_LR;
+            }
+            if (!pop_regs(cpu_index, regs, &vsp, v)) {
+                return false;
+            }
+        } else if (op == EHABI_FINISH) {
+            break;
+        } else if (op == 0xb1) {
+            // pop r0-r3 under mask
+            v = op_next(&s);
+            if (!v || (v & 0xf0) || !pop_regs(cpu_index, regs, &vsp, v)) {
+                return false;
+            }
+        } else if (op == 0xb2) {
+            uint8_t b;
+            int shift = 0;
+
+            v = 0;
+            do {
+                b = op_next(&s);
+                v |= (uint32_t)(b & 0x7f) << shift;
+                shift += 7;
+            } while ((b & 0x80) && shift < 32);
+            vsp += 0x204 + (v << 2);
+        } else if (op == 0xb3) {
+            // VFP registers saved with FSTMFDX
+            vsp += ((op_next(&s) & 0x0f) + 1) * 8 + 4;
+        } else if ((op & 0xf8) == 0xb8) {
+            vsp += ((op & 0x07) + 1) * 8 + 4;
+        } else if (op == 0xc6 || op == 0xc8 || op == 0xc9) {
+            // iWMMXt or VFP registers, 8 bytes each
+            vsp += ((op_next(&s) & 0x0f) + 1) * 8;
+        } else if (op == 0xc7) {
+            v = op_next(&s);
+            if (!v || (v & 0xf0)) {
+                return false;
+            }
+            vsp += __builtin_popcount(v) * 4;
+        } else if ((op & 0xf8) == 0xc0 || (op & 0xf8) == 0xd0) {
+            vsp += ((op & 0x07) + 1) * 8;
+        } else {
+            // spare or reserved
+            return false;
+        }
+    }
+
+    regs[ARM_REG_SP] = vsp;
+    if (!pc_set) {
+        regs[ARM_REG_PC] = regs[ARM_REG_LR];
+    }
+
+    return true;
+}
+
+static unsigned unwind_stack(unsigned int cpu_index, uint32_t *regs, uint32_t *pcs)
+{
+    uint32_t pc = regs[ARM_REG_PC] & ~1u;
+    uint32_t fp = regs[ARM_REG_FP];
+    unsigned depth = 0;
+
+    pcs[depth++] = pc;
+
+    while (depth < max_depth) {
+        uint32_t sp = regs[ARM_REG_SP], ret, next_fp, words[3];
+
+        switch (unwind) {
+        case UNWIND_EXIDX:
+            if (!unwind_exidx(cpu_index, regs, pc)) {
+                return depth;
+            }
+            ret = regs[ARM_REG_PC] & ~1u;
+            // no progress, e.g. at the reset handler
+            if (ret - 2 == pc && regs[ARM_REG_SP] == sp) {
+                return depth;
+            }
+            break;
+
+        case UNWIND_FP:
+            // [fp] = lr, [fp - 4] = fp
+            if (!fp || qemu_plugin_vcpu_read_memory(cpu_index, fp - 4, words, 8)) {
+                return depth;
+            }
+            next_fp = GUINT32_FROM_LE(words[0]);
+            ret = GUINT32_FROM_LE(words[1]) & ~1u;
+            fp = next_fp > fp ? next_fp : 0;
+            break;
+
+        case UNWIND_APCS:
+            // [fp] = pc, [fp - 4] = lr, [fp - 8] = sp, [fp - 12] = fp
+            if (!fp || qemu_plugin_vcpu_read_memory(cpu_index, fp - 12, words, 12)) {
+                return depth;
+            }
+            next_fp = GUINT32_FROM_LE(words[0]);
+            ret = GUINT32_FROM_LE(words[2]) & ~1u;
+            fp = next_fp > fp ? next_fp : 0;
+            break;
+
+        default:
+            return depth;
+        }
+
+        if (!ret) {
+            return depth;
+        }
+
+        // the call instruction, the return address may be past a noreturn function
+        pc = ret - 2;
+        pcs[depth++] = pc;
+    }
+
+    return depth;
+}
+
+
+static guint stack_hash(gconstpointer p)
+{
+    const Stack *s = p;
+    guint hash = s->depth;
+    unsigned i;
+
+    for (i = 0; i < s->depth; i++) {
+        hash = hash * 31 + g_direct_hash(s->frames[i]);
+    }
+
+    return hash;
+}
+
+static gboolean stack_equal(gconstpointer a, gconstpointer b)
+{
+    const Stack *sa = a;
+    const Stack *sb = b;
+
+    return sa->depth == sb->depth
+        && !memcmp(sa->frames, sb->frames, sa->depth * sizeof(sa->frames[0]));
+}
+
+static void vcpu_sample(qemu_plugin_id_t id, unsigned int cpu_index)
+{
+    uint64_t now = qemu_plugin_virtual_clock_ns();
+    uint32_t regs[ARM_NUM_REGS], pcs[MAX_DEPTH];
+    uint64_t weight;
+    Stack *stack;
+    unsigned i;
+
+    if (cpu_index != 0 || !gprs) {
+        return;
+    }
+
+    // attribute skipped virtual time to the current stack
+    weight = (now - last_sample + period_ns / 2) / period_ns;
+    last_sample = now;
+    if (!weight) {
+        weight = 1;
+    }
+
+    for (i = 0; i < ARM_NUM_REGS; i++) {
+        regs[i] = qemu_plugin_gpr(gprs, gpr_size, i);
+    }
+
+    scratch->depth = unwind_stack(cpu_index, regs, pcs);
+    for (i = 0; i < scratch->depth; i++) {
+        scratch->frames[i] = elf_symbol_lookup(elf, pcs[i]);
+    }
+
+    stack = g_hash_table_lookup(stacks, scratch);
+    if (!stack) {
+        size_t size = sizeof(Stack) + scratch->depth * sizeof(scratch->frames[0]);
+
+        stack = g_memdup(scratch, size);
+        stack->weight = 0;
+        g_hash_table_add(stacks, stack);
+    }
+
+    stack->weight += weight;
+    samples++;
+    total_weight += weight;
+}
+
+static void vcpu_init(qemu_plugin_id_t id, unsigned int vcpu_index)
+{
+    int n_regs;
+
+    if (vcpu_index == 0) {
+        gprs = qemu_plugin_vcpu_gprs(vcpu_index, &gpr_size, &n_regs);
+        if (gprs && n_regs < ARM_NUM_REGS) {
+            gprs = NULL;
+        }
+        if (!gprs) {
+            fprintf(stderr, "iobcprof: registers not available, no samples\n");
+        }
+    }
+}
+
+
+static Function *function_get(GHashTable *functions, Symbol *sym)
+{
+    Function *fn = g_hash_table_lookup(functions, sym);
+
+    if (!fn) {
+        fn = g_new0(Function, 1);
+        fn->sym = sym;
+        g_hash_table_insert(functions, sym, fn);
+    }
+
+    return fn;
+}
+
+static gint function_cmp(gconstpointer a, gconstpointer b)
+{
+    const Function *fa = a;
+    const Function *fb = b;
+
+    if (fa->self != fb->self) {
+        return fa->self > fb->self ? -1 : 1;
+    }
+    return fa->total > fb->total ? -1 : fa->total < fb->total;
+}
+
+static void write_folded(void)
+{
+    GHashTableIter iter;
+    Stack *stack;
+    FILE *f = fopen(folded_path, "w");
+
+    if (!f) {
+        fprintf(stderr, "iobcprof: cannot open '%s'\n", folded_path);
+        return;
+    }
+
+    g_hash_table_iter_init(&iter, stacks);
+    while (g_hash_table_iter_next(&iter, (gpointer *)&stack, NULL)) {
+        int i;
+
+        for (i = stack->depth - 1; i >= 0; i--) {
+            fprintf(f, "%s%s", stack->frames[i]->name, i ? ";" : "");
+        }
+        fprintf(f, " %" PRIu64 "\n", stack->weight);
+    }
+
+    fclose(f);
+}
+
+static void plugin_exit(qemu_plugin_id_t id, void *p)
+{
+    g_autoptr(GString) report = g_string_new("");
+    GHashTable *functions = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+    GHashTableIter iter;
+    Stack *stack;
+    GList *list, *it;
+    unsigned n;
+
+    if (folded_path) {
+        write_folded();
+    }
+
+    g_hash_table_iter_init(&iter, stacks);
+    while (g_hash_table_iter_next(&iter, (gpointer *)&stack, NULL)) {
+        unsigned i, j;
+
+        function_get(functions, stack->frames[0])->self += stack->weight;
+
+        // count recursive functions once per stack
+        for (i = 0; i < stack->depth; i++) {
+            for (j = 0; j < i && stack->frames[j] != stack->frames[i]; j++) {
+            }
+            if (j == i) {
+                function_get(functions, stack->frames[i])->total += stack->weight;
+            }
+        }
+    }
+
+    g_string_append_printf(report, "samples: %" PRIu64 " (weighted: %" PRIu64
+                           ", period: %" PRIu64 " us), stacks: %u\n\n",
+                           samples, total_weight, period_ns / 1000,
+                           g_hash_table_size(stacks));
+    g_string_append_printf(report, "%7s %7s %12s  %s\n", "self", "total",
+                           "samples", "function");
+
+    list = g_list_sort(g_hash_table_get_values(functions), function_cmp);
+
+    for (it = list, n = 0; it && n < top_n; it = it->next, n++) {
+        Function *fn = it->data;
+
+        g_string_append_printf(report, "%6.2f%% %6.2f%% %12" PRIu64 "  %s\n",
+                               total_weight ? 100.0 * fn->self / total_weight : 0.0,
+                               total_weight ? 100.0 * fn->total / total_weight : 0.0,
+                               fn->self, fn->sym->name);
+    }
+
+    g_list_free(list);
+    g_hash_table_destroy(functions);
+    qemu_plugin_outs(report->str);
+}
+
+QEMU_PLUGIN_EXPORT
+int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
+                        int argc, char **argv)
+{
+    int i;
+
+    for (i = 0; i < argc; i++) {
+        char *opt = argv[i];
+
+        if (g_str_has_prefix(opt, "elf=")) {
+            if (!load_elf(opt + 4)) {
+                return -1;
+            }
+        } else if (g_str_has_prefix(opt, "period=")) {
+            period_ns = strtoull(opt + 7, NULL, 0) * 1000;
+        } else if (g_str_has_prefix(opt, "unwind=")) {
+            const char *method = opt + 7;
+
+            if (!strcmp(method, "exidx")) {
+                unwind = UNWIND_EXIDX;
+            } else if (!strcmp(method, "fp")) {
+                unwind = UNWIND_FP;
+            } else if (!strcmp(method, "apcs")) {
+                unwind = UNWIND_APCS;
+            } else if (!strcmp(method, "none")) {
+                unwind = UNWIND_NONE;
+            } else {
+                fprintf(stderr, "option parsing failed: %s\n", opt);
+                return -1;
+            }
+            unwind_set = true;
+        } else if (g_str_has_prefix(opt, "depth=")) {
+            max_depth = strtoul(opt + 6, NULL, 0);
+        } else if (g_str_has_prefix(opt, "folded=")) {
+            folded_path = g_strdup(opt + 7);
+        } else if (g_str_has_prefix(opt, "top=")) {
+            top_n = strtoul(opt + 4, NULL, 0);
+        } else {
+            fprintf(stderr, "option parsing failed: %s\n", opt);
+            return -1;
+        }
+    }
+
+    if (!elf) {
+        fprintf(stderr, "iobcprof: no ELF file given (elf=<file>)\n");
+        return -1;
+    }
+
+    if (!period_ns) {
+        fprintf(stderr, "iobcprof: invalid sampling period\n");
+        return -1;
+    }
+
+    if (unwind == UNWIND_EXIDX && !exidx->len) {
+        if (unwind_set) {
+            fprintf(stderr, "iobcprof: no unwind tables (.ARM.exidx) in the ELF file\n");
+            return -1;
+        }
+        unwind = UNWIND_NONE;
+    }
+
+    max_depth = MAX(1, MIN(max_depth, MAX_DEPTH));
+    scratch = g_malloc0(sizeof(Stack) + MAX_DEPTH * sizeof(scratch->frames[0]));
+    stacks = g_hash_table_new_full(stack_hash, stack_equal, g_free, NULL);
+
+    qemu_plugin_register_vcpu_init_cb(id, vcpu_init);
+    qemu_plugin_register_vcpu_periodic_cb(id, period_ns, vcpu_sample);
+    qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
+    return 0;
+}
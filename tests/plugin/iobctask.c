@@ -0,0 +1,479 @@
+/*
+ * ISIS iOBC FreeRTOS task profiler.
+ *
+ * Attributes executed instructions and virtual time to the FreeRTOS task
+ * running at the time, i.e. the task pointed to by pxCurrentTCB, and reports
+ * per-task CPU shares, context switches, and stack high-water marks.
+ *
+ * pxCurrentTCB is located via the symbols of the firmware ELF file. It is
+ * re-read after executing code of the functions assigning it (see
+ * switch-funcs), so that the per-block overhead stays small. A switch is
+ * attributed to the exception entered last before it: an IRQ (the handler
+ * is identified by the first block executed after the IRQ vector, as the
+ * AT91 vector jumps directly to the AIC_IVR handler, e.g. the PIT tick) or
+ * an SWI (yield). Time spent in interrupt handlers is attributed to the
+ * interrupted task.
+ *
+ * The stack high-water mark is the lowest stack pointer observed above the
+ * stack start (pxStack) of a task, taken from the saved pxTopOfStack on each
+ * switch and from stack pointer samples in SYS or USR mode.
+ *
+ * Time spent while pxCurrentTCB points outside of RAM (e.g. before it is
+ * initialized) is attributed to an "[invalid TCB]" task without stack data.
+ *
+ * Options:
+ * - elf=<file>: Firmware ELF file (required).
+ * - trace=<file>: Write a timeline of task runs in the Chrome trace event
+ *   format (JSON), e.g. for chrome://tracing or ui.perfetto.dev.
+ * - switch-funcs=<sym>[:<sym>...]: Functions assigning pxCurrentTCB
+ *   (default: vTaskSwitchContext, vTaskStartScheduler, xTaskGenericCreate,
+ *   xTaskCreate, prvAddNewTaskToReadyList, and vTaskDelete, if present).
+ * - tcb-stack=<offset>: Offset of pxStack in the TCB (default: 48).
+ * - tcb-name=<offset>: Offset of pcTaskName in the TCB (default: 52).
+ * - name-len=<n>: configMAX_TASK_NAME_LEN (default: 16).
+ * - sample=<n>: Sample the stack pointer every n blocks, 0 to disable
+ *   (default: 64).
+ *
+ * The default TCB offsets are those of FreeRTOS 7 to 10 on 32-bit targets
+ * without MPU and list integrity checks. The iOBC has a single CPU, so no
+ * locking is done.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <glib.h>
+
+#include <qemu-plugin.h>
+
+#include "iobc-elf.h"
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+#define ARM_REG_SP          13
+#define ARM_REG_CPSR        25
+#define ARM_CPSR_MODE       0x1f
+#define ARM_MODE_USR        0x10
+#define ARM_MODE_SYS        0x1f
+
+// low and high exception vectors
+#define ARM_VECTOR_SWI      0x00000008
+#define ARM_VECTOR_IRQ      0x00000018
+#define ARM_VECTOR_HIGH     0xffff0000
+
+typedef enum {
+    CAUSE_NONE,
+    CAUSE_IRQ,
+    CAUSE_SWI,
+} Cause;
+
+typedef struct {
+    uint32_t tcb;
+    char *name;
+    uint32_t stack;
+    bool invalid;               // TCB not in RAM, e.g. pxCurrentTCB unset
+
+    uint64_t insns;
+    uint64_t time_ns;
+    uint64_t switches;          // switched in
+    uint64_t preempted;         // switched out by an IRQ
+    uint64_t yields;            // switched out by an SWI
+
+    uint32_t min_sp;            // lowest stack pointer above pxStack
+    uint64_t sp_samples;
+} Task;
+
+typedef struct {
+    uint64_t vaddr;
+    unsigned n_insns;
+    bool switch_fn;
+    Cause vector;
+} Block;
+
+static ElfFile *elf;
+static uint32_t current_tcb_addr;
+static char **switch_funcs;
+
+static uint32_t tcb_stack_offset = 48;
+static uint32_t tcb_name_offset = 52;
+static unsigned name_len = 16;
+static unsigned sample_interval = 64;
+
+static GHashTable *blocks;      // vaddr -> Block *
+static GHashTable *tasks;       // TCB address -> Task *
+static GHashTable *irq_switches; // handler Symbol * -> count
+
+static Task *current;
+static uint64_t current_since;
+static bool tcb_dirty = true;
+static Cause last_cause;
+static Symbol *last_handler;
+static bool irq_entered;
+static unsigned sample_count;
+
+static const void *gprs;
+static size_t gpr_size;
+
+static FILE *trace;
+static bool trace_first = true;
+
+
+
+static bool read_u32(unsigned int cpu_index, uint64_t addr, uint32_t *value)
+{
+    uint32_t data;
+
+    if (qemu_plugin_vcpu_read_memory(cpu_index, addr, &data, sizeof(data))) {
+        return false;
+    }
+
+    *value = GUINT32_FROM_LE(data);
+    return true;
+}
+
+static Task *task_lookup(unsigned int cpu_index, uint32_t tcb)
+{
+    Task *task = g_hash_table_lookup(tasks, GUINT_TO_POINTER(tcb));
+    g_autofree char *name = NULL;
+
+    if (task) {
+        return task;
+    }
+
+    task = g_new0(Task, 1);
+    task->tcb = tcb;
+    task->min_sp = UINT32_MAX;
+
+    if (!tcb) {
+        task->name = g_strdup("[no task]");
+    } else if (!read_u32(cpu_index, tcb + tcb_stack_offset, &task->stack)) {
+        task->name = g_strdup("[invalid TCB]");
+        task->invalid = true;
+    } else {
+        name = g_malloc0(name_len + 1);
+        if (qemu_plugin_vcpu_read_memory(cpu_index, tcb + tcb_name_offset, name,
+                                         name_len)) {
+            name[0] = '\0';
+        }
+        // keep the trace valid JSON
+        g_strcanon(name, G_CSET_A_2_Z G_CSET_a_2_z G_CSET_DIGITS " _-.:/()[]#+", '_');
+        task->name = g_strdup(name[0] ? name : "[unnamed]");
+    }
+
+    g_hash_table_insert(tasks, GUINT_TO_POINTER(tcb), task);
+    return task;
+}
+
+static void task_sample_sp(Task *task, uint32_t sp)
+{
+    if (!task->tcb || task->invalid || sp < task->stack) {
+        return;
+    }
+
+    task->sp_samples++;
+    if (sp < task->min_sp) {
+        task->min_sp = sp;
+    }
+}
+
+static const char *cause_name(Cause cause, Symbol *handler)
+{
+    switch (cause) {
+    case CAUSE_IRQ:
+        return handler ? handler->name : "irq";
+    case CAUSE_SWI:
+        return "yield";
+    default:
+        return "direct";
+    }
+}
+
+static void trace_run(Task *task, uint64_t start, uint64_t end, const char *cause)
+{
+    if (!trace) {
+        return;
+    }
+
+    fprintf(trace, "%s{\"name\":\"%s\",\"cat\":\"task\",\"ph\":\"X\",\"pid\":0,"
+            "\"tid\":%" PRIu32 ",\"ts\":%.3f,\"dur\":%.3f,"
+            "\"args\":{\"tcb\":\"0x%08" PRIx32 "\",\"switched-out-by\":\"%s\"}}",
+            trace_first ? "[\n" : ",\n", task->name, task->tcb, start / 1e3,
+            (end - start) / 1e3, task->tcb, cause);
+    trace_first = false;
+}
+
+static void task_switch(unsigned int cpu_index, uint32_t tcb)
+{
+    uint64_t now = qemu_plugin_virtual_clock_ns();
+    Task *next = task_lookup(cpu_index, tcb);
+    uint32_t sp;
+
+    if (current) {
+        const char *cause = cause_name(last_cause, last_handler);
+
+        current->time_ns += now - current_since;
+        trace_run(current, current_since, now, cause);
+
+        // the context of the outgoing task has been saved on its stack
+        if (current->tcb && read_u32(cpu_index, current->tcb, &sp)) {
+            task_sample_sp(current, sp);
+        }
+
+        if (last_cause == CAUSE_IRQ) {
+            Symbol *handler = last_handler ? last_handler : &symbol_unknown;
+            uint64_t n = GPOINTER_TO_SIZE(g_hash_table_lookup(irq_switches, handler));
+
+            current->preempted++;
+            g_hash_table_insert(irq_switches, handler, GSIZE_TO_POINTER(n + 1));
+        } else if (last_cause == CAUSE_SWI) {
+            current->yields++;
+        }
+    }
+
+    next->switches++;
+    current = next;
+    current_since = now;
+    last_cause = CAUSE_NONE;
+}
+
+static void sample_sp(unsigned int cpu_index)
+{
+    uint64_t cpsr;
+
+    if (!gprs || !qemu_plugin_vcpu_read_register(cpu_index, ARM_REG_CPSR, &cpsr)) {
+        return;
+    }
+
+    // other modes run on their own (banked) stacks
+    if ((cpsr & ARM_CPSR_MODE) == ARM_MODE_USR || (cpsr & ARM_CPSR_MODE) == ARM_MODE_SYS) {
+        task_sample_sp(current, qemu_plugin_gpr(gprs, gpr_size, ARM_REG_SP));
+    }
+}
+
+static void vcpu_tb_exec(unsigned int cpu_index, void *udata)
+{
+    Block *block = udata;
+
+    // the IRQ vector jumps to the handler read from AIC_IVR
+    if (irq_entered) {
+        irq_entered = false;
+        last_handler = elf_symbol_lookup(elf, block->vaddr);
+    }
+
+    if (tcb_dirty) {
+        uint32_t tcb = 0;
+
+        // keep the current task if pxCurrentTCB cannot be read
+        if (!read_u32(cpu_index, current_tcb_addr, &tcb) && current) {
+            tcb = current->tcb;
+        }
+
+        tcb_dirty = false;
+        if (!current || tcb != current->tcb) {
+            task_switch(cpu_index, tcb);
+        }
+    }
+
+    current->insns += block->n_insns;
+
+    if (block->vector != CAUSE_NONE) {
+        last_cause = block->vector;
+        last_handler = NULL;
+        irq_entered = block->vector == CAUSE_IRQ;
+    }
+
+    // check for a switch after the assignment has been executed
+    if (block->switch_fn) {
+        tcb_dirty = true;
+    }
+
+    if (sample_interval && ++sample_count >= sample_interval) {
+        sample_count = 0;
+        sample_sp(cpu_index);
+    }
+}
+
+static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+    uint64_t vaddr = qemu_plugin_tb_vaddr(tb);
+    unsigned n_insns = qemu_plugin_tb_n_insns(tb);
+    Block *block = g_hash_table_lookup(blocks, &vaddr);
+
+    // blocks are never freed, reuse them on retranslation
+    if (!block || block->n_insns != n_insns) {
+        uint64_t vector = vaddr & ~(uint64_t)ARM_VECTOR_HIGH;
+        Symbol *sym = elf_symbol_lookup(elf, vaddr);
+        int i;
+
+        block = g_new0(Block, 1);
+        block->vaddr = vaddr;
+        block->n_insns = n_insns;
+
+        if (vaddr == vector || (vaddr & ARM_VECTOR_HIGH) == ARM_VECTOR_HIGH) {
+            block->vector = vector == ARM_VECTOR_IRQ ? CAUSE_IRQ
+                          : vector == ARM_VECTOR_SWI ? CAUSE_SWI : CAUSE_NONE;
+        }
+
+        for (i = 0; sym != &symbol_unknown && switch_funcs[i]; i++) {
+            if (!strcmp(sym->name, switch_funcs[i])) {
+                block->switch_fn = true;
+            }
+        }
+
+        g_hash_table_insert(blocks, &block->vaddr, block);
+    }
+
+    qemu_plugin_register_vcpu_tb_exec_cb(tb, vcpu_tb_exec, QEMU_PLUGIN_CB_R_REGS,
+                                         block);
+}
+
+static void vcpu_init(qemu_plugin_id_t id, unsigned int vcpu_index)
+{
+    int n_regs;
+
+    if (vcpu_index == 0) {
+        gprs = qemu_plugin_vcpu_gprs(vcpu_index, &gpr_size, &n_regs);
+    }
+}
+
+
+static gint task_cmp(gconstpointer a, gconstpointer b)
+{
+    const Task *ta = a;
+    const Task *tb = b;
+
+    return ta->time_ns > tb->time_ns ? -1 : ta->time_ns < tb->time_ns;
+}
+
+static void plugin_exit(qemu_plugin_id_t id, void *p)
+{
+    g_autoptr(GString) report = g_string_new("");
+    uint64_t now = qemu_plugin_virtual_clock_ns();
+    uint64_t total_insns = 0, total_ns = 0, switches = 0;
+    GHashTableIter iter;
+    GList *list, *it;
+    Symbol *handler;
+    gpointer count;
+
+    if (current) {
+        current->time_ns += now - current_since;
+        trace_run(current, current_since, now, "exit");
+    }
+
+    if (trace) {
+        fprintf(trace, "%s]\n", trace_first ? "[" : "\n");
+        fclose(trace);
+    }
+
+    list = g_list_sort(g_hash_table_get_values(tasks), task_cmp);
+
+    for (it = list; it; it = it->next) {
+        Task *task = it->data;
+
+        total_insns += task->insns;
+        total_ns += task->time_ns;
+        switches += task->switches;
+    }
+
+    g_string_append_printf(report, "%-16s %-10s %14s %7s %12s %7s %9s %9s %9s %10s\n",
+                           "task", "tcb", "insns", "share", "time [ms]", "share",
+                           "switches", "preempted", "yields", "min free");
+
+    for (it = list; it; it = it->next) {
+        Task *task = it->data;
+
+        g_string_append_printf(report, "%-16s 0x%08" PRIx32 " %14" PRIu64 " %6.2f%%"
+                               " %12.3f %6.2f%% %9" PRIu64 " %9" PRIu64 " %9" PRIu64,
+                               task->name, task->tcb, task->insns,
+                               total_insns ? 100.0 * task->insns / total_insns : 0.0,
+                               task->time_ns / 1e6,
+                               total_ns ? 100.0 * task->time_ns / total_ns : 0.0,
+                               task->switches, task->preempted, task->yields);
+
+        if (task->sp_samples) {
+            g_string_append_printf(report, " %10" PRIu32 "\n", task->min_sp - task->stack);
+        } else {
+            g_string_append_printf(report, " %10s\n", "-");
+        }
+    }
+
+    g_string_append_printf(report, "\ncontext switches: %" PRIu64 " (%.1f/s)\n",
+                           switches, total_ns ? switches * 1e9 / total_ns : 0.0);
+
+    g_string_append(report, "\nswitches by interrupt handler:\n");
+    g_hash_table_iter_init(&iter, irq_switches);
+    while (g_hash_table_iter_next(&iter, (gpointer *)&handler, &count)) {
+        g_string_append_printf(report, "  %-32s %12" PRIu64 "\n", handler->name,
+                               (uint64_t)GPOINTER_TO_SIZE(count));
+    }
+
+    g_list_free(list);
+    qemu_plugin_outs(report->str);
+}
+
+QEMU_PLUGIN_EXPORT
+int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
+                        int argc, char **argv)
+{
+    int i;
+
+    for (i = 0; i < argc; i++) {
+        char *opt = argv[i];
+
+        if (g_str_has_prefix(opt, "elf=")) {
+            elf = elf_load("iobctask", opt + 4, false);
+            if (!elf) {
+                return -1;
+            }
+            if (!elf_symbol_find(elf, "pxCurrentTCB", &current_tcb_addr)) {
+                fprintf(stderr, "iobctask: no symbol pxCurrentTCB in '%s'\n",
+                        opt + 4);
+                return -1;
+            }
+        } else if (g_str_has_prefix(opt, "trace=")) {
+            trace = fopen(opt + 6, "w");
+            if (!trace) {
+                fprintf(stderr, "iobctask: cannot open '%s'\n", opt + 6);
+                return -1;
+            }
+        } else if (g_str_has_prefix(opt, "switch-funcs=")) {
+            switch_funcs = g_strsplit(opt + 13, ":", -1);
+        } else if (g_str_has_prefix(opt, "tcb-stack=")) {
+            tcb_stack_offset = strtoul(opt + 10, NULL, 0);
+        } else if (g_str_has_prefix(opt, "tcb-name=")) {
+            tcb_name_offset = strtoul(opt + 9, NULL, 0);
+        } else if (g_str_has_prefix(opt, "name-len=")) {
+            name_len = strtoul(opt + 9, NULL, 0);
+        } else if (g_str_has_prefix(opt, "sample=")) {
+            sample_interval = strtoul(opt + 7, NULL, 0);
+        } else {
+            fprintf(stderr, "option parsing failed: %s\n", opt);
+            return -1;
+        }
+    }
+
+    if (!elf) {
+        fprintf(stderr, "iobctask: no ELF file given (elf=<file>)\n");
+        return -1;
+    }
+
+    if (!switch_funcs) {
+        switch_funcs = g_strsplit("vTaskSwitchContext:vTaskStartScheduler:"
+                                  "xTaskGenericCreate:xTaskCreate:"
+                                  "prvAddNewTaskToReadyList:vTaskDelete", ":", -1);
+    }
+
+    blocks = g_hash_table_new(g_int64_hash, g_int64_equal);
+    tasks = g_hash_table_new(NULL, NULL);
+    irq_switches = g_hash_table_new(NULL, NULL);
+
+    qemu_plugin_register_vcpu_init_cb(id, vcpu_init);
+    qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
+    qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
+    return 0;
+}
@@ -0,0 +1,798 @@
+/*
+ * ISIS iOBC cycle-approximate timing model.
+ *
+ * Estimates the execution time of the guest on the ARM926EJ-S of the iOBC
+ * (AT91SAM9G20 at 400 MHz, 32 KiB I- and D-cache, external SDRAM), and with
+ * -icount, drives QEMU_CLOCK_VIRTUAL from the estimated cycles instead of
+ * a fixed time per instruction, so that timers, timeouts, and the timing
+ * reports of the firmware reflect the expected execution time on target.
+ *
+ * The model consists of:
+ * - Issue cycles per instruction (ARM9E-S core, ARM and Thumb state), e.g.
+ *   multiplies, loads and stores of multiple registers, and branches (taken
+ *   branches are detected from the next executed block), and load-use
+ *   interlocks within a block.
+ * - Set-associative I- and D-caches with round-robin replacement, indexed by
+ *   virtual address (as on the ARM926). The D-cache allocates on read misses
+ *   only, stores are assumed to be absorbed by the write buffer.
+ * - Wait states of the memory regions, for the first word and for each
+ *   further word of a cache line fill, and for uncached accesses.
+ * - Bus contention by PDC transfers to external memory, as a configurable
+ *   load of the external bus (bus-load), which extends external memory
+ *   accesses accordingly. The transfers themselves are not visible to
+ *   plugins.
+ *
+ * Conditional execution (other than of branches), cache maintenance
+ * operations, and the cache enable bits are not modeled, i.e. caches are
+ * assumed to be enabled and coherent. Addresses are taken as physical
+ * addresses for the memory regions, i.e. the firmware is expected to use an
+ * identity mapping if the MMU is enabled (as done by the ISIS BSP).
+ *
+ * To drive the virtual clock, run with -icount shift=0 or shift=1 (1 or 2
+ * ns per instruction, at most one cycle at 400 MHz). The estimated time
+ * exceeding the time per executed instruction is then added as stall.
+ * Without -icount, only the report is produced.
+ *
+ * Options:
+ * - freq=<MHz>: CPU clock (default: 400).
+ * - icache=<size>:<ways>:<line>: I-cache geometry in bytes (default:
+ *   32768:4:32).
+ * - dcache=<size>:<ways>:<line>: D-cache geometry (default: 32768:4:32).
+ * - sdram=<first>:<next>: SDRAM wait states in CPU cycles for the first word
+ *   and each further word of a line fill (default: 12:2).
+ * - sram=<first>:<next>: Internal SRAM and ROM wait states (default: 2:2).
+ * - flash=<first>:<next>: NOR flash wait states (default: 20:8).
+ * - io=<cycles>: Peripheral access wait states (default: 6).
+ * - uncached=<region>[:<region>...]: Regions not cached by the firmware
+ *   (sram, rom, flash, sdram).
+ * - bus-load=<percent>: Average load of the external bus by PDC transfers
+ *   (default: 0).
+ * - elf=<file>: Firmware ELF file, to report the cycles per function.
+ * - top=<n>: Number of functions in the report (default: 20).
+ *
+ * The iOBC has a single CPU, so no locking is done.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <glib.h>
+
+#include <qemu-plugin.h>
+
+#include "iobc-elf.h"
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
+
+#define ARM_REG_PC          15
+
+#define BRANCH_TAKEN        3
+#define BRANCH_NOT_TAKEN    1
+
+typedef struct {
+    const char *name;
+    uint64_t start;
+    uint64_t size;
+    bool external;              // behind the EBI, shared with the PDC
+    unsigned *first;            // wait states of the first word
+    unsigned *next;             // wait states of each further word
+    bool uncached;
+} Region;
+
+static unsigned sdram_first = 12, sdram_next = 2;
+static unsigned sram_first = 2, sram_next = 2;
+static unsigned flash_first = 20, flash_next = 8;
+static unsigned io_cycles = 6;
+
+// see iobc_init in hw/arm/isis_obc/iobc-board.c
+static Region regions[] = {
+    { "rom",   0x00000000, 0x00100000, false, &sram_first,  &sram_next  },
+    { "rom",   0x00100000, 0x00008000, false, &sram_first,  &sram_next  },
+    { "sram",  0x00200000, 0x00004000, false, &sram_first,  &sram_next  },
+    { "sram",  0x00300000, 0x00004000, false, &sram_first,  &sram_next  },
+    { "flash", 0x10000000, 0x10000000, true,  &flash_first, &flash_next },
+    { "sdram", 0x20000000, 0x10000000, true,  &sdram_first, &sdram_next },
+};
+
+static Region region_io = { "io", 0, 0, false, &io_cycles, &io_cycles, true };
+
+typedef struct {
+    const char *name;
+    unsigned size;
+    unsigned ways;
+    unsigned line;
+    unsigned sets;
+    uint32_t *tags;             // line number + 1, 0 if invalid
+    uint8_t *victim;            // next way to replace per set
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t stall;
+} Cache;
+
+static Cache icache = { "icache", 32768, 4, 32 };
+static Cache dcache = { "dcache", 32768, 4, 32 };
+
+typedef struct {
+    uint64_t vaddr;
+    uint64_t end;
+    unsigned n_insns;
+    unsigned cycles;            // issue cycles, assuming a taken branch
+    bool branch;                // ends with a (possibly conditional) branch
+    uint32_t first_line;        // I-cache lines covered
+    uint32_t last_line;
+    Region *region;
+    Symbol *sym;
+} Block;
+
+static unsigned freq_mhz = 400;
+static unsigned bus_load;
+static unsigned top_n = 20;
+static ElfFile *elf;            // symbol counts are the cycles spent
+
+static GHashTable *blocks;      // vaddr -> Block *
+static Block *last_block;
+
+static uint64_t insns, cycles, core_cycles, pending;
+static uint64_t not_taken;
+static uint64_t uncached_loads, uncached_stores, uncached_stall;
+static uint64_t io_accesses, io_stall;
+static uint64_t insn_ns, stalled;
+static bool underrun;
+
+
+
+static Region *region_lookup(uint64_t addr)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(regions); i++) {
+        if (addr - regions[i].start < regions[i].size) {
+            return &regions[i];
+        }
+    }
+
+    return &region_io;
+}
+
+// wait states of an access of the given number of words, with bus contention
+static uint64_t region_cycles(Region *r, unsigned words)
+{
+    uint64_t n = *r->first + (uint64_t)(words - 1) * *r->next;
+
+    if (r->external) {
+        n = n * (100 + bus_load) / 100;
+    }
+
+    return n;
+}
+
+static bool cache_init(Cache *c)
+{
+    if (!c->ways || c->line < 4 || (c->line & (c->line - 1))
+            || c->size % (c->ways * c->line)) {
+        fprintf(stderr, "iobctime: invalid %s geometry %u:%u:%u\n", c->name,
+                c->size, c->ways, c->line);
+        return false;
+    }
+
+    c->sets = c->size / (c->ways * c->line);
+    c->tags = g_new0(uint32_t, c->sets * c->ways);
+    c->victim = g_new0(uint8_t, c->sets);
+    return true;
+}
+
+// returns true on a hit, allocates the line on a miss if requested
+static bool cache_access(Cache *c, uint32_t line, bool allocate)
+{
+    unsigned set = line % c->sets;
+    uint32_t *tags = &c->tags[set * c->ways];
+    unsigned way;
+
+    for (way = 0; way < c->ways; way++) {
+        if (tags[way] == line + 1) {
+            c->hits++;
+            return true;
+        }
+    }
+
+    c->misses++;
+
+    if (allocate) {
+        tags[c->victim[set]] = line + 1;
+        c->victim[set] = (c->victim[set] + 1) % c->ways;
+    }
+
+    return false;
+}
+
+static bool parse_pair(const char *arg, unsigned *a, unsigned *b)
+{
+    return sscanf(arg, "%u:%u", a, b) == 2;
+}
+
+static bool parse_cache(const char *arg, Cache *c)
+{
+    return sscanf(arg, "%u:%u:%u", &c->size, &c->ways, &c->line) == 3;
+}
+
+
+/*
+ * Issue cycles of an ARM instruction (ARM9E-S), assuming that it is executed
+ * and that branches are taken. Sets the registers read, and the register
+ * loaded with its result latency, for interlocks.
+ */
+static unsigned arm_cycles(uint32_t i, bool *branch, uint16_t *srcs,
+                           int *load_reg, unsigned *load_latency)
+{
+    unsigned rd = (i >> 12) & 0xf, rn = (i >> 16) & 0xf;
+    unsigned n;
+
+    *srcs = (1u << rn) | (1u << (i & 0xf));
+
+    // unconditional space: BLX (immediate), PLD
+    if ((i >> 28) == 0xf) {
+        if ((i & 0x0e000000) == 0x0a000000) {
+            *branch = true;
+            return BRANCH_TAKEN;
+        }
+        return 1;
+    }
+
+    // BX, BLX (register)
+    if ((i & 0x0ffffff0) == 0x012fff10 || (i & 0x0ffffff0) == 0x012fff30) {
+        *branch = true;
+        return BRANCH_TAKEN;
+    }
+
+    // B, BL
+    if ((i & 0x0e000000) == 0x0a000000) {
+        *branch = true;
+        return BRANCH_TAKEN;
+    }
+
+    // SWI
+    if ((i & 0x0f000000) == 0x0f000000) {
+        return 3;
+    }
+
+    // MUL, MLA, and long multiplies
+    if ((i & 0x0f0000f0) == 0x00000090 && (i & 0x00c00000) != 0x00400000) {
+        *srcs |= 1u << ((i >> 8) & 0xf) | 1u << rd;
+        if (i & 0x00800000) {
+            return i & 0x00100000 ? 5 : 3;
+        }
+        return i & 0x00100000 ? 4 : 2;
+    }
+
+    // SWP
+    if ((i & 0x0fb00ff0) == 0x01000090) {
+        return 2;
+    }
+
+    // halfword and signed byte transfers, LDRD, STRD
+    if ((i & 0x0e000090) == 0x00000090 && (i & 0x60)) {
+        if (!(i & 0x00100000) && (i & 0x60) != 0x20) {
+            // LDRD, STRD
+            if (i & 0x20) {
+                *srcs |= 3u << rd;
+            } else {
+                *load_reg = rd + 1;
+                *load_latency = 2;
+            }
+            return 2;
+        }
+        if (i & 0x00100000) {
+            *load_reg = rd;
+            *load_latency = 3;
+        } else {
+            *srcs |= 1u << rd;
+        }
+        return 1;
+    }
+
+    // signed multiplies (SMLAxy etc.), QADD etc., MRS, MSR, CLZ
+    if ((i & 0x0f900000) == 0x01000000 && (i & 0x90) != 0x90) {
+        if ((i & 0x0f900090) == 0x01000080) {
+            *srcs |= 1u << ((i >> 8) & 0xf) | 1u << rd;
+            return (i & 0x00600000) == 0x00400000 ? 2 : 1;
+        }
+        if ((i & 0x0fb000f0) == 0x01000000) {
+            return 2;
+        }
+        if ((i & 0x0fb000f0) == 0x01200000) {
+            return (i & 0x00070000) ? 3 : 1;
+        }
+        return 1;
+    }
+
+    // data processing
+    if ((i & 0x0c000000) == 0x00000000) {
+        unsigned op = (i >> 21) & 0xf;
+
+        n = 1;
+        if (!(i & 0x02000000) && (i & 0x10)) {
+            *srcs |= 1u << ((i >> 8) & 0xf);
+            n++;
+        }
+        // TST, TEQ, CMP, CMN do not write rd
+        if (rd == ARM_REG_PC && (op < 8 || op > 11)) {
+            *branch = true;
+            n += 2;
+        }
+        return n;
+    }
+
+    // LDR, STR, LDRB, STRB
+    if ((i & 0x0c000000) == 0x04000000) {
+        if (!(i & 0x00100000)) {
+            *srcs |= 1u << rd;
+            return 1;
+        }
+        if (rd == ARM_REG_PC) {
+            *branch = true;
+            return 5;
+        }
+        *load_reg = rd;
+        *load_latency = i & 0x00400000 ? 3 : 2;
+        return 1;
+    }
+
+    // LDM, STM
+    if ((i & 0x0e000000) == 0x08000000) {
+        n = __builtin_popcount(i & 0xffff);
+        n = n < 2 ? 2 : n;
+        if ((i & 0x00100000) && (i & (1u << ARM_REG_PC))) {
+            *branch = true;
+            n += 4;
+        }
+        if (!(i & 0x00100000)) {
+            *srcs |= i & 0xffff;
+        }
+        return n;
+    }
+
+    // MRC, MCR
+    if ((i & 0x0f000010) == 0x0e000010) {
+        return 2;
+    }
+
+    return 1;
+}
+
+// as arm_cycles, for Thumb instructions (without BL, handled by the caller)
+static unsigned thumb_cycles(uint16_t i, bool *branch, uint16_t *srcs,
+                             int *load_reg, unsigned *load_latency)
+{
+    unsigned n;
+
+    *srcs = 1u << ((i >> 3) & 7) | 1u << ((i >> 6) & 7);
+
+    // SWI
+    if ((i & 0xff00) == 0xdf00) {
+        return 3;
+    }
+
+    // B (conditional and unconditional)
+    if ((i & 0xf000) == 0xd000 || (i & 0xf800) == 0xe000) {
+        *branch = true;
+        return BRANCH_TAKEN;
+    }
+
+    // BX, BLX (register)
+    if ((i & 0xff00) == 0x4700) {
+        *branch = true;
+        return BRANCH_TAKEN;
+    }
+
+    // ADD, MOV with pc as destination
+    if ((i & 0xfd87) == 0x4487) {
+        *branch = true;
+        return 3;
+    }
+
+    // data processing, reading rd as well
+    if ((i & 0xfc00) == 0x4000) {
+        *srcs |= 1u << (i & 7);
+        // MUL
+        return (i & 0xffc0) == 0x4340 ? 4 : 1;
+    }
+
+    // STR, STRB, STRH (register and immediate offset, sp-relative)
+    if ((i & 0xfe00) == 0x5000 || (i & 0xfe00) == 0x5200 || (i & 0xfe00) == 0x5400
+            || (i & 0xf800) == 0x6000 || (i & 0xf800) == 0x7000
+            || (i & 0xf800) == 0x8000) {
+        *srcs |= 1u << (i & 7);
+        return 1;
+    }
+    if ((i & 0xf800) == 0x9000) {
+        *srcs = 1u << ((i >> 8) & 7);
+        return 1;
+    }
+
+    // LDR (register, immediate, pc- and sp-relative)
+    if ((i & 0xfe00) == 0x5800 || (i & 0xf800) == 0x6800) {
+        *load_reg = i & 7;
+        *load_latency = 2;
+        return 1;
+    }
+    if ((i & 0xf800) == 0x4800 || (i & 0xf800) == 0x9800) {
+        *load_reg = (i >> 8) & 7;
+        *load_latency = 2;
+        return 1;
+    }
+
+    // LDRB, LDRH, LDRSB, LDRSH
+    if ((i & 0xf000) == 0x5000 || (i & 0xf800) == 0x7800 || (i & 0xf800) == 0x8800) {
+        *load_reg = i & 7;
+        *load_latency = 3;
+        return 1;
+    }
+
+    // PUSH, POP
+    if ((i & 0xf600) == 0xb400) {
+        n = __builtin_popcount(i & 0x1ff);
+        n = n < 2 ? 2 : n;
+        if ((i & 0xff00) == 0xbd00) {
+            *branch = true;
+            n += 4;
+        }
+        return n;
+    }
+
+    // LDMIA, STMIA
+    if ((i & 0xf000) == 0xc000) {
+        n = __builtin_popcount(i & 0xff);
+        return n < 2 ? 2 : n;
+    }
+
+    return 1;
+}
+
+static void vcpu_tb_exec(unsigned int cpu_index, void *udata)
+{
+    Block *block = udata;
+    uint64_t penalty = 0;
+    uint32_t line;
+
+    // dynamic penalties of the previous block, and its branch outcome
+    if (last_block) {
+        if (last_block->branch && block->vaddr == last_block->end) {
+            // the issue cycles have been counted for a taken branch
+            last_block->sym->count -= BRANCH_TAKEN - BRANCH_NOT_TAKEN;
+            cycles -= BRANCH_TAKEN - BRANCH_NOT_TAKEN;
+            core_cycles -= BRANCH_TAKEN - BRANCH_NOT_TAKEN;
+            not_taken++;
+        }
+        last_block->sym->count += pending;
+        cycles += pending;
+        pending = 0;
+    }
+
+    for (line = block->first_line; line <= block->last_line; line++) {
+        if (block->region->uncached) {
+            continue;
+        }
+        if (!cache_access(&icache, line, true)) {
+            uint64_t n = region_cycles(block->region, icache.line / 4);
+
+            icache.stall += n;
+            penalty += n;
+        }
+    }
+
+    // uncached code is fetched word by word
+    if (block->region->uncached) {
+        uint64_t n = block->n_insns * region_cycles(block->region, 1);
+
+        uncached_stall += n;
+        penalty += n;
+    }
+
+    insns += block->n_insns;
+    core_cycles += block->cycles;
+    cycles += block->cycles + penalty;
+    block->sym->count += block->cycles + penalty;
+    last_block = block;
+
+    // stall the vCPU by the estimated time exceeding the accounted time
+    if (insn_ns) {
+        uint64_t target = cycles * 1000 / freq_mhz / insn_ns;
+
+        if (target > insns + stalled) {
+            qemu_plugin_vcpu_icount_stall(cpu_index, target - insns - stalled);
+            stalled = target - insns;
+        } else if (target < insns) {
+            underrun = true;
+        }
+    }
+}
+
+static void vcpu_mem(unsigned int cpu_index, qemu_plugin_meminfo_t meminfo,
+                     uint64_t vaddr, void *udata)
+{
+    struct qemu_plugin_hwaddr *hw = qemu_plugin_get_hwaddr(meminfo, vaddr);
+    bool store = qemu_plugin_mem_is_store(meminfo);
+    Region *r;
+    uint64_t n;
+
+    if (hw && qemu_plugin_hwaddr_is_io(hw)) {
+        // peripherals are neither cacheable nor bufferable
+        io_accesses++;
+        io_stall += io_cycles;
+        pending += io_cycles;
+        return;
+    }
+
+    r = region_lookup(vaddr);
+
+    if (r->uncached) {
+        // stores are absorbed by the write buffer
+        if (store) {
+            uncached_stores++;
+        } else {
+            n = region_cycles(r, 1);
+            uncached_loads++;
+            uncached_stall += n;
+            pending += n;
+        }
+        return;
+    }
+
+    if (!cache_access(&dcache, vaddr / dcache.line, !store) && !store) {
+        n = region_cycles(r, dcache.line / 4);
+        dcache.stall += n;
+        pending += n;
+    }
+}
+
+static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+    uint64_t vaddr = qemu_plugin_tb_vaddr(tb);
+    size_t n = qemu_plugin_tb_n_insns(tb);
+    Block *block = g_hash_table_lookup(blocks, &vaddr);
+    bool create = !block || block->n_insns != n;
+    int load_reg = -1;
+    unsigned load_latency = 0;
+    bool thumb = vaddr & 2;
+    size_t i;
+
+    // the state is not known here, but Thumb blocks consisting of a BL only are rare
+    for (i = 0; i < n; i++) {
+        thumb |= qemu_plugin_insn_size(qemu_plugin_tb_get_insn(tb, i)) == 2;
+    }
+
+    // blocks are never freed, reuse them on retranslation
+    if (create) {
+        block = g_new0(Block, 1);
+        block->vaddr = vaddr;
+        block->n_insns = n;
+        block->region = region_lookup(vaddr);
+        block->sym = elf_symbol_lookup(elf, vaddr);
+    }
+
+    block->cycles = 0;
+
+    for (i = 0; i < n; i++) {
+        struct qemu_plugin_insn *insn = qemu_plugin_tb_get_insn(tb, i);
+        const uint8_t *data = qemu_plugin_insn_data(insn);
+        size_t size = qemu_plugin_insn_size(insn);
+        bool branch = false;
+        uint16_t srcs = 0;
+        int next_load_reg = -1;
+        unsigned next_latency = 0;
+        unsigned c;
+
+        if (thumb && size == 4) {
+            // BL and BLX (immediate), a pair of 16-bit instructions
+            branch = true;
+            c = 1 + BRANCH_TAKEN;
+        } else if (size == 4) {
+            uint32_t word = data[0] | data[1] << 8 | data[2] << 16
+                          | (uint32_t)data[3] << 24;
+
+            c = arm_cycles(word, &branch, &srcs, &next_load_reg, &next_latency);
+        } else {
+            c = thumb_cycles(data[0] | data[1] << 8, &branch, &srcs,
+                             &next_load_reg, &next_latency);
+        }
+
+        // load-use interlock
+        if (load_reg >= 0 && (srcs & (1u << load_reg))) {
+            c += load_latency - 1;
+        }
+        load_reg = next_load_reg;
+        load_latency = next_latency;
+
+        block->cycles += c;
+        block->branch = branch;
+        block->end = qemu_plugin_insn_vaddr(insn) + size;
+
+        qemu_plugin_register_vcpu_mem_cb(insn, vcpu_mem, QEMU_PLUGIN_CB_NO_REGS,
+                                         QEMU_PLUGIN_MEM_RW, NULL);
+    }
+
+    block->first_line = vaddr / icache.line;
+    block->last_line = (block->end - 1) / icache.line;
+
+    if (create) {
+        g_hash_table_insert(blocks, &block->vaddr, block);
+    }
+
+    qemu_plugin_register_vcpu_tb_exec_cb(tb, vcpu_tb_exec, QEMU_PLUGIN_CB_NO_REGS,
+                                         block);
+}
+
+
+static void report_cache(GString *report, Cache *c)
+{
+    uint64_t total = c->hits + c->misses;
+
+    g_string_append_printf(report, "%-8s %14" PRIu64 " %14" PRIu64 " %8.3f%% %14"
+                           PRIu64 "   (%u KiB, %u-way, %u B lines)\n", c->name,
+                           c->hits, c->misses, total ? 100.0 * c->misses / total : 0.0,
+                           c->stall, c->size / 1024, c->ways, c->line);
+}
+
+static gint symbol_cycles_cmp(gconstpointer a, gconstpointer b)
+{
+    const Symbol *sa = *(Symbol **)a;
+    const Symbol *sb = *(Symbol **)b;
+
+    return sa->count > sb->count ? -1 : sa->count < sb->count;
+}
+
+static void plugin_exit(qemu_plugin_id_t id, void *p)
+{
+    g_autoptr(GString) report = g_string_new("");
+    int i;
+
+    if (last_block) {
+        last_block->sym->count += pending;
+        cycles += pending;
+        pending = 0;
+    }
+
+    g_string_append_printf(report, "instructions: %" PRIu64 ", cycles: %" PRIu64
+                           " (CPI %.2f), estimated time: %.3f ms at %u MHz\n",
+                           insns, cycles, insns ? (double)cycles / insns : 0.0,
+                           cycles / (freq_mhz * 1e3), freq_mhz);
+    g_string_append_printf(report, "core: %" PRIu64 " cycles, branches not taken: %"
+                           PRIu64 "\n\n", core_cycles, not_taken);
+
+    g_string_append_printf(report, "%-8s %14s %14s %9s %14s\n", "", "hits", "misses",
+                           "rate", "stall cycles");
+    report_cache(report, &icache);
+    report_cache(report, &dcache);
+    g_string_append_printf(report, "uncached %14" PRIu64 " loads %8" PRIu64
+                           " stores %14" PRIu64 "\n", uncached_loads, uncached_stores,
+                           uncached_stall);
+    g_string_append_printf(report, "io       %14" PRIu64 " accesses %20" PRIu64 "\n",
+                           io_accesses, io_stall);
+
+    if (insn_ns) {
+        g_string_append_printf(report, "\nvirtual clock: %" PRIu64 " ns per instruction,"
+                               " %.3f ms stalled\n", insn_ns,
+                               stalled * insn_ns / 1e6);
+        if (underrun) {
+            g_string_append(report, "warning: the time per instruction exceeds the "
+                            "estimate, use a smaller -icount shift\n");
+        }
+    } else {
+        g_string_append(report, "\nvirtual clock: not driven (requires -icount "
+                        "with a fixed shift)\n");
+    }
+
+    if (elf) {
+        GPtrArray *list = g_ptr_array_new();
+
+        for (i = 0; i < elf->symbols->len; i++) {
+            Symbol *sym = &g_array_index(elf->symbols, Symbol, i);
+
+            if (sym->count) {
+                g_ptr_array_add(list, sym);
+            }
+        }
+        if (symbol_unknown.count) {
+            g_ptr_array_add(list, &symbol_unknown);
+        }
+        g_ptr_array_sort(list, symbol_cycles_cmp);
+
+        g_string_append_printf(report, "\n%14s %7s %12s  %s\n", "cycles", "share",
+                               "time [ms]", "function");
+        for (i = 0; i < list->len && i < top_n; i++) {
+            Symbol *sym = g_ptr_array_index(list, i);
+
+            g_string_append_printf(report, "%14" PRIu64 " %6.2f%% %12.3f  %s\n",
+                                   sym->count, 100.0 * sym->count / cycles,
+                                   sym->count / (freq_mhz * 1e3), sym->name);
+        }
+
+        g_ptr_array_free(list, true);
+    }
+
+    qemu_plugin_outs(report->str);
+}
+
+QEMU_PLUGIN_EXPORT
+int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
+                        int argc, char **argv)
+{
+    int i, j;
+
+    for (i = 0; i < argc; i++) {
+        char *opt = argv[i];
+        bool ok = true;
+
+        if (g_str_has_prefix(opt, "freq=")) {
+            freq_mhz = strtoul(opt + 5, NULL, 0);
+            ok = freq_mhz > 0;
+        } else if (g_str_has_prefix(opt, "icache=")) {
+            ok = parse_cache(opt + 7, &icache);
+        } else if (g_str_has_prefix(opt, "dcache=")) {
+            ok = parse_cache(opt + 7, &dcache);
+        } else if (g_str_has_prefix(opt, "sdram=")) {
+            ok = parse_pair(opt + 6, &sdram_first, &sdram_next);
+        } else if (g_str_has_prefix(opt, "sram=")) {
+            ok = parse_pair(opt + 5, &sram_first, &sram_next);
+        } else if (g_str_has_prefix(opt, "flash=")) {
+            ok = parse_pair(opt + 6, &flash_first, &flash_next);
+        } else if (g_str_has_prefix(opt, "io=")) {
+            io_cycles = strtoul(opt + 3, NULL, 0);
+        } else if (g_str_has_prefix(opt, "uncached=")) {
+            g_auto(GStrv) names = g_strsplit(opt + 9, ":", -1);
+            int k;
+
+            for (k = 0; names[k]; k++) {
+                bool found = false;
+
+                for (j = 0; j < ARRAY_SIZE(regions); j++) {
+                    if (!strcmp(regions[j].name, names[k])) {
+                        regions[j].uncached = true;
+                        found = true;
+                    }
+                }
+                ok &= found;
+            }
+        } else if (g_str_has_prefix(opt, "bus-load=")) {
+            bus_load = strtoul(opt + 9, NULL, 0);
+            ok = bus_load < 100;
+        } else if (g_str_has_prefix(opt, "elf=")) {
+            elf = elf_load("iobctime", opt + 4, false);
+            if (!elf) {
+                return -1;
+            }
+        } else if (g_str_has_prefix(opt, "top=")) {
+            top_n = strtoul(opt + 4, NULL, 0);
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            fprintf(stderr, "option parsing failed: %s\n", opt);
+            return -1;
+        }
+    }
+
+    if (!cache_init(&icache) || !cache_init(&dcache)) {
+        return -1;
+    }
+
+    insn_ns = qemu_plugin_icount_insn_ns();
+    if (insn_ns * freq_mhz > 1000) {
+        fprintf(stderr, "iobctime: an instruction takes longer than a cycle at "
+                "%u MHz, use a smaller -icount shift\n", freq_mhz);
+    }
+
+    blocks = g_hash_table_new(g_int64_hash, g_int64_equal);
+
+    qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
+    qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
+    return 0;
+}
@@ -0,0 +1,312 @@
+/*
+ * QTest testcase for the AT91 Advanced Interrupt Controller of the ISIS iOBC.
+ *
+ * Interrupts are raised via the software-set register (AIC_ISCR), which only
+ * affects edge-triggered sources. Delivery of nIRQ to the core is observed
+ * via the core interrupt status register (AIC_CISR), which mirrors the state
+ * of the nIRQ/nFIQ lines. Interrupt statistics are checked via the QMP
+ * command query-iobc-irq-stats, with the qtest clock providing exact times.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+#include "qapi/qmp/qdict.h"
+#include "qapi/qmp/qlist.h"
+#include "qapi/qmp/qnum.h"
+
+#define AIC_BASE            0xFFFFF000
+
+#define AIC_SMR(n)          (AIC_BASE + 0x000 + (n) * 4)
+#define AIC_SVR(n)          (AIC_BASE + 0x080 + (n) * 4)
+#define AIC_IVR             (AIC_BASE + 0x100)
+#define AIC_ISR             (AIC_BASE + 0x108)
+#define AIC_IPR             (AIC_BASE + 0x10C)
+#define AIC_CISR            (AIC_BASE + 0x114)
+#define AIC_IECR            (AIC_BASE + 0x120)
+#define AIC_IDCR            (AIC_BASE + 0x124)
+#define AIC_ICCR            (AIC_BASE + 0x128)
+#define AIC_ISCR            (AIC_BASE + 0x12C)
+#define AIC_EOICR           (AIC_BASE + 0x130)
+#define AIC_SPU             (AIC_BASE + 0x134)
+
+#define CISR_NIRQ           0x01
+
+#define SMR_RISING          (0x03 << 5)
+
+#define SVR_VALUE(n)        (0x1000 + (n))
+#define SPU_VALUE           0xDEAD
+
+#define BENCH_ITERATIONS    20000
+
+
+static QTestState *aic_init(void)
+{
+    QTestState *qts = qtest_init("-M isis-obc");
+    int i;
+
+    for (i = 0; i < 32; i++) {
+        qtest_writel(qts, AIC_SVR(i), SVR_VALUE(i));
+    }
+    qtest_writel(qts, AIC_SPU, SPU_VALUE);
+
+    return qts;
+}
+
+static void aic_setup_source(QTestState *qts, int irq, int pri)
+{
+    qtest_writel(qts, AIC_SMR(irq), SMR_RISING | pri);
+    qtest_writel(qts, AIC_IECR, 1 << irq);
+}
+
+static uint32_t aic_enter(QTestState *qts)
+{
+    return qtest_readl(qts, AIC_IVR);
+}
+
+static void aic_leave(QTestState *qts)
+{
+    qtest_writel(qts, AIC_EOICR, 0);
+}
+
+static void test_priority(void)
+{
+    QTestState *qts = aic_init();
+
+    aic_setup_source(qts, 9, 3);
+    aic_setup_source(qts, 17, 6);
+    aic_setup_source(qts, 18, 6);
+    aic_setup_source(qts, 20, 1);
+
+    g_assert_cmphex(qtest_readl(qts, AIC_CISR) & CISR_NIRQ, ==, 0);
+
+    qtest_writel(qts, AIC_ISCR, BIT(9) | BIT(17) | BIT(18) | BIT(20));
+    g_assert_cmphex(qtest_readl(qts, AIC_IPR), ==,
+                    BIT(9) | BIT(17) | BIT(18) | BIT(20));
+    g_assert_cmphex(qtest_readl(qts, AIC_CISR) & CISR_NIRQ, ==, CISR_NIRQ);
+
+    // highest priority first, lowest source number on equal priority
+    g_assert_cmphex(aic_enter(qts), ==, SVR_VALUE(17));
+    g_assert_cmphex(qtest_readl(qts, AIC_ISR), ==, 17);
+    aic_leave(qts);
+
+    g_assert_cmphex(aic_enter(qts), ==, SVR_VALUE(18));
+    g_assert_cmphex(qtest_readl(qts, AIC_ISR), ==, 18);
+    aic_leave(qts);
+
+    g_assert_cmphex(aic_enter(qts), ==, SVR_VALUE(9));
+    aic_leave(qts);
+
+    g_assert_cmphex(aic_enter(qts), ==, SVR_VALUE(20));
+    aic_leave(qts);
+
+    // nothing left: spurious
+    g_assert_cmphex(qtest_readl(qts, AIC_CISR) & CISR_NIRQ, ==, 0);
+    g_assert_cmphex(aic_enter(qts), ==, SPU_VALUE);
+    aic_leave(qts);
+
+    qtest_quit(qts);
+}
+
+static void test_reprioritize(void)
+{
+    QTestState *qts = aic_init();
+
+    aic_setup_source(qts, 9, 3);
+    aic_setup_source(qts, 17, 6);
+    qtest_writel(qts, AIC_ISCR, BIT(9) | BIT(17));
+
+    // change priority while pending
+    qtest_writel(qts, AIC_SMR(9), SMR_RISING | 7);
+    g_assert_cmphex(aic_enter(qts), ==, SVR_VALUE(9));
+    aic_leave(qts);
+
+    // disabled sources do not take part in arbitration
+    qtest_writel(qts, AIC_ISCR, BIT(9));
+    qtest_writel(qts, AIC_IDCR, BIT(9));
+    g_assert_cmphex(aic_enter(qts), ==, SVR_VALUE(17));
+    aic_leave(qts);
+
+    g_assert_cmphex(qtest_readl(qts, AIC_CISR) & CISR_NIRQ, ==, 0);
+    qtest_writel(qts, AIC_IECR, BIT(9));
+    g_assert_cmphex(qtest_readl(qts, AIC_CISR) & CISR_NIRQ, ==, CISR_NIRQ);
+    qtest_writel(qts, AIC_ICCR, BIT(9));
+    g_assert_cmphex(qtest_readl(qts, AIC_CISR) & CISR_NIRQ, ==, 0);
+
+    qtest_quit(qts);
+}
+
+static void test_nesting(void)
+{
+    QTestState *qts = aic_init();
+
+    aic_setup_source(qts, 9, 3);
+    aic_setup_source(qts, 17, 6);
+    aic_setup_source(qts, 20, 1);
+
+    qtest_writel(qts, AIC_ISCR, BIT(9));
+    g_assert_cmphex(aic_enter(qts), ==, SVR_VALUE(9));
+    g_assert_cmphex(qtest_readl(qts, AIC_CISR) & CISR_NIRQ, ==, 0);
+
+    // lower priority must not preempt the current interrupt
+    qtest_writel(qts, AIC_ISCR, BIT(20));
+    g_assert_cmphex(qtest_readl(qts, AIC_CISR) & CISR_NIRQ, ==, 0);
+
+    // higher priority preempts
+    qtest_writel(qts, AIC_ISCR, BIT(17));
+    g_assert_cmphex(qtest_readl(qts, AIC_CISR) & CISR_NIRQ, ==, CISR_NIRQ);
+    g_assert_cmphex(aic_enter(qts), ==, SVR_VALUE(17));
+    g_assert_cmphex(qtest_readl(qts, AIC_ISR), ==, 17);
+    g_assert_cmphex(qtest_readl(qts, AIC_CISR) & CISR_NIRQ, ==, 0);
+    aic_leave(qts);
+
+    // back to source 9, which still blocks source 20
+    g_assert_cmphex(qtest_readl(qts, AIC_ISR), ==, 9);
+    g_assert_cmphex(qtest_readl(qts, AIC_CISR) & CISR_NIRQ, ==, 0);
+    aic_leave(qts);
+
+    g_assert_cmphex(qtest_readl(qts, AIC_CISR) & CISR_NIRQ, ==, CISR_NIRQ);
+    g_assert_cmphex(aic_enter(qts), ==, SVR_VALUE(20));
+    aic_leave(qts);
+
+    qtest_quit(qts);
+}
+
+static QDict *aic_source_stats(QDict *stats, int irq)
+{
+    const QListEntry *entry;
+
+    QLIST_FOREACH_ENTRY(qdict_get_qlist(stats, "sources"), entry) {
+        QDict *src = qobject_to(QDict, qlist_entry_obj(entry));
+
+        if (qdict_get_int(src, "irq") == irq) {
+            return src;
+        }
+    }
+
+    g_assert_not_reached();
+}
+
+static void aic_check_hist(QDict *src, const char *name, int64_t value)
+{
+    QDict *hist = qdict_get_qdict(src, name);
+
+    g_assert_cmpint(qdict_get_int(hist, "count"), ==, 1);
+    g_assert_cmpint(qdict_get_int(hist, "total"), ==, value);
+    g_assert_cmpint(qdict_get_int(hist, "min"), ==, value);
+    g_assert_cmpint(qdict_get_int(hist, "max"), ==, value);
+}
+
+static void test_stats(void)
+{
+    QTestState *qts = aic_init();
+    const QListEntry *entry;
+    QDict *rsp, *stats, *src;
+    int i;
+
+    aic_setup_source(qts, 9, 3);
+    aic_setup_source(qts, 17, 6);
+
+    qtest_writel(qts, AIC_ISCR, BIT(9));
+    qtest_clock_step(qts, 1000);
+    g_assert_cmphex(aic_enter(qts), ==, SVR_VALUE(9));
+
+    // nested interrupt
+    qtest_writel(qts, AIC_ISCR, BIT(17));
+    qtest_clock_step(qts, 200);
+    g_assert_cmphex(aic_enter(qts), ==, SVR_VALUE(17));
+    qtest_clock_step(qts, 300);
+    aic_leave(qts);
+    qtest_clock_step(qts, 400);
+    aic_leave(qts);
+
+    g_assert_cmphex(aic_enter(qts), ==, SPU_VALUE);
+    aic_leave(qts);
+
+    rsp = qtest_qmp(qts, "{ 'execute': 'query-iobc-irq-stats',"
+                         "  'arguments': { 'reset': true } }");
+    stats = qdict_get_qdict(rsp, "return");
+
+    src = aic_source_stats(stats, 9);
+    g_assert_cmpint(qdict_get_int(src, "priority"), ==, 3);
+    g_assert_cmpint(qdict_get_int(src, "asserted"), ==, 1);
+    g_assert_cmpint(qdict_get_int(src, "serviced"), ==, 1);
+    aic_check_hist(src, "latency", 1000);
+    aic_check_hist(src, "service", 900);
+
+    src = aic_source_stats(stats, 17);
+    g_assert_cmpint(qdict_get_int(src, "priority"), ==, 6);
+    g_assert_cmpint(qdict_get_int(src, "asserted"), ==, 1);
+    g_assert_cmpint(qdict_get_int(src, "serviced"), ==, 1);
+    aic_check_hist(src, "latency", 200);
+    aic_check_hist(src, "service", 300);
+
+    g_assert_cmpint(qdict_get_int(stats, "spurious"), ==, 1);
+    g_assert_cmpint(qdict_get_int(stats, "depth"), ==, 0);
+    g_assert_cmpint(qdict_get_int(stats, "max-nesting"), ==, 2);
+
+    // one IVR read at depth two, two (including the spurious one) at depth one
+    i = 0;
+    QLIST_FOREACH_ENTRY(qdict_get_qlist(stats, "nesting"), entry) {
+        g_assert_cmpint(qnum_get_int(qobject_to(QNum, qlist_entry_obj(entry))), ==,
+                        i == 0 ? 2 : i == 1 ? 1 : 0);
+        i++;
+    }
+    qobject_unref(rsp);
+
+    // all counts have been reset by the previous query
+    rsp = qtest_qmp(qts, "{ 'execute': 'query-iobc-irq-stats' }");
+    stats = qdict_get_qdict(rsp, "return");
+    g_assert_cmpint(qdict_get_int(stats, "spurious"), ==, 0);
+    g_assert_cmpint(qdict_get_int(stats, "max-nesting"), ==, 0);
+    qobject_unref(rsp);
+
+    qtest_quit(qts);
+}
+
+static void test_throughput(void)
+{
+    QTestState *qts = aic_init();
+    gint64 start, elapsed;
+    int i, irq;
+
+    for (irq = 2; irq < 29; irq++) {
+        aic_setup_source(qts, irq, irq % 8);
+    }
+
+    start = g_get_monotonic_time();
+    for (i = 0; i < BENCH_ITERATIONS; i++) {
+        irq = 2 + (i % 27);
+
+        qtest_writel(qts, AIC_ISCR, 1 << irq);
+        g_assert_cmphex(aic_enter(qts), ==, SVR_VALUE(irq));
+        aic_leave(qts);
+    }
+    elapsed = g_get_monotonic_time() - start;
+
+    g_test_message("%d interrupts (ISCR/IVR/EOICR) in %" PRId64 " us: "
+                   "%.1f kIRQ/s", BENCH_ITERATIONS, elapsed,
+                   BENCH_ITERATIONS * 1e3 / MAX(elapsed, 1));
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/iobc/aic/priority", test_priority);
+    qtest_add_func("/iobc/aic/reprioritize", test_reprioritize);
+    qtest_add_func("/iobc/aic/nesting", test_nesting);
+    qtest_add_func("/iobc/aic/stats", test_stats);
+
+    if (g_test_perf()) {
+        qtest_add_func("/iobc/aic/throughput", test_throughput);
+    }
+
+    return g_test_run();
+}
@@ -0,0 +1,176 @@
+/*
+ * QTest testcase for the fault policies of the ISIS iOBC.
+ *
+ * Runs a small program from the NOR flash (mapped at the boot memory) which
+ * reads the write-only RSTC control register, i.e. performs an illegal read
+ * access, and checks the outcome for each policy. The program stores the
+ * value read plus one to SRAM0 + 4 and the link register of the data abort
+ * handler to SRAM0 + 0.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+#include "qapi/qmp/qdict.h"
+
+#define ADDR_PFLASH         0x10000000
+#define ADDR_SRAM0          0x00200000
+
+#define RSTC_CR             0xFFFFFD00
+
+#define RESULT_ABT_LR       (ADDR_SRAM0 + 0x00)
+#define RESULT_VALUE        (ADDR_SRAM0 + 0x04)
+
+// program counter of the faulting load
+#define FAULT_PC            0x2C
+
+#define POLL_TIMEOUT_US     (5 * G_USEC_PER_SEC)
+
+
+static const uint32_t program[] = {
+    0xEA000006,     // 0x00: b      0x20                reset
+    0xEAFFFFFE,     // 0x04: b      .                   undefined
+    0xEAFFFFFE,     // 0x08: b      .                   swi
+    0xEAFFFFFE,     // 0x0C: b      .                   prefetch abort
+    0xE584E000,     // 0x10: str    lr, [r4]            data abort
+    0xEAFFFFFE,     // 0x14: b      .
+    0xEAFFFFFE,     // 0x18: b      .                   irq
+    0xEAFFFFFE,     // 0x1C: b      .                   fiq
+    0xE3A04602,     // 0x20: mov    r4, #0x00200000
+    0xE59F0014,     // 0x24: ldr    r0, [pc, #0x14]
+    0xE3A01055,     // 0x28: mov    r1, #0x55
+    0xE5901000,     // 0x2C: ldr    r1, [r0]
+    0xE2811001,     // 0x30: add    r1, r1, #1
+    0xE5841004,     // 0x34: str    r1, [r4, #4]
+    0xEAFFFFFE,     // 0x38: b      .
+    0x00000000,     // 0x3C:
+    RSTC_CR,        // 0x40:
+};
+
+
+static QTestState *fault_start(const char *policy)
+{
+    QTestState *qts;
+    QDict *rsp;
+    int i;
+
+    qts = qtest_initf("-M isis-obc,fault-policy=%s -accel tcg -S", policy);
+
+    for (i = 0; i < ARRAY_SIZE(program); i++) {
+        qtest_writel(qts, ADDR_PFLASH + i * 4, program[i]);
+    }
+
+    rsp = qtest_qmp(qts, "{ 'execute': 'cont' }");
+    g_assert(!qdict_haskey(rsp, "error"));
+    qobject_unref(rsp);
+
+    return qts;
+}
+
+static void fault_check_event(QTestState *qts, const char *policy)
+{
+    QDict *event = qtest_qmp_eventwait_ref(qts, "IOBC_FAULT");
+    QDict *data = qdict_get_qdict(event, "data");
+
+    g_assert_cmpstr(qdict_get_str(data, "source"), ==, "at91.rstc");
+    g_assert_cmphex(qdict_get_int(data, "address"), ==, RSTC_CR);
+    g_assert_false(qdict_get_bool(data, "write"));
+    g_assert_cmphex(qdict_get_int(data, "pc"), ==, FAULT_PC);
+    g_assert_cmpstr(qdict_get_str(data, "policy"), ==, policy);
+
+    qobject_unref(event);
+}
+
+static uint32_t fault_wait_result(QTestState *qts, uint64_t addr)
+{
+    int64_t end = g_get_monotonic_time() + POLL_TIMEOUT_US;
+    uint32_t value;
+
+    while (!(value = qtest_readl(qts, addr))) {
+        g_assert_cmpint(g_get_monotonic_time(), <, end);
+        g_usleep(1000);
+    }
+
+    return value;
+}
+
+static void test_log(void)
+{
+    QTestState *qts = fault_start("abort:at91.rstc=log");
+
+    fault_check_event(qts, "log");
+
+    // the read returns zero and execution continues
+    g_assert_cmphex(fault_wait_result(qts, RESULT_VALUE), ==, 1);
+    g_assert_cmphex(qtest_readl(qts, RESULT_ABT_LR), ==, 0);
+
+    qtest_quit(qts);
+}
+
+static void test_data_abort(void)
+{
+    QTestState *qts = fault_start("data-abort");
+
+    fault_check_event(qts, "data-abort");
+
+    // the abort handler is entered with LR pointing 8 bytes past the load
+    g_assert_cmphex(fault_wait_result(qts, RESULT_ABT_LR), ==, FAULT_PC + 8);
+    g_assert_cmphex(qtest_readl(qts, RESULT_VALUE), ==, 0);
+
+    qtest_quit(qts);
+}
+
+static void test_stop(void)
+{
+    QTestState *qts = fault_start("stop");
+    QDict *rsp;
+
+    fault_check_event(qts, "stop");
+    qtest_qmp_eventwait(qts, "STOP");
+
+    rsp = qtest_qmp(qts, "{ 'execute': 'query-status' }");
+    g_assert_cmpstr(qdict_get_str(qdict_get_qdict(rsp, "return"), "status"),
+                    ==, "paused");
+    qobject_unref(rsp);
+
+    // once resumed, the access is handled as with log
+    rsp = qtest_qmp(qts, "{ 'execute': 'cont' }");
+    g_assert(!qdict_haskey(rsp, "error"));
+    qobject_unref(rsp);
+
+    g_assert_cmphex(fault_wait_result(qts, RESULT_VALUE), ==, 1);
+
+    qtest_quit(qts);
+}
+
+static void test_abort(void)
+{
+    if (g_test_subprocess()) {
+        QTestState *qts = qtest_init("-M isis-obc,fault-policy=log:at91.rstc=abort");
+
+        // QEMU aborts, so this fails and does not return
+        qtest_readl(qts, RSTC_CR);
+        qtest_quit(qts);
+        return;
+    }
+
+    g_test_trap_subprocess(NULL, 0, 0);
+    g_test_trap_assert_failed();
+    g_test_trap_assert_stderr("*at91.rstc: illegal read access at 0x00*");
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/iobc/fault/log", test_log);
+    qtest_add_func("/iobc/fault/data-abort", test_data_abort);
+    qtest_add_func("/iobc/fault/stop", test_stop);
+    qtest_add_func("/iobc/fault/abort", test_abort);
+
+    return g_test_run();
+}
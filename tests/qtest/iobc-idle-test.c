@@ -0,0 +1,114 @@
+/*
+ * QTest testcase for turbo idle on the ISIS iOBC.
+ *
+ * Runs a small program from the NOR flash (mapped at the boot memory) which
+ * busy-waits for the PIT in an idle loop given as idle-pc. The PIT period is
+ * ten seconds of virtual time. With turbo-idle, the virtual clock is advanced
+ * to the PIT deadline while the CPU is halted at the idle loop, so the wait
+ * takes much less wall-clock time. The program stores the number of loop
+ * iterations to SRAM0 and sets a flag once done.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+#include "qapi/qmp/qdict.h"
+
+#define ADDR_PFLASH         0x10000000
+#define ADDR_SRAM0          0x00200000
+#define ADDR_AIC            0xFFFFF000
+#define ADDR_RTT            0xFFFFFD20
+#define ADDR_PIT            0xFFFFFD30
+
+#define RESULT_DONE         (ADDR_SRAM0 + 0x00)
+#define RESULT_ITERATIONS   (ADDR_SRAM0 + 0x04)
+
+#define AIC_IECR            (ADDR_AIC + 0x120)
+#define RTT_VR              (ADDR_RTT + 0x08)
+#define PIT_MR              (ADDR_PIT + 0x00)
+
+// PITEN and PITIEN, 10 s period at MCK/16 = 2048 Hz after reset
+#define PIT_PERIOD_S        10
+#define PIT_MR_VALUE        (BIT(24) | BIT(25) | (PIT_PERIOD_S * 2048 - 1))
+
+#define IDLE_PC             0x28
+
+#define POLL_TIMEOUT_US     (5 * G_USEC_PER_SEC)
+
+
+static const uint32_t program[] = {
+    0xEA000006,     // 0x00: b      0x20                reset
+    0xEAFFFFFE,     // 0x04: b      .                   undefined
+    0xEAFFFFFE,     // 0x08: b      .                   swi
+    0xEAFFFFFE,     // 0x0C: b      .                   prefetch abort
+    0xEAFFFFFE,     // 0x10: b      .                   data abort
+    0xEAFFFFFE,     // 0x14: b      .
+    0xEAFFFFFE,     // 0x18: b      .                   irq
+    0xEAFFFFFE,     // 0x1C: b      .                   fiq
+    0xE59F0024,     // 0x20: ldr    r0, [pc, #0x24]     PIT
+    0xE3A02000,     // 0x24: mov    r2, #0
+    0xE2822001,     // 0x28: add    r2, r2, #1          idle loop
+    0xE5901004,     // 0x2C: ldr    r1, [r0, #4]        SR
+    0xE3110001,     // 0x30: tst    r1, #1              PITS
+    0x0AFFFFFB,     // 0x34: beq    0x28
+    0xE3A04602,     // 0x38: mov    r4, #0x00200000
+    0xE5842004,     // 0x3C: str    r2, [r4, #4]
+    0xE3A01001,     // 0x40: mov    r1, #1
+    0xE5841000,     // 0x44: str    r1, [r4]
+    0xEAFFFFFE,     // 0x48: b      .
+    0xFFFFFD30,     // 0x4C:
+};
+
+
+static void test_turbo(void)
+{
+    int64_t start, end;
+    QTestState *qts;
+    QDict *rsp;
+    int i;
+
+    qts = qtest_initf("-M isis-obc,idle-pc=0x%x,turbo-idle=on -accel tcg -S", IDLE_PC);
+
+    for (i = 0; i < ARRAY_SIZE(program); i++) {
+        qtest_writel(qts, ADDR_PFLASH + i * 4, program[i]);
+    }
+
+    // the interrupt stays masked in the CPU, it only ends the idle state
+    qtest_writel(qts, AIC_IECR, BIT(1));
+    qtest_writel(qts, PIT_MR, PIT_MR_VALUE);
+
+    start = g_get_monotonic_time();
+    end = start + POLL_TIMEOUT_US;
+
+    rsp = qtest_qmp(qts, "{ 'execute': 'cont' }");
+    g_assert(!qdict_haskey(rsp, "error"));
+    qobject_unref(rsp);
+
+    while (!qtest_readl(qts, RESULT_DONE)) {
+        g_assert_cmpint(g_get_monotonic_time(), <, end);
+        g_usleep(1000);
+    }
+
+    // the RTT counts virtual seconds: the PIT deadline has been reached in
+    // less wall-clock time than virtual time
+    g_assert_cmpint(g_get_monotonic_time() - start, <, PIT_PERIOD_S * G_USEC_PER_SEC);
+    g_assert_cmpuint(qtest_readl(qts, RTT_VR), >=, PIT_PERIOD_S - 1);
+
+    // the CPU is halted at the idle loop instead of spinning in it
+    g_assert_cmpuint(qtest_readl(qts, RESULT_ITERATIONS), ==, 1);
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/iobc/idle/turbo", test_turbo);
+
+    return g_test_run();
+}
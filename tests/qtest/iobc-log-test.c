@@ -0,0 +1,118 @@
+/*
+ * QTest testcase for the emulator logging channel of the ISIS iOBC.
+ *
+ * Hands messages placed in SRAM0 to the logging channel and checks the
+ * resulting output, including the line time stamps, as well as the rejection
+ * of overlong messages.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+#include "qapi/qmp/qdict.h"
+
+#define ADDR_SRAM0          0x00200000
+#define ADDR_LOG            0x90000000
+
+#define LOG_ADDR            (ADDR_LOG + 0x00)
+#define LOG_LEN             (ADDR_LOG + 0x04)
+
+
+static QTestState *log_start(const char *path, const char *policy)
+{
+    return qtest_initf("-M isis-obc,log=log0,fault-policy=%s "
+                       "-chardev file,id=log0,path=%s", policy, path);
+}
+
+static void log_write(QTestState *qts, const char *msg)
+{
+    qtest_memwrite(qts, ADDR_SRAM0, msg, strlen(msg));
+    qtest_writel(qts, LOG_ADDR, ADDR_SRAM0);
+    qtest_writel(qts, LOG_LEN, strlen(msg));
+}
+
+static char *log_finish(QTestState *qts, const char *path)
+{
+    char *out;
+
+    qtest_quit(qts);
+
+    g_assert(g_file_get_contents(path, &out, NULL, NULL));
+    unlink(path);
+
+    return out;
+}
+
+static void test_output(void)
+{
+    g_autofree char *path = NULL;
+    g_autofree char *out = NULL;
+    QTestState *qts;
+    int fd;
+
+    fd = g_file_open_tmp("iobc-log-test-XXXXXX.log", &path, NULL);
+    g_assert(fd >= 0);
+    close(fd);
+
+    qts = log_start(path, "abort");
+
+    g_assert_cmphex(qtest_readl(qts, LOG_ADDR), ==, 0);
+
+    // the unterminated line is continued by the next message
+    log_write(qts, "boot\nfirst ");
+    g_assert_cmphex(qtest_readl(qts, LOG_ADDR), ==, ADDR_SRAM0);
+
+    qtest_clock_step(qts, 1500 * 1000 * 1000);
+    log_write(qts, "line\nsecond\n");
+
+    out = log_finish(qts, path);
+    g_assert_cmpstr(out, ==,
+                    "[     0.000000] boot\n"
+                    "[     0.000000] first line\n"
+                    "[     1.500000] second\n");
+}
+
+static void test_too_long(void)
+{
+    g_autofree char *path = NULL;
+    g_autofree char *out = NULL;
+    QTestState *qts;
+    QDict *event, *data;
+    int fd;
+
+    fd = g_file_open_tmp("iobc-log-test-XXXXXX.log", &path, NULL);
+    g_assert(fd >= 0);
+    close(fd);
+
+    qts = log_start(path, "log");
+
+    qtest_writel(qts, LOG_ADDR, ADDR_SRAM0);
+    qtest_writel(qts, LOG_LEN, 0x10001);
+
+    event = qtest_qmp_eventwait_ref(qts, "IOBC_FAULT");
+    data = qdict_get_qdict(event, "data");
+    g_assert_cmpstr(qdict_get_str(data, "source"), ==, "iobc.log");
+    g_assert_cmphex(qdict_get_int(data, "address"), ==, LOG_LEN);
+    g_assert_true(qdict_get_bool(data, "write"));
+    qobject_unref(event);
+
+    // nothing is output for the rejected message, later ones are fine
+    log_write(qts, "ok\n");
+
+    out = log_finish(qts, path);
+    g_assert_cmpstr(out, ==, "[     0.000000] ok\n");
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/iobc/log/output", test_output);
+    qtest_add_func("/iobc/log/too-long", test_too_long);
+
+    return g_test_run();
+}
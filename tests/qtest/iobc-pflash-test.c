@@ -0,0 +1,175 @@
+/*
+ * QTest testcase for the CFI NOR program flash of the ISIS iOBC.
+ *
+ * Runs the isis-obc machine with pflash-cfi=on and without backing drive.
+ * Commands are issued in 16 bit word mode, unlock addresses are word
+ * addresses. Progress of erase and program operations is observed via the
+ * DQ6 toggle bit.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+#include "qapi/qmp/qdict.h"
+#include "qapi/qmp/qlist.h"
+
+#define PFLASH_BASE         0x10000000
+#define PFLASH_SIZE         0x100000
+
+#define PFLASH_UNLOCK0      (PFLASH_BASE + 0x555 * 2)
+#define PFLASH_UNLOCK1      (PFLASH_BASE + 0x2AA * 2)
+
+// sector 1: second sector of the bottom boot block
+#define SECTOR1_ADDR        (PFLASH_BASE + 0x4000)
+
+#define STATUS_DQ6          0x40
+
+// typical word program time (CFI address 0x1F), in ns
+#define PROGRAM_TIME_NS     (128 * 1000)
+
+
+static void pflash_unlock(QTestState *qts)
+{
+    qtest_writew(qts, PFLASH_UNLOCK0, 0xAA);
+    qtest_writew(qts, PFLASH_UNLOCK1, 0x55);
+}
+
+static void pflash_sector_erase(QTestState *qts, uint64_t addr)
+{
+    pflash_unlock(qts);
+    qtest_writew(qts, PFLASH_UNLOCK0, 0x80);
+    pflash_unlock(qts);
+    qtest_writew(qts, addr, 0x30);
+}
+
+static void pflash_program(QTestState *qts, uint64_t addr, uint16_t value)
+{
+    pflash_unlock(qts);
+    qtest_writew(qts, PFLASH_UNLOCK0, 0xA0);
+    qtest_writew(qts, addr, value);
+}
+
+static bool pflash_busy(QTestState *qts, uint64_t addr)
+{
+    uint16_t a = qtest_readw(qts, addr);
+    uint16_t b = qtest_readw(qts, addr);
+
+    return (a ^ b) & STATUS_DQ6;
+}
+
+static void pflash_wait(QTestState *qts, uint64_t addr)
+{
+    while (pflash_busy(qts, addr)) {
+        qtest_clock_step(qts, 50 * 1000);
+    }
+}
+
+static QDict *pflash_query(QTestState *qts, bool reset)
+{
+    QDict *resp, *ret;
+
+    resp = qtest_qmp(qts, "{'execute': 'query-iobc-pflash',"
+                          " 'arguments': {'reset': %i}}", reset);
+    g_assert(qdict_haskey(resp, "return"));
+
+    ret = qdict_get_qdict(resp, "return");
+    qobject_ref(ret);
+    qobject_unref(resp);
+
+    return ret;
+}
+
+static QDict *pflash_query_sector(QDict *info, int64_t sector)
+{
+    QListEntry *e;
+
+    QLIST_FOREACH_ENTRY(qdict_get_qlist(info, "sectors"), e) {
+        QDict *sec = qobject_to(QDict, qlist_entry_obj(e));
+
+        if (qdict_get_int(sec, "sector") == sector) {
+            return sec;
+        }
+    }
+
+    g_assert_not_reached();
+}
+
+static void test_erase_program(void)
+{
+    QTestState *qts = qtest_init("-M isis-obc,pflash-cfi=on");
+    QDict *info, *sec;
+
+    pflash_sector_erase(qts, SECTOR1_ADDR);
+    pflash_wait(qts, SECTOR1_ADDR);
+    g_assert_cmphex(qtest_readw(qts, SECTOR1_ADDR), ==, 0xFFFF);
+    g_assert_cmphex(qtest_readw(qts, SECTOR1_ADDR + 0x1FFE), ==, 0xFFFF);
+
+    // neighboring sectors are not affected
+    g_assert_cmphex(qtest_readw(qts, SECTOR1_ADDR - 2), ==, 0x0000);
+    g_assert_cmphex(qtest_readw(qts, SECTOR1_ADDR + 0x2000), ==, 0x0000);
+
+    pflash_program(qts, SECTOR1_ADDR, 0x1234);
+    g_assert_cmphex(qtest_readw(qts, SECTOR1_ADDR), ==, 0x1234);
+
+    // programming can only clear bits
+    pflash_program(qts, SECTOR1_ADDR, 0xFF0F);
+    g_assert_cmphex(qtest_readw(qts, SECTOR1_ADDR), ==, 0x1204);
+
+    // the flash is mirrored across the chip select window
+    g_assert_cmphex(qtest_readw(qts, SECTOR1_ADDR + PFLASH_SIZE), ==, 0x1204);
+
+    info = pflash_query(qts, true);
+    g_assert_cmpint(qlist_size(qdict_get_qlist(info, "sectors")), ==, 19);
+    g_assert_cmpint(qdict_get_int(info, "erases"), ==, 1);
+    g_assert_cmpint(qdict_get_int(info, "programs"), ==, 2);
+
+    sec = pflash_query_sector(info, 1);
+    g_assert_cmphex(qdict_get_int(sec, "offset"), ==, 0x4000);
+    g_assert_cmphex(qdict_get_int(sec, "size"), ==, 0x2000);
+    g_assert_cmpint(qdict_get_int(sec, "erases"), ==, 1);
+    g_assert_cmpint(qdict_get_int(sec, "programs"), ==, 2);
+    qobject_unref(info);
+
+    info = pflash_query(qts, false);
+    g_assert_cmpint(qdict_get_int(info, "erases"), ==, 0);
+    g_assert_cmpint(qdict_get_int(info, "programs"), ==, 0);
+    qobject_unref(info);
+
+    qtest_quit(qts);
+}
+
+static void test_program_timing(void)
+{
+    QTestState *qts = qtest_init("-M isis-obc,pflash-cfi=on,pflash-timing=on");
+
+    pflash_sector_erase(qts, SECTOR1_ADDR);
+    g_assert_true(pflash_busy(qts, SECTOR1_ADDR));
+    pflash_wait(qts, SECTOR1_ADDR);
+    g_assert_cmphex(qtest_readw(qts, SECTOR1_ADDR), ==, 0xFFFF);
+
+    pflash_program(qts, SECTOR1_ADDR, 0x1234);
+    g_assert_true(pflash_busy(qts, SECTOR1_ADDR));
+
+    qtest_clock_step(qts, PROGRAM_TIME_NS - 1);
+    g_assert_true(pflash_busy(qts, SECTOR1_ADDR));
+
+    qtest_clock_step(qts, 1);
+    g_assert_false(pflash_busy(qts, SECTOR1_ADDR));
+    g_assert_cmphex(qtest_readw(qts, SECTOR1_ADDR), ==, 0x1234);
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/iobc/pflash/erase-program", test_erase_program);
+    qtest_add_func("/iobc/pflash/program-timing", test_program_timing);
+
+    return g_test_run();
+}
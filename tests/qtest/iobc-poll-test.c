@@ -0,0 +1,133 @@
+/*
+ * QTest testcase for the polling loop skip of the ISIS iOBC.
+ *
+ * Runs a small program from the NOR flash (mapped at the boot memory) which
+ * starts a TWI transfer at 1 Hz and polls the status register until the
+ * transfer completes. The transfer takes about two seconds of virtual time,
+ * which should be skipped instead of waited for. The program stores the
+ * number of polling iterations to SRAM0 and sets a flag once done.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+#include "qapi/qmp/qdict.h"
+#include "qapi/qmp/qlist.h"
+
+#define ADDR_PFLASH         0x10000000
+#define ADDR_SRAM0          0x00200000
+#define ADDR_TWI            0xFFFAC000
+
+#define RESULT_DONE         (ADDR_SRAM0 + 0x00)
+#define RESULT_ITERATIONS   (ADDR_SRAM0 + 0x04)
+
+#define TWI_SR              (ADDR_TWI + 0x20)
+
+#define POLL_TIMEOUT_US     (5 * G_USEC_PER_SEC)
+
+
+static const uint32_t program[] = {
+    0xEA000006,     // 0x00: b      0x20                reset
+    0xEAFFFFFE,     // 0x04: b      .                   undefined
+    0xEAFFFFFE,     // 0x08: b      .                   swi
+    0xEAFFFFFE,     // 0x0C: b      .                   prefetch abort
+    0xEAFFFFFE,     // 0x10: b      .                   data abort
+    0xEAFFFFFE,     // 0x14: b      .
+    0xEAFFFFFE,     // 0x18: b      .                   irq
+    0xEAFFFFFE,     // 0x1C: b      .                   fiq
+    0xE59F003C,     // 0x20: ldr    r0, [pc, #0x3C]     TWI
+    0xE3A01004,     // 0x24: mov    r1, #4
+    0xE5801000,     // 0x28: str    r1, [r0]            CR = MSEN
+    0xE59F1034,     // 0x2C: ldr    r1, [pc, #0x34]
+    0xE5801010,     // 0x30: str    r1, [r0, #0x10]     CWGR, 1 Hz at 32768 Hz MCK
+    0xE3A01055,     // 0x34: mov    r1, #0x55
+    0xE5801034,     // 0x38: str    r1, [r0, #0x34]     THR
+    0xE3A02000,     // 0x3C: mov    r2, #0
+    0xE2822001,     // 0x40: add    r2, r2, #1
+    0xE5901020,     // 0x44: ldr    r1, [r0, #0x20]     SR
+    0xE3110001,     // 0x48: tst    r1, #1              TXCOMP
+    0x0AFFFFFB,     // 0x4C: beq    0x40
+    0xE3A04602,     // 0x50: mov    r4, #0x00200000
+    0xE5842004,     // 0x54: str    r2, [r4, #4]
+    0xE3A01001,     // 0x58: mov    r1, #1
+    0xE5841000,     // 0x5C: str    r1, [r4]
+    0xEAFFFFFE,     // 0x60: b      .
+    0xFFFAC000,     // 0x64:
+    0x0006FFFF,     // 0x68:
+};
+
+
+static QTestState *poll_run(void)
+{
+    int64_t end = g_get_monotonic_time() + POLL_TIMEOUT_US;
+    QTestState *qts;
+    QDict *rsp;
+    int i;
+
+    qts = qtest_init("-M isis-obc,poll-skip=on -accel tcg -S");
+
+    for (i = 0; i < ARRAY_SIZE(program); i++) {
+        qtest_writel(qts, ADDR_PFLASH + i * 4, program[i]);
+    }
+
+    rsp = qtest_qmp(qts, "{ 'execute': 'cont' }");
+    g_assert(!qdict_haskey(rsp, "error"));
+    qobject_unref(rsp);
+
+    while (!qtest_readl(qts, RESULT_DONE)) {
+        g_assert_cmpint(g_get_monotonic_time(), <, end);
+        g_usleep(1000);
+    }
+
+    return qts;
+}
+
+static QDict *poll_stats(QDict *rsp, uint64_t addr)
+{
+    const QListEntry *entry;
+
+    QLIST_FOREACH_ENTRY(qdict_get_qlist(rsp, "return"), entry) {
+        QDict *stats = qobject_to(QDict, qlist_entry_obj(entry));
+
+        if (qdict_get_int(stats, "address") == addr) {
+            return stats;
+        }
+    }
+
+    g_assert_not_reached();
+}
+
+static void test_skip(void)
+{
+    QTestState *qts = poll_run();
+    QDict *rsp, *stats;
+
+    // the loop keeps polling until the skip threshold of eight reads is reached
+    g_assert_cmpuint(qtest_readl(qts, RESULT_ITERATIONS), >, 8);
+
+    rsp = qtest_qmp(qts, "{ 'execute': 'query-iobc-polls' }");
+    stats = poll_stats(rsp, TWI_SR);
+
+    g_assert_cmpstr(qdict_get_str(stats, "source"), ==, "at91.twi");
+    g_assert_cmpstr(qdict_get_str(stats, "name"), ==, "SR");
+    g_assert_cmpint(qdict_get_int(stats, "skips"), >=, 1);
+
+    // the transfer takes two ticks of the 1 Hz TWI clock
+    g_assert_cmpint(qdict_get_int(stats, "skipped-ns"), >, NANOSECONDS_PER_SECOND);
+
+    qobject_unref(rsp);
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/iobc/poll/skip", test_skip);
+
+    return g_test_run();
+}
@@ -0,0 +1,173 @@
+/*
+ * QTest testcase for the soft-float routine intercept on the ISIS iOBC.
+ *
+ * Runs a small program from the NOR flash (mapped at the boot memory) which
+ * calls stand-ins for __aeabi_dadd, __aeabi_d2iz and __aeabi_i2d. The
+ * stand-ins return all ones in r0 and r1, so results computed by the
+ * intercept can be told apart from results of the guest routines. This
+ * covers the mapping of 64 bit arguments to r0/r1 and r2/r3 and of results
+ * to r0 (and r1). The program stores the results to SRAM0 and sets a flag
+ * once done.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+#include "qapi/qmp/qdict.h"
+
+#define ADDR_PFLASH         0x10000000
+#define ADDR_SRAM0          0x00200000
+
+#define RESULT_DADD_LO      (ADDR_SRAM0 + 0x00)
+#define RESULT_DADD_HI      (ADDR_SRAM0 + 0x04)
+#define RESULT_D2IZ         (ADDR_SRAM0 + 0x08)
+#define RESULT_I2D_LO       (ADDR_SRAM0 + 0x0C)
+#define RESULT_I2D_HI       (ADDR_SRAM0 + 0x10)
+#define RESULT_DONE         (ADDR_SRAM0 + 0x14)
+
+#define SOFTFLOAT_FUNCS     "__aeabi_dadd=0x7C:__aeabi_d2iz=0x88:__aeabi_i2d=0x94"
+
+#define POLL_TIMEOUT_US     (5 * G_USEC_PER_SEC)
+
+
+static const uint32_t program[] = {
+    0xEA000006,     // 0x00: b      0x20                reset
+    0xEAFFFFFE,     // 0x04: b      .                   undefined
+    0xEAFFFFFE,     // 0x08: b      .                   swi
+    0xEAFFFFFE,     // 0x0C: b      .                   prefetch abort
+    0xEAFFFFFE,     // 0x10: b      .                   data abort
+    0xEAFFFFFE,     // 0x14: b      .
+    0xEAFFFFFE,     // 0x18: b      .                   irq
+    0xEAFFFFFE,     // 0x1C: b      .                   fiq
+    0xE3A04602,     // 0x20: mov    r4, #0x00200000
+    0xE284DA01,     // 0x24: add    sp, r4, #0x1000
+    0xE59F0070,     // 0x28: ldr    r0, [pc, #0x70]     1.5 + 2^-40
+    0xE59F1070,     // 0x2C: ldr    r1, [pc, #0x70]
+    0xE59F2070,     // 0x30: ldr    r2, [pc, #0x70]     2.25
+    0xE59F3070,     // 0x34: ldr    r3, [pc, #0x70]
+    0xE1A0E00F,     // 0x38: mov    lr, pc
+    0xEA00000E,     // 0x3C: b      0x7C                __aeabi_dadd
+    0xE5840000,     // 0x40: str    r0, [r4]
+    0xE5841004,     // 0x44: str    r1, [r4, #4]
+    0xE59F0060,     // 0x48: ldr    r0, [pc, #0x60]     -7.75
+    0xE59F1060,     // 0x4C: ldr    r1, [pc, #0x60]
+    0xE1A0E00F,     // 0x50: mov    lr, pc
+    0xEA00000B,     // 0x54: b      0x88                __aeabi_d2iz
+    0xE5840008,     // 0x58: str    r0, [r4, #8]
+    0xE3E00004,     // 0x5C: mvn    r0, #4              -5
+    0xE1A0E00F,     // 0x60: mov    lr, pc
+    0xEA00000A,     // 0x64: b      0x94                __aeabi_i2d
+    0xE584000C,     // 0x68: str    r0, [r4, #12]
+    0xE5841010,     // 0x6C: str    r1, [r4, #16]
+    0xE3A00001,     // 0x70: mov    r0, #1
+    0xE5840014,     // 0x74: str    r0, [r4, #20]
+    0xEAFFFFFE,     // 0x78: b      .
+    0xE3E00000,     // 0x7C: mvn    r0, #0              __aeabi_dadd
+    0xE3E01000,     // 0x80: mvn    r1, #0
+    0xE12FFF1E,     // 0x84: bx     lr
+    0xE3E00000,     // 0x88: mvn    r0, #0              __aeabi_d2iz
+    0xE3E01000,     // 0x8C: mvn    r1, #0
+    0xE12FFF1E,     // 0x90: bx     lr
+    0xE3E00000,     // 0x94: mvn    r0, #0              __aeabi_i2d
+    0xE3E01000,     // 0x98: mvn    r1, #0
+    0xE12FFF1E,     // 0x9C: bx     lr
+    0x00001000,     // 0xA0:
+    0x3FF80000,     // 0xA4:
+    0x00000000,     // 0xA8:
+    0x40020000,     // 0xAC:
+    0x00000000,     // 0xB0:
+    0xC01F0000,     // 0xB4:
+};
+
+
+static QTestState *softfloat_run(const char *mode)
+{
+    int64_t end = g_get_monotonic_time() + POLL_TIMEOUT_US;
+    QTestState *qts;
+    QDict *rsp;
+    int i;
+
+    qts = qtest_initf("-M isis-obc,softfloat-intercept=%s,softfloat-funcs=" SOFTFLOAT_FUNCS
+                      " -accel tcg -S", mode);
+
+    for (i = 0; i < ARRAY_SIZE(program); i++) {
+        qtest_writel(qts, ADDR_PFLASH + i * 4, program[i]);
+    }
+
+    rsp = qtest_qmp(qts, "{ 'execute': 'cont' }");
+    g_assert(!qdict_haskey(rsp, "error"));
+    qobject_unref(rsp);
+
+    while (!qtest_readl(qts, RESULT_DONE)) {
+        g_assert_cmpint(g_get_monotonic_time(), <, end);
+        g_usleep(1000);
+    }
+
+    return qts;
+}
+
+static void test_intercept(void)
+{
+    QTestState *qts = softfloat_run("on");
+
+    // 1.5 + 2^-40 + 2.25 = 3.75 + 2^-40
+    g_assert_cmphex(qtest_readl(qts, RESULT_DADD_LO), ==, 0x00000800);
+    g_assert_cmphex(qtest_readl(qts, RESULT_DADD_HI), ==, 0x400E0000);
+    g_assert_cmphex(qtest_readl(qts, RESULT_D2IZ), ==, (uint32_t)-7);
+    g_assert_cmphex(qtest_readl(qts, RESULT_I2D_LO), ==, 0x00000000);
+    g_assert_cmphex(qtest_readl(qts, RESULT_I2D_HI), ==, 0xC0140000);
+
+    qtest_quit(qts);
+}
+
+static void test_off(void)
+{
+    QTestState *qts = softfloat_run("off");
+
+    g_assert_cmphex(qtest_readl(qts, RESULT_DADD_LO), ==, 0xFFFFFFFF);
+    g_assert_cmphex(qtest_readl(qts, RESULT_DADD_HI), ==, 0xFFFFFFFF);
+    g_assert_cmphex(qtest_readl(qts, RESULT_D2IZ), ==, 0xFFFFFFFF);
+    g_assert_cmphex(qtest_readl(qts, RESULT_I2D_LO), ==, 0xFFFFFFFF);
+
+    qtest_quit(qts);
+}
+
+static void test_verify(void)
+{
+    if (g_test_subprocess()) {
+        QTestState *qts = softfloat_run("verify");
+
+        // the guest routines are executed and return to the call site
+        g_assert_cmphex(qtest_readl(qts, RESULT_DADD_LO), ==, 0xFFFFFFFF);
+        g_assert_cmphex(qtest_readl(qts, RESULT_D2IZ), ==, 0xFFFFFFFF);
+        g_assert_cmphex(qtest_readl(qts, RESULT_I2D_HI), ==, 0xFFFFFFFF);
+
+        qtest_quit(qts);
+        return;
+    }
+
+    g_test_trap_subprocess(NULL, 0, 0);
+    g_test_trap_assert_passed();
+    g_test_trap_assert_stderr("*soft-float mismatch: __aeabi_dadd(0x00001000, 0x3ff80000, "
+                              "0x00000000, 0x40020000) returned 0xffffffffffffffff, "
+                              "intercept computed 0x400e000000000800*"
+                              "soft-float mismatch: __aeabi_d2iz(0x00000000, 0xc01f0000, "
+                              "0x00000000, 0x40020000) returned 0xffffffff, "
+                              "intercept computed 0xfffffff9*"
+                              "verified 3 soft-float calls, 3 mismatches*");
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/iobc/softfloat/intercept", test_intercept);
+    qtest_add_func("/iobc/softfloat/off", test_off);
+    qtest_add_func("/iobc/softfloat/verify", test_verify);
+
+    return g_test_run();
+}
@@ -0,0 +1,152 @@
+/*
+ * QTest testcase for the virtual time scale of the ISIS iOBC.
+ *
+ * Runs an endless loop from the NOR flash (mapped at the boot memory) with
+ * the PIT and RTT enabled, changes the time scale via QMP and reads the
+ * counters of both timers. The counters have to be monotonic, continuous
+ * across changes and advance at the requested rate.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+#include "qapi/qmp/qdict.h"
+
+#define ADDR_PFLASH         0x10000000
+#define ADDR_RTT            0xFFFFFD20
+#define ADDR_PIT            0xFFFFFD30
+
+#define RTT_MR              (ADDR_RTT + 0x00)
+#define RTT_VR              (ADDR_RTT + 0x08)
+#define PIT_MR              (ADDR_PIT + 0x00)
+#define PIT_PIIR            (ADDR_PIT + 0x0C)
+
+// 32 Hz from the 32768 Hz slow clock
+#define RTT_MR_VALUE        (BIT(18) | 0x400)
+
+// MCK/16 = 2048 Hz after reset, with a period of 2^20 ticks PIIR counts
+// linearly (PICNT and CPIV)
+#define PIT_MR_VALUE        (BIT(24) | 0xFFFFF)
+#define PIT_HZ              2048
+
+#define PHASE_US            (300 * 1000)
+#define SAMPLE_US           (10 * 1000)
+
+
+typedef struct Sample {
+    int64_t before;
+    int64_t after;
+    uint32_t pit;
+    uint32_t rtt;
+} Sample;
+
+static void scale_sample(QTestState *qts, Sample *s)
+{
+    s->before = g_get_monotonic_time();
+    s->pit = qtest_readl(qts, PIT_PIIR);
+    s->rtt = qtest_readl(qts, RTT_VR);
+    s->after = g_get_monotonic_time();
+}
+
+static void scale_set(QTestState *qts, double ratio)
+{
+    QDict *rsp;
+
+    rsp = qtest_qmp(qts, "{ 'execute': 'iobc-set-time-scale',"
+                         "  'arguments': { 'ratio': %f } }", ratio);
+    g_assert(!qdict_haskey(rsp, "error"));
+    qobject_unref(rsp);
+}
+
+static void scale_check_rate(const Sample *a, const Sample *b, double ratio)
+{
+    // the counters are read somewhere in between the host time stamps
+    double min = (b->before - a->after) * ratio * PIT_HZ / G_USEC_PER_SEC;
+    double max = (b->after - a->before) * ratio * PIT_HZ / G_USEC_PER_SEC;
+
+    g_assert_cmpfloat(b->pit - a->pit, >=, min - 2);
+    g_assert_cmpfloat(b->pit - a->pit, <=, max + 2);
+}
+
+// sample the counters for one phase, return the last sample in s
+static void scale_run_phase(QTestState *qts, Sample *s, double ratio)
+{
+    int64_t end = g_get_monotonic_time() + PHASE_US;
+    Sample first = *s;
+    Sample next;
+
+    while (g_get_monotonic_time() < end) {
+        g_usleep(SAMPLE_US);
+        scale_sample(qts, &next);
+
+        g_assert_cmpuint(next.pit, >=, s->pit);
+        g_assert_cmpuint(next.rtt, >=, s->rtt);
+
+        *s = next;
+    }
+
+    scale_check_rate(&first, s, ratio);
+}
+
+static void test_scale(void)
+{
+    static const double ratios[] = { 10.0, 0.1, 1.0, 20.0 };
+    QTestState *qts;
+    QDict *rsp, *ret;
+    Sample s, prev;
+    int i;
+
+    qts = qtest_init("-M isis-obc -accel tcg -S");
+
+    qtest_writel(qts, ADDR_PFLASH, 0xEAFFFFFE);     // b .
+    qtest_writel(qts, RTT_MR, RTT_MR_VALUE);
+    qtest_writel(qts, PIT_MR, PIT_MR_VALUE);
+
+    rsp = qtest_qmp(qts, "{ 'execute': 'cont' }");
+    g_assert(!qdict_haskey(rsp, "error"));
+    qobject_unref(rsp);
+
+    scale_sample(qts, &s);
+    scale_run_phase(qts, &s, 1.0);
+
+    for (i = 0; i < ARRAY_SIZE(ratios); i++) {
+        prev = s;
+        scale_set(qts, ratios[i]);
+        scale_sample(qts, &s);
+
+        // no jump across the change: at most the larger rate applies
+        g_assert_cmpuint(s.pit, >=, prev.pit);
+        g_assert_cmpuint(s.rtt, >=, prev.rtt);
+        g_assert_cmpfloat(s.pit - prev.pit, <=,
+                          (s.after - prev.before) * MAX(ratios[i], i ? ratios[i - 1] : 1.0)
+                          * PIT_HZ / G_USEC_PER_SEC + 2);
+
+        scale_run_phase(qts, &s, ratios[i]);
+    }
+
+    rsp = qtest_qmp(qts, "{ 'execute': 'query-iobc-time-scale' }");
+    ret = qdict_get_qdict(rsp, "return");
+    g_assert_cmpfloat(qdict_get_double(ret, "ratio"), ==, 20.0);
+    g_assert_false(qdict_get_bool(ret, "unbounded"));
+    qobject_unref(rsp);
+
+    rsp = qtest_qmp(qts, "{ 'execute': 'iobc-set-time-scale',"
+                         "  'arguments': { 'ratio': 0 } }");
+    g_assert(qdict_haskey(rsp, "error"));
+    qobject_unref(rsp);
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/iobc/time-scale/counters", test_scale);
+
+    return g_test_run();
+}
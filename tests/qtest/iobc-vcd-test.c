@@ -0,0 +1,91 @@
+/*
+ * QTest testcase for the value change dump (VCD) recording of the ISIS iOBC
+ * PIO controllers.
+ *
+ * Toggles an output pin of PIOA at known virtual times and checks the header
+ * and the time stamps of the resulting dump, which is written when QEMU
+ * exits.
+ *
+ * Copyright (c) 2019-2020 KSat e.V. Stuttgart
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or, at your
+ * option, any later version. See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+
+#define PIOA_BASE           0xFFFFF400
+
+#define PIO_PER             (PIOA_BASE + 0x00)
+#define PIO_OER             (PIOA_BASE + 0x10)
+#define PIO_SODR            (PIOA_BASE + 0x30)
+#define PIO_CODR            (PIOA_BASE + 0x34)
+
+#define PIN                 BIT(31)
+
+
+static void test_pio_toggle(void)
+{
+    g_autofree char *path = NULL;
+    g_autofree char *vcd = NULL;
+    g_autofree char *rise = NULL;
+    g_autofree char *fall = NULL;
+    const char *header, *p_rise, *p_fall;
+    int64_t t_rise, t_fall;
+    QTestState *qts;
+    int fd;
+
+    fd = g_file_open_tmp("iobc-vcd-test-XXXXXX.vcd", &path, NULL);
+    g_assert(fd >= 0);
+    close(fd);
+
+    // record only PA31, which gets the first identifier ('!')
+    qts = qtest_initf("-M isis-obc,vcd=%s,vcd-pioa=0x80000000,vcd-piob=0,vcd-pioc=0",
+                      path);
+
+    qtest_writel(qts, PIO_PER, PIN);
+    qtest_writel(qts, PIO_OER, PIN);
+    qtest_writel(qts, PIO_CODR, PIN);
+
+    t_rise = qtest_clock_step(qts, 1000);
+    qtest_writel(qts, PIO_SODR, PIN);
+
+    t_fall = qtest_clock_step(qts, 2500);
+    qtest_writel(qts, PIO_CODR, PIN);
+
+    qtest_quit(qts);
+
+    g_assert(g_file_get_contents(path, &vcd, NULL, NULL));
+    unlink(path);
+
+    header = strstr(vcd, "$enddefinitions $end\n");
+    g_assert_nonnull(header);
+    g_assert_nonnull(strstr(vcd, "$timescale 1ns $end\n"));
+    g_assert_nonnull(strstr(vcd, "$scope module pioa $end\n"));
+    g_assert_nonnull(strstr(vcd, "$var wire 1 ! p31 $end\n"));
+    g_assert_null(strstr(vcd, "$scope module piob $end\n"));
+
+    // the rising edge may coincide with the initial values of the header
+    rise = g_strdup_printf("#%" PRId64 "\n", t_rise);
+    p_rise = strstr(header, rise);
+    g_assert_nonnull(p_rise);
+    g_assert_nonnull(strstr(p_rise, "1!\n"));
+
+    fall = g_strdup_printf("#%" PRId64 "\n0!\n", t_fall);
+    p_fall = strstr(header, fall);
+    g_assert_nonnull(p_fall);
+    g_assert(p_fall > strstr(p_rise, "1!\n"));
+
+    // no further changes after the falling edge
+    g_assert_cmpstr(p_fall + strlen(fall), ==, "");
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/iobc/vcd/pio-toggle", test_pio_toggle);
+
+    return g_test_run();
+}
@@ -90,6 +90,12 @@ static bool query_is_blacklisted(const char *cmd)
         /* Success depends on target arch: */
         "query-cpu-definitions",  /* arm, i386, ppc, s390x */
         "query-gic-capabilities", /* arm */
+        /* Success depends on machine: */
+        "query-iobc-irq-stats",   /* isis-obc */
+        "query-iobc-pflash",      /* isis-obc */
+        "query-iobc-warm-start",  /* isis-obc */
+        "query-iobc-time-scale",  /* isis-obc */
+        "query-iobc-polls",       /* isis-obc */
         /* Success depends on target-specific build configuration: */
         "query-pci",              /* CONFIG_PCI */
         /* Success depends on launching SEV guest */
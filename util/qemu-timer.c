@@ -634,8 +634,13 @@ int64_t timerlistgroup_deadline_ns(QEMUTimerListGroup *tlg)
     QEMUClockType type;
     for (type = 0; type < QEMU_CLOCK_MAX; type++) {
         if (qemu_clock_use_for_deadline(type)) {
-            deadline = qemu_soonest_timeout(deadline,
-                                            timerlist_deadline_ns(tlg->tl[type]));
+            int64_t ns = timerlist_deadline_ns(tlg->tl[type]);
+
+            /* QEMU_CLOCK_VIRTUAL may run faster or slower than host time */
+            if (type == QEMU_CLOCK_VIRTUAL) {
+                ns = cpu_clock_deadline_to_host(ns);
+            }
+            deadline = qemu_soonest_timeout(deadline, ns);
         }
     }
     return deadline;